@@ -340,6 +340,8 @@ int main(int argc, char* argv[])
 				{
 					IExternalPOW::Options powOptions;
 					find_certificates(powOptions, vm[cli::STRATUM_SECRETS_PATH].as<string>(), vm[cli::STRATUM_USE_TLS].as<bool>());
+					powOptions.shareInterval_s = vm[cli::STRATUM_SHARE_INTERVAL].as<uint32_t>();
+					powOptions.verifierThreads = vm[cli::STRATUM_VERIFIER_THREADS].as<uint32_t>();
 					unsigned noncePrefixDigits = vm[cli::NONCEPREFIX_DIGITS].as<unsigned>();
 					if (noncePrefixDigits > 6) noncePrefixDigits = 6;
 					stratumServer = IExternalPOW::create(powOptions, *reactor, io::Address().port(stratumPort), noncePrefixDigits);
@@ -380,6 +382,8 @@ int main(int argc, char* argv[])
 					}
 
 					node.m_Cfg.m_VerificationThreads = vm[cli::VERIFICATION_THREADS].as<int>();
+					node.m_Cfg.m_DbReaderThreads = vm[cli::DB_READER_THREADS].as<uint32_t>();
+					node.m_Cfg.m_IoThreads = vm[cli::IO_THREADS].as<uint32_t>();
 
 					node.m_Cfg.m_LogEvents = vm[cli::LOG_UTXOS].as<bool>();
 
@@ -18,9 +18,92 @@
 namespace beam {
 namespace bvm2 {
 
+	void ContractReadCache::Delete(Entry& x)
+	{
+		assert(m_Size >= x.get_Size());
+		m_Size -= x.get_Size();
+
+		m_Keys.erase(KeySet::s_iterator_to(x.m_Key));
+		m_Mru.erase(MruList::s_iterator_to(x.m_Mru));
+		delete &x;
+	}
+
+	void ContractReadCache::ShrinkTo(size_t n)
+	{
+		while (m_Size > n)
+			Delete(m_Mru.back().get_ParentObj());
+	}
+
+	void ContractReadCache::SetTip(const Block::SystemState::ID& id)
+	{
+		if (m_Tip == id)
+			return;
+
+		// new tip or rollback
+		ShrinkTo(0);
+		m_Tip = id;
+	}
+
+	const ByteBuffer* ContractReadCache::Find(const ByteBuffer& key)
+	{
+		Entry::Key k;
+		k.m_Value = key;
+
+		KeySet::iterator it = m_Keys.find(k);
+		if (m_Keys.end() == it)
+			return nullptr;
+
+		Entry& x = it->get_ParentObj();
+
+		m_Mru.erase(MruList::s_iterator_to(x.m_Mru));
+		m_Mru.push_front(x.m_Mru);
+
+		return &x.m_Result;
+	}
+
+	void ContractReadCache::Insert(ByteBuffer&& key, ByteBuffer&& res)
+	{
+		std::unique_ptr<Entry> pEntry(new Entry);
+		pEntry->m_Key.m_Value = std::move(key);
+		pEntry->m_Result = std::move(res);
+
+		size_t nSize = pEntry->get_Size();
+		if (nSize > m_MaxSize)
+			return;
+
+		KeySet::iterator it = m_Keys.find(pEntry->m_Key);
+		if (m_Keys.end() != it)
+			Delete(it->get_ParentObj()); // was requested concurrently
+
+		ShrinkTo(m_MaxSize - nSize);
+
+		m_Keys.insert(pEntry->m_Key);
+		m_Mru.push_front(pEntry->m_Mru);
+		m_Size += nSize;
+
+		pEntry.release();
+	}
+
 	ManagerStd::ManagerStd()
 	{
 		m_pOut = &m_Out;
+		ZeroObject(m_ReadCacheTip);
+	}
+
+	ContractReadCache* ManagerStd::get_ReadCache(Block::SystemState::ID& id)
+	{
+		if (!m_pReadCache || !m_pHist || m_Context.m_pParent)
+			return nullptr; // no cache, or dependent context
+
+		Block::SystemState::Full s;
+		m_pHist->get_Tip(s);
+		if (!s.m_Height)
+			return nullptr;
+
+		s.get_ID(id);
+		m_pReadCache->SetTip(id);
+
+		return m_pReadCache.get();
 	}
 
 
@@ -61,6 +144,16 @@ namespace bvm2 {
 			pTrg = std::make_unique<beam::Merkle::Hash>(*m_Context.m_pParent);
 	}
 
+	template <typename TMsg>
+	void get_ReadCacheKey(ByteBuffer& res, const TMsg& msg, char nType)
+	{
+		Serializer ser;
+		ser
+			& nType
+			& msg;
+		ser.swap_buf(res);
+	}
+
 	struct ManagerStd::RemoteRead
 	{
 		struct Handler
@@ -70,6 +163,45 @@ namespace bvm2 {
 			ManagerStd& m_This;
 			proto::FlyClient::Request::Ptr m_pRequest;
 
+			// the results are re-serialized as a single chunk, to be replayed from the cache
+			struct CacheFill
+			{
+				ByteBuffer m_Key;
+				Block::SystemState::ID m_Tip;
+				Serializer m_Ser;
+			};
+
+			std::unique_ptr<CacheFill> m_pCacheFill;
+
+			void CacheWrite(const Blob& key, const Blob& val)
+			{
+				auto& ser = m_pCacheFill->m_Ser;
+				ser
+					& key.n
+					& val.n;
+
+				ser.WriteRaw(key.p, key.n);
+				ser.WriteRaw(val.p, val.n);
+			}
+
+			void CacheCommit()
+			{
+				if (!m_pCacheFill)
+					return;
+
+				auto& x = *m_pCacheFill;
+				Block::SystemState::ID id;
+				auto* pCache = m_This.get_ReadCache(id);
+				if (pCache && (id == x.m_Tip))
+				{
+					ByteBuffer res;
+					x.m_Ser.swap_buf(res);
+					pCache->Insert(std::move(x.m_Key), std::move(res));
+				}
+
+				m_pCacheFill.reset();
+			}
+
 			Handler(ManagerStd& x)
 				:m_This(x)
 			{
@@ -108,6 +240,34 @@ namespace bvm2 {
 			}
 		};
 
+		// on miss prepares the handler to fill the cache
+		static bool ReadCached(Handler& h, ByteBuffer& res, char nType)
+		{
+			Block::SystemState::ID id;
+			auto* pCache = h.m_This.get_ReadCache(id);
+			if (!pCache)
+				return false;
+
+			ByteBuffer key;
+			if ('V' == nType)
+				get_ReadCacheKey(key, Cast::Up<proto::FlyClient::RequestContractVars>(*h.m_pRequest).m_Msg, nType);
+			else
+				get_ReadCacheKey(key, Cast::Up<proto::FlyClient::RequestContractLogs>(*h.m_pRequest).m_Msg, nType);
+
+			auto* pRes = pCache->Find(key);
+			if (pRes)
+			{
+				// replay as a single complete response, no need to post it
+				res = *pRes;
+				return true;
+			}
+
+			h.m_pCacheFill = std::make_unique<Handler::CacheFill>();
+			h.m_pCacheFill->m_Key = std::move(key);
+			h.m_pCacheFill->m_Tip = id;
+			return false;
+		}
+
 		struct Vars
 			:public Handler
 			,public IReadVars
@@ -128,7 +288,10 @@ namespace bvm2 {
 						return false;
 
 					if (r.m_Res.m_Result.empty())
+					{
+						CacheCommit();
 						return false;
+					}
 
 					m_Consumed = 0;
 					m_Buf = std::move(r.m_Res.m_Result);
@@ -155,6 +318,9 @@ namespace bvm2 {
 				m_LastVal.p = pBuf + m_Consumed;
 				m_Consumed += m_LastVal.n;
 
+				if (m_pCacheFill)
+					CacheWrite(m_LastKey, m_LastVal);
+
 				if ((m_Consumed == m_Buf.size()) && r.m_Res.m_bMore)
 				{
 					r.m_Res.m_bMore = false;
@@ -179,6 +345,7 @@ namespace bvm2 {
 
 			size_t m_Consumed = 0;
 			ByteBuffer m_Buf;
+			HeightPos m_PosEnc; // for the cache
 
 			virtual bool MoveNext() override
 			{
@@ -190,7 +357,10 @@ namespace bvm2 {
 					if (!CheckDone())
 						return false;
 					if (r.m_Res.m_Result.empty())
+					{
+						CacheCommit();
 						return false;
+					}
 
 					m_Consumed = 0;
 					m_Buf = std::move(r.m_Res.m_Result);
@@ -227,6 +397,24 @@ namespace bvm2 {
 				m_LastVal.p = pBuf + m_Consumed;
 				m_Consumed += m_LastVal.n;
 
+				if (m_pCacheFill)
+				{
+					// same encoding as the node uses, relative to the original lower bound
+					HeightPos dp;
+					dp.m_Height = m_LastPos.m_Height - m_PosEnc.m_Height;
+					if (dp.m_Height)
+					{
+						m_PosEnc.m_Height = m_LastPos.m_Height;
+						m_PosEnc.m_Pos = 0;
+					}
+
+					dp.m_Pos = m_LastPos.m_Pos - m_PosEnc.m_Pos;
+					m_PosEnc.m_Pos = m_LastPos.m_Pos;
+
+					m_pCacheFill->m_Ser & dp;
+					CacheWrite(m_LastKey, m_LastVal);
+				}
+
 				if ((m_Consumed == m_Buf.size()) && r.m_Res.m_bMore)
 				{
 					// ask for more
@@ -276,7 +464,9 @@ namespace bvm2 {
 
 		SetParentContext(r.m_pCtx);
 		p->m_pRequest = std::move(pReq);
-		p->Post();
+
+		if (!RemoteRead::ReadCached(*p, r.m_Res.m_Result, 'V'))
+			p->Post();
 
 		pOut = std::move(p);
 	}
@@ -301,7 +491,10 @@ namespace bvm2 {
 
 		SetParentContext(r.m_pCtx);
 		p->m_pRequest = std::move(pReq);
-		p->Post();
+		p->m_PosEnc = r.m_Msg.m_PosMin;
+
+		if (!RemoteRead::ReadCached(*p, r.m_Res.m_Result, 'L'))
+			p->Post();
 
 		pOut = std::move(p);
 	}
@@ -375,11 +568,33 @@ namespace bvm2 {
 
 	bool ManagerStd::VarGetProof(Blob& key, ByteBuffer& val, beam::Merkle::Proof& proof)
 	{
+		ByteBuffer keyCache;
+
 		if (!m_Pending.m_pSingleRequest)
 		{
 			proto::FlyClient::RequestContractVar::Ptr pReq(new proto::FlyClient::RequestContractVar);
 			key.Export(pReq->m_Msg.m_Key);
 
+			auto* pCache = get_ReadCache(m_ReadCacheTip);
+			if (pCache)
+			{
+				get_ReadCacheKey(keyCache, pReq->m_Msg, 'P');
+
+				auto* pRes = pCache->Find(keyCache);
+				if (pRes)
+				{
+					Deserializer der;
+					der.reset(*pRes);
+					der
+						& val
+						& proof;
+
+					return !proof.empty();
+				}
+			}
+			else
+				ZeroObject(m_ReadCacheTip);
+
 			PerformSingleRequest(*pReq);
 		}
 
@@ -388,6 +603,22 @@ namespace bvm2 {
 			auto pReq = GetResSingleRequest();
 			auto& r = pReq->As<proto::FlyClient::RequestContractVar>();
 
+			Block::SystemState::ID id;
+			auto* pCache = get_ReadCache(id);
+			if (pCache && (id == m_ReadCacheTip))
+			{
+				Serializer ser;
+				ser
+					& r.m_Res.m_Value
+					& r.m_Res.m_Proof;
+
+				ByteBuffer res;
+				ser.swap_buf(res);
+
+				get_ReadCacheKey(keyCache, r.m_Msg, 'P');
+				pCache->Insert(std::move(keyCache), std::move(res));
+			}
+
 			if (!r.m_Res.m_Proof.empty())
 			{
 				r.m_Res.m_Value.swap(val);
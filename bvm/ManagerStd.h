@@ -18,6 +18,56 @@
 #include "invoke_data.h"
 
 namespace beam::bvm2 {
+
+	// Results of the remote reads (contract vars/logs enumeration, var proofs) requested by the app shaders.
+	// Shared by the consequent runs, valid only for the tip at which they were requested.
+	struct ContractReadCache
+	{
+		typedef std::shared_ptr<ContractReadCache> Ptr;
+
+		struct Entry
+		{
+			struct Key
+				:public boost::intrusive::set_base_hook<>
+			{
+				ByteBuffer m_Value;
+				bool operator < (const Key& x) const { return m_Value < x.m_Value; }
+				IMPLEMENT_GET_PARENT_OBJ(Entry, m_Key)
+			} m_Key;
+
+			struct Mru
+				:public boost::intrusive::list_base_hook<>
+			{
+				IMPLEMENT_GET_PARENT_OBJ(Entry, m_Mru)
+			} m_Mru;
+
+			ByteBuffer m_Result;
+
+			size_t get_Size() const { return sizeof(Entry) + m_Key.m_Value.size() + m_Result.size(); }
+		};
+
+		typedef boost::intrusive::set<Entry::Key> KeySet;
+		typedef boost::intrusive::list<Entry::Mru> MruList;
+
+		KeySet m_Keys;
+		MruList m_Mru;
+		size_t m_Size = 0; // total size of the cached results
+		size_t m_MaxSize = 1024 * 1024 * 16;
+
+		Block::SystemState::ID m_Tip;
+
+		ContractReadCache() { ZeroObject(m_Tip); }
+		~ContractReadCache() { ShrinkTo(0); }
+
+		void Delete(Entry&);
+		void ShrinkTo(size_t);
+
+		void SetTip(const Block::SystemState::ID&); // resets the cache if the tip is different
+
+		const ByteBuffer* Find(const ByteBuffer& key); // modifies MRU if found
+		void Insert(ByteBuffer&& key, ByteBuffer&& res);
+	};
+
 	class ManagerStd
 		:public ProcessorManager
 	{
@@ -52,6 +102,9 @@ namespace beam::bvm2 {
 
 		struct RemoteRead;
 
+		Block::SystemState::ID m_ReadCacheTip; // for the pending single request
+		ContractReadCache* get_ReadCache(Block::SystemState::ID&);
+
 		void SetParentContext(std::unique_ptr<beam::Merkle::Hash>& pTrg) const;
 		void PerformSingleRequest(proto::FlyClient::Request& r);
 		proto::FlyClient::Request::Ptr GetResSingleRequest();
@@ -82,6 +135,7 @@ namespace beam::bvm2 {
 		// Params
 		proto::FlyClient::INetwork::Ptr m_pNetwork; // required for 'view' operations
 		Block::SystemState::IHistory* m_pHist = nullptr;
+		ContractReadCache::Ptr m_pReadCache; // optional, shared with other runs
 		bool m_EnforceDependent = false;
 
 		ByteBuffer m_BodyManager; // always required
@@ -165,6 +165,7 @@ namespace bvm2 {
 		ZeroObject(m_Data);
 		ZeroObject(m_LinearMem);
 		m_Instruction.m_p0 = m_Instruction.m_p1 = nullptr;
+		m_pDecoded.reset();
 
 		m_vStack.resize((nStackBytes + sizeof(Wasm::Word) - 1) / sizeof(Wasm::Word), 0);
 
@@ -244,6 +245,9 @@ namespace bvm2 {
 		assert(!(bInheritContext && m_FarCalls.m_Stack.empty()));
 		FarCalls::Frame* pPrev = bInheritContext ? &m_FarCalls.m_Stack.back() : nullptr;
 
+		if (!m_FarCalls.m_Stack.empty())
+			m_FarCalls.m_Stack.back().m_pDecoded = std::move(m_pDecoded);
+
 		auto& x = *m_FarCalls.m_Stack.Create_back();
 		x.m_Cid = cid;
 		x.m_FarRetAddr = nRetAddr;
@@ -260,6 +264,9 @@ namespace bvm2 {
 		const Header& hdr = ParseMod();
 		Wasm::Test(iMethod < ByteOrder::from_le(hdr.m_NumMethods));
 
+		if (m_pDecodedCache)
+			m_pDecoded = m_pDecodedCache->Get(cid, m_Code, m_prTable0);
+
 		if (bInheritContext)
 			x.m_Cid = pPrev->m_Cid;
 
@@ -296,11 +303,14 @@ namespace bvm2 {
 		m_Stack.m_BytesMax = x.m_StackBytesMax;
 
 		m_FarCalls.m_Stack.Delete(x);
+		m_pDecoded.reset();
 
 		if (!m_FarCalls.m_Stack.empty())
 		{
-			m_Code = m_FarCalls.m_Stack.back().m_Body;
+			auto& xPrev = m_FarCalls.m_Stack.back();
+			m_Code = xPrev.m_Body;
 			ParseMod(); // restore code/data sections
+			m_pDecoded = std::move(xPrev.m_pDecoded);
 
 			Processor::OnRet(nRetAddr);
 		}
@@ -421,6 +431,90 @@ namespace bvm2 {
 
 		m_Charge -= n;
 	}
+
+	uint32_t ProcessorContract::RunCharged()
+	{
+		// The pre-decoded ops don't discharge anything by themselves, hence the cycles can be discharged once per batch.
+		// The result is exactly the same as discharging each cycle before its instruction.
+		uint32_t nAvail = m_Charge / Limits::Cost::Cycle;
+		uint32_t nLeft = nAvail;
+
+		try {
+			RunDecoded(nLeft);
+		}
+		catch (...) {
+			DischargeUnits((nAvail - nLeft) * Limits::Cost::Cycle);
+			throw;
+		}
+
+		uint32_t nDone = nAvail - nLeft;
+		if (nDone)
+			DischargeUnits(nDone * Limits::Cost::Cycle);
+		else
+		{
+			DischargeUnits(Limits::Cost::Cycle);
+			RunOnce();
+			nDone = 1;
+		}
+
+		return nDone;
+	}
+
+	Wasm::Decoded::Ptr DecodedCache::Get(const ContractID& cid, const Blob& code, Wasm::Word nLimit)
+	{
+		Entry* pE = nullptr;
+
+		auto itC = m_Cids.find(cid);
+		if (m_Cids.end() != itC)
+		{
+			auto it = m_Shaders.find(itC->second);
+			if ((m_Shaders.end() != it) && it->second.m_p->IsSame(code))
+				pE = &it->second;
+		}
+
+		if (!pE)
+		{
+			ShaderID sid;
+			get_ShaderID(sid, code);
+
+			auto it = m_Shaders.find(sid);
+			if (m_Shaders.end() == it)
+			{
+				if (m_Shaders.size() >= m_MaxShaders)
+				{
+					// evict the least recently used
+					auto itOld = m_Shaders.begin();
+					for (auto it2 = itOld; m_Shaders.end() != ++it2; )
+						if (it2->second.m_Used < itOld->second.m_Used)
+							itOld = it2;
+
+					m_Shaders.erase(itOld);
+				}
+
+				it = m_Shaders.emplace(sid, Entry()).first;
+				auto& pD = it->second.m_p;
+				pD = std::make_shared<Wasm::Decoded>();
+				pD->Init(code, nLimit);
+			}
+
+			if (m_Cids.size() >= m_MaxShaders * 16)
+				m_Cids.clear();
+			m_Cids[cid] = sid;
+
+			pE = &it->second;
+		}
+
+		assert(pE->m_p->m_nLimit == nLimit); // derived from the same code
+		pE->m_Used = ++m_Used;
+		return pE->m_p;
+	}
+
+	void DecodedCache::Clear()
+	{
+		m_Shaders.clear();
+		m_Cids.clear();
+	}
+
 	void Processor::Compile(ByteBuffer& res, const Blob& src, Kind kind, Wasm::Compiler::DebugInfo* pDbgInfo /* = nullptr */)
 	{
 		Wasm::CheckpointTxt cp("Wasm/compile");
@@ -104,6 +104,26 @@ namespace bvm2 {
 
 	void get_AssetOwner(PeerID&, const ContractID&, const Asset::Metadata&);
 
+	// Pre-decoded contract code, keyed by the ShaderID. Not thread-safe, the decoded forms are also completed lazily during the execution.
+	struct DecodedCache
+	{
+		uint32_t m_MaxShaders = 64;
+
+		Wasm::Decoded::Ptr Get(const ContractID&, const Blob& code, Wasm::Word nLimit);
+		void Clear();
+
+	private:
+
+		struct Entry {
+			Wasm::Decoded::Ptr m_p;
+			uint64_t m_Used;
+		};
+
+		std::map<ShaderID, Entry> m_Shaders;
+		std::map<ContractID, ShaderID> m_Cids; // saves the ShaderID calculation, the code is compared anyway
+		uint64_t m_Used = 0;
+	};
+
 	class ProcessorContract;
 
 	class Processor
@@ -309,6 +329,7 @@ namespace bvm2 {
 		virtual bool IsSuspended() { return false; }
 
 		static void Compile(ByteBuffer&, const Blob&, Kind, Wasm::Compiler::DebugInfo* = nullptr);
+		static constexpr uint32_t s_CompilerVersion = 1; // must be incremented whenever the compiled code or the bindings change (invalidates cached results)
 
 	private:
 		static void ResolveBinding(Wasm::Compiler& c, uint32_t iFunction, Kind);
@@ -339,6 +360,7 @@ namespace bvm2 {
 				Wasm::Word m_StackPosMin;
 				Wasm::Word m_StackBytesMax;
 				Wasm::Word m_StackBytesRet;
+				Wasm::Decoded::Ptr m_pDecoded; // saved while the frame is suspended
 
 				DebugCallstack m_Debug;
 			};
@@ -434,6 +456,9 @@ namespace bvm2 {
 
 		uint32_t m_Charge = Limits::BlockCharge;
 
+		DecodedCache* m_pDecodedCache = nullptr; // optional, enables the pre-decoded execution
+		uint32_t RunCharged(); // runs at least 1 instruction, discharges the cycles. Returns the number of instructions
+
 		virtual void CallFar(const ContractID&, uint32_t iMethod, Wasm::Word pArgs, uint32_t nArgs, uint8_t bInheritContext); // can override to invoke host code instead of interpretator (for debugging)
 	};
 
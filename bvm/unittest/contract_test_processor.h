@@ -299,8 +299,11 @@ namespace beam::bvm2
 			return true;
 		}
 
+		DecodedCache m_DecodedCache;
+
 		ContractTestProcessor()
 		{
+			m_pDecodedCache = &m_DecodedCache; // reset it to test the regular path only
 			//m_Dbg.m_Stack = true;
 			//m_Dbg.m_Instructions = true;
 			//m_Dbg.m_ExtCall = true;
@@ -308,6 +311,20 @@ namespace beam::bvm2
 
 		uint32_t m_Cycles;
 
+		struct RunStats
+		{
+			uint32_t m_Cycles;
+			uint32_t m_Discharge;
+			bool m_Ok;
+
+			bool operator == (const RunStats& x) const {
+				// on failure the cycles of the interrupted batch are discharged, but not counted
+				return (m_Ok == x.m_Ok) && (m_Discharge == x.m_Discharge) && (!m_Ok || (m_Cycles == x.m_Cycles));
+			}
+		};
+
+		std::vector<RunStats>* m_pvRunStats = nullptr; // if set - each RunGuarded is recorded
+
 		void CallFarN(const ContractID& cid, uint32_t iMethod, void* pArgs, uint32_t nArgs, uint8_t bInheritContext)
 		{
 			m_Stack.AliasAlloc(nArgs);
@@ -319,12 +336,11 @@ namespace beam::bvm2
 			CallFar(cid, iMethod, nSp, nArgs, bInheritContext);
 
 			bool bWasm = false;
-			for (; m_FarCalls.m_Stack.size() > nFrames; m_Cycles++)
+			while (m_FarCalls.m_Stack.size() > nFrames)
 			{
 				bWasm = true;
 
-				DischargeUnits(Limits::Cost::Cycle);
-				RunOnce();
+				m_Cycles += RunCharged();
 
 #ifdef WASM_INTERPRETER_DEBUG
 				if (m_Dbg.m_pOut)
@@ -407,6 +423,14 @@ namespace beam::bvm2
 				ret = false;
 			}
 
+			if (m_pvRunStats)
+			{
+				auto& x = m_pvRunStats->emplace_back();
+				x.m_Cycles = m_Cycles;
+				x.m_Discharge = Limits::BlockCharge - m_Charge;
+				x.m_Ok = ret;
+			}
+
 			return ret;
 		}
 
@@ -21,6 +21,7 @@
 #include "../../utility/hex.h"
 #include "../bvm2.h"
 #include "../bvm2_impl.h"
+#include "../ManagerStd.h"
 
 #include "../ethash_service/ethash_utils.h"
 
@@ -2102,6 +2103,46 @@ namespace bvm2 {
 			verify_test(!RunGuarded_T(cid, args.s_iMethod, args));
 		}
 
+		{
+			// regular vs pre-decoded execution. Must be identical, including the charge (also on failure)
+			DecodedCache* pDecodedCache = m_pDecodedCache;
+			uint32_t pCharge[2];
+
+			for (uint32_t i = 0; i < 2; i++)
+			{
+				m_pDecodedCache = i ? &m_DecodedCache : nullptr;
+
+				Shaders::Dummy::InfCycle args;
+				args.m_Val = 12;
+				verify_test(!RunGuarded_T(cid, args.s_iMethod, args));
+
+				pCharge[i] = m_Charge;
+			}
+
+			verify_test(pCharge[0] == pCharge[1]);
+
+			uint32_t pCycles[2];
+			for (uint32_t i = 0; i < 2; i++)
+			{
+				m_pDecodedCache = i ? &m_DecodedCache : nullptr;
+
+				Shaders::Dummy::MathTest2 args;
+				ZeroObject(args);
+				args.m_Nom.set_Val<5>(0x7fffffff);
+				args.m_Nom.set_Val<3>(0xe3212316);
+				args.m_Denom.set_Val<3>(0x1fffffff);
+
+				verify_test(RunGuarded_T(cid, args.s_iMethod, args));
+				pCycles[i] = m_Cycles;
+				pCharge[i] = m_Charge;
+			}
+
+			verify_test(pCycles[0] == pCycles[1]);
+			verify_test(pCharge[0] == pCharge[1]);
+
+			m_pDecodedCache = pDecodedCache;
+		}
+
 		{
 			Shaders::Dummy::Hash1 args;
 
@@ -3718,10 +3759,462 @@ namespace
 			verify_test(!hvSeed.cmp(hvExpected));
 		}
 	}
+
+	void TestContractReadCache()
+	{
+		using namespace beam;
+		using namespace beam::bvm2;
+
+		typedef Block::SystemState::Full Hdr;
+
+		// emulates ManagerStd::get_ReadCache: the cache is bound to the current tip of the history
+		struct Env
+		{
+			Block::SystemState::HistoryMap m_Hist;
+			ContractReadCache m_Cache;
+
+			void AddState(Height h, uint8_t nBranch)
+			{
+				Hdr s;
+				ZeroObject(s);
+				s.m_Height = h;
+				s.m_Kernels.m_pData[0] = nBranch; // distinct branches, same heights
+
+				m_Hist.DeleteFrom(h);
+				m_Hist.AddStates(&s, 1);
+			}
+
+			ContractReadCache& get()
+			{
+				Hdr s;
+				verify_test(m_Hist.get_Tip(s));
+
+				Block::SystemState::ID id;
+				s.get_ID(id);
+				m_Cache.SetTip(id);
+				return m_Cache;
+			}
+
+			bool Find(uint8_t nKey, uint8_t nRes)
+			{
+				const ByteBuffer* pRes = get().Find(ByteBuffer(1, nKey));
+				if (!pRes)
+					return false;
+
+				verify_test(ByteBuffer(1, nRes) == *pRes);
+				return true;
+			}
+
+			void Insert(uint8_t nKey, uint8_t nRes)
+			{
+				get().Insert(ByteBuffer(1, nKey), ByteBuffer(1, nRes));
+			}
+		} env;
+
+		for (Height h = 1; h <= 10; h++)
+			env.AddState(h, 0);
+
+		// hits
+		verify_test(!env.Find(1, 11));
+		env.Insert(1, 11);
+		env.Insert(2, 12);
+		verify_test(env.Find(1, 11));
+		verify_test(env.Find(2, 12));
+		verify_test(!env.Find(3, 13));
+
+		// repeated insertion (concurrent requests) replaces the result
+		env.Insert(2, 22);
+		verify_test(env.Find(2, 22));
+
+		// size limit, the least recently used are evicted
+		size_t nEntry = env.m_Cache.m_Size / 2;
+		env.m_Cache.m_MaxSize = nEntry * 2;
+		verify_test(env.Find(1, 11)); // now 2 is the least recently used
+		env.Insert(3, 13);
+		verify_test(!env.Find(2, 22));
+		verify_test(env.Find(1, 11));
+		verify_test(env.Find(3, 13));
+		env.m_Cache.m_MaxSize = 1024 * 1024;
+
+		// new tip
+		env.AddState(11, 0);
+		verify_test(!env.Find(1, 11));
+		verify_test(!env.m_Cache.m_Size);
+
+		env.Insert(1, 111);
+		verify_test(env.Find(1, 111));
+
+		// reorg to a different branch at the same height
+		env.AddState(11, 1);
+		verify_test(!env.Find(1, 111));
+
+		env.Insert(1, 112);
+		verify_test(env.Find(1, 112));
+
+		// back to the original branch: the results obtained on the other branch must not be replayed
+		env.AddState(11, 0);
+		verify_test(!env.Find(1, 112));
+
+		env.Insert(1, 111);
+		verify_test(env.Find(1, 111));
+
+		// rollback
+		env.m_Hist.DeleteFrom(11);
+		verify_test(!env.Find(1, 111));
+		verify_test(!env.m_Cache.m_Size);
+	}
+
+	void TestManagerReadCache()
+	{
+		using namespace beam;
+		using namespace beam::bvm2;
+
+		// emulates the node: the enumeration results are split into chunks, same encoding. Requests are completed immediately
+		struct MyNetwork
+			:public proto::FlyClient::INetwork
+		{
+			std::map<ByteBuffer, ByteBuffer> m_Vars;
+
+			struct Log
+			{
+				HeightPos m_Pos;
+				ByteBuffer m_Key;
+				ByteBuffer m_Val;
+			};
+
+			std::vector<Log> m_vLogs; // sorted by pos
+
+			uint32_t m_nChunk = 3; // entries per response
+			uint32_t m_nRequests = 0;
+
+			void Connect() override {}
+			void Disconnect() override {}
+
+			static bool IsLess(const HeightPos& a, const HeightPos& b)
+			{
+				return (a.m_Height < b.m_Height) || ((a.m_Height == b.m_Height) && (a.m_Pos < b.m_Pos));
+			}
+
+			static void WriteEntry(Serializer& ser, const ByteBuffer& key, const ByteBuffer& val)
+			{
+				Blob bKey(key), bVal(val);
+
+				ser
+					& bKey.n
+					& bVal.n;
+
+				ser.WriteRaw(bKey.p, bKey.n);
+				ser.WriteRaw(bVal.p, bVal.n);
+			}
+
+			void OnRequest(proto::FlyClient::RequestContractVars& r)
+			{
+				const auto& msg = r.m_Msg;
+				Serializer ser;
+				uint32_t n = 0;
+				r.m_Res.m_bMore = false;
+
+				for (auto it = m_Vars.lower_bound(msg.m_KeyMin); (m_Vars.end() != it) && (it->first <= msg.m_KeyMax); it++)
+				{
+					if (msg.m_bSkipMin && (it->first == msg.m_KeyMin))
+						continue;
+
+					WriteEntry(ser, it->first, it->second);
+
+					if (++n == m_nChunk)
+					{
+						r.m_Res.m_bMore = true; // as the node does, even if it was the last one
+						break;
+					}
+				}
+
+				ser.swap_buf(r.m_Res.m_Result);
+			}
+
+			void OnRequest(proto::FlyClient::RequestContractLogs& r)
+			{
+				const auto& msg = r.m_Msg;
+				HeightPos posEnc = msg.m_PosMin;
+				Serializer ser;
+				uint32_t n = 0;
+				r.m_Res.m_bMore = false;
+
+				for (const auto& x : m_vLogs)
+				{
+					if (IsLess(x.m_Pos, msg.m_PosMin) || IsLess(msg.m_PosMax, x.m_Pos))
+						continue;
+					if ((!msg.m_KeyMin.empty() || !msg.m_KeyMax.empty()) && ((x.m_Key < msg.m_KeyMin) || (msg.m_KeyMax < x.m_Key)))
+						continue;
+
+					HeightPos dp;
+					dp.m_Height = x.m_Pos.m_Height - posEnc.m_Height;
+					if (dp.m_Height)
+					{
+						posEnc.m_Height = x.m_Pos.m_Height;
+						posEnc.m_Pos = 0;
+					}
+
+					dp.m_Pos = x.m_Pos.m_Pos - posEnc.m_Pos;
+					posEnc.m_Pos = x.m_Pos.m_Pos;
+
+					ser & dp;
+					WriteEntry(ser, x.m_Key, x.m_Val);
+
+					if (++n == m_nChunk)
+					{
+						r.m_Res.m_bMore = true;
+						break;
+					}
+				}
+
+				ser.swap_buf(r.m_Res.m_Result);
+			}
+
+			void OnRequest(proto::FlyClient::RequestContractVar& r)
+			{
+				auto it = m_Vars.find(r.m_Msg.m_Key);
+				if (m_Vars.end() == it)
+					return; // no proof
+
+				r.m_Res.m_Value = it->second;
+
+				// not a real proof, only should be replayed intact
+				auto& node = r.m_Res.m_Proof.emplace_back();
+				node.first = true;
+				ECC::Hash::Processor() << Blob(it->first) >> node.second;
+			}
+
+			void PostRequestInternal(proto::FlyClient::Request& r) override
+			{
+				m_nRequests++;
+
+				switch (r.get_Type())
+				{
+				case proto::FlyClient::Request::Type::ContractVars:
+					OnRequest(r.As<proto::FlyClient::RequestContractVars>());
+					break;
+
+				case proto::FlyClient::Request::Type::ContractLogs:
+					OnRequest(r.As<proto::FlyClient::RequestContractLogs>());
+					break;
+
+				case proto::FlyClient::Request::Type::ContractVar:
+					OnRequest(r.As<proto::FlyClient::RequestContractVar>());
+					break;
+
+				default:
+					verify_test(false);
+				}
+
+				r.m_pTrg->OnComplete(r);
+			}
+		};
+
+		struct MyManager
+			:public ManagerStd
+		{
+			using ManagerStd::IReadVars;
+			using ManagerStd::IReadLogs;
+			using ManagerStd::VarsEnum;
+			using ManagerStd::LogsEnum;
+			using ManagerStd::VarGetProof;
+		};
+
+		auto pNet = std::make_shared<MyNetwork>();
+		auto& net = *pNet;
+
+		for (uint8_t i = 0; i < 10; i++)
+			net.m_Vars[ByteBuffer(1 + i % 3, 0x10 + i)] = ByteBuffer(i, i); // incl. empty value
+
+		// chunk boundaries within the same height, at the height end, and an empty last chunk
+		const HeightPos pPos[] = { {5, 0}, {5, 1}, {5, 4}, {6, 2}, {6, 3}, {8, 0}, {8, 7}, {8, 8}, {8, 9}, {9, 1}, {12, 0}, {12, 3} };
+		for (uint32_t i = 0; i < _countof(pPos); i++)
+		{
+			auto& x = net.m_vLogs.emplace_back();
+			x.m_Pos = pPos[i];
+			x.m_Key.assign(2, static_cast<uint8_t>(0x20 + i % 4));
+			x.m_Val.assign(i, static_cast<uint8_t>(i));
+		}
+
+		Block::SystemState::HistoryMap hist;
+		{
+			Block::SystemState::Full s;
+			ZeroObject(s);
+			s.m_Height = 20;
+			hist.AddStates(&s, 1);
+		}
+
+		MyManager man;
+		man.m_pNetwork = pNet;
+		man.m_pHist = &hist;
+
+		auto pCache = std::make_shared<ContractReadCache>();
+
+		// serialized results
+		auto ReadVars = [&man](const ByteBuffer& kMin, const ByteBuffer& kMax)
+		{
+			MyManager::IReadVars::Ptr p;
+			man.VarsEnum(kMin, kMax, p);
+
+			Serializer ser;
+			while (p->MoveNext())
+			{
+				ByteBuffer key, val;
+				p->m_LastKey.Export(key);
+				p->m_LastVal.Export(val);
+				ser & key & val;
+			}
+
+			ByteBuffer res;
+			ser.swap_buf(res);
+			return res;
+		};
+
+		auto ReadLogs = [&man](const ByteBuffer& kMin, const ByteBuffer& kMax, const HeightPos* pPosMin, const HeightPos* pPosMax)
+		{
+			MyManager::IReadLogs::Ptr p;
+			man.LogsEnum(kMin, kMax, pPosMin, pPosMax, p);
+
+			Serializer ser;
+			while (p->MoveNext())
+			{
+				ByteBuffer key, val;
+				p->m_LastKey.Export(key);
+				p->m_LastVal.Export(val);
+				ser & p->m_LastPos & key & val;
+			}
+
+			ByteBuffer res;
+			ser.swap_buf(res);
+			return res;
+		};
+
+		// the same results: uncached, on cache miss (the network is used the same way), and replayed from the cache
+		auto Compare = [&](const auto& fn, const auto& expected, uint32_t nMinRequests)
+		{
+			man.m_pReadCache.reset();
+			pCache->ShrinkTo(0);
+
+			uint32_t n0 = net.m_nRequests;
+			verify_test(fn() == expected);
+			uint32_t nRequests = net.m_nRequests - n0;
+			verify_test(nRequests >= nMinRequests);
+
+			man.m_pReadCache = pCache;
+
+			verify_test(fn() == expected);
+			verify_test(net.m_nRequests - n0 == nRequests * 2);
+
+			verify_test(fn() == expected);
+			verify_test(net.m_nRequests - n0 == nRequests * 2);
+		};
+
+		{
+			Serializer ser;
+			for (const auto& v : net.m_Vars)
+				ser & v.first & v.second;
+
+			ByteBuffer expected;
+			ser.swap_buf(expected);
+
+			Compare([&]() { return ReadVars(ByteBuffer(), ByteBuffer(4, 0xff)); }, expected, 4);
+		}
+
+		{
+			// subrange, starts in the middle
+			ByteBuffer kMin(2, 0x11), kMax(1, 0x19);
+
+			Serializer ser;
+			for (const auto& v : net.m_Vars)
+				if ((kMin <= v.first) && (v.first <= kMax))
+					ser & v.first & v.second;
+
+			ByteBuffer expected;
+			ser.swap_buf(expected);
+
+			Compare([&]() { return ReadVars(kMin, kMax); }, expected, 3);
+		}
+
+		auto ExpectedLogs = [&net](const ByteBuffer& kMin, const ByteBuffer& kMax, const HeightPos& posMin, const HeightPos& posMax)
+		{
+			Serializer ser;
+			for (const auto& x : net.m_vLogs)
+			{
+				if (MyNetwork::IsLess(x.m_Pos, posMin) || MyNetwork::IsLess(posMax, x.m_Pos))
+					continue;
+				if ((!kMin.empty() || !kMax.empty()) && ((x.m_Key < kMin) || (kMax < x.m_Key)))
+					continue;
+
+				ser & x.m_Pos & x.m_Key & x.m_Val;
+			}
+
+			ByteBuffer res;
+			ser.swap_buf(res);
+			return res;
+		};
+
+		{
+			HeightPos posMax(MaxHeight);
+			Compare([&]() { return ReadLogs(ByteBuffer(), ByteBuffer(), nullptr, nullptr); }, ExpectedLogs(ByteBuffer(), ByteBuffer(), HeightPos(0), posMax), 5);
+		}
+
+		{
+			// the lower bound in the middle of a height
+			HeightPos posMin(5, 2), posMax(12, 0);
+			Compare([&]() { return ReadLogs(ByteBuffer(), ByteBuffer(), &posMin, &posMax); }, ExpectedLogs(ByteBuffer(), ByteBuffer(), posMin, posMax), 4);
+		}
+
+		{
+			// by keys, sparse positions
+			ByteBuffer kMin(2, 0x21), kMax(2, 0x22);
+			HeightPos posMin(5, 1), posMax(MaxHeight);
+			Compare([&]() { return ReadLogs(kMin, kMax, &posMin, nullptr); }, ExpectedLogs(kMin, kMax, posMin, posMax), 2);
+		}
+
+		auto GetProof = [&man](const ByteBuffer& key)
+		{
+			Blob bKey(key);
+			ByteBuffer val;
+			beam::Merkle::Proof proof;
+			bool bRes = man.VarGetProof(bKey, val, proof);
+
+			return std::make_tuple(bRes, val, proof);
+		};
+
+		for (const auto& v : net.m_Vars)
+		{
+			beam::Merkle::Proof proof;
+			auto& node = proof.emplace_back();
+			node.first = true;
+			ECC::Hash::Processor() << Blob(v.first) >> node.second;
+
+			Compare([&]() { return GetProof(v.first); }, std::make_tuple(true, v.second, proof), 1);
+		}
+
+		{
+			// no proof, also cached
+			Compare([&]() { return GetProof(ByteBuffer(1, 0x77)); }, std::make_tuple(false, ByteBuffer(), beam::Merkle::Proof()), 1);
+		}
+
+		// new tip: nothing is replayed
+		{
+			Block::SystemState::Full s;
+			ZeroObject(s);
+			s.m_Height = 21;
+			hist.AddStates(&s, 1);
+		}
+
+		uint32_t n0 = net.m_nRequests;
+		ReadVars(ByteBuffer(), ByteBuffer(4, 0xff));
+		verify_test(net.m_nRequests - n0 >= 4);
+	}
 }
 
-int main()
+int main(int argc, char* argv[])
 {
+	// shaders_test --benchmark: also time the whole suite via the regular and the pre-decoded interpreter paths
+	const bool bBenchmark = (argc > 1) && !strcmp(argv[1], "--benchmark");
+
 	try
 	{
 		ECC::PseudoRandomGenerator prg;
@@ -3733,6 +4226,8 @@ int main()
 		TestMergeSort();
 		TestRLP();
 		TestEthSeedForPoW();
+		TestContractReadCache();
+		TestManagerReadCache();
 
 		MyProcessor proc;
 
@@ -3808,7 +4303,59 @@ int main()
 			*/
 		}
 
-		proc.TestAll();
+		{
+			// the whole suite via the regular and the pre-decoded paths, each from the same random state.
+			// Every run must be identical, including the charge (also on failure)
+			MyProcessor procRegular;
+			procRegular.m_pDecodedCache = nullptr;
+			procRegular.m_Eth = proc.m_Eth;
+
+			MyProcessor* ppProc[] = { &procRegular, &proc };
+			std::vector<MyProcessor::RunStats> pvStats[_countof(ppProc)];
+
+			for (uint32_t i = 0; i < _countof(ppProc); i++)
+			{
+				ECC::PseudoRandomGenerator prgSuite;
+				ECC::PseudoRandomGenerator::Scope scopeSuite(&prgSuite);
+
+				ppProc[i]->m_pvRunStats = pvStats + i;
+
+				ppProc[i]->TestAll();
+
+				ppProc[i]->m_pvRunStats = nullptr;
+			}
+
+			verify_test(pvStats[0].size() == pvStats[1].size());
+			for (size_t i = 0; i < std::min(pvStats[0].size(), pvStats[1].size()); i++)
+				verify_test(pvStats[0][i] == pvStats[1][i]);
+		}
+
+		if (bBenchmark)
+		{
+			// best of several rounds, each on a fresh processor (the decoded cache starts empty)
+			const uint32_t nRounds = 5;
+			uint32_t pBest_ms[] = { static_cast<uint32_t>(-1), static_cast<uint32_t>(-1) };
+
+			for (uint32_t iRound = 0; iRound < nRounds; iRound++)
+			{
+				for (uint32_t i = 0; i < _countof(pBest_ms); i++)
+				{
+					MyProcessor procBench;
+					if (!i)
+						procBench.m_pDecodedCache = nullptr;
+					procBench.m_Eth = proc.m_Eth;
+
+					ECC::PseudoRandomGenerator prgSuite;
+					ECC::PseudoRandomGenerator::Scope scopeSuite(&prgSuite);
+
+					uint32_t t0 = GetTime_ms();
+					procBench.TestAll();
+					pBest_ms[i] = std::min(pBest_ms[i], GetTime_ms() - t0);
+				}
+			}
+
+			printf("Shaders suite, best of %u. Regular: %u ms, pre-decoded: %u ms\n", nRounds, pBest_ms[0], pBest_ms[1]);
+		}
 
 		MyManager man(proc);
 		man.InitMem();
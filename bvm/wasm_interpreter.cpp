@@ -1772,8 +1772,11 @@ namespace Wasm {
 			uint8_t nType = Type::s_Base + static_cast<uint8_t>((sizeof(Word) - 1) & (nOffset - Type::s_Base));
 			uint8_t nWords = Type::Words(nType);
 
-			nOffset /= sizeof(Word);
+			OnLocalEx(nOffset / sizeof(Word), nWords, bSet, bGet);
+		}
 
+		void OnLocalEx(uint32_t nOffset, uint32_t nWords, bool bSet, bool bGet)
+		{
 			Test((nOffset >= nWords) && (nOffset <= m_Stack.m_Pos - m_Stack.m_PosMin));
 
 			uint32_t* pSrc = m_Stack.m_pPtr + m_Stack.m_Pos;
@@ -1808,25 +1811,40 @@ namespace Wasm {
 			OnGlobalVar(iVar, bGet);
 		}
 
-		uint8_t* MemArgEx(uint32_t nSize, bool bW)
+		Word ReadMemArg()
 		{
 			auto nAlign = m_Instruction.Read<Word>();
 			Stack::TestAlignmentPower(nAlign);
 
-			auto nOffs = m_Instruction.Read<Word>();
-			nOffs += m_Stack.Pop<Word>();
+			return m_Instruction.Read<Word>(); // offset
+		}
 
+		uint8_t* MemAt(Word nOffs, uint32_t nSize, bool bW)
+		{
+			nOffs += m_Stack.Pop<Word>();
 			return get_AddrEx(nOffs, nSize, bW);
 		}
 
-		uint8_t* MemArgW(uint32_t nSize) {
-			return MemArgEx(nSize, true);
+		template <typename T, typename TMem>
+		void OnLoad(Word nOffs)
+		{
+			TMem val1 = from_wasm<typename Type::ToFlexible<TMem, false>::T>(MemAt(nOffs, sizeof(TMem), false));
+			m_Stack.Push(Type::Extend<T, TMem>(val1));
 		}
 
-		const uint8_t* MemArgR(uint32_t nSize) {
-			return MemArgEx(nSize, false);
+		template <typename T, typename TMem>
+		void OnStore(Word nOffs)
+		{
+			auto val = m_Stack.Pop<T>();
+			to_wasm(MemAt(nOffs, sizeof(TMem), true), static_cast<TMem>(val));
 		}
 
+		void OnDropEx(uint32_t nWords);
+		void OnSelectEx(uint32_t nWords);
+		void OnRetEx(uint32_t nRets, uint32_t nLocals, uint32_t nArgs);
+
+		void RunDecodedPlus(uint32_t& nCycles);
+
 		void RunOncePlus()
 		{
 			struct MyCheckpoint :public Checkpoint {
@@ -1875,20 +1893,13 @@ namespace Wasm {
 
 
 #define THE_MACRO(id, type, name, tmem) \
-			THE_CASE(type##_##name) { \
-				tmem val1 = from_wasm<Type::ToFlexible<tmem, false>::T>(MemArgR(sizeof(tmem))); \
-				auto valExt = Type::Extend<Type::Code2Type<Type::type>::T, tmem>(val1); \
-				m_Stack.Push(valExt); \
-			} break;
+			THE_CASE(type##_##name) OnLoad<Type::Code2Type<Type::type>::T, tmem>(ReadMemArg()); break;
 
 			WasmInstructions_Load(THE_MACRO)
 #undef THE_MACRO
 
 #define THE_MACRO(id, type, name, tmem) \
-			THE_CASE(type##_##name) { \
-				auto val = m_Stack.Pop<Type::Code2Type<Type::type>::T>(); \
-				to_wasm(MemArgW(sizeof(tmem)), static_cast<tmem>(val)); \
-			} break;
+			THE_CASE(type##_##name) OnStore<Type::Code2Type<Type::type>::T, tmem>(ReadMemArg()); break;
 
 			WasmInstructions_Store(THE_MACRO)
 #undef THE_MACRO
@@ -1945,7 +1956,16 @@ namespace Wasm {
 
 		Test(nOffset <= blob.n);
 		nSizeOut = blob.n - nOffset;
-		return reinterpret_cast<uint8_t*>(Cast::NotConst(blob.p)) + nOffset;
+		uint8_t* pRet = reinterpret_cast<uint8_t*>(Cast::NotConst(blob.p)) + nOffset;
+
+		if (bW && m_pDecoded && (MemoryType::Data == nMemType))
+		{
+			// theoretically the code may modify itself
+			if (static_cast<size_t>(pRet - reinterpret_cast<const uint8_t*>(m_Code.p)) < m_pDecoded->m_nLimit)
+				m_pDecoded.reset();
+		}
+
+		return pRet;
 	}
 
 	uint8_t* Processor::get_AddrEx(uint32_t nOffset, uint32_t nSize, bool bW) const
@@ -2040,14 +2060,22 @@ namespace Wasm {
 
 	void ProcessorPlus::On_drop()
 	{
-		uint32_t nWords = Type::Words(m_Instruction.Read1());
+		OnDropEx(Type::Words(m_Instruction.Read1()));
+	}
+
+	void ProcessorPlus::OnDropEx(uint32_t nWords)
+	{
 		Test(m_Stack.m_Pos - m_Stack.m_PosMin >= nWords);
 		m_Stack.m_Pos -= nWords;
 	}
 
 	void ProcessorPlus::On_select()
 	{
-		uint32_t nWords = Type::Words(m_Instruction.Read1());
+		OnSelectEx(Type::Words(m_Instruction.Read1()));
+	}
+
+	void ProcessorPlus::OnSelectEx(uint32_t nWords)
+	{
 		auto nSel = m_Stack.Pop<Word>();
 
 		Test(m_Stack.m_Pos - m_Stack.m_PosMin >= (nWords << 1)); // must be at least 2 such operands
@@ -2177,6 +2205,11 @@ namespace Wasm {
 		auto nLocals = m_Instruction.Read<uint32_t>();
 		auto nArgs = m_Instruction.Read<uint32_t>();
 
+		OnRetEx(nRets, nLocals, nArgs);
+	}
+
+	void ProcessorPlus::OnRetEx(uint32_t nRets, uint32_t nLocals, uint32_t nArgs)
+	{
 		// stack layout
 		// ...
 		// args
@@ -2262,5 +2295,655 @@ namespace Wasm {
 
 
 
+	/////////////////////////////////////////////
+	// Decoded
+
+#define WasmDecodedOps_Custom(macro) \
+	macro(fallback) \
+	macro(call_ext) \
+	macro(jmp) \
+	macro(local_get) \
+	macro(local_set) \
+	macro(local_tee) \
+	macro(global_get_imp) \
+	macro(global_set_imp) \
+	macro(drop) \
+	macro(select) \
+	macro(i32_wrap_i64) \
+	macro(i64_extend_i32_s) \
+	macro(i64_extend_i32_u) \
+	macro(br) \
+	macro(br_if) \
+	macro(br_table) \
+	macro(call) \
+	macro(call_indirect) \
+	macro(ret) \
+	macro(i32_const) \
+	macro(i64_const) \
+	macro(prolog) \
+	macro(local_get_i32_add) \
+	macro(local_get_i32_load) \
+	macro(i32_const_i32_add) \
+
+#define WasmDecodedOps_All(macro) \
+	WasmDecodedOps_Custom(macro) \
+	WasmInstructions_unop_Polymorphic_32(macro##_Poly) \
+	WasmInstructions_binop_Polymorphic_32(macro##_Poly) \
+	WasmInstructions_binop_Polymorphic_x(macro##_Poly) \
+	WasmInstructions_Load(macro##_Mem) \
+	WasmInstructions_Store(macro##_Mem) \
+
+	struct DecodedOp
+	{
+		enum Enum : uint8_t
+		{
+#define THE_MACRO(name) name,
+#define THE_MACRO_Poly(name, id32, id64) i32_##name, i64_##name,
+#define THE_MACRO_Mem(id, type, name, tmem) type##_##name,
+			WasmDecodedOps_All(THE_MACRO)
+#undef THE_MACRO_Mem
+#undef THE_MACRO_Poly
+#undef THE_MACRO
+			count
+		};
+	};
+
+	static_assert(DecodedOp::count <= 0x100);
+
+	struct DecodedPlus
+		:public Decoded
+	{
+		static Word ReadAddr(Reader& inp)
+		{
+			return from_wasm<Word>(inp.Consume(sizeof(Word)));
+		}
+
+		static void ReadLocal(Reader& inp, Op& op)
+		{
+			// same as in ProcessorPlus::OnLocal
+			uint32_t nOffset = inp.Read<uint32_t>();
+			uint8_t nType = Type::s_Base + static_cast<uint8_t>((sizeof(Word) - 1) & (nOffset - Type::s_Base));
+
+			op.m_Aux = Type::Words(nType);
+			op.m_pArg[0] = nOffset / sizeof(Word);
+		}
+
+		bool TranslateOne(Reader& inp, Op& op)
+		{
+			typedef Instruction I;
+			I nInstruction = (I) inp.Read1();
+
+			switch (nInstruction)
+			{
+			case I::local_get:
+				op.m_Code = DecodedOp::local_get;
+				ReadLocal(inp, op);
+				break;
+
+			case I::local_set:
+				op.m_Code = DecodedOp::local_set;
+				ReadLocal(inp, op);
+				break;
+
+			case I::local_tee:
+				op.m_Code = DecodedOp::local_tee;
+				ReadLocal(inp, op);
+				break;
+
+			case I::global_get_imp:
+				op.m_Code = DecodedOp::global_get_imp;
+				op.m_pArg[0] = inp.Read<uint32_t>();
+				break;
+
+			case I::global_set_imp:
+				op.m_Code = DecodedOp::global_set_imp;
+				op.m_pArg[0] = inp.Read<uint32_t>();
+				break;
+
+			case I::drop:
+				op.m_Code = DecodedOp::drop;
+				op.m_Aux = Type::Words(inp.Read1());
+				break;
+
+			case I::select:
+				op.m_Code = DecodedOp::select;
+				op.m_Aux = Type::Words(inp.Read1());
+				break;
+
+			case I::i32_wrap_i64:
+				op.m_Code = DecodedOp::i32_wrap_i64;
+				break;
+
+			case I::i64_extend_i32_s:
+				op.m_Code = DecodedOp::i64_extend_i32_s;
+				break;
+
+			case I::i64_extend_i32_u:
+				op.m_Code = DecodedOp::i64_extend_i32_u;
+				break;
+
+			case I::br:
+				op.m_Code = DecodedOp::br;
+				op.m_pArg[0] = ReadAddr(inp);
+				return false;
+
+			case I::br_if:
+				op.m_Code = DecodedOp::br_if;
+				op.m_pArg[0] = ReadAddr(inp);
+				break;
+
+			case I::br_table:
+				{
+					op.m_Code = DecodedOp::br_table;
+					uint32_t nLabels = inp.Read<uint32_t>();
+					op.m_pArg[0] = nLabels;
+
+					nLabels++;
+					uint32_t nSize = sizeof(Word) * nLabels;
+					Test(nSize / sizeof(Word) == nLabels); // overflow check
+
+					op.m_pArg[1] = static_cast<Word>(inp.Consume(nSize) - &m_Code.front());
+				}
+				return false;
+
+			case I::call:
+				op.m_Code = DecodedOp::call;
+				op.m_pArg[0] = ReadAddr(inp);
+				break;
+
+			case I::call_indirect:
+				op.m_Code = DecodedOp::call_indirect;
+				break;
+
+			case I::ret:
+				op.m_Code = DecodedOp::ret;
+				op.m_pArg[0] = inp.Read<uint32_t>(); // nRets
+				op.m_pArg[1] = inp.Read<uint32_t>(); // nLocals
+				op.m_pArg[2] = inp.Read<uint32_t>(); // nArgs
+				return false;
+
+			case I::i32_const:
+				op.m_Code = DecodedOp::i32_const;
+				op.m_pArg[0] = static_cast<uint32_t>(inp.Read<int32_t>());
+				break;
+
+			case I::i64_const:
+				{
+					op.m_Code = DecodedOp::i64_const;
+					uint64_t val = inp.Read<int64_t>();
+					op.m_pArg[0] = static_cast<Word>(val);
+					op.m_pArg[1] = static_cast<Word>(val >> 32);
+				}
+				break;
+
+			case I::prolog:
+				op.m_Code = DecodedOp::prolog;
+				op.m_pArg[0] = inp.Read<uint32_t>();
+				break;
+
+			case I::call_ext:
+				op.m_Code = DecodedOp::call_ext; // left to the interpreter, the execution continues after it
+				inp.Read<uint32_t>();
+				op.m_Cycles = 0;
+				break;
+
+#define THE_MACRO(name, id32, id64) \
+			case I::i32_##name: op.m_Code = DecodedOp::i32_##name; break; \
+			case I::i64_##name: op.m_Code = DecodedOp::i64_##name; break;
+
+			WasmInstructions_unop_Polymorphic_32(THE_MACRO)
+			WasmInstructions_binop_Polymorphic_32(THE_MACRO)
+			WasmInstructions_binop_Polymorphic_x(THE_MACRO)
+#undef THE_MACRO
+
+#define THE_MACRO(id, type, name, tmem) \
+			case I::type##_##name: \
+				op.m_Code = DecodedOp::type##_##name; \
+				Processor::Stack::TestAlignmentPower(inp.Read<Word>()); \
+				op.m_pArg[0] = inp.Read<Word>(); \
+				break;
+
+			WasmInstructions_Load(THE_MACRO)
+			WasmInstructions_Store(THE_MACRO)
+#undef THE_MACRO
+
+			default:
+				Fail();
+			}
+
+			return true;
+		}
+
+		void TryFuse(Reader& inp, Op& op)
+		{
+			Reader inp2 = inp;
+
+			try
+			{
+				typedef Instruction I;
+				I nInstruction = (I) inp2.Read1();
+
+				switch (op.m_Code)
+				{
+				case DecodedOp::local_get:
+					if (I::i32_add == nInstruction)
+						op.m_Code = DecodedOp::local_get_i32_add;
+					else
+					{
+						if (I::i32_load != nInstruction)
+							return;
+
+						Processor::Stack::TestAlignmentPower(inp2.Read<Word>());
+						op.m_pArg[2] = inp2.Read<Word>();
+						op.m_Code = DecodedOp::local_get_i32_load;
+					}
+					break;
+
+				case DecodedOp::i32_const:
+					if (I::i32_add != nInstruction)
+						return;
+					op.m_Code = DecodedOp::i32_const_i32_add;
+					break;
+
+				default:
+					return;
+				}
+			}
+			catch (const std::exception&) {
+				return; // leave it to the regular path
+			}
+
+			// the fused op may fail in either part, the 2nd instruction address is kept for diagnostics
+			op.m_pArg[1] = static_cast<Word>(inp.m_p0 - &m_Code.front());
+			op.m_Cycles = 2;
+			inp = inp2;
+		}
+
+		void Translate(Word ip)
+		{
+			const uint8_t* p0 = &m_Code.front();
+
+			Reader inp(Reader::Mode::Standard);
+			inp.m_p0 = p0 + ip;
+			inp.m_p1 = p0 + m_nLimit;
+
+			for (bool bFirst = true; ; bFirst = false)
+			{
+				Op op;
+				ZeroObject(op);
+				op.m_Ip = static_cast<Word>(inp.m_p0 - p0);
+				op.m_Cycles = 1;
+
+				if (op.m_Ip >= m_nLimit)
+				{
+					op.m_Code = DecodedOp::fallback;
+					op.m_Cycles = 0;
+					m_vOps.push_back(op);
+					break;
+				}
+
+				uint32_t& nIdx = m_vIdx[op.m_Ip];
+				if (nIdx && !bFirst)
+				{
+					// continue with what's already translated
+					op.m_Code = DecodedOp::jmp;
+					op.m_Cycles = 0;
+					op.m_pArg[0] = nIdx - 1;
+					m_vOps.push_back(op);
+					break;
+				}
+
+				bool bNext;
+				try
+				{
+					bNext = TranslateOne(inp, op);
+					// signed constants that depend on the reader mode are left to the regular path
+					Test(!inp.m_ModeTriggered);
+
+					if (bNext)
+						TryFuse(inp, op);
+				}
+				catch (const std::exception&)
+				{
+					op.m_Code = DecodedOp::fallback;
+					op.m_Cycles = 0;
+					bNext = false;
+				}
+
+				op.m_IpNext = static_cast<Word>(inp.m_p0 - p0);
+
+				nIdx = static_cast<uint32_t>(m_vOps.size()) + 1;
+				m_vOps.push_back(op);
+
+				if (!bNext)
+					break;
+			}
+		}
+	};
+
+	void Decoded::Init(const Blob& code, Word nLimit)
+	{
+		assert(nLimit <= code.n);
+		code.Export(m_Code);
+		m_nLimit = nLimit;
+
+		m_vOps.clear();
+		m_vIdx.assign(nLimit, 0);
+	}
+
+	bool Decoded::IsSame(const Blob& code) const
+	{
+		return
+			(m_Code.size() == code.n) &&
+			(!code.n || !memcmp(&m_Code.front(), code.p, code.n));
+	}
+
+	uint32_t Decoded::Find(Word ip)
+	{
+		assert(ip < m_nLimit);
+		if (!m_vIdx[ip])
+			Cast::Up<DecodedPlus>(*this).Translate(ip);
+
+		assert(m_vIdx[ip]);
+		return m_vIdx[ip] - 1;
+	}
+
+	void Processor::RunDecoded(uint32_t& nCycles)
+	{
+#ifndef WASM_INTERPRETER_DEBUG // instructions are logged only by the regular path
+		auto& p = Cast::Up<ProcessorPlus>(*this);
+		static_assert(sizeof(p) == sizeof(*this));
+		p.RunDecodedPlus(nCycles);
+#endif // WASM_INTERPRETER_DEBUG
+	}
+
+#if defined(__GNUC__) || defined(__clang__)
+#	define WASM_DECODED_THREADED // dispatch via computed goto
+#endif
+
+	void ProcessorPlus::RunDecodedPlus(uint32_t& nCycles)
+	{
+		Decoded::Ptr pGuard = m_pDecoded; // may be detached during the execution
+		if (!pGuard)
+			return;
+
+		Decoded& d = *pGuard;
+		assert(d.m_Code.size() == m_Code.n);
+		const void* pCode = m_Code.p;
+
+		Word ipExit = get_Ip();
+		if (ipExit >= d.m_nLimit)
+			return;
+
+		const Decoded::Op* pOp = &d.m_vOps[d.Find(ipExit)];
+		uint32_t nLeft = nCycles;
+
+		struct MyCheckpoint :public Checkpoint {
+			Word m_Ip;
+			virtual void Dump(std::ostream& os) override {
+				os << "wasm/Run, Ip=" << uintBigFrom(m_Ip);
+			}
+		} cp;
+
+#ifdef WASM_DECODED_THREADED
+		static const void* const s_pLabels[] = {
+#	define THE_MACRO(name) &&OnOp_##name,
+#	define THE_MACRO_Poly(name, id32, id64) &&OnOp_i32_##name, &&OnOp_i64_##name,
+#	define THE_MACRO_Mem(id, type, name, tmem) &&OnOp_##type##_##name,
+			WasmDecodedOps_All(THE_MACRO)
+#	undef THE_MACRO_Mem
+#	undef THE_MACRO_Poly
+#	undef THE_MACRO
+		};
+		static_assert(_countof(s_pLabels) == DecodedOp::count);
+
+#	define WASM_OP(name) case DecodedOp::name: OnOp_##name:
+#	define WASM_OP_DISPATCH \
+			if (pOp->m_Cycles > nLeft) \
+				goto OnStop; \
+			nLeft -= pOp->m_Cycles; \
+			cp.m_Ip = pOp->m_Ip; \
+			goto *s_pLabels[pOp->m_Code];
+#else // WASM_DECODED_THREADED
+#	define WASM_OP(name) case DecodedOp::name:
+#	define WASM_OP_DISPATCH continue;
+#endif // WASM_DECODED_THREADED
+
+#define WASM_OP_NEXT pOp++; WASM_OP_DISPATCH
+
+#define WASM_OP_SETIP(ip) \
+		m_Instruction.m_p0 = reinterpret_cast<const uint8_t*>(m_Code.p) + ip; \
+		m_Instruction.m_p1 = reinterpret_cast<const uint8_t*>(m_Code.p) + m_Code.n;
+
+#define WASM_OP_JMP(ip) \
+		do { \
+			ipExit = ip; \
+			Test(ipExit < m_Code.n); \
+			if (ipExit >= d.m_nLimit) \
+				goto OnExit; \
+			pOp = &d.m_vOps[d.Find(ipExit)]; \
+		} while (false)
+
+		// after virtual calls that may switch the code (far calls/returns), or detach it
+#define WASM_OP_RESUME \
+		if ((m_Code.p != pCode) || (m_pDecoded.get() != &d)) \
+			goto OnExitAsIs; \
+		WASM_OP_JMP(get_Ip()); \
+		WASM_OP_DISPATCH
+
+		try
+		{
+			for (;;)
+			{
+				if (pOp->m_Cycles > nLeft)
+					goto OnStop;
+				nLeft -= pOp->m_Cycles;
+				cp.m_Ip = pOp->m_Ip;
+
+#ifdef WASM_DECODED_THREADED
+				goto *s_pLabels[pOp->m_Code];
+#endif // WASM_DECODED_THREADED
+
+				switch (pOp->m_Code)
+				{
+				WASM_OP(fallback)
+				WASM_OP(call_ext)
+					goto OnStop;
+
+				WASM_OP(jmp)
+					pOp = &d.m_vOps[pOp->m_pArg[0]];
+					WASM_OP_DISPATCH
+
+				WASM_OP(local_get)
+					OnLocalEx(pOp->m_pArg[0], pOp->m_Aux, false, true);
+					WASM_OP_NEXT
+
+				WASM_OP(local_set)
+					OnLocalEx(pOp->m_pArg[0], pOp->m_Aux, true, false);
+					WASM_OP_NEXT
+
+				WASM_OP(local_tee)
+					OnLocalEx(pOp->m_pArg[0], pOp->m_Aux, true, true);
+					WASM_OP_NEXT
+
+				WASM_OP(global_get_imp)
+					OnGlobalVar(pOp->m_pArg[0], true);
+					WASM_OP_NEXT
+
+				WASM_OP(global_set_imp)
+					OnGlobalVar(pOp->m_pArg[0], false);
+					WASM_OP_NEXT
+
+				WASM_OP(drop)
+					OnDropEx(pOp->m_Aux);
+					WASM_OP_NEXT
+
+				WASM_OP(select)
+					OnSelectEx(pOp->m_Aux);
+					WASM_OP_NEXT
+
+				WASM_OP(i32_wrap_i64)
+					On_i32_wrap_i64();
+					WASM_OP_NEXT
+
+				WASM_OP(i64_extend_i32_s)
+					On_i64_extend_i32_s();
+					WASM_OP_NEXT
+
+				WASM_OP(i64_extend_i32_u)
+					On_i64_extend_i32_u();
+					WASM_OP_NEXT
+
+				WASM_OP(br)
+					WASM_OP_JMP(pOp->m_pArg[0]);
+					WASM_OP_DISPATCH
+
+				WASM_OP(br_if)
+					if (m_Stack.Pop<Word>())
+					{
+						WASM_OP_JMP(pOp->m_pArg[0]);
+						WASM_OP_DISPATCH
+					}
+					WASM_OP_NEXT
+
+				WASM_OP(br_table)
+					{
+						Word nOperand = m_Stack.Pop<Word>();
+						std::setmin(nOperand, pOp->m_pArg[0]); // fallback to 'def' if out-of-range
+
+						const uint8_t* pAddrs = reinterpret_cast<const uint8_t*>(m_Code.p) + pOp->m_pArg[1];
+						WASM_OP_JMP(from_wasm<Word>(pAddrs + sizeof(Word) * nOperand));
+					}
+					WASM_OP_DISPATCH
+
+				WASM_OP(call)
+					WASM_OP_SETIP(pOp->m_IpNext)
+					m_Stack.Push(pOp->m_IpNext);
+					OnCall(pOp->m_pArg[0]);
+					WASM_OP_RESUME
+
+				WASM_OP(call_indirect)
+					{
+						Word iFunc = m_Stack.Pop<Word>();
+						Word nAddr = ReadTable(iFunc);
+
+						WASM_OP_SETIP(pOp->m_IpNext)
+						m_Stack.Push(pOp->m_IpNext);
+						OnCall(nAddr);
+					}
+					WASM_OP_RESUME
+
+				WASM_OP(ret)
+					WASM_OP_SETIP(pOp->m_IpNext)
+					OnRetEx(pOp->m_pArg[0], pOp->m_pArg[1], pOp->m_pArg[2]);
+					WASM_OP_RESUME
+
+				WASM_OP(i32_const)
+					m_Stack.Push<uint32_t>(pOp->m_pArg[0]);
+					WASM_OP_NEXT
+
+				WASM_OP(i64_const)
+					m_Stack.Push<uint64_t>(pOp->m_pArg[0] | (static_cast<uint64_t>(pOp->m_pArg[1]) << 32));
+					WASM_OP_NEXT
+
+				WASM_OP(prolog)
+					for (Word nWords = pOp->m_pArg[0]; nWords--; )
+						m_Stack.Push1(0);
+					WASM_OP_NEXT
+
+				WASM_OP(local_get_i32_add)
+					OnLocalEx(pOp->m_pArg[0], pOp->m_Aux, false, true);
+					cp.m_Ip = pOp->m_pArg[1];
+					On_add<uint32_t, uint32_t>();
+					WASM_OP_NEXT
+
+				WASM_OP(local_get_i32_load)
+					OnLocalEx(pOp->m_pArg[0], pOp->m_Aux, false, true);
+					cp.m_Ip = pOp->m_pArg[1];
+					OnLoad<uint32_t, uint32_t>(pOp->m_pArg[2]);
+					WASM_OP_NEXT
+
+				WASM_OP(i32_const_i32_add)
+					m_Stack.Push<uint32_t>(pOp->m_pArg[0]);
+					cp.m_Ip = pOp->m_pArg[1];
+					On_add<uint32_t, uint32_t>();
+					WASM_OP_NEXT
+
+#define THE_MACRO(name, id32, id64) \
+				WASM_OP(i32_##name) On_##name<uint32_t, uint32_t>(); WASM_OP_NEXT \
+				WASM_OP(i64_##name) On_##name<uint32_t, uint64_t>(); WASM_OP_NEXT
+
+				WasmInstructions_unop_Polymorphic_32(THE_MACRO)
+				WasmInstructions_binop_Polymorphic_32(THE_MACRO)
+#undef THE_MACRO
+
+#define THE_MACRO(name, id32, id64) \
+				WASM_OP(i32_##name) On_##name<uint32_t, uint32_t>(); WASM_OP_NEXT \
+				WASM_OP(i64_##name) On_##name<uint64_t, uint64_t>(); WASM_OP_NEXT
+
+				WasmInstructions_binop_Polymorphic_x(THE_MACRO)
+#undef THE_MACRO
+
+#define THE_MACRO(id, type, name, tmem) \
+				WASM_OP(type##_##name) OnLoad<Type::Code2Type<Type::type>::T, tmem>(pOp->m_pArg[0]); WASM_OP_NEXT
+
+				WasmInstructions_Load(THE_MACRO)
+#undef THE_MACRO
+
+#define THE_MACRO(id, type, name, tmem) \
+				WASM_OP(type##_##name) \
+					OnStore<Type::Code2Type<Type::type>::T, tmem>(pOp->m_pArg[0]); \
+					if (m_pDecoded.get() != &d) \
+					{ \
+						ipExit = pOp->m_IpNext; \
+						goto OnExit; /* the code modified itself */ \
+					} \
+					WASM_OP_NEXT
+
+				WasmInstructions_Store(THE_MACRO)
+#undef THE_MACRO
+
+				default:
+					assert(false);
+					Fail();
+				}
+			}
+
+		OnStop: // pOp is not executed
+			ipExit = pOp->m_Ip;
+
+		OnExit:
+			WASM_OP_SETIP(ipExit)
+
+		OnExitAsIs:
+			nCycles = nLeft;
+		}
+		catch (...)
+		{
+			// leave the state as the regular path would, the failed instruction is already read
+			Word ipNext = pOp->m_IpNext;
+			if ((pOp->m_Cycles > 1) && (cp.m_Ip == pOp->m_Ip))
+			{
+				// fused op failed in its 1st part
+				nLeft += pOp->m_Cycles - 1;
+				ipNext = pOp->m_pArg[1];
+			}
+			nCycles = nLeft;
+
+			if ((m_Code.p == pCode) && (m_pDecoded.get() == &d))
+			{
+				WASM_OP_SETIP(ipNext)
+			}
+			throw;
+		}
+
+#undef WASM_OP_RESUME
+#undef WASM_OP_SETIP
+#undef WASM_OP_JMP
+#undef WASM_OP_NEXT
+#undef WASM_OP_DISPATCH
+#undef WASM_OP
+	}
+
 } // namespace Wasm
 } // namespace beam
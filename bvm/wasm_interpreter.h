@@ -295,6 +295,35 @@ namespace Wasm {
 	};
 
 
+	// Pre-decoded form of the compiled code, to save the decoding on each instruction.
+	// Instructions are translated lazily, starting from the visited addresses, into ops with fixed-width operands.
+	// Frequent instruction pairs are fused. Whatever can't be translated is left to the regular interpreter.
+	struct Decoded
+	{
+		typedef std::shared_ptr<Decoded> Ptr;
+
+		struct Op
+		{
+			uint8_t m_Code;
+			uint8_t m_Cycles; // num of original instructions
+			uint16_t m_Aux;
+			Word m_Ip;
+			Word m_IpNext;
+			Word m_pArg[3];
+		};
+
+		ByteBuffer m_Code; // copy of the original code
+		Word m_nLimit; // only the instructions below it are translated. Writes below it invalidate the decoded form
+
+		std::vector<Op> m_vOps;
+		std::vector<uint32_t> m_vIdx; // ip -> op index + 1, or 0 if not translated yet
+
+		void Init(const Blob& code, Word nLimit);
+		bool IsSame(const Blob& code) const;
+
+		uint32_t Find(Word ip); // translates on demand, ip must be below the limit
+	};
+
 	struct Processor
 	{
 		Blob m_Code;
@@ -426,6 +455,13 @@ namespace Wasm {
 
 		void RunOnce();
 
+		// Optional pre-decoded form of m_Code, set by the owner. Detached automatically if the code is modified.
+		mutable Decoded::Ptr m_pDecoded;
+
+		// Runs up to nCycles instructions via the pre-decoded form, nCycles is decreased accordingly (also on exception).
+		// Stops before the instructions that should go through RunOnce (such as call_ext), may run nothing.
+		void RunDecoded(uint32_t& nCycles);
+
 		uint8_t* get_AddrEx(uint32_t nOffset, uint32_t nSize, bool bW) const;
 		uint8_t* get_AddrExVar(uint32_t nOffset, uint32_t& nSizeOut, bool bW) const;
 
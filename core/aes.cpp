@@ -479,6 +479,11 @@ void AES::Encoder::Init(const uint8_t* pKey)
 		RK[14] = RK[6] ^ RK[13];
 		RK[15] = RK[7] ^ RK[14];
 	}
+
+	for (i = 0; i < (Nr + 1) * 4; i++)
+	{
+		PUT_UINT32(m_erk[i], m_pRk, i * 4);
+	}
 }
 
 void AES::Decoder::Init(const Encoder& enc)
@@ -824,19 +829,13 @@ void AES::StreamCipher::PerfXor(uint8_t* pBuf, uint32_t nSize)
 
 void AES::StreamCipher::XCrypt(const Encoder& enc, uint8_t* pBuf, uint32_t nSize)
 {
-	while (true)
+	// remaining of the generated cipherstream
+	if (m_nBuf)
 	{
-		if (!m_nBuf)
-		{
-			enc.Proceed(m_pBuf, m_Counter.m_pData);
-			m_nBuf = _countof(m_pBuf);
-			m_Counter.Inc();
-		}
-
 		if (m_nBuf >= nSize)
 		{
 			PerfXor(pBuf, nSize);
-			break;
+			return;
 		}
 
 		uint8_t n = m_nBuf;
@@ -845,4 +844,134 @@ void AES::StreamCipher::XCrypt(const Encoder& enc, uint8_t* pBuf, uint32_t nSize
 		pBuf += n;
 		nSize -= n;
 	}
+
+	// whole blocks
+	uint32_t nBlocks = nSize / s_BlockSize;
+	if (nBlocks)
+	{
+		XCryptBlocks(enc, pBuf, nBlocks);
+
+		nBlocks *= s_BlockSize;
+		pBuf += nBlocks;
+		nSize -= nBlocks;
+	}
+
+	// partial block
+	if (nSize)
+	{
+		enc.Proceed(m_pBuf, m_Counter.m_pData);
+		m_nBuf = _countof(m_pBuf);
+		m_Counter.Inc();
+
+		PerfXor(pBuf, nSize);
+	}
+}
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#	define BEAM_AES_NI
+#endif
+
+#ifdef BEAM_AES_NI
+
+#ifdef _MSC_VER
+#	include <intrin.h>
+#	define BEAM_TARGET_AES
+#else // _MSC_VER
+#	include <cpuid.h>
+#	define BEAM_TARGET_AES __attribute__((target("aes,sse2")))
+#endif // _MSC_VER
+
+#include <wmmintrin.h>
+
+namespace
+{
+	bool IsHwSupported()
+	{
+		const uint32_t nFlagAes = 1U << 25; // ecx of leaf 1
+#ifdef _MSC_VER
+		int pRegs[4];
+		__cpuid(pRegs, 1);
+		return !!(static_cast<uint32_t>(pRegs[2]) & nFlagAes);
+#else // _MSC_VER
+		unsigned int eax, ebx, ecx, edx;
+		return __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & nFlagAes);
+#endif // _MSC_VER
+	}
+
+	BEAM_TARGET_AES void XCryptHw(const uint8_t* pRk, const uint8_t* pCounters, uint8_t* pBuf, uint32_t nBlocks)
+	{
+		__m128i pKeys[AES::Nr + 1];
+		for (int i = 0; i <= AES::Nr; i++)
+			pKeys[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pRk) + i);
+
+		__m128i pX[8];
+		assert(nBlocks <= _countof(pX));
+
+		// blocks are processed in parallel, to hide aesenc latency
+		for (uint32_t i = 0; i < nBlocks; i++)
+			pX[i] = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pCounters) + i), pKeys[0]);
+
+		for (int iRound = 1; iRound < AES::Nr; iRound++)
+			for (uint32_t i = 0; i < nBlocks; i++)
+				pX[i] = _mm_aesenc_si128(pX[i], pKeys[iRound]);
+
+		for (uint32_t i = 0; i < nBlocks; i++)
+		{
+			pX[i] = _mm_aesenclast_si128(pX[i], pKeys[AES::Nr]);
+
+			__m128i* pDst = reinterpret_cast<__m128i*>(pBuf) + i;
+			_mm_storeu_si128(pDst, _mm_xor_si128(_mm_loadu_si128(pDst), pX[i]));
+		}
+	}
+}
+
+bool AES::s_UseHw = IsHwSupported();
+
+#else // BEAM_AES_NI
+
+bool AES::s_UseHw = false;
+
+#endif // BEAM_AES_NI
+
+void AES::StreamCipher::XCryptBlocks(const Encoder& enc, uint8_t* pBuf, uint32_t nBlocks)
+{
+	uint8_t pCounters[s_Batch * s_BlockSize];
+	uint8_t pStream[s_Batch * s_BlockSize];
+
+	while (nBlocks)
+	{
+		uint32_t n = std::min(nBlocks, s_Batch);
+
+		for (uint32_t i = 0; i < n; i++)
+		{
+			memcpy(pCounters + i * s_BlockSize, m_Counter.m_pData, s_BlockSize);
+			m_Counter.Inc();
+		}
+
+		uint32_t nBytes = n * s_BlockSize;
+
+#ifdef BEAM_AES_NI
+		if (s_UseHw)
+			XCryptHw(enc.m_pRk, pCounters, pBuf, n);
+		else
+#endif // BEAM_AES_NI
+		{
+			for (uint32_t i = 0; i < n; i++)
+				enc.Proceed(pStream + i * s_BlockSize, pCounters + i * s_BlockSize);
+
+			// xor by words
+			uint32_t i = 0;
+			for (; i + sizeof(uint64_t) <= nBytes; i += sizeof(uint64_t))
+			{
+				uint64_t a, b;
+				memcpy(&a, pBuf + i, sizeof(a));
+				memcpy(&b, pStream + i, sizeof(b));
+				a ^= b;
+				memcpy(pBuf + i, &a, sizeof(a));
+			}
+		}
+
+		pBuf += nBytes;
+		nBlocks -= n;
+	}
 }
@@ -11,6 +11,7 @@ struct AES
 	struct Encoder
 	{
 		uint32_t m_erk[64]; // encryption round keys. Actually needed 60, but during init extra space is used
+		uint8_t m_pRk[(Nr + 1) * s_BlockSize]; // the same round keys in byte order, for the hw-accelerated version
 		void Init(const uint8_t* pKey);
 		void Proceed(uint8_t* pDst, const uint8_t* pSrc) const;
 	};
@@ -34,6 +35,13 @@ struct AES
 
 		void Reset();
 		void XCrypt(const Encoder&, uint8_t* pBuf, uint32_t nSize);
+
+	private:
+		static constexpr uint32_t s_Batch = 8; // blocks per iteration
+		void XCryptBlocks(const Encoder&, uint8_t* pBuf, uint32_t nBlocks);
 	};
 
+	// AES-NI is used if supported by the CPU. Can be turned off (for tests and benchmarks)
+	static bool s_UseHw;
+
 };
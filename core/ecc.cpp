@@ -1458,6 +1458,11 @@ namespace ECC {
 
 		WnafBase::Shared wsP, wsC;
 
+		bool bPippenger =
+			(Mode::Fast == g_Mode) &&
+			(Reuse::None == m_ReuseFlag) &&
+			(static_cast<uint32_t>(m_Casual) >= Pippenger::s_Threshold);
+
 		unsigned int iBit = ECC::nBits;
 
 		if (Mode::Fast == g_Mode)
@@ -1487,6 +1492,12 @@ namespace ECC {
 					continue;
 				}
 
+				if (bPippenger)
+				{
+					f.m_nNeeded = 1; // only the point itself, it'll be normalized with others
+					continue;
+				}
+
 				unsigned int nEntries = f.m_Wnaf.Init(wsC, m_pKCasual[iEntry], iEntry + 1);
 				assert(nEntries <= _countof(f.m_Wnaf.m_pVals));
 
@@ -1655,11 +1666,139 @@ namespace ECC {
 		}
 		else
 		{
+			if (bPippenger)
+				CalculatePippenger(res); // casual points are in the same (scaled) coordinates
+
 			// fix denominator
 			secp256k1_fe_mul(&res.get_Raw().z, &res.get_Raw().z, &zDenom);
 		}
 	}
 
+	uint32_t MultiMac::Pippenger::s_Threshold = 160;
+
+	unsigned int MultiMac::Pippenger::get_WndBits(uint32_t nCount)
+	{
+		// Each window costs an addition per point, plus 2 additions per bucket
+		unsigned int nBest = 2;
+		uint64_t nCostBest = static_cast<uint64_t>(-1);
+
+		for (unsigned int nBits = 2; nBits <= 16; nBits++)
+		{
+			uint64_t nCost = (ECC::nBits / nBits + 1) * (static_cast<uint64_t>(nCount) + (1U << nBits));
+			if (nCost < nCostBest)
+			{
+				nCostBest = nCost;
+				nBest = nBits;
+			}
+		}
+
+		return nBest;
+	}
+
+namespace
+{
+	unsigned int GetBits(const Scalar::Native& k, unsigned int iBit, unsigned int nBits)
+	{
+		const unsigned int nBitsPerWord = sizeof(Scalar::Native::uint) << 3;
+		const Scalar::Native::uint* p = k.get().d;
+
+		unsigned int iWord = iBit / nBitsPerWord;
+		if (iWord >= _countof(k.get().d))
+			return 0;
+
+		unsigned int iBitInWord = iBit % nBitsPerWord;
+		Scalar::Native::uint n = p[iWord] >> iBitInWord;
+
+		if ((iBitInWord + nBits > nBitsPerWord) && (iWord + 1 < _countof(k.get().d)))
+			n |= p[iWord + 1] << (nBitsPerWord - iBitInWord);
+
+		return static_cast<unsigned int>(n) & ((1U << nBits) - 1);
+	}
+}
+
+	void MultiMac::CalculatePippenger(Point::Native& res) const
+	{
+		const unsigned int nWndBits = Pippenger::get_WndBits(m_Casual);
+		const unsigned int nWnds = ECC::nBits / nWndBits + 1; // extra bit for the carry
+		const unsigned int nHalf = 1U << (nWndBits - 1);
+		const uint32_t nCount = m_Casual;
+
+		// signed digits in range [-nHalf+1, nHalf], arranged by windows
+		std::vector<int32_t> vDigits(static_cast<size_t>(nCount) * nWnds);
+
+		for (uint32_t iEntry = 0; iEntry < nCount; iEntry++)
+		{
+			if (!m_pCasual[iEntry].U.F.get().m_nNeeded)
+				continue; // zero point
+
+			const Scalar::Native& k = m_pKCasual[iEntry];
+			unsigned int nCarry = 0;
+
+			for (unsigned int iWnd = 0; iWnd < nWnds; iWnd++)
+			{
+				int32_t nVal = GetBits(k, iWnd * nWndBits, nWndBits) + nCarry;
+
+				nCarry = (nVal > static_cast<int32_t>(nHalf));
+				if (nCarry)
+					nVal -= (1 << nWndBits);
+
+				vDigits[static_cast<size_t>(iWnd) * nCount + iEntry] = nVal;
+			}
+
+			assert(!nCarry);
+		}
+
+		std::vector<Point::Native> vBuckets(nHalf);
+		Point::Native sum, sumBuckets, acc;
+		acc = Zero;
+
+		secp256k1_ge ge;
+
+		for (unsigned int iWnd = nWnds; iWnd--; )
+		{
+			if (!(acc == Zero))
+				for (unsigned int i = 0; i < nWndBits; i++)
+					acc = acc * Two;
+
+			for (uint32_t i = 0; i < nHalf; i++)
+				vBuckets[i] = Zero;
+
+			const int32_t* pDigits = &vDigits[static_cast<size_t>(iWnd) * nCount];
+
+			for (uint32_t iEntry = 0; iEntry < nCount; iEntry++)
+			{
+				int32_t nVal = pDigits[iEntry];
+				if (!nVal)
+					continue;
+
+				Point::Native::BatchNormalizer::get_As(ge, m_pCasual[iEntry].U.F.get().m_pPt[0]);
+
+				if (nVal < 0)
+				{
+					secp256k1_ge_neg(&ge, &ge);
+					nVal = -nVal;
+				}
+
+				secp256k1_gej& gej = vBuckets[nVal - 1].get_Raw();
+				secp256k1_gej_add_ge_var(&gej, &gej, &ge, nullptr);
+			}
+
+			// sum of i * bucket[i]
+			sum = Zero;
+			sumBuckets = Zero;
+
+			for (uint32_t i = nHalf; i--; )
+			{
+				sum += vBuckets[i];
+				sumBuckets += sum;
+			}
+
+			acc += sumBuckets;
+		}
+
+		res += acc;
+	}
+
 	void MultiMac_Dyn::Prepare(uint32_t nMaxCasual, uint32_t nMaxPrepared)
 	{
 		if (nMaxCasual)
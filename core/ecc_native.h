@@ -405,6 +405,14 @@ namespace ECC
 
 		Reuse::Enum m_ReuseFlag;
 
+		struct Pippenger
+		{
+			// Bucket method for the casual points in large batches (fast mode only, without reuse).
+			// Prepared points are still processed via wNAF, their precalculated tables are more effective.
+			static uint32_t s_Threshold; // min num of casual points to use it
+			static unsigned int get_WndBits(uint32_t nCount);
+		};
+
 		MultiMac() { Reset(); }
 
 		void Reset();
@@ -413,6 +421,7 @@ namespace ECC
 	private:
 
 		struct Normalizer;
+		void CalculatePippenger(Point::Native&) const;
 	};
 
 	template <int nMaxCasual, int nMaxPrepared>
@@ -479,9 +479,27 @@ struct FlyMmr::Inner
 		m_Count = m_This.m_Count;
 	}
 
+	// subtrees up to this height are evaluated level-by-level, each level hashed at once
+	static const uint8_t s_hBatchMax = 12;
+
 	void Calculate(Hash& hv, const Position& pos) const
 	{
-		if (pos.H)
+		if ((pos.H > 1) && (pos.H <= s_hBatchMax))
+		{
+			std::vector<Hash> v(size_t(1) << pos.H);
+
+			uint64_t x0 = pos.X << pos.H;
+			assert(x0 + v.size() <= m_Count);
+
+			for (size_t i = 0; i < v.size(); i++)
+				m_This.LoadElement(v[i], x0 + i);
+
+			for (uint32_t n = static_cast<uint32_t>(v.size()) >> 1; n; n >>= 1)
+				MultiInterpret::Do(&v.front(), &v.front(), n);
+
+			hv = v.front();
+		}
+		else if (pos.H)
 		{
 			Position pos2;
 			pos2.X = pos.X << 1;
@@ -525,6 +543,375 @@ bool FlyMmr::get_Proof(IProofBuilder& builder, uint64_t i) const
 }
 
 
+/////////////////////////////
+// MultiInterpret
+namespace
+{
+	const uint32_t s_pK[64] = {
+		0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+		0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+		0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+		0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+		0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+		0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+		0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+		0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+	};
+
+	const uint32_t s_pIV[8] = {
+		0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+	};
+
+	uint32_t RotR(uint32_t x, uint32_t n)
+	{
+		return (x >> n) | (x << (32 - n));
+	}
+
+	// The 2nd block of a 64-byte message is always the same (padding + length).
+	// Its expanded schedule with the round constants added is evaluated once.
+	struct PadSchedule
+	{
+		uint32_t m_pKW[64];
+
+		PadSchedule()
+		{
+			uint32_t pW[64] = { 0x80000000 };
+			pW[15] = 512; // length in bits
+
+			for (uint32_t t = 16; t < 64; t++)
+			{
+				uint32_t s0 = RotR(pW[t - 15], 7) ^ RotR(pW[t - 15], 18) ^ (pW[t - 15] >> 3);
+				uint32_t s1 = RotR(pW[t - 2], 17) ^ RotR(pW[t - 2], 19) ^ (pW[t - 2] >> 10);
+				pW[t] = pW[t - 16] + s0 + pW[t - 7] + s1;
+			}
+
+			for (uint32_t t = 0; t < 64; t++)
+				m_pKW[t] = pW[t] + s_pK[t];
+		}
+
+		static const PadSchedule& get()
+		{
+			static const PadSchedule s;
+			return s;
+		}
+	};
+}
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#	define BEAM_MERKLE_SIMD
+#endif
+
+#ifdef BEAM_MERKLE_SIMD
+
+#ifdef _MSC_VER
+#	include <intrin.h>
+#	define BEAM_TARGET_AVX2
+#	define BEAM_TARGET_SHA
+#else // _MSC_VER
+#	include <cpuid.h>
+#	define BEAM_TARGET_AVX2 __attribute__((target("avx2")))
+#	define BEAM_TARGET_SHA __attribute__((target("sha,sse4.1,ssse3")))
+#endif // _MSC_VER
+
+#include <immintrin.h>
+
+namespace
+{
+	void CpuId(uint32_t* pRegs, uint32_t nLeaf)
+	{
+#ifdef _MSC_VER
+		int pR[4];
+		__cpuidex(pR, nLeaf, 0);
+		for (uint32_t i = 0; i < 4; i++)
+			pRegs[i] = static_cast<uint32_t>(pR[i]);
+#else // _MSC_VER
+		if (!__get_cpuid_count(nLeaf, 0, pRegs, pRegs + 1, pRegs + 2, pRegs + 3))
+			memset(pRegs, 0, sizeof(uint32_t) * 4);
+#endif // _MSC_VER
+	}
+
+	bool HasShaNi()
+	{
+		uint32_t pR[4];
+		CpuId(pR, 1);
+		if ((pR[2] & (1U << 9 | 1U << 19)) != (1U << 9 | 1U << 19)) // ssse3, sse4.1
+			return false;
+
+		CpuId(pR, 7);
+		return !!(pR[1] & (1U << 29));
+	}
+
+	bool HasAvx2()
+	{
+		uint32_t pR[4];
+		CpuId(pR, 1);
+		if (!(pR[2] & (1U << 27))) // osxsave
+			return false;
+
+		// make sure the OS saves the ymm state
+#ifdef _MSC_VER
+		uint64_t nXcr0 = _xgetbv(0);
+#else // _MSC_VER
+		uint32_t nLo, nHi;
+		__asm__ __volatile__("xgetbv" : "=a"(nLo), "=d"(nHi) : "c"(0));
+		uint64_t nXcr0 = (uint64_t(nHi) << 32) | nLo;
+#endif // _MSC_VER
+		if ((nXcr0 & 6) != 6)
+			return false;
+
+		CpuId(pR, 7);
+		return !!(pR[1] & (1U << 5));
+	}
+
+	uint32_t LoadBE(const uint8_t* p)
+	{
+		return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+	}
+
+	void StoreBE(uint8_t* p, uint32_t x)
+	{
+		p[0] = static_cast<uint8_t>(x >> 24);
+		p[1] = static_cast<uint8_t>(x >> 16);
+		p[2] = static_cast<uint8_t>(x >> 8);
+		p[3] = static_cast<uint8_t>(x);
+	}
+
+	struct Avx2
+	{
+		static constexpr uint32_t s_Lanes = 8;
+
+#define BEAM_AVX2_ROTR(x, n) _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - (n)))
+
+		static BEAM_TARGET_AVX2 void Round(__m256i* pS, __m256i kw)
+		{
+			// pS: a,b,c,d,e,f,g,h
+			__m256i e = pS[4];
+			__m256i s1 = _mm256_xor_si256(_mm256_xor_si256(BEAM_AVX2_ROTR(e, 6), BEAM_AVX2_ROTR(e, 11)), BEAM_AVX2_ROTR(e, 25));
+			__m256i ch = _mm256_xor_si256(_mm256_and_si256(e, pS[5]), _mm256_andnot_si256(e, pS[6]));
+			__m256i t1 = _mm256_add_epi32(_mm256_add_epi32(pS[7], s1), _mm256_add_epi32(ch, kw));
+
+			__m256i a = pS[0];
+			__m256i s0 = _mm256_xor_si256(_mm256_xor_si256(BEAM_AVX2_ROTR(a, 2), BEAM_AVX2_ROTR(a, 13)), BEAM_AVX2_ROTR(a, 22));
+			__m256i maj = _mm256_or_si256(_mm256_and_si256(a, pS[1]), _mm256_and_si256(pS[2], _mm256_or_si256(a, pS[1])));
+			__m256i t2 = _mm256_add_epi32(s0, maj);
+
+			pS[7] = pS[6];
+			pS[6] = pS[5];
+			pS[5] = e;
+			pS[4] = _mm256_add_epi32(pS[3], t1);
+			pS[3] = pS[2];
+			pS[2] = pS[1];
+			pS[1] = a;
+			pS[0] = _mm256_add_epi32(t1, t2);
+		}
+
+		static BEAM_TARGET_AVX2 void Do(Hash* pOut, const Hash* pIn, uint32_t nMsgs, const PadSchedule& pad)
+		{
+			assert(nMsgs && (nMsgs <= s_Lanes));
+
+			// transpose: each vector holds the same message word of all the lanes
+			uint32_t pBuf[16][s_Lanes] = { { 0 } };
+			for (uint32_t j = 0; j < nMsgs; j++)
+			{
+				const uint8_t* pMsg = pIn[2 * j].m_pData; // both hashes are contiguous
+				for (uint32_t t = 0; t < 16; t++)
+					pBuf[t][j] = LoadBE(pMsg + 4 * t);
+			}
+
+			__m256i pW[16];
+			for (uint32_t t = 0; t < 16; t++)
+				pW[t] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pBuf[t]));
+
+			__m256i pS[8], pS0[8];
+			for (uint32_t i = 0; i < 8; i++)
+				pS[i] = pS0[i] = _mm256_set1_epi32(static_cast<int>(s_pIV[i]));
+
+			for (uint32_t t = 0; t < 64; t++)
+			{
+				if (t >= 16)
+				{
+					__m256i w15 = pW[(t - 15) & 15];
+					__m256i w2 = pW[(t - 2) & 15];
+					__m256i s0 = _mm256_xor_si256(_mm256_xor_si256(BEAM_AVX2_ROTR(w15, 7), BEAM_AVX2_ROTR(w15, 18)), _mm256_srli_epi32(w15, 3));
+					__m256i s1 = _mm256_xor_si256(_mm256_xor_si256(BEAM_AVX2_ROTR(w2, 17), BEAM_AVX2_ROTR(w2, 19)), _mm256_srli_epi32(w2, 10));
+					pW[t & 15] = _mm256_add_epi32(_mm256_add_epi32(pW[t & 15], s0), _mm256_add_epi32(pW[(t - 7) & 15], s1));
+				}
+
+				Round(pS, _mm256_add_epi32(pW[t & 15], _mm256_set1_epi32(static_cast<int>(s_pK[t]))));
+			}
+
+			for (uint32_t i = 0; i < 8; i++)
+				pS[i] = pS0[i] = _mm256_add_epi32(pS[i], pS0[i]);
+
+			// padding block
+			for (uint32_t t = 0; t < 64; t++)
+				Round(pS, _mm256_set1_epi32(static_cast<int>(pad.m_pKW[t])));
+
+			for (uint32_t i = 0; i < 8; i++)
+			{
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(pBuf[i]), _mm256_add_epi32(pS[i], pS0[i]));
+
+				for (uint32_t j = 0; j < nMsgs; j++)
+					StoreBE(pOut[j].m_pData + 4 * i, pBuf[i][j]);
+			}
+		}
+
+#undef BEAM_AVX2_ROTR
+	};
+
+	struct ShaNi
+	{
+		static constexpr uint32_t s_Lanes = 2; // interleaved, to hide the sha256rnds2 latency
+
+		static BEAM_TARGET_SHA void Rounds4(__m128i& s0, __m128i& s1, __m128i kw)
+		{
+			s1 = _mm_sha256rnds2_epu32(s1, s0, kw);
+			s0 = _mm_sha256rnds2_epu32(s0, s1, _mm_shuffle_epi32(kw, 0x0E));
+		}
+
+		static BEAM_TARGET_SHA void Do(Hash* pOut, const Hash* pIn, uint32_t nMsgs, const PadSchedule& pad)
+		{
+			assert(nMsgs && (nMsgs <= s_Lanes));
+
+			const __m128i mskBswap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+			const uint8_t* ppMsg[s_Lanes];
+			for (uint32_t j = 0; j < s_Lanes; j++)
+				ppMsg[j] = pIn[2 * std::min(j, nMsgs - 1)].m_pData; // unused lanes just repeat the last message
+
+			// state in the ABEF/CDGH form
+			__m128i pS0[s_Lanes], pS1[s_Lanes], pSave0[s_Lanes], pSave1[s_Lanes];
+			for (uint32_t j = 0; j < s_Lanes; j++)
+			{
+				pS0[j] = pSave0[j] = _mm_set_epi32(static_cast<int>(s_pIV[0]), static_cast<int>(s_pIV[1]), static_cast<int>(s_pIV[4]), static_cast<int>(s_pIV[5]));
+				pS1[j] = pSave1[j] = _mm_set_epi32(static_cast<int>(s_pIV[2]), static_cast<int>(s_pIV[3]), static_cast<int>(s_pIV[6]), static_cast<int>(s_pIV[7]));
+			}
+
+			__m128i pW[s_Lanes][4];
+
+			for (uint32_t g = 0; g < 16; g++)
+			{
+				__m128i k = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s_pK + 4 * g));
+
+				for (uint32_t j = 0; j < s_Lanes; j++)
+				{
+					__m128i* pWj = pW[j];
+
+					if (g < 4)
+						pWj[g] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ppMsg[j] + 16 * g)), mskBswap);
+					else
+					{
+						__m128i x = _mm_sha256msg1_epu32(pWj[g & 3], pWj[(g + 1) & 3]);
+						x = _mm_add_epi32(x, _mm_alignr_epi8(pWj[(g + 3) & 3], pWj[(g + 2) & 3], 4));
+						pWj[g & 3] = _mm_sha256msg2_epu32(x, pWj[(g + 3) & 3]);
+					}
+
+					Rounds4(pS0[j], pS1[j], _mm_add_epi32(pWj[g & 3], k));
+				}
+			}
+
+			for (uint32_t j = 0; j < s_Lanes; j++)
+			{
+				pS0[j] = pSave0[j] = _mm_add_epi32(pS0[j], pSave0[j]);
+				pS1[j] = pSave1[j] = _mm_add_epi32(pS1[j], pSave1[j]);
+			}
+
+			// padding block
+			for (uint32_t g = 0; g < 16; g++)
+			{
+				__m128i kw = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pad.m_pKW + 4 * g));
+
+				for (uint32_t j = 0; j < s_Lanes; j++)
+					Rounds4(pS0[j], pS1[j], kw);
+			}
+
+			for (uint32_t j = 0; j < nMsgs; j++)
+			{
+				__m128i s0 = _mm_add_epi32(pS0[j], pSave0[j]);
+				__m128i s1 = _mm_add_epi32(pS1[j], pSave1[j]);
+
+				// back to ABCD/EFGH
+				__m128i x = _mm_shuffle_epi32(s0, 0x1B);
+				s1 = _mm_shuffle_epi32(s1, 0xB1);
+				s0 = _mm_blend_epi16(x, s1, 0xF0);
+				s1 = _mm_alignr_epi8(s1, x, 8);
+
+				__m128i* pDst = reinterpret_cast<__m128i*>(pOut[j].m_pData);
+				_mm_storeu_si128(pDst, _mm_shuffle_epi8(s0, mskBswap));
+				_mm_storeu_si128(pDst + 1, _mm_shuffle_epi8(s1, mskBswap));
+			}
+		}
+	};
+
+	template <typename T>
+	void DoMulti(Hash* pOut, const Hash* pIn, uint32_t nPairs)
+	{
+		const PadSchedule& pad = PadSchedule::get();
+
+		for (uint32_t i = 0; i < nPairs; i += T::s_Lanes)
+			T::Do(pOut + i, pIn + 2 * i, std::min(T::s_Lanes, nPairs - i), pad);
+	}
+}
+
+#endif // BEAM_MERKLE_SIMD
+
+bool MultiInterpret::IsSupported(Impl e)
+{
+	switch (e)
+	{
+	case Impl::Std:
+		return true;
+
+#ifdef BEAM_MERKLE_SIMD
+	case Impl::Avx2:
+		return HasAvx2();
+
+	case Impl::ShaNi:
+		return HasShaNi();
+#endif // BEAM_MERKLE_SIMD
+
+	default:
+		return false;
+	}
+}
+
+namespace
+{
+	MultiInterpret::Impl DetectMultiInterpret()
+	{
+		if (MultiInterpret::IsSupported(MultiInterpret::Impl::ShaNi))
+			return MultiInterpret::Impl::ShaNi;
+
+		if (MultiInterpret::IsSupported(MultiInterpret::Impl::Avx2))
+			return MultiInterpret::Impl::Avx2;
+
+		return MultiInterpret::Impl::Std;
+	}
+}
+
+MultiInterpret::Impl MultiInterpret::s_Impl = DetectMultiInterpret();
+
+void MultiInterpret::Do(Hash* pOut, const Hash* pIn, uint32_t nPairs)
+{
+	// in-place is ok: each portion is read completely before its output is written, and the output never overtakes the input
+	switch (s_Impl)
+	{
+#ifdef BEAM_MERKLE_SIMD
+	case Impl::ShaNi:
+		DoMulti<ShaNi>(pOut, pIn, nPairs);
+		break;
+
+	case Impl::Avx2:
+		DoMulti<Avx2>(pOut, pIn, nPairs);
+		break;
+#endif // BEAM_MERKLE_SIMD
+
+	default:
+		for (uint32_t i = 0; i < nPairs; i++)
+			Interpret(pOut[i], pIn[2 * i], pIn[2 * i + 1]);
+	}
+}
+
 /////////////////////////////
 // MultiProof
 MultiProof::Builder::Builder(MultiProof& x)
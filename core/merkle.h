@@ -77,6 +77,22 @@ namespace Merkle {
 	void Interpret(Hash&, const Hash& hLeft, const Hash& hRight);
 	void Interpret(Hash&, const Hash& hNew, bool bNewOnRight);
 
+	// Hashes many node pairs at once: pOut[i] = H(pIn[2*i], pIn[2*i + 1]).
+	// pOut may be the same as pIn, so that a whole level is reduced in-place.
+	struct MultiInterpret
+	{
+		enum struct Impl {
+			Std,
+			Avx2, // 8 messages interleaved in ymm lanes
+			ShaNi, // SHA extensions, 2 messages interleaved
+		};
+
+		static Impl s_Impl; // the best one supported by the CPU, detected at startup
+		static bool IsSupported(Impl);
+
+		static void Do(Hash* pOut, const Hash* pIn, uint32_t nPairs);
+	};
+
 	struct Mmr
 	{
 		uint64_t m_Count;
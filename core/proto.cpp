@@ -17,6 +17,7 @@
 #include "core/ecc_native.h"
 #include "proto.h"
 #include "../utility/logger.h"
+#include <thread>
 
 namespace beam {
 namespace proto {
@@ -150,6 +151,16 @@ void InitCipherIV(AES::StreamCipher& c, const ECC::Hash::Value& hvSecret, const
     c.m_nBuf = 0;
 }
 
+void InitViaSharedSecret(ECC::Hash::Value& hvSecret, const ECC::Point::Native& ptSecret, AES::Encoder& enc, ECC::Hash::Mac& hmac)
+{
+    ECC::Hash::Processor() << ptSecret >> hvSecret;
+
+    static_assert(AES::s_KeyBytes == ECC::Hash::Value::nBytes, "");
+    enc.Init(hvSecret.m_pData);
+
+    hmac.Reset(hvSecret.m_pData, hvSecret.nBytes);
+}
+
 bool InitViaDiffieHellman(const ECC::Scalar::Native& myPrivate, const PeerID& remotePublic, AES::Encoder& enc, ECC::Hash::Mac& hmac, AES::StreamCipher* pCipherOut, AES::StreamCipher* pCipherIn)
 {
     // Diffie-Hellman
@@ -160,12 +171,7 @@ bool InitViaDiffieHellman(const ECC::Scalar::Native& myPrivate, const PeerID& re
     ECC::Point::Native ptSecret = p * myPrivate;
 
     ECC::NoLeak<ECC::Hash::Value> hvSecret;
-    ECC::Hash::Processor() << ptSecret >> hvSecret.V;
-
-    static_assert(AES::s_KeyBytes == ECC::Hash::Value::nBytes, "");
-    enc.Init(hvSecret.V.m_pData);
-
-    hmac.Reset(hvSecret.V.m_pData, hvSecret.V.nBytes);
+    InitViaSharedSecret(hvSecret.V, ptSecret, enc, hmac);
 
     if (pCipherOut)
         InitCipherIV(*pCipherOut, hvSecret.V, remotePublic);
@@ -217,6 +223,35 @@ bool Bbs::Encrypt(ByteBuffer& res, const PeerID& publicAddr, ECC::Scalar::Native
 }
 
 bool Bbs::Decrypt(uint8_t*& p, uint32_t& n, const ECC::Scalar::Native& privateAddr)
+{
+    Decryptor d;
+    if (!d.Init(p, n))
+        return false;
+
+    PeerID myPublic;
+    myPublic.FromSk(Cast::NotConst(privateAddr)); // must have been already normalized. Should not be modified.
+
+    return d.Decrypt(p, n, privateAddr, myPublic);
+}
+
+bool Bbs::Decryptor::Init(const uint8_t* p, uint32_t n)
+{
+    PeerID remotePublic;
+    if (n < remotePublic.nBytes + ECC::Hash::Value::nBytes)
+        return false;
+
+    memcpy(remotePublic.m_pData, p, remotePublic.nBytes);
+
+    ECC::Point::Native pt;
+    if (!remotePublic.ExportNnz(pt))
+        return false; // bad address
+
+    ECC::Mode::Scope scope(ECC::Mode::Secure);
+    m_Casual.Init(pt);
+    return true;
+}
+
+bool Bbs::Decryptor::Decrypt(uint8_t*& p, uint32_t& n, const ECC::Scalar::Native& privateAddr, const PeerID& publicAddr) const
 {
     PeerID remotePublic;
     ECC::Hash::Value hvMac, hvMac2;
@@ -224,13 +259,25 @@ bool Bbs::Decrypt(uint8_t*& p, uint32_t& n, const ECC::Scalar::Native& privateAd
     if (n < remotePublic.nBytes + hvMac.nBytes)
         return false;
 
-    memcpy(remotePublic.m_pData, p, remotePublic.nBytes);
+    // Diffie-Hellman. In secure mode the table of the casual point is not modified during calculation, hence can be shared
+    ECC::Point::Native ptSecret;
+    {
+        ECC::Mode::Scope scope(ECC::Mode::Secure);
+
+        ECC::MultiMac mm;
+        mm.m_pCasual = Cast::NotConst(&m_Casual);
+        mm.m_Casual = 1;
+        mm.m_pKCasual = Cast::NotConst(&privateAddr);
+        mm.Calculate(ptSecret);
+    }
 
     AES::Encoder enc;
     AES::StreamCipher cIn;
     ECC::Hash::Mac hmac;
-    if (!InitViaDiffieHellman(privateAddr, remotePublic, enc, hmac, NULL, &cIn))
-        return false; // bad address
+
+    ECC::NoLeak<ECC::Hash::Value> hvSecret;
+    InitViaSharedSecret(hvSecret.V, ptSecret, enc, hmac);
+    InitCipherIV(cIn, hvSecret.V, publicAddr);
 
     cIn.XCrypt(enc, p + remotePublic.nBytes, n - remotePublic.nBytes);
 
@@ -292,6 +339,356 @@ bool NotCalled_VerifyNoDuplicatedIDs(uint32_t id)
     return false;
 }
 
+/////////////////////////
+// IoShards
+uint32_t IoShards::s_MaxInFlight = 1024 * 1024 * 4;
+
+struct IoShards::Item
+{
+    Item* m_pNext;
+    std::shared_ptr<Link> m_pLink;
+
+    virtual ~Item() {}
+};
+
+struct IoShards::ItemIn
+    :public Item
+{
+    ByteBuffer m_Data;
+    io::ErrorCode m_Err = io::EC_OK; // the input is closed, no data
+};
+
+struct IoShards::ItemOut
+    :public Item
+{
+    virtual void Dispatch(NodeConnection&) = 0;
+};
+
+template <typename T>
+struct IoShards::ItemMsg
+    :public ItemOut
+{
+    T m_Msg;
+
+    ItemMsg(T&& msg) :m_Msg(std::move(msg)) {}
+
+    virtual void Dispatch(NodeConnection& c) override
+    {
+        c.OnMsgInternal(0, std::move(m_Msg));
+    }
+};
+
+struct IoShards::ItemErr
+    :public ItemOut
+{
+    ProtocolError m_Error;
+
+    virtual void Dispatch(NodeConnection& c) override
+    {
+        c.on_protocol_error(0, m_Error);
+    }
+};
+
+struct IoShards::ItemIoErr
+    :public ItemOut
+{
+    io::ErrorCode m_Err;
+
+    virtual void Dispatch(NodeConnection& c) override
+    {
+        c.on_connection_error(0, m_Err);
+    }
+};
+
+struct IoShards::ItemDone
+    :public ItemOut
+{
+    size_t m_Size;
+
+    virtual void Dispatch(NodeConnection&) override;
+};
+
+struct IoShards::Queue
+{
+    std::atomic<Item*> m_pTop;
+
+    Queue() :m_pTop(nullptr) {}
+    ~Queue() { Clear(); }
+
+    bool Push(Item* p) // returns true if the queue was empty
+    {
+        Item* pTop = m_pTop.load(std::memory_order_relaxed);
+        do
+            p->m_pNext = pTop;
+        while (!m_pTop.compare_exchange_weak(pTop, p, std::memory_order_release, std::memory_order_relaxed));
+
+        return !pTop;
+    }
+
+    Item* PopAll() // in the order of insertion
+    {
+        Item* p = m_pTop.exchange(nullptr, std::memory_order_acquire);
+        Item* pRes = nullptr;
+
+        while (p)
+        {
+            Item* pNext = p->m_pNext;
+            p->m_pNext = pRes;
+            pRes = p;
+            p = pNext;
+        }
+
+        return pRes;
+    }
+
+    void Clear()
+    {
+        for (Item* p = PopAll(); p; )
+        {
+            Item* pNext = p->m_pNext;
+            delete p;
+            p = pNext;
+        }
+    }
+};
+
+struct IoShards::Shard
+{
+    IoShards& m_This;
+    Queue m_In;
+    io::Reactor::Ptr m_pReactor;
+    io::AsyncEvent::Ptr m_pEvt;
+    std::thread m_Thread;
+    bool m_PostOut = false; // shard thread only
+
+    Shard(IoShards& x) :m_This(x) {}
+
+    void OnIn();
+};
+
+struct IoShards::Link
+    :public IErrorHandler
+    ,public std::enable_shared_from_this<Link>
+{
+    IoShards& m_This;
+    Shard& m_Shard;
+    std::atomic<bool> m_Detached;
+
+    // owner thread
+    NodeConnection* m_pConn; // reset when the connection is closed
+    size_t m_InFlight = 0;
+    bool m_Paused = false;
+    bool m_Closed = false; // io error is pending in the shard
+
+    // shard thread
+    ProtocolPlus m_Protocol;
+    MsgReader m_Reader;
+    bool m_Failed = false;
+
+    Link(IoShards& x, Shard& s, NodeConnection& c)
+        :m_This(x)
+        ,m_Shard(s)
+        ,m_Detached(false)
+        ,m_pConn(&c)
+        ,m_Protocol('B', 'm', 10, sizeof(HighestMsgCode), *this, 1000)
+        ,m_Reader(m_Protocol, 0, 100)
+    {
+#define THE_MACRO(code, msg) \
+        m_Protocol.add_message_handler<Link, msg##_NoInit, &Link::OnMsgParsed<msg##_NoInit> >(uint8_t(code), this, 0, 1024*1024*10);
+
+        BeamNodeMsgsAll(THE_MACRO)
+#undef THE_MACRO
+    }
+
+    void Push(ItemOut* p)
+    {
+        p->m_pLink = shared_from_this();
+        if (m_This.m_pOut->Push(p))
+            m_Shard.m_PostOut = true;
+    }
+
+    template <typename T>
+    bool OnMsgParsed(uint64_t, T&& msg)
+    {
+        m_This.m_Stats.m_Messages++;
+        Push(new ItemMsg<T>(std::move(msg)));
+        return true;
+    }
+
+    void OnData(const ItemIn& x)
+    {
+        if (x.m_Err)
+        {
+            // raised after all the preceding messages are dispatched
+            ItemIoErr* pErr = new ItemIoErr;
+            pErr->m_Err = x.m_Err;
+            Push(pErr);
+            return;
+        }
+
+        if (!m_Failed && !m_Reader.new_data_from_stream(io::EC_OK, &x.m_Data.front(), x.m_Data.size()))
+            m_Failed = true;
+
+        ItemDone* pDone = new ItemDone;
+        pDone->m_Size = x.m_Data.size();
+        Push(pDone);
+    }
+
+    // IErrorHandler
+    virtual void on_protocol_error(uint64_t, ProtocolError error) override
+    {
+        m_Failed = true;
+
+        ItemErr* pErr = new ItemErr;
+        pErr->m_Error = error;
+        Push(pErr);
+    }
+
+    virtual void on_connection_error(uint64_t, io::ErrorCode) override
+    {
+        assert(false); // io errors are handled by the owner
+    }
+};
+
+void IoShards::ItemDone::Dispatch(NodeConnection& c)
+{
+    Link& l = *m_pLink;
+    assert(l.m_InFlight >= m_Size);
+    l.m_InFlight -= m_Size;
+
+    if (l.m_Paused && !l.m_Closed && (l.m_InFlight <= s_MaxInFlight / 2))
+    {
+        l.m_Paused = false;
+        if (!c.m_InputPaused)
+            c.SetInput();
+    }
+}
+
+void IoShards::Shard::OnIn()
+{
+    for (Item* p = m_In.PopAll(); p; )
+    {
+        std::unique_ptr<ItemIn> pIn(static_cast<ItemIn*>(p));
+        p = p->m_pNext;
+
+        Link& l = *pIn->m_pLink;
+        if (l.m_Detached)
+            continue;
+
+        m_This.m_Stats.m_Bytes += pIn->m_Data.size();
+        l.OnData(*pIn);
+    }
+
+    if (m_PostOut)
+    {
+        m_PostOut = false;
+        m_This.m_pEvtOut->post();
+    }
+}
+
+IoShards::IoShards()
+    :m_iNext(0)
+{
+    m_Stats.m_Bytes = 0;
+    m_Stats.m_Messages = 0;
+    m_Stats.m_Links = 0;
+}
+
+IoShards::~IoShards()
+{
+    Stop();
+}
+
+void IoShards::Start(uint32_t nThreads)
+{
+    assert(!IsRunning());
+    if (!nThreads)
+        return;
+
+    m_pOut = std::make_unique<Queue>();
+    m_pEvtOut = io::AsyncEvent::create(io::Reactor::get_Current(), [this]() { OnOut(); });
+
+    m_vShards.resize(nThreads);
+    for (auto& pShard : m_vShards)
+    {
+        pShard = std::make_unique<Shard>(*this);
+        Shard& s = *pShard;
+
+        s.m_pReactor = io::Reactor::create();
+        s.m_pEvt = io::AsyncEvent::create(*s.m_pReactor, [&s]() { s.OnIn(); });
+        s.m_Thread = std::thread(&IoShards::RunThread, s.m_pReactor, Rules::get());
+    }
+}
+
+void IoShards::RunThread(const io::Reactor::Ptr& pReactor, const Rules& r)
+{
+    Rules::Scope scopeRules(r);
+    pReactor->run();
+}
+
+void IoShards::Stop()
+{
+    // all the connections are supposed to be closed by now
+    for (auto& pShard : m_vShards)
+        pShard->m_pReactor->stop();
+
+    for (auto& pShard : m_vShards)
+        if (pShard->m_Thread.joinable())
+            pShard->m_Thread.join();
+
+    m_vShards.clear();
+    m_pOut.reset();
+    m_pEvtOut.reset();
+}
+
+void IoShards::Attach(NodeConnection& c)
+{
+    assert(IsRunning() && c.m_Connection && !c.m_pShardLink);
+
+    Shard& s = *m_vShards[m_iNext++ % m_vShards.size()];
+    auto pLink = std::make_shared<Link>(*this, s, c);
+
+    // from now on the inbound cipher state is owned by the link. The rest is constant for the connection lifetime
+    ProtocolPlus& src = c.m_Protocol;
+    ProtocolPlus& dst = pLink->m_Protocol;
+    dst.m_Enc = src.m_Enc;
+    dst.m_CipherIn = src.m_CipherIn;
+    dst.m_HMac = src.m_HMac;
+    dst.m_Mode = ProtocolPlus::Mode::Duplex;
+
+    pLink->m_Reader.take_state(c.m_Connection->get_msg_reader());
+
+    c.m_pShardLink = std::move(pLink);
+    m_Stats.m_Links++;
+}
+
+void IoShards::Forward(Link& l, io::ErrorCode err, const void* p, size_t n)
+{
+    std::unique_ptr<ItemIn> pItem(new ItemIn);
+    pItem->m_pLink = l.shared_from_this();
+    pItem->m_Data.assign((const uint8_t*) p, (const uint8_t*) p + n);
+    pItem->m_Err = err;
+
+    l.m_InFlight += n;
+
+    if (l.m_Shard.m_In.Push(pItem.release()))
+        l.m_Shard.m_pEvt->post();
+}
+
+void IoShards::OnOut()
+{
+    for (Item* p = m_pOut->PopAll(); p; )
+    {
+        std::unique_ptr<ItemOut> pOut(static_cast<ItemOut*>(p));
+        p = p->m_pNext;
+
+        // the connection may be closed by the previous message
+        NodeConnection* pConn = pOut->m_pLink->m_pConn;
+        if (pConn)
+            pOut->Dispatch(*pConn);
+    }
+}
+
 /////////////////////////
 // NodeConnection
 NodeConnection::NodeConnection()
@@ -321,9 +718,19 @@ void NodeConnection::Reset()
     }
 
 	m_RulesCfgSent = false;
+
+    if (m_pShardLink)
+    {
+        m_pShardLink->m_pConn = nullptr;
+        m_pShardLink->m_Detached = true;
+        m_pShardLink->m_This.m_Stats.m_Links--;
+        m_pShardLink.reset();
+    }
+
     m_Connection = NULL;
     m_pAsyncFail = NULL;
     m_LoginFlags = 0;
+    m_InputPaused = false;
 
     m_Protocol.ResetVars();
 }
@@ -513,6 +920,92 @@ void NodeConnection::Accept(io::TcpStream::Ptr&& newStream)
         100,
         std::move(newStream)
         );
+
+    SetInput();
+}
+
+void NodeConnection::SetInput()
+{
+    io::Result res = m_Connection->set_input(
+        [this](io::ErrorCode err, void* p, size_t n) -> bool
+        { return OnInput(err, p, n); }
+    );
+
+    TestIoResultAsync(res);
+}
+
+bool NodeConnection::OnInput(io::ErrorCode err, void* p, size_t n)
+{
+    if (!m_pShardLink)
+    {
+        if (!m_Connection->get_msg_reader().new_data_from_stream(err, p, n))
+            return false; // at this moment, the *this* may be deleted
+
+        if (!m_Connection)
+            return true;
+
+        // once the secure channel is established - the rest of the inbound processing is moved to the shard
+        if ((ProtocolPlus::Mode::Duplex == m_Protocol.m_Mode) && m_pIoShards && m_pIoShards->IsRunning())
+            m_pIoShards->Attach(*this);
+
+        // paused by the handlers. Takes effect only now, the read buffer is in use while the messages are parsed
+        if (m_InputPaused)
+            m_Connection->pause_input();
+
+        return true;
+    }
+
+    IoShards::Link& l = *m_pShardLink;
+
+    if (err)
+    {
+        // the data forwarded so far must be dispatched first (may end with Bye), hence the error is queued behind it
+        l.m_Closed = true;
+        m_Connection->pause_input();
+        m_pIoShards->Forward(l, err, nullptr, 0);
+        return true;
+    }
+
+    if (p && n)
+    {
+        m_pIoShards->Forward(l, io::EC_OK, p, n);
+
+        if (!l.m_Paused && (l.m_InFlight > IoShards::s_MaxInFlight))
+        {
+            l.m_Paused = true;
+            m_Connection->pause_input();
+        }
+    }
+
+    return true;
+}
+
+void NodeConnection::PauseInput()
+{
+    if (m_InputPaused)
+        return;
+
+    m_InputPaused = true;
+
+    // with the shard the messages are dispatched outside of the socket input callback, it's safe to pause now
+    if (m_pShardLink && m_Connection)
+        m_Connection->pause_input();
+}
+
+void NodeConnection::ResumeInput()
+{
+    if (!m_InputPaused)
+        return;
+
+    m_InputPaused = false;
+
+    if (!m_Connection)
+        return;
+
+    if (m_pShardLink && (m_pShardLink->m_Paused || m_pShardLink->m_Closed))
+        return; // would be resumed by the shard
+
+    SetInput();
 }
 
 bool NodeConnection::IsLive() const
@@ -540,6 +1033,7 @@ bool NodeConnection::OnMsgInternal(uint64_t, msg##_NoInit&& v) \
     try { \
         /* checkpoint */ \
         TestInputMsgContext(code); \
+        OnMsgIn(code); \
         return OnMsg2(std::move(v)); \
     } catch (const NodeProcessingException& e) { \
         OnProcessingExc(e); \
@@ -21,8 +21,10 @@
 #include "../p2p/connection.h"
 #include "../utility/io/tcpserver.h"
 #include "../utility/io/timer.h"
+#include "../utility/io/asyncevent.h"
 #include "aes.h"
 #include "block_crypt.h"
+#include <atomic>
 
 namespace beam {
 namespace proto {
@@ -604,6 +606,21 @@ namespace proto {
 
 		bool Encrypt(ByteBuffer& res, const PeerID& publicAddr, ECC::Scalar::Native& nonce, const void*, uint32_t); // will fail iff addr is invalid
 		bool Decrypt(uint8_t*& p, uint32_t& n, const ECC::Scalar::Native& privateAddr);
+
+		// Trial decryption of the same message with many own addresses.
+		// The sender point is imported once, and its multiples table is shared by all the attempts.
+		// After Init the object is read-only, Decrypt may be called from several threads simultaneously.
+		struct Decryptor
+		{
+			bool Init(const uint8_t* p, uint32_t n); // fails if the message is malformed
+
+			// p must point to a copy of the message given in Init, which is decrypted in-place (as in Bbs::Decrypt).
+			// publicAddr must correspond to privateAddr, it's needed to derive the IV.
+			bool Decrypt(uint8_t*& p, uint32_t& n, const ECC::Scalar::Native& privateAddr, const PeerID& publicAddr) const;
+
+		private:
+			ECC::MultiMac::Casual m_Casual; // always in secure mode
+		};
 	};
 
 	struct TxStatus
@@ -739,9 +756,63 @@ namespace proto {
         Type m_type;
     };
 
+    class NodeConnection;
+
+    // Worker reactors for the inbound traffic of the node connections.
+    // Sockets stay on the owner reactor (libuv handles can't migrate between loops). Once the secure channel is established
+    // the raw input is forwarded to one of the shards, which does the decryption, MAC verification, framing and deserialization.
+    // Parsed messages are returned to the owner thread via the lock-free queue, and dispatched in order.
+    struct IoShards
+    {
+        struct Link;
+
+        struct Stats
+        {
+            std::atomic<uint64_t> m_Bytes;
+            std::atomic<uint64_t> m_Messages;
+            uint32_t m_Links; // currently attached
+        };
+
+        static uint32_t s_MaxInFlight; // per connection, the input is paused while more bytes are pending
+
+        IoShards();
+        ~IoShards();
+
+        void Start(uint32_t nThreads); // must be called from the owner reactor thread
+        void Stop();
+        bool IsRunning() const { return !m_vShards.empty(); }
+        const Stats& get_Stats() const { return m_Stats; }
+
+    private:
+        friend class NodeConnection;
+
+        struct Item;
+        struct ItemIn;
+        struct ItemOut;
+        struct ItemDone;
+        struct ItemErr;
+        struct ItemIoErr;
+        template <typename T> struct ItemMsg;
+        struct Queue;
+        struct Shard;
+
+        std::vector<std::unique_ptr<Shard> > m_vShards;
+        std::unique_ptr<Queue> m_pOut;
+        io::AsyncEvent::Ptr m_pEvtOut;
+        uint32_t m_iNext;
+        Stats m_Stats;
+
+        void Attach(NodeConnection&);
+        void Forward(Link&, io::ErrorCode, const void*, size_t); // in order, the error (if set) closes the input
+        void OnOut();
+        static void RunThread(const io::Reactor::Ptr&, const Rules&);
+    };
+
     class NodeConnection
         :public INodeMsgHandler
     {
+        friend struct IoShards;
+
         ProtocolPlus m_Protocol;
         std::unique_ptr<Connection> m_Connection;
         io::AsyncEvent::Ptr m_pAsyncFail;
@@ -767,8 +838,15 @@ namespace proto {
 
 		void OnLoginInternal(Login&&);
 
+        std::shared_ptr<IoShards::Link> m_pShardLink;
+        bool m_InputPaused = false;
+        void SetInput();
+        bool OnInput(io::ErrorCode, void* data, size_t size);
+
     public:
 
+        IoShards* m_pIoShards = nullptr; // if set and running - the inbound traffic is moved there once the channel is secure
+
         uint32_t m_LoginFlags;
         uint32_t get_Ext() const;
 
@@ -815,7 +893,13 @@ namespace proto {
 
         const Connection* get_Connection() { return m_Connection.get(); }
 
+        // Stop reading from the socket, i.e. back-pressure the peer. The messages that were already received are still delivered
+        void PauseInput();
+        void ResumeInput();
+        bool IsInputPaused() const { return m_InputPaused; }
+
         virtual void OnConnectedSecure() {}
+        virtual void OnMsgIn(uint8_t /* nCode */) {} // called for each inbound message, before it's handled
 
         struct ByeReason
         {
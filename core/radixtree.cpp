@@ -157,6 +157,56 @@ bool RadixTree::Goto(CursorBase& cu, const uint8_t* pKey, uint16_t nBits) const
 	cu.m_nBits = 0;
 	cu.m_nPosInLastNode = 0;
 
+	return GotoInternal(cu, pKey, nBits);
+}
+
+bool RadixTree::GotoNext(CursorBase& cu, const uint8_t* pKey, const uint8_t* pKeyPrev, uint16_t nBits) const
+{
+	// common prefix with the previous key
+	uint16_t nCommon = 0;
+	while ((nCommon + 8 <= nBits) && (pKey[nCommon >> 3] == pKeyPrev[nCommon >> 3]))
+		nCommon += 8;
+
+	while ((nCommon < nBits) && !(1 & (CursorBase::get_BitRawStat(pKey, nCommon) ^ CursorBase::get_BitRawStat(pKeyPrev, nCommon))))
+		nCommon++;
+
+	std::setmin(nCommon, cu.m_nBits); // the previous key matched the path only up to this
+
+	// rewind to the deepest node that the new key reaches as well
+	uint16_t nPos = 0;
+	if (cu.m_nPtrs)
+	{
+		uint16_t n = 0;
+		for (; n + 1 < cu.m_nPtrs; n++)
+		{
+			uint16_t nNext = nPos + cu.m_pp[n]->get_Bits() + 1;
+			if (nNext > nCommon)
+				break;
+			nPos = nNext;
+		}
+
+		cu.m_nPtrs = n + 1;
+	}
+	else
+	{
+		Node* p = get_Root();
+		if (p)
+		{
+			cu.m_pp[0] = p;
+			cu.m_nPtrs = 1;
+		}
+	}
+
+	cu.m_nBits = nPos;
+	cu.m_nPosInLastNode = 0;
+
+	return GotoInternal(cu, pKey, nBits);
+}
+
+bool RadixTree::GotoInternal(CursorBase& cu, const uint8_t* pKey, uint16_t nBits) const
+{
+	Node* p = cu.m_nPtrs ? cu.m_pp[cu.m_nPtrs - 1] : nullptr;
+
 	while (nBits > cu.m_nBits)
 	{
 		if (!p)
@@ -212,10 +262,23 @@ RadixTree::Leaf* RadixTree::Find(CursorBase& cu, const uint8_t* pKey, uint16_t n
 		return &cu.get_Leaf();
 	}
 
-	assert(cu.m_nBits < nBits);
+	return bCreate ? CreateAt(cu, pKey, nBits) : nullptr;
+}
+
+RadixTree::Leaf* RadixTree::FindNext(CursorBase& cu, const uint8_t* pKey, const uint8_t* pKeyPrev, uint16_t nBits, bool& bCreate)
+{
+	if (GotoNext(cu, pKey, pKeyPrev, nBits))
+	{
+		bCreate = false;
+		return &cu.get_Leaf();
+	}
 
-	if (!bCreate)
-		return nullptr;
+	return bCreate ? CreateAt(cu, pKey, nBits) : nullptr;
+}
+
+RadixTree::Leaf* RadixTree::CreateAt(CursorBase& cu, const uint8_t* pKey, uint16_t nBits)
+{
+	assert(cu.m_nBits < nBits);
 
 	OnDirty();
 
@@ -301,7 +364,11 @@ void RadixTree::Delete(CursorBase& cu)
 	DeleteLeaf(p);
 
 	if (1 == cu.m_nPtrs)
+	{
 		assert(!m_RootOffset);
+		cu.m_nPtrs = 0;
+		cu.m_nBits = 0;
+	}
 	else
 	{
 		cu.m_nPtrs--;
@@ -327,12 +394,20 @@ void RadixTree::Delete(CursorBase& cu)
 
 				pN->m_Bits += pPrev->m_Bits + 1;
 				ReplaceTip(cu, pN);
+				cu.m_pp[cu.m_nPtrs - 1] = pN;
 
 				DeleteJoint(pPrev);
 
 				break;
 			}
 		}
+
+		// the deleted key matched the path up to the (extended) tip
+		cu.m_nBits = 0;
+		for (uint16_t j = 0; j + 1 < cu.m_nPtrs; j++)
+			cu.m_nBits += cu.m_pp[j]->get_Bits() + 1;
+
+		cu.m_nPosInLastNode = 0;
 	}
 }
 
@@ -488,7 +563,81 @@ void RadixHashTree::get_Hash(Merkle::Hash& hv)
 		hv = Zero;
 }
 
-const Merkle::Hash& RadixHashTree::get_Hash(Node& n, Merkle::Hash& hv)
+void RadixHashTree::get_Hash(Merkle::Hash& hv, Executor& ex)
+{
+	uint32_t nThreads = ex.get_Threads();
+	Node* pRoot = get_Root();
+
+	if ((nThreads > 1) && pRoot && !(Node::s_Clean & pRoot->m_Bits))
+	{
+		// split the dirty part of the tree into independent subtrees
+		std::vector<Node*> vNodes, vNext;
+		vNodes.push_back(pRoot);
+
+		const size_t nTarget = nThreads * 8;
+		for (uint32_t nDepth = 0; (vNodes.size() < nTarget) && (nDepth < 32); nDepth++)
+		{
+			vNext.clear();
+			bool bExpanded = false;
+
+			for (Node* p : vNodes)
+			{
+				if (Node::s_Leaf & p->m_Bits)
+					vNext.push_back(p);
+				else
+				{
+					Joint& x = Cast::Up<Joint>(*p);
+					for (size_t i = 0; i < _countof(x.m_ppC); i++)
+					{
+						Node* pC = x.m_ppC[i].get_Strict();
+						if (!(Node::s_Clean & pC->m_Bits))
+							vNext.push_back(pC);
+					}
+
+					bExpanded = true;
+				}
+			}
+
+			if (!bExpanded)
+				break;
+
+			vNodes.swap(vNext);
+		}
+
+		if (vNodes.size() > 1)
+		{
+			struct MyTask
+				:public Executor::TaskSync
+			{
+				RadixHashTree* m_pThis;
+				const std::vector<Node*>* m_pNodes;
+
+				virtual void Exec(Executor::Context& ctx) override
+				{
+					uint32_t i0, nCount;
+					ctx.get_Portion(i0, nCount, static_cast<uint32_t>(m_pNodes->size()));
+
+					for (uint32_t i = 0; i < nCount; i++)
+					{
+						Merkle::Hash hvPlaceholder;
+						m_pThis->get_Hash(*m_pNodes->at(i0 + i), hvPlaceholder, false);
+					}
+				}
+			};
+
+			OnDirty(); // once, in advance
+
+			MyTask t;
+			t.m_pThis = this;
+			t.m_pNodes = &vNodes;
+			ex.ExecAll(t);
+		}
+	}
+
+	get_Hash(hv); // the rest, sequentially
+}
+
+const Merkle::Hash& RadixHashTree::get_Hash(Node& n, Merkle::Hash& hv, bool bNotify /* = true */)
 {
 	if (Node::s_Leaf & n.m_Bits)
 	{
@@ -496,7 +645,8 @@ const Merkle::Hash& RadixHashTree::get_Hash(Node& n, Merkle::Hash& hv)
 
 		if (!(Node::s_Clean & n.m_Bits))
 		{
-			OnDirty();
+			if (bNotify)
+				OnDirty();
 			n.m_Bits |= Node::s_Clean;
 		}
 
@@ -511,10 +661,11 @@ const Merkle::Hash& RadixHashTree::get_Hash(Node& n, Merkle::Hash& hv)
 		for (size_t i = 0; i < _countof(x.m_ppC); i++)
 		{
 			ECC::Hash::Value hvPlaceholder;
-			hp << get_Hash(*x.m_ppC[i].get_Strict(), hvPlaceholder);
+			hp << get_Hash(*x.m_ppC[i].get_Strict(), hvPlaceholder, bNotify);
 		}
 
-		OnDirty();
+		if (bNotify)
+			OnDirty();
 
 		hp >> x.m_Hash;
 		x.m_Bits |= Node::s_Clean;
@@ -140,7 +140,12 @@ public:
 
 	Leaf* Find(CursorBase& cu, const uint8_t* pKey, uint16_t nBits, bool& bCreate);
 
-	void Delete(CursorBase& cu);
+	void Delete(CursorBase& cu); // the cursor remains valid for the subsequent GotoNext/FindNext
+
+	// Batched access. The cursor is reused from the previous call (made with pKeyPrev), only the part of the path that diverges is traversed.
+	// Most efficient when the keys are sorted. The tree must not be modified in-between, except via this cursor.
+	bool GotoNext(CursorBase& cu, const uint8_t* pKey, const uint8_t* pKeyPrev, uint16_t nBits) const;
+	Leaf* FindNext(CursorBase& cu, const uint8_t* pKey, const uint8_t* pKeyPrev, uint16_t nBits, bool& bCreate);
 
 	struct ITraveler
 	{
@@ -169,6 +174,8 @@ protected:
 private:
 	void set_Root(Node*);
 
+	bool GotoInternal(CursorBase& cu, const uint8_t* pKey, uint16_t nBits) const;
+	Leaf* CreateAt(CursorBase& cu, const uint8_t* pKey, uint16_t nBits);
 	void DeleteNode(Node*);
 	void ReplaceTip(CursorBase& cu, Node* pNew);
 	bool Traverse(const Node&, ITraveler&) const;
@@ -187,6 +194,7 @@ public:
 	};
 
 	void get_Hash(Merkle::Hash&);
+	void get_Hash(Merkle::Hash&, Executor&); // dirty subtrees are evaluated in parallel
 	void get_Proof(Merkle::Proof&, const CursorBase&);
 
 protected:
@@ -194,7 +202,7 @@ protected:
 	virtual Joint* CreateJoint() override { return new MyJoint; }
 	virtual void DeleteJoint(Joint* p) override { delete Cast::Up<MyJoint>(p); }
 
-	const Merkle::Hash& get_Hash(Node&, Merkle::Hash&);
+	const Merkle::Hash& get_Hash(Node&, Merkle::Hash&, bool bNotify = true);
 
 	virtual const Merkle::Hash& get_LeafHash(Node&, Merkle::Hash&) = 0;
 };
@@ -219,6 +227,11 @@ public:
 		return Cast::Up<MyLeaf>(RadixTree::Find(cu, key.m_pData, ECC::nBits, bCreate));
 	}
 
+	MyLeaf* FindNext(CursorBase& cu, const Merkle::Hash& key, const Merkle::Hash& keyPrev, bool& bCreate)
+	{
+		return Cast::Up<MyLeaf>(RadixTree::FindNext(cu, key.m_pData, keyPrev.m_pData, ECC::nBits, bCreate));
+	}
+
 	~RadixHashOnlyTree() { Clear(); }
 
 protected:
@@ -290,6 +303,11 @@ public:
 		return Cast::Up<MyLeaf>(RadixTree::Find(cu, key.V.m_pData, key.s_Bits, bCreate));
 	}
 
+	MyLeaf* FindNext(CursorBase& cu, const Key& key, const Key& keyPrev, bool& bCreate)
+	{
+		return Cast::Up<MyLeaf>(RadixTree::FindNext(cu, key.V.m_pData, keyPrev.V.m_pData, key.s_Bits, bCreate));
+	}
+
 	~UtxoTree() { Clear(); }
 
 	void PushID(TxoID, MyLeaf&);
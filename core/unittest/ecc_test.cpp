@@ -20,6 +20,7 @@
 #include "../../utility/serialize.h"
 #include "../serialization_adapters.h"
 #include "../aes.h"
+#include "../radixtree.h"
 #include "../proto.h"
 #include "../lelantus.h"
 #include "../../utility/byteorder.h"
@@ -570,6 +571,57 @@ void TestPoints()
 	p0 = -p0;
 	p0 += p1;
 	verify_test(p0 == Zero);
+
+	// multi-scalar multiplication, both wNAF and bucket methods
+	const uint32_t nThreshold = MultiMac::Pippenger::s_Threshold;
+
+	for (uint32_t nCount : { 1U, 2U, 7U, 33U, 200U, 700U })
+	{
+		std::vector<Point::Native> vPts(nCount);
+		std::vector<Scalar::Native> vKs(nCount);
+
+		Scalar::Native kPrep;
+		SetRandom(kPrep);
+		p1 = Context::get().G * kPrep;
+
+		for (uint32_t i = 0; i < nCount; i++)
+		{
+			SetRandom(vPts[i]);
+			SetRandom(vKs[i]);
+
+			if (3 == i)
+				vPts[i] = Zero;
+			if (4 == i)
+				vKs[i] = Zero;
+			if (5 == i)
+				vKs[i] = -Scalar::Native(1U); // max value
+
+			p1 += vPts[i] * vKs[i];
+		}
+
+		for (uint32_t iMethod = 0; iMethod < 2; iMethod++)
+		{
+			MultiMac::Pippenger::s_Threshold = iMethod ? 1 : static_cast<uint32_t>(-1);
+
+			MultiMac_Dyn mm;
+			mm.Prepare(nCount, 1);
+
+			for (uint32_t i = 0; i < nCount; i++)
+			{
+				mm.m_pCasual[mm.m_Casual].Init(vPts[i]);
+				mm.m_pKCasual[mm.m_Casual++] = vKs[i];
+			}
+
+			mm.m_ppPrepared[0] = &Context::get().m_Ipp.G_;
+			mm.m_pKPrep[0] = kPrep;
+			mm.m_Prepared = 1;
+
+			mm.Calculate(p0);
+			verify_test(p0 == p1);
+		}
+	}
+
+	MultiMac::Pippenger::s_Threshold = nThreshold;
 }
 
 void TestSigning()
@@ -1491,6 +1543,51 @@ void TestAES()
 
 	sd.dec.Proceed(pBuf, pBuf); // inplace decode
 	verify_test(!memcmp(pBuf, pPlaintext, sizeof(pPlaintext)));
+
+	// CTR mode: https://nvlpubs.nist.gov/nistpubs/Legacy/SP/nistspecialpublication800-38a.pdf, F.5.5
+	const uint8_t pCtrPlaintext[AES::s_BlockSize * 4] = {
+		0x6B,0xC1,0xBE,0xE2,0x2E,0x40,0x9F,0x96,0xE9,0x3D,0x7E,0x11,0x73,0x93,0x17,0x2A,
+		0xAE,0x2D,0x8A,0x57,0x1E,0x03,0xAC,0x9C,0x9E,0xB7,0x6F,0xAC,0x45,0xAF,0x8E,0x51,
+		0x30,0xC8,0x1C,0x46,0xA3,0x5C,0xE4,0x11,0xE5,0xFB,0xC1,0x19,0x1A,0x0A,0x52,0xEF,
+		0xF6,0x9F,0x24,0x45,0xDF,0x4F,0x9B,0x17,0xAD,0x2B,0x41,0x7B,0xE6,0x6C,0x37,0x10
+	};
+
+	const uint8_t pCtrCiphertext[AES::s_BlockSize * 4] = {
+		0x60,0x1E,0xC3,0x13,0x77,0x57,0x89,0xA5,0xB7,0xA7,0xF5,0x04,0xBB,0xF3,0xD2,0x28,
+		0xF4,0x43,0xE3,0xCA,0x4D,0x62,0xB5,0x9A,0xCA,0x84,0xE9,0x90,0xCA,0xCA,0xF5,0xC5,
+		0x2B,0x09,0x30,0xDA,0xA2,0x3D,0xE9,0x4C,0xE8,0x70,0x17,0xBA,0x2D,0x84,0x98,0x8D,
+		0xDF,0xC9,0xC5,0x8D,0xB6,0x7A,0xAD,0xA6,0x13,0xC2,0xDD,0x08,0x45,0x79,0x41,0xA6
+	};
+
+	const bool bUseHw = AES::s_UseHw;
+
+	for (uint32_t iPass = 0; iPass < 2; iPass++)
+	{
+		AES::s_UseHw = iPass && bUseHw; // portable and hw-accelerated (if supported)
+
+		// different portions, to cover partial and batched blocks
+		for (uint32_t nPortion = 1; nPortion <= sizeof(pCtrPlaintext); nPortion += 7)
+		{
+			AES::StreamCipher asc;
+			asc.Reset();
+			for (uint32_t i = 0; i < AES::s_BlockSize; i++)
+				asc.m_Counter.m_pData[i] = static_cast<uint8_t>(0xf0 + i);
+
+			uint8_t pCtrBuf[sizeof(pCtrPlaintext)];
+			memcpy(pCtrBuf, pCtrPlaintext, sizeof(pCtrBuf));
+
+			for (uint32_t nDone = 0; nDone < sizeof(pCtrBuf); )
+			{
+				uint32_t n = std::min(nPortion, static_cast<uint32_t>(sizeof(pCtrBuf)) - nDone);
+				asc.XCrypt(se.enc, pCtrBuf + nDone, n);
+				nDone += n;
+			}
+
+			verify_test(!memcmp(pCtrBuf, pCtrCiphertext, sizeof(pCtrBuf)));
+		}
+	}
+
+	AES::s_UseHw = bUseHw;
 }
 
 void TestKdfPair(Key::IKdf& skdf, Key::IPKdf& pkdf)
@@ -1596,6 +1693,38 @@ void TestBbs()
 	n = (uint32_t) buf.size();
 
 	verify_test(!beam::proto::Bbs::Decrypt(p, n, privateAddr));
+
+	// batched trial decryption, the shared decryptor with several addresses
+	const uint32_t nAddrs = 5, iMatch = 3;
+	Scalar::Native pSk[nAddrs];
+	beam::PeerID pPk[nAddrs];
+	for (uint32_t i = 0; i < nAddrs; i++)
+	{
+		SetRandom(pSk[i]);
+		pPk[i].FromSk(pSk[i]);
+	}
+
+	SetRandom(nonce);
+	verify_test(beam::proto::Bbs::Encrypt(buf, pPk[iMatch], nonce, szMsg, sizeof(szMsg)));
+
+	beam::proto::Bbs::Decryptor dec;
+	verify_test(dec.Init(&buf.at(0), (uint32_t) buf.size()));
+	verify_test(!dec.Init(&buf.at(0), 10));
+
+	for (uint32_t i = 0; i < nAddrs; i++)
+	{
+		beam::ByteBuffer buf2 = buf;
+		p = &buf2.at(0);
+		n = (uint32_t) buf2.size();
+
+		bool bOk = dec.Decrypt(p, n, pSk[i], pPk[i]);
+		verify_test(bOk == (iMatch == i));
+		if (bOk)
+		{
+			verify_test(n == sizeof(szMsg));
+			verify_test(!memcmp(p, szMsg, n));
+		}
+	}
 }
 
 void TestRatio(const beam::Difficulty& d0, const beam::Difficulty& d1, double k)
@@ -2699,6 +2828,53 @@ void RunBenchmark()
 		} while (bm.ShouldContinue());
 	}
 
+	{
+		Mode::Scope scope(Mode::Fast);
+		const uint32_t nThreshold = MultiMac::Pippenger::s_Threshold;
+
+		for (uint32_t nCount = 16; nCount <= 0x4000; nCount <<= 2)
+		{
+			MultiMac_Dyn mm;
+			mm.Prepare(nCount, 0);
+
+			std::vector<Point::Native> vPts(nCount);
+			std::vector<Scalar::Native> vKs(nCount);
+			for (uint32_t i = 0; i < nCount; i++)
+			{
+				SetRandom(vPts[i]);
+				SetRandom(vKs[i]);
+			}
+
+			for (uint32_t iMethod = 0; iMethod < 2; iMethod++)
+			{
+				MultiMac::Pippenger::s_Threshold = iMethod ? 1 : static_cast<uint32_t>(-1);
+
+				char sz[0x40];
+				snprintf(sz, sizeof(sz), "MultiMac.%s x%u", iMethod ? "Bucket" : "wNAF", nCount);
+
+				BenchmarkMeter bm(sz);
+				bm.N = 1;
+				do
+				{
+					for (uint32_t n = 0; n < bm.N; n++)
+					{
+						mm.Reset();
+						for (uint32_t i = 0; i < nCount; i++)
+						{
+							mm.m_pCasual[mm.m_Casual].Init(vPts[i]);
+							mm.m_pKCasual[mm.m_Casual++] = vKs[i];
+						}
+
+						mm.Calculate(p0);
+					}
+
+				} while (bm.ShouldContinue());
+			}
+		}
+
+		MultiMac::Pippenger::s_Threshold = nThreshold;
+	}
+
 	{
 		AES::Encoder enc;
 		enc.Init(hv.m_pData);
@@ -2707,17 +2883,95 @@ void RunBenchmark()
 
 		uint8_t pBuf[0x400];
 
-		BenchmarkMeter bm("AES.XCrypt-1MB");
-		bm.N = 10;
-		do
+		const bool bUseHw = AES::s_UseHw;
+
+		for (uint32_t iPass = 0; iPass < 2; iPass++)
 		{
-			for (uint32_t i = 0; i < bm.N; i++)
+			AES::s_UseHw = iPass && bUseHw;
+			if (iPass && !bUseHw)
+				break; // not supported
+
+			BenchmarkMeter bm(iPass ? "AES.XCrypt-1MB.Hw" : "AES.XCrypt-1MB");
+			bm.N = 10;
+			do
 			{
-				for (size_t nSize = 0; nSize < 0x100000; nSize += sizeof(pBuf))
-					asc.XCrypt(enc, pBuf, sizeof(pBuf));
-			}
+				for (uint32_t i = 0; i < bm.N; i++)
+				{
+					for (size_t nSize = 0; nSize < 0x100000; nSize += sizeof(pBuf))
+						asc.XCrypt(enc, pBuf, sizeof(pBuf));
+				}
 
-		} while (bm.ShouldContinue());
+			} while (bm.ShouldContinue());
+		}
+
+		AES::s_UseHw = bUseHw;
+	}
+
+	{
+		// UtxoTree update: per-key Find/Delete and sequential hash vs sorted batch via FindNext and parallel hash
+		std::vector<beam::UtxoTree::Key> vKeys(100000);
+		for (uint32_t i = 0; i < vKeys.size(); i++)
+		{
+			beam::UtxoTree::Key::Data d;
+			GenRandom(d.m_Commitment.m_X);
+			d.m_Commitment.m_Y = 1 & i;
+			d.m_Maturity = i;
+			vKeys[i] = d;
+		}
+
+		std::sort(vKeys.begin(), vKeys.end(), [](const beam::UtxoTree::Key& a, const beam::UtxoTree::Key& b) { return a.V < b.V; });
+
+		beam::ExecutorMT_R ex;
+
+		for (uint32_t iMethod = 0; iMethod < 2; iMethod++)
+		{
+			char sz[0x40];
+			snprintf(sz, sizeof(sz), "UtxoTree.%s x%u", iMethod ? "Batch" : "PerKey", static_cast<uint32_t>(vKeys.size()));
+
+			BenchmarkMeter bm(sz);
+			bm.N = 1;
+			do
+			{
+				for (uint32_t n = 0; n < bm.N; n++)
+				{
+					beam::UtxoTree t;
+					beam::UtxoTree::Cursor cu;
+					Hash::Value hv;
+
+					for (uint32_t i = 0; i < vKeys.size(); i++)
+					{
+						bool bCreate = true;
+						beam::UtxoTree::MyLeaf* p = (iMethod && i) ?
+							t.FindNext(cu, vKeys[i], vKeys[i - 1], bCreate) :
+							t.Find(cu, vKeys[i], bCreate);
+
+						p->m_ID = i;
+					}
+
+					if (iMethod)
+						t.get_Hash(hv, ex);
+					else
+						t.get_Hash(hv);
+
+					for (uint32_t i = 0; i < vKeys.size(); i += 2)
+					{
+						bool bCreate = false;
+						if (iMethod && i)
+							t.FindNext(cu, vKeys[i], vKeys[i - 2], bCreate);
+						else
+							t.Find(cu, vKeys[i], bCreate);
+
+						t.Delete(cu);
+					}
+
+					if (iMethod)
+						t.get_Hash(hv, ex);
+					else
+						t.get_Hash(hv);
+				}
+
+			} while (bm.ShouldContinue());
+		}
 	}
 
 	{
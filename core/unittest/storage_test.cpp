@@ -15,6 +15,7 @@
 #include <iostream>
 #include "../radixtree.h"
 #include "../navigator.h"
+#include "../block_crypt.h"
 #include "../../utility/serialize.h"
 
 #ifndef WIN32
@@ -412,6 +413,130 @@ namespace beam
 		verify_test(hv1 == hv2);
 	}
 
+	void TestUtxoTreeBatch()
+	{
+		std::vector<UtxoTree::Key> vKeys;
+		vKeys.resize(2000);
+
+		for (uint32_t i = 0; i < vKeys.size(); i++)
+		{
+			UtxoTree::Key::Data d;
+			SetRandomUtxoKey(d);
+			vKeys[i] = d;
+		}
+
+		std::sort(vKeys.begin(), vKeys.end(), [](const UtxoTree::Key& a, const UtxoTree::Key& b) { return a.V < b.V; });
+		vKeys.erase(std::unique(vKeys.begin(), vKeys.end(), [](const UtxoTree::Key& a, const UtxoTree::Key& b) { return a.V == b.V; }), vKeys.end());
+
+		UtxoTree t1, t2;
+		Merkle::Hash hv1, hv2;
+
+		// insert, per-key vs batched
+		for (uint32_t i = 0; i < vKeys.size(); i++)
+		{
+			UtxoTree::Cursor cu;
+			bool bCreate = true;
+			UtxoTree::MyLeaf* p = t1.Find(cu, vKeys[i], bCreate);
+
+			verify_test(p && bCreate);
+			SetLeafIDs(t1, *p, i, false);
+		}
+
+		UtxoTree::Cursor cu;
+		for (uint32_t i = 0; i < vKeys.size(); i++)
+		{
+			bool bCreate = true;
+			UtxoTree::MyLeaf* p = i ?
+				t2.FindNext(cu, vKeys[i], vKeys[i - 1], bCreate) :
+				t2.Find(cu, vKeys[i], bCreate);
+
+			verify_test(p && bCreate);
+			SetLeafIDs(t2, *p, i, false);
+		}
+
+		// hash, sequential vs parallel
+		t1.get_Hash(hv1);
+
+		ExecutorMT_R ex;
+		if (ex.get_Threads() < 4)
+			ex.set_Threads(4); // make sure the parallel path is exercised
+
+		t2.get_Hash(hv2, ex);
+
+		verify_test(hv1 == hv2);
+
+		// lookup of all the keys, including misses
+		UtxoTree::Key keyPrev = vKeys[vKeys.size() - 1]; // the cursor is at the last inserted key
+		for (uint32_t i = 0; i < vKeys.size(); i++)
+		{
+			bool bCreate = false;
+			UtxoTree::MyLeaf* p = t2.FindNext(cu, vKeys[i], keyPrev, bCreate);
+			verify_test(p && !bCreate && (p->m_Key.V == vKeys[i].V));
+
+			UtxoTree::Key::Data d;
+			d = vKeys[i];
+			d.m_Maturity++;
+			keyPrev = d;
+
+			if (std::binary_search(vKeys.begin(), vKeys.end(), keyPrev, [](const UtxoTree::Key& a, const UtxoTree::Key& b) { return a.V < b.V; }))
+				keyPrev = vKeys[i];
+			else
+				verify_test(!t2.FindNext(cu, keyPrev, vKeys[i], bCreate));
+		}
+
+		// delete every other key, per-key vs batched
+		for (uint32_t i = 0; i < vKeys.size(); i += 2)
+		{
+			bool bCreate = false;
+			UtxoTree::MyLeaf* p = t1.Find(cu, vKeys[i], bCreate);
+
+			verify_test(p && !bCreate);
+			SetLeafIDs(t1, *p, i, true);
+			t1.Delete(cu);
+		}
+
+		for (uint32_t i = 0; i < vKeys.size(); i += 2)
+		{
+			bool bCreate = false;
+			UtxoTree::MyLeaf* p = i ?
+				t2.FindNext(cu, vKeys[i], vKeys[i - 2], bCreate) :
+				t2.Find(cu, vKeys[i], bCreate);
+
+			verify_test(p && !bCreate);
+			SetLeafIDs(t2, *p, i, true);
+			t2.Delete(cu);
+		}
+
+		t1.get_Hash(hv1);
+		t2.get_Hash(hv2, ex);
+		verify_test(hv1 == hv2);
+		verify_test(t1.Count() == t2.Count());
+
+		// delete the rest, backwards, down to an empty tree
+		uint32_t jLast = (uint32_t) (vKeys.size() - 1) | 1;
+		if (jLast >= vKeys.size())
+			jLast -= 2;
+
+		for (uint32_t j = jLast; ; j -= 2)
+		{
+			bool bCreate = false;
+			UtxoTree::MyLeaf* p = (j < jLast) ?
+				t2.FindNext(cu, vKeys[j], vKeys[j + 2], bCreate) :
+				t2.Find(cu, vKeys[j], bCreate);
+
+			verify_test(p && !bCreate);
+			SetLeafIDs(t2, *p, j, true);
+			t2.Delete(cu);
+
+			if (1 == j)
+				break;
+		}
+
+		t2.get_Hash(hv2, ex);
+		verify_test(hv2 == Zero);
+		verify_test(!t2.Count());
+	}
+
 	struct MyMmr
 		:public Merkle::Mmr
 	{
@@ -487,6 +612,53 @@ namespace beam
 		}
 	};
 
+	void TestMultiInterpret()
+	{
+		std::vector<Merkle::Hash> vIn, vRef, vOut;
+		vIn.resize(2 * 37);
+		for (uint32_t i = 0; i < vIn.size(); i++)
+			for (uint32_t j = 0; j < vIn[i].nBytes; j++)
+				vIn[i].m_pData[j] = (uint8_t) rand();
+
+		vRef.resize(vIn.size() / 2);
+		for (uint32_t i = 0; i < vRef.size(); i++)
+			Merkle::Interpret(vRef[i], vIn[2 * i], vIn[2 * i + 1]);
+
+		const Merkle::MultiInterpret::Impl pImpl[] = {
+			Merkle::MultiInterpret::Impl::Std,
+			Merkle::MultiInterpret::Impl::Avx2,
+			Merkle::MultiInterpret::Impl::ShaNi,
+		};
+
+		const Merkle::MultiInterpret::Impl eDetected = Merkle::MultiInterpret::s_Impl;
+
+		for (uint32_t iImpl = 0; iImpl < _countof(pImpl); iImpl++)
+		{
+			if (!Merkle::MultiInterpret::IsSupported(pImpl[iImpl]))
+				continue;
+
+			Merkle::MultiInterpret::s_Impl = pImpl[iImpl];
+
+			for (uint32_t n = 0; n <= vRef.size(); n++)
+			{
+				vOut.assign(vIn.begin(), vIn.end());
+				Merkle::MultiInterpret::Do(&vOut.front(), &vIn.front(), n);
+
+				for (uint32_t i = 0; i < n; i++)
+					verify_test(vOut[i] == vRef[i]);
+
+				// in-place
+				vOut.assign(vIn.begin(), vIn.end());
+				Merkle::MultiInterpret::Do(&vOut.front(), &vOut.front(), n);
+
+				for (uint32_t i = 0; i < n; i++)
+					verify_test(vOut[i] == vRef[i]);
+			}
+		}
+
+		Merkle::MultiInterpret::s_Impl = eDetected;
+	}
+
 	void TestMmr()
 	{
 		std::vector<Merkle::Hash> vHashes;
@@ -675,6 +847,8 @@ int main()
 {
 	beam::TestNavigator();
 	beam::TestUtxoTree();
+	beam::TestUtxoTreeBatch();
+	beam::TestMultiInterpret();
 	beam::TestMmr();
 
 	return g_TestsFailed ? -1 : 0;
@@ -21,6 +21,7 @@
 #include "nlohmann/json.hpp"
 #include "utility/helpers.h"
 #include "utility/logger.h"
+#include "utility/metrics.h"
 
 #include "wallet/core/common.h"
 #include "wallet/core/common_utils.h"
@@ -29,6 +30,7 @@
 #include "wallet/client/wallet_client.h"
 #include "wallet/client/extensions/broadcast_gateway/broadcast_router.h"
 #include "wallet/core/wallet_network.h"
+#include <sstream>
 #ifdef BEAM_ATOMIC_SWAP_SUPPORT
 #include <boost/algorithm/string.hpp>
 #include <boost/serialization/nvp.hpp>
@@ -1339,6 +1341,16 @@ private:
         return true;
     }
 
+    bool get_metrics(io::SerializedMsg& out) override
+    {
+        std::ostringstream os;
+        Metrics::Registry::get().WritePrometheus(os);
+
+        std::string s = os.str();
+        out.push_back({ s.data(), s.size() });
+        return true;
+    }
+
     bool get_peers(io::SerializedMsg& out) override
     {
         auto& peers = _node.get_AcessiblePeerAddrs();
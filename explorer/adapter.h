@@ -40,6 +40,9 @@ struct IAdapter {
 
     virtual bool get_peers(io::SerializedMsg& out) = 0;
 
+    /// Returns body for /metrics request, in Prometheus text format
+    virtual bool get_metrics(io::SerializedMsg& out) = 0;
+
 #ifdef BEAM_ATOMIC_SWAP_SUPPORT
     virtual bool get_swap_offers(io::SerializedMsg& out) = 0;
 
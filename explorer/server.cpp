@@ -35,6 +35,7 @@ enum Dirs {
     , DIR_BLOCK
     , DIR_BLOCKS
     , DIR_PEERS
+    , DIR_METRICS
 #ifdef BEAM_ATOMIC_SWAP_SUPPORT
     , DIR_SWAP_OFFERS
     , DIR_SWAPS_STATUS
@@ -125,6 +126,7 @@ bool Server::on_request(uint64_t id, const HttpMsgReader::Message& msg) {
         , { "block", DIR_BLOCK }
         , { "blocks", DIR_BLOCKS }
         , { "peers", DIR_PEERS }
+        , { "metrics", DIR_METRICS }
 #ifdef BEAM_ATOMIC_SWAP_SUPPORT
         , { "swap_offers", DIR_SWAP_OFFERS }
         , { "swap_totals", DIR_SWAPS_STATUS }
@@ -151,6 +153,9 @@ bool Server::on_request(uint64_t id, const HttpMsgReader::Message& msg) {
             case DIR_PEERS:
                 func = &Server::send_peers;
                 break;
+            case DIR_METRICS:
+                func = &Server::send_metrics;
+                break;
 #ifdef BEAM_ATOMIC_SWAP_SUPPORT
             case DIR_SWAP_OFFERS:
                 func = &Server::send_swap_offers;
@@ -247,6 +252,13 @@ bool Server::send_peers(const HttpConnection::Ptr& conn) {
     return send(conn, 200, "OK");
 }
 
+bool Server::send_metrics(const HttpConnection::Ptr& conn) {
+    if (!_backend.get_metrics(_body)) {
+        return send(conn, 500, "Internal error #3");
+    }
+    return send(conn, 200, "OK", "text/plain; version=0.0.4");
+}
+
 #ifdef BEAM_ATOMIC_SWAP_SUPPORT
 bool Server::send_swap_offers(const HttpConnection::Ptr& conn) {
     if (!_backend.get_swap_offers(_body)) {
@@ -286,7 +298,7 @@ bool Server::send_contract_details(const HttpConnection::Ptr& conn) {
     return send(conn, 200, "OK");
 }
 
-bool Server::send(const HttpConnection::Ptr& conn, int code, const char* message) {
+bool Server::send(const HttpConnection::Ptr& conn, int code, const char* message, const char* contentType) {
     assert(conn);
 
     size_t bodySize = 0;
@@ -299,7 +311,7 @@ bool Server::send(const HttpConnection::Ptr& conn, int code, const char* message
         0, //headers,
         0, //sizeof(headers) / sizeof(HeaderPair),
         1,
-        "application/json",
+        contentType,
         bodySize
     );
 
@@ -53,13 +53,14 @@ private:
     bool send_block(const HttpConnection::Ptr& conn);
     bool send_blocks(const HttpConnection::Ptr& conn);
     bool send_peers(const HttpConnection::Ptr& conn);
+    bool send_metrics(const HttpConnection::Ptr& conn);
     bool send_contracts(const HttpConnection::Ptr& conn);
     bool send_contract_details(const HttpConnection::Ptr& conn);
 #ifdef BEAM_ATOMIC_SWAP_SUPPORT
     bool send_swap_offers(const HttpConnection::Ptr& conn);
     bool send_swap_totals(const HttpConnection::Ptr& conn);
 #endif  // BEAM_ATOMIC_SWAP_SUPPORT
-    bool send(const HttpConnection::Ptr& conn, int code, const char* message);
+    bool send(const HttpConnection::Ptr& conn, int code, const char* message, const char* contentType = "application/json");
 
     HttpMsgCreator _msgCreator;
     IAdapter& _backend;
@@ -24,11 +24,43 @@ namespace beam::wallet
 
     /////////////////////////
     // LocalPrivateKeyKeeper2
+    uint32_t LocalPrivateKeyKeeper2::s_ParallelBatchThreshold = 8;
+
     LocalPrivateKeyKeeper2::LocalPrivateKeyKeeper2(const Key::IKdf::Ptr& pKdf)
         :m_pKdf(pKdf)
     {
     }
 
+    struct LocalPrivateKeyKeeper2::BatchTask
+        :public Executor::TaskSync
+    {
+        uint32_t m_Count;
+
+        virtual void ExecOne(uint32_t i) = 0;
+
+        void Exec(Executor::Context& ctx) override
+        {
+            uint32_t i0, nCount;
+            ctx.get_Portion(i0, nCount, m_Count);
+
+            for (uint32_t i = 0; i < nCount; i++)
+                ExecOne(i0 + i);
+        }
+
+        void Run(LocalPrivateKeyKeeper2& kk)
+        {
+            if ((m_Count >= s_ParallelBatchThreshold) && (kk.m_BatchExecutor.get_Threads() > 1))
+            {
+                std::unique_lock<std::mutex> scope(kk.m_BatchMutex);
+                kk.m_BatchExecutor.ExecAll(*this);
+                return;
+            }
+
+            for (uint32_t i = 0; i < m_Count; i++)
+                ExecOne(i);
+        }
+    };
+
     IPrivateKeyKeeper2::Status::Type LocalPrivateKeyKeeper2::ToImage(Point::Native& res, uint32_t iGen, const Scalar::Native& sk)
     {
         const Generator::Obscured* pGen;
@@ -161,13 +193,45 @@ namespace beam::wallet
     {
         Values& vals = bOuts ? m_Outs : m_Ins;
 
+        // the blinding factors are independent, for large txs (splits, payouts) they're derived in parallel
+        std::vector<Scalar::Native> vSk;
+        if (v.size() >= s_ParallelBatchThreshold)
+        {
+            struct Task :public BatchTask
+            {
+                const CoinID* m_pCid;
+                Scalar::Native* m_pSk;
+                const Key::IKdf::Ptr* m_ppKdf;
+
+                void ExecOne(uint32_t i) override
+                {
+                    const CoinID& cid = m_pCid[i];
+                    CoinID::Worker(cid).Create(m_pSk[i], *cid.get_ChildKdf(*m_ppKdf));
+                }
+            };
+
+            vSk.resize(v.size());
+
+            Task t;
+            t.m_Count = static_cast<uint32_t>(v.size());
+            t.m_pCid = &v.front();
+            t.m_pSk = &vSk.front();
+            t.m_ppKdf = &m_This.m_pKdf;
+            t.Run(m_This);
+        }
+
         Scalar::Native sk;
         for (size_t i = 0; i < v.size(); i++)
         {
             const CoinID& cid = v[i];
 
-            CoinID::Worker(cid).Create(sk, *cid.get_ChildKdf(m_This.m_pKdf));
-            m_sk += sk;
+            if (vSk.empty())
+            {
+                CoinID::Worker(cid).Create(sk, *cid.get_ChildKdf(m_This.m_pKdf));
+                m_sk += sk;
+            }
+            else
+                m_sk += vSk[i];
 
             if (m_NonConventional)
                 continue; // ignore values
@@ -283,6 +347,65 @@ namespace beam::wallet
         return Status::Success;
     }
 
+    IPrivateKeyKeeper2::Status::Type LocalPrivateKeyKeeper2::InvokeSync(Method::CreateOutputs& x)
+    {
+        // The child kdfs are derived once per batch, then the outputs (mostly the range proofs) are created in parallel.
+        // The bulletproof generators are precomputed in the ECC context, so there's nothing else to share among the outputs.
+        struct Task :public BatchTask
+        {
+            Method::CreateOutput* m_pOuts;
+            const Key::IKdf::Ptr* m_ppKdf; // per output
+            Key::IKdf* m_pMaster;
+
+            void ExecOne(uint32_t i) override
+            {
+                Method::CreateOutput& m = m_pOuts[i];
+
+                Scalar::Native sk;
+                m.m_pResult->Create(m.m_hScheme, sk, *m_ppKdf[i], m.m_Cid, *m_pMaster, Output::OpCode::Standard, &m.m_User);
+            }
+        };
+
+        uint32_t nCount = static_cast<uint32_t>(x.m_vOutputs.size());
+        if (!nCount)
+            return Status::Success;
+
+        std::vector<Key::IKdf::Ptr> vKdf(nCount);
+        std::map<Key::Index, Key::IKdf::Ptr> mapChild;
+
+        for (uint32_t i = 0; i < nCount; i++)
+        {
+            Method::CreateOutput& m = x.m_vOutputs[i];
+
+            // disallow weak paramters
+            if (IsTrustless() && (m.m_hScheme < Rules::get().pForks[1].m_Height))
+                return Status::Unspecified;
+
+            Key::Index iChild;
+            if (m.m_Cid.get_ChildKdfIndex(iChild))
+            {
+                Key::IKdf::Ptr& pChild = mapChild[iChild];
+                if (!pChild)
+                    pChild = MasterKey::get_Child(*m_pKdf, iChild);
+
+                vKdf[i] = pChild;
+            }
+            else
+                vKdf[i] = m_pKdf;
+
+            m.m_pResult.reset(new Output);
+        }
+
+        Task t;
+        t.m_Count = nCount;
+        t.m_pOuts = &x.m_vOutputs.front();
+        t.m_ppKdf = &vKdf.front();
+        t.m_pMaster = m_pKdf.get();
+        t.Run(*this);
+
+        return Status::Success;
+    }
+
     IPrivateKeyKeeper2::Status::Type LocalPrivateKeyKeeper2::InvokeSync(Method::CreateInputShielded& x)
     {
         assert(x.m_pKernel && x.m_pList);
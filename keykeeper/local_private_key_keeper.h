@@ -30,6 +30,7 @@ namespace beam::wallet
         static void UpdateOffset(Method::TxCommon&, const ECC::Scalar::Native& kDiff, const ECC::Scalar::Native& kKrn);
 
         struct Aggregation;
+        struct BatchTask;
 
     public:
 
@@ -41,10 +42,20 @@ namespace beam::wallet
         KEY_KEEPER_METHODS(THE_MACRO)
 #undef THE_MACRO
 
+        virtual Status::Type InvokeSync(Method::CreateOutputs& m) override;
+
+        // batches (outputs, coins to aggregate) of at least that size are processed on all the cores
+        static uint32_t s_ParallelBatchThreshold;
+
     protected:
 
         ECC::Key::IKdf::Ptr m_pKdf;
 
+        // shared by all the batches, its threads are created on first use. Batches invoked concurrently (from several
+        // ThreadedPrivateKeyKeeper workers) are serialized, so that there are never more batch threads than cores
+        std::mutex m_BatchMutex;
+        ExecutorMT_R m_BatchExecutor;
+
         // make nonce generation abstract, to enable testing the code with predefined nonces
         virtual Slot::Type get_NumSlots() = 0;
         virtual void get_Nonce(ECC::Scalar::Native&, Slot::Type) = 0;
@@ -0,0 +1,429 @@
+// Copyright 2018 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "bbs_store.h"
+#include "../utility/logger.h"
+#include <boost/filesystem.hpp>
+#include <cinttypes>
+
+namespace beam {
+
+namespace fs = boost::filesystem;
+
+void BbsStore::Open(const char* szDir, uint64_t nStamp)
+{
+	Close();
+
+	fs::path pathDir(szDir);
+	fs::create_directories(pathDir);
+
+	// the stamp ties the store to the node db. If the db was re-created - the store is discarded
+	fs::path pathStamp = pathDir / "stamp";
+	uint64_t nStampPrev = 0;
+	{
+		std::FILE* pF = std::fopen(pathStamp.string().c_str(), "rb");
+		if (pF)
+		{
+			if (1 != std::fread(&nStampPrev, sizeof(nStampPrev), 1, pF))
+				nStampPrev = 0;
+			std::fclose(pF);
+		}
+	}
+
+	bool bReset = (nStampPrev != nStamp);
+
+	std::vector<std::pair<uint64_t, fs::path> > vFiles;
+	for (fs::directory_iterator it(pathDir); fs::directory_iterator() != it; ++it)
+	{
+		const fs::path& p = it->path();
+		if (p.extension() != ".seg")
+			continue;
+
+		if (bReset)
+		{
+			fs::remove(p);
+			continue;
+		}
+
+		uint64_t id0 = std::strtoull(p.stem().string().c_str(), nullptr, 16);
+		if (id0)
+			vFiles.emplace_back(id0, p);
+	}
+
+	if (bReset)
+	{
+		std::FILE* pF = std::fopen(pathStamp.string().c_str(), "wb");
+		if (!pF)
+			throw std::runtime_error("can't write bbs stamp");
+
+		bool bOk = (1 == std::fwrite(&nStamp, sizeof(nStamp), 1, pF));
+		std::fclose(pF);
+		if (!bOk)
+			throw std::runtime_error("can't write bbs stamp");
+	}
+
+	std::sort(vFiles.begin(), vFiles.end());
+
+	m_sDir = szDir;
+	m_Totals.m_Count = 0;
+	m_Totals.m_Size = 0;
+
+	for (const auto& x : vFiles)
+	{
+		auto pSeg = std::make_unique<Segment>();
+		pSeg->m_ID0 = x.first;
+		pSeg->m_sPath = x.second.string();
+		pSeg->m_File.Open(pSeg->m_sPath.c_str());
+
+		if (x.first <= m_LastID)
+			pSeg->m_vPos.clear(); // overlapping segment, ignore it
+		else
+			Load(*pSeg);
+
+		if (pSeg->m_vPos.empty())
+		{
+			pSeg->m_File.Close();
+			fs::remove(x.second);
+			continue;
+		}
+
+		m_LastID = pSeg->get_IDEnd() - 1;
+		m_Segments.push_back(std::move(pSeg));
+	}
+
+	if (!m_Segments.empty())
+	{
+		// cut the unused tail of the last segment, so that appending resumes at zeroed space
+		Segment& s = *m_Segments.back();
+		s.m_File.CloseMapping();
+		s.m_File.Resize(s.m_Size);
+		s.m_File.OpenMapping();
+	}
+
+	LOG_INFO() << "Bbs store: " << m_Segments.size() << " segments, " << m_Totals.m_Count << " messages";
+}
+
+void BbsStore::Close()
+{
+	m_Segments.clear();
+	m_Keys.clear();
+	m_Channels.clear();
+	m_sDir.clear();
+	m_LastID = 0;
+	m_Totals.m_Count = 0;
+	m_Totals.m_Size = 0;
+}
+
+template <typename T>
+T BbsStore_AlignUp(T x)
+{
+	return (x + 7) & ~T(7);
+}
+
+void BbsStore::Load(Segment& s)
+{
+	const MappedFileRaw& f = s.m_File;
+
+	for (MappedFileRaw::Offset nPos = 0; nPos + sizeof(Hdr) <= f.m_nMapping; )
+	{
+		const Hdr& hdr = f.get_At<Hdr>(nPos);
+		if (hdr.m_ID != s.get_IDEnd())
+			break;
+
+		MappedFileRaw::Offset nNext = nPos + sizeof(Hdr) + hdr.m_Size;
+		if (nNext > f.m_nMapping)
+			break;
+
+		if (m_Keys.end() != m_Keys.find(hdr.m_Key))
+			break; // duplicate? should not happen
+
+		s.m_vPos.push_back(nPos);
+		s.m_Size = nNext;
+		nPos = BbsStore_AlignUp(nNext);
+
+		Timestamp t = get_BoundTime(hdr.m_TimePosted);
+		if (1 == s.m_vPos.size())
+			s.m_TimeMin = s.m_TimeMax = t;
+		else
+		{
+			std::setmin(s.m_TimeMin, t);
+			std::setmax(s.m_TimeMax, t);
+		}
+		s.m_Bytes += hdr.m_Size;
+
+		AddToIndex(hdr);
+	}
+}
+
+void BbsStore::AddToIndex(const Hdr& hdr)
+{
+	m_Keys[hdr.m_Key] = hdr.m_ID;
+	m_Channels[hdr.m_Channel].push_back(hdr.m_ID);
+
+	m_Totals.m_Count++;
+	m_Totals.m_Size += hdr.m_Size;
+}
+
+Timestamp BbsStore::get_BoundTime(Timestamp tPosted) const
+{
+	// the message itself is kept intact, only its account in the segment bounds (and hence the expiration) is limited
+	return std::min(tPosted, getTimestamp() + m_Cfg.m_MaxAhead_s);
+}
+
+BbsStore::Segment& BbsStore::get_Writable(Timestamp t, uint32_t nSize)
+{
+	if (!m_Segments.empty())
+	{
+		Segment& s = *m_Segments.back();
+		if ((t < s.m_TimeMin + m_Cfg.m_SegmentSpan_s) && (s.m_Size + nSize <= m_Cfg.m_SegmentSize))
+			return s;
+	}
+
+	uint64_t id0 = m_LastID + 1;
+
+	char szName[0x20];
+	snprintf(szName, _countof(szName), "%016" PRIx64 ".seg", id0);
+
+	auto pSeg = std::make_unique<Segment>();
+	pSeg->m_ID0 = id0;
+	pSeg->m_sPath = (fs::path(m_sDir) / szName).string();
+	pSeg->m_File.Open(pSeg->m_sPath.c_str());
+
+	if (pSeg->m_File.m_nMapping)
+	{
+		// leftover
+		pSeg->m_File.CloseMapping();
+		pSeg->m_File.Resize(0);
+	}
+
+	pSeg->m_TimeMin = pSeg->m_TimeMax = t;
+
+	m_Segments.push_back(std::move(pSeg));
+	return *m_Segments.back();
+}
+
+uint64_t BbsStore::Insert(const Data& d)
+{
+	assert(IsOpen());
+
+	uint32_t nSize = BbsStore_AlignUp(static_cast<uint32_t>(sizeof(Hdr) + d.m_Message.n));
+	Timestamp t = get_BoundTime(d.m_TimePosted);
+	Segment& s = get_Writable(t, nSize);
+
+	MappedFileRaw::Offset nPos = BbsStore_AlignUp(s.m_Size);
+	MappedFileRaw::Offset nEnd = nPos + sizeof(Hdr) + d.m_Message.n;
+
+	if (nEnd > s.m_File.m_nMapping)
+	{
+		MappedFileRaw::Offset nNew = s.m_File.m_nMapping + m_Cfg.m_GrowSize;
+		std::setmax(nNew, nEnd);
+
+		s.m_File.CloseMapping();
+		s.m_File.Resize(nNew);
+		s.m_File.OpenMapping();
+	}
+
+	uint64_t id = ++m_LastID;
+	assert(s.get_IDEnd() == id);
+
+	Hdr& hdr = s.m_File.get_At<Hdr>(nPos);
+	hdr.m_Key = d.m_Key;
+	hdr.m_TimePosted = d.m_TimePosted;
+	hdr.m_Channel = d.m_Channel;
+	hdr.m_Nonce = d.m_Nonce;
+	hdr.m_Size = d.m_Message.n;
+
+	if (d.m_Message.n)
+		memcpy(&hdr + 1, d.m_Message.p, d.m_Message.n);
+
+	hdr.m_ID = id; // last, marks the record as valid
+
+	s.m_vPos.push_back(nPos);
+	s.m_Size = nEnd;
+	std::setmin(s.m_TimeMin, t);
+	std::setmax(s.m_TimeMax, t);
+	s.m_Bytes += d.m_Message.n;
+
+	AddToIndex(hdr);
+	return id;
+}
+
+size_t BbsStore::KeyHash::operator()(const Key& key) const
+{
+	// the key is a hash, no need to mix
+	size_t val;
+	memcpy(&val, key.m_pData, sizeof(val));
+	return val;
+}
+
+uint64_t BbsStore::Find(const Key& key) const
+{
+	auto it = m_Keys.find(key);
+	return (m_Keys.end() == it) ? 0 : it->second;
+}
+
+const BbsStore::Segment* BbsStore::FindSegment(uint64_t id, size_t& iPos) const
+{
+	// find the 1st segment that contains IDs >= id
+	auto it = std::upper_bound(m_Segments.begin(), m_Segments.end(), id,
+		[](uint64_t id_, const std::unique_ptr<Segment>& p) { return id_ < p->get_IDEnd(); });
+
+	if (m_Segments.end() == it)
+		return nullptr;
+
+	const Segment& s = **it;
+	iPos = (id > s.m_ID0) ? static_cast<size_t>(id - s.m_ID0) : 0;
+	return &s;
+}
+
+void BbsStore::Segment::Read(size_t i, Data& d) const
+{
+	const Hdr& hdr = get_Hdr(i);
+	d.m_Key = hdr.m_Key;
+	d.m_TimePosted = hdr.m_TimePosted;
+	d.m_Channel = hdr.m_Channel;
+	d.m_Nonce = hdr.m_Nonce;
+	d.m_Message.p = &hdr + 1;
+	d.m_Message.n = hdr.m_Size;
+}
+
+bool BbsStore::Find(uint64_t id, Data& d) const
+{
+	size_t iPos;
+	const Segment* pSeg = FindSegment(id, iPos);
+	if (!pSeg || (pSeg->m_ID0 + iPos != id))
+		return false;
+
+	pSeg->Read(iPos, d);
+	return true;
+}
+
+uint64_t BbsStore::FindCursor(Timestamp t) const
+{
+	for (const auto& pSeg : m_Segments)
+	{
+		const Segment& s = *pSeg;
+		if (s.m_TimeMax < t)
+			continue;
+
+		for (size_t i = 0; i < s.m_vPos.size(); i++)
+			if (s.get_Hdr(i).m_TimePosted >= t)
+				return s.m_ID0 + i;
+	}
+
+	return m_LastID + 1;
+}
+
+Timestamp BbsStore::get_MaxTime() const
+{
+	Timestamp ret = 0;
+	for (const auto& pSeg : m_Segments)
+		std::setmax(ret, pSeg->m_TimeMax);
+	return ret;
+}
+
+void BbsStore::Cleanup(Timestamp tExpire, const NodeDB::BbsTotals& lims)
+{
+	while (!m_Segments.empty())
+	{
+		bool bInLimits =
+			(m_Totals.m_Count <= lims.m_Count) &&
+			(m_Totals.m_Size <= lims.m_Size);
+
+		if (bInLimits && (m_Segments.front()->m_TimeMax >= tExpire))
+			break;
+
+		DropFront();
+	}
+}
+
+void BbsStore::DropFront()
+{
+	std::unique_ptr<Segment> pSeg = std::move(m_Segments.front());
+	m_Segments.pop_front();
+
+	const Segment& s = *pSeg;
+	for (size_t i = 0; i < s.m_vPos.size(); i++)
+	{
+		const Hdr& hdr = s.get_Hdr(i);
+		m_Keys.erase(hdr.m_Key);
+
+		auto it = m_Channels.find(hdr.m_Channel);
+		assert((m_Channels.end() != it) && (it->second.front() == hdr.m_ID));
+
+		it->second.pop_front();
+		if (it->second.empty())
+			m_Channels.erase(it);
+	}
+
+	m_Totals.m_Count -= static_cast<uint32_t>(s.m_vPos.size());
+	m_Totals.m_Size -= s.m_Bytes;
+
+	pSeg->m_File.Close();
+
+	boost::system::error_code ec;
+	fs::remove(pSeg->m_sPath, ec);
+	if (ec)
+		LOG_WARNING() << "Couldn't delete bbs segment " << pSeg->m_sPath << ": " << ec.message();
+}
+
+void BbsStore::EnumAll(Walker& x) const
+{
+	x.m_pThis = this;
+	x.m_pChannel = nullptr;
+}
+
+void BbsStore::EnumChannel(Walker& x, BbsChannel ch) const
+{
+	x.m_pThis = this;
+
+	auto it = m_Channels.find(ch);
+	if (m_Channels.end() == it)
+	{
+		x.m_pChannel = nullptr;
+		x.m_pThis = nullptr; // nothing
+		return;
+	}
+
+	x.m_pChannel = &it->second;
+	x.m_iPos = std::upper_bound(x.m_pChannel->begin(), x.m_pChannel->end(), x.m_ID) - x.m_pChannel->begin();
+}
+
+bool BbsStore::Walker::MoveNext()
+{
+	if (!m_pThis)
+		return false;
+
+	if (m_pChannel)
+	{
+		if (m_iPos >= m_pChannel->size())
+			return false;
+
+		uint64_t id = (*m_pChannel)[m_iPos++];
+		BEAM_VERIFY(m_pThis->Find(id, m_Data));
+		m_ID = id;
+		return true;
+	}
+
+	size_t iPos;
+	const Segment* pSeg = m_pThis->FindSegment(m_ID + 1, iPos);
+	if (!pSeg)
+		return false;
+
+	pSeg->Read(iPos, m_Data);
+	m_ID = pSeg->m_ID0 + iPos;
+	return true;
+}
+
+} // namespace beam
@@ -0,0 +1,127 @@
+// Copyright 2018 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "db.h"
+#include "../core/mapped_file.h"
+#include <deque>
+#include <unordered_map>
+
+namespace beam {
+
+// Append-only storage for BBS messages, kept apart from the node DB.
+// Messages are appended to memory-mapped segment files, each segment covers a limited time span (and size).
+// Messages are addressed by the sequential ID, as in the DB. Expiration drops whole segments.
+// The key and per-channel indexes are in memory, rebuilt from the segments on open.
+struct BbsStore
+{
+	typedef NodeDB::WalkerBbs::Key Key;
+	typedef NodeDB::WalkerBbs::Data Data;
+
+	struct Cfg
+	{
+		uint32_t m_SegmentSpan_s = 3600; // time span of messages per segment
+		uint32_t m_SegmentSize = 1024 * 1024 * 64; // max segment size
+		uint32_t m_GrowSize = 1024 * 1024; // file growth granularity
+		uint32_t m_MaxAhead_s = 60 * 15; // posted times further ahead are clamped for the segment bounds, otherwise such a message would keep its segment alive
+	} m_Cfg;
+
+	~BbsStore() { Close(); }
+
+	void Open(const char* szDir, uint64_t nStamp); // creates the directory if necessary. Discards the contents if the stamp doesn't match
+	void Close();
+	bool IsOpen() const { return !m_sDir.empty(); }
+
+	uint64_t Insert(const Data&); // must be unique (if not sure - first try to find it). Returns the ID
+	uint64_t Find(const Key&) const; // returns 0 if not found
+	bool Find(uint64_t id, Data&) const; // the message is valid until the next modification
+
+	uint64_t FindCursor(Timestamp) const; // 1st ID with posted time >= the given, or next ID if none
+	uint64_t get_LastID() const { return m_LastID; }
+	Timestamp get_MaxTime() const; // clamped by m_Cfg.m_MaxAhead_s
+	const NodeDB::BbsTotals& get_Totals() const { return m_Totals; }
+
+	// drops the oldest segments, as long as all their messages are older than tExpire, or the totals exceed the limits
+	void Cleanup(Timestamp tExpire, const NodeDB::BbsTotals& lims);
+
+	struct Walker
+	{
+		uint64_t m_ID; // set to lower bound (exclusive) before enumeration
+		Data m_Data;
+
+		bool MoveNext();
+
+	private:
+		friend struct BbsStore;
+		const BbsStore* m_pThis = nullptr;
+		const std::deque<uint64_t>* m_pChannel = nullptr; // if enumerating a single channel
+		size_t m_iPos;
+	};
+
+	void EnumAll(Walker&) const; // ordered by ID
+	void EnumChannel(Walker&, BbsChannel) const; // ordered by ID
+
+	size_t get_Segments() const { return m_Segments.size(); }
+
+private:
+
+#pragma pack (push, 1)
+	struct Hdr
+	{
+		uint64_t m_ID; // written last, 0 for the unused space
+		Key m_Key;
+		Timestamp m_TimePosted;
+		BbsChannel m_Channel;
+		uint32_t m_Nonce;
+		uint32_t m_Size;
+	};
+#pragma pack (pop)
+
+	struct Segment
+	{
+		uint64_t m_ID0;
+		std::string m_sPath;
+		MappedFileRaw m_File;
+		MappedFileRaw::Offset m_Size = 0; // used
+		std::vector<MappedFileRaw::Offset> m_vPos;
+		Timestamp m_TimeMin = 0; // posted times, clamped by get_BoundTime
+		Timestamp m_TimeMax = 0;
+		uint64_t m_Bytes = 0; // messages size
+
+		uint64_t get_IDEnd() const { return m_ID0 + m_vPos.size(); }
+		const Hdr& get_Hdr(size_t i) const { return m_File.get_At<Hdr>(m_vPos[i]); }
+		void Read(size_t i, Data&) const;
+	};
+
+	struct KeyHash {
+		size_t operator()(const Key&) const;
+	};
+
+	std::string m_sDir;
+	std::deque<std::unique_ptr<Segment> > m_Segments; // ordered by ID
+	std::unordered_map<Key, uint64_t, KeyHash> m_Keys;
+	std::map<BbsChannel, std::deque<uint64_t> > m_Channels;
+	uint64_t m_LastID = 0;
+	NodeDB::BbsTotals m_Totals = { 0, 0 };
+
+	void Load(Segment&);
+	void AddToIndex(const Hdr&);
+	Timestamp get_BoundTime(Timestamp tPosted) const;
+	void DropFront();
+	Segment& get_Writable(Timestamp, uint32_t nSize);
+	const Segment* FindSegment(uint64_t id, size_t& iPos) const;
+};
+
+} // namespace beam
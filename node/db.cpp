@@ -17,6 +17,7 @@
 #include "../core/peer_manager.h"
 #include "../utility/logger.h"
 #include "../utility/byteorder.h"
+#include "node_metrics.h"
 #include <algorithm>
 
 namespace beam {
@@ -351,13 +352,22 @@ const void* NodeDB::Recordset::get_BlobStrict(int col, uint32_t n)
 	return x.p;
 }
 
-void NodeDB::Open(const char* szPath)
+static const uint64_t s_DbVersionTop = 32;
+
+void NodeDB::Open(const char* szPath, bool bWal /* = false */)
 {
 	TestRet(sqlite3_open_v2(szPath, &m_pDb, SQLITE_OPEN_READWRITE | SQLITE_OPEN_NOMUTEX | SQLITE_OPEN_CREATE, NULL));
 	// Attempt to fix the "busy" error when PC goes to sleep and then awakes. Try the busy handler with non-zero timeout (maybe a single retry would be enough)
 	sqlite3_busy_timeout(m_pDb, 5000);
 
-	ExecTextOut("PRAGMA locking_mode = EXCLUSIVE");
+	if (bWal)
+	{
+		// readers (OpenReadOnly) may access the committed data concurrently
+		ExecTextOut("PRAGMA journal_mode = WAL");
+	}
+	else
+		ExecTextOut("PRAGMA locking_mode = EXCLUSIVE");
+
 	ExecTextOut("PRAGMA journal_size_limit=1048576"); // limit journal file, otherwise it may remain huge even after tx commit, until the app is closed
 
 	bool bCreate;
@@ -367,7 +377,7 @@ void NodeDB::Open(const char* szPath)
 		bCreate = !rs.Step();
 	}
 
-	const uint64_t nVersionTop = 32;
+	const uint64_t nVersionTop = s_DbVersionTop;
 
 
 	Transaction t(*this);
@@ -464,6 +474,15 @@ void NodeDB::Open(const char* szPath)
 	t.Commit();
 }
 
+void NodeDB::OpenReadOnly(const char* szPath)
+{
+	TestRet(sqlite3_open_v2(szPath, &m_pDb, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, NULL));
+	sqlite3_busy_timeout(m_pDb, 5000);
+
+	if (ParamIntGetDef(ParamID::DbVer) != s_DbVersionTop)
+		ThrowError("db version mismatch");
+}
+
 void NodeDB::CheckIntegrity()
 {
 	std::string s = ExecTextOut("PRAGMA integrity_check");
@@ -858,6 +877,7 @@ void NodeDB::Transaction::Start(NodeDB& db)
 void NodeDB::Transaction::Commit()
 {
 	assert(m_pDB);
+	Metrics::Histogram::Scope scopeMetrics(NodeMetrics::DbCommit_us);
 	m_pDB->ExecStep(Query::Commit, "COMMIT");
 	m_pDB = NULL;
 }
@@ -2076,6 +2096,11 @@ void NodeDB::BbsDel(uint64_t id)
 	TestChanged1Row();
 }
 
+void NodeDB::BbsDelAll()
+{
+	ExecQuick("DELETE FROM " TblBbs);
+}
+
 uint64_t NodeDB::BbsIns(const WalkerBbs::Data& d)
 {
 	Recordset rs(*this, Query::BbsIns, "INSERT INTO " TblBbs "(" TblBbs_InsFieldsListed ") VALUES(?,?,?,?,?)");
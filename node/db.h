@@ -63,6 +63,7 @@ public:
 			ForbiddenState,
 			Flags1, // used for 2-stage migration, where the 2nd stage is performed by the Processor
 			CacheState,
+			BbsStamp, // ties the BBS store to this db
 		};
 	};
 
@@ -242,7 +243,8 @@ public:
 	virtual ~NodeDB();
 
 	void Close();
-	void Open(const char* szPath);
+	void Open(const char* szPath, bool bWal = false);
+	void OpenReadOnly(const char* szPath); // the db must be already opened (and upgraded) by the writer in WAL mode
 	bool IsOpen() const
 	{
 		return nullptr != m_pDb;
@@ -474,6 +476,7 @@ public:
 	bool BbsFind(WalkerBbs&); // set Key
 	uint64_t BbsFind(const WalkerBbs::Key&);
 	void BbsDel(uint64_t id);
+	void BbsDelAll();
 	uint64_t BbsFindCursor(Timestamp);
 	Timestamp get_BbsMaxTime();
 	uint64_t get_BbsLastID();
@@ -27,6 +27,7 @@
 #include "../utility/logger_checkpoints.h"
 
 #include "../bvm/bvm2.h"
+#include "node_metrics.h"
 
 #include "pow/external_pow.h"
 
@@ -322,6 +323,16 @@ void Node::Wanted::OnTimer()
 
 void Node::TryAssignTask(Task& t)
 {
+	if (t.m_Key.second)
+	{
+		NodeProcessor::SyncPipeline& sp = m_Processor.m_SyncPipeline; // alias
+		if (sp.m_ApplyPending >= sp.m_Cfg.m_FetchMaxPending)
+		{
+			sp.m_Fetch.m_Stalls++; // enough downloaded blocks wait for apply
+			return;
+		}
+	}
+
 	// Prioritize w.r.t. rating!
 	for (PeerMan::LiveSet::iterator it = m_PeerMan.m_LiveSet.begin(); m_PeerMan.m_LiveSet.end() != it; ++it)
 	{
@@ -571,9 +582,31 @@ void Node::DeleteOutdated()
         }
     }
 
-	for (TxPool::Fluff::ProfitSet::iterator it = m_TxPool.m_setProfit.begin(); m_TxPool.m_setProfit.end() != it; )
+    // Revalidate only the txs that reference objects touched by the recently applied blocks, or have expired.
+    // Everything is revalidated after rollback, or if the new blocks crossed a fork.
+    auto& touched = m_Processor.m_Touched;
+    Height hNext = m_Processor.m_Cursor.m_ID.m_Height + 1;
+
+    bool bFull =
+        touched.m_Overflow ||
+        (touched.m_hMin > hNext) ||
+        (Rules::get().FindFork(touched.m_hMin) != Rules::get().FindFork(hNext));
+
+    std::vector<TxPool::Fluff::Element*> vAffected;
+    if (bFull)
+    {
+        vAffected.reserve(m_TxPool.m_setProfit.size());
+        for (TxPool::Fluff::ProfitSet::iterator it = m_TxPool.m_setProfit.begin(); m_TxPool.m_setProfit.end() != it; it++)
+            vAffected.push_back(&it->get_ParentObj());
+    }
+    else
+        m_TxPool.get_Affected(vAffected, touched.m_Keys, hNext);
+
+    touched.Reset();
+
+	for (size_t i = 0; i < vAffected.size(); i++)
 	{
-		TxPool::Fluff::Element& x = (it++)->get_ParentObj();
+		TxPool::Fluff::Element& x = *vAffected[i];
 		Transaction& tx = *x.m_pValue;
 
         uint32_t nBvmCharge = 0;
@@ -640,6 +673,7 @@ void Node::Processor::OnNewState()
 	if (IsFastSync())
 		return;
 
+    NodeMetrics::TxRejectCached.Add(-static_cast<int64_t>(get_ParentObj().m_TxReject.size()));
     get_ParentObj().m_TxReject.clear();
     get_ParentObj().DeleteOutdated(); // Better to delete all irrelevant txs explicitly, even if the node is supposed to mine
     // because in practice mining could be OFF (for instance, if miner key isn't defined, and owner wallet is offline).
@@ -831,6 +865,17 @@ void Node::Processor::TryGoUpAsync()
 	}
 }
 
+bool Node::Processor::OnGoUpYield()
+{
+	if (!m_pGoUpTimer)
+		m_pGoUpTimer = io::Timer::create(io::Reactor::get_Current());
+
+	// resume after the network events are handled. A zero timer restarted from within its callback would fire immediately
+	m_pGoUpTimer->start(1, false, [this]() { OnGoUpTimer(); });
+	m_bGoUpPending = true;
+	return true;
+}
+
 void Node::Processor::OnGoUpTimer()
 {
 	m_bGoUpPending = false;
@@ -933,6 +978,7 @@ Node::Peer* Node::AllocPeer(const beam::io::Address& addr)
     m_lstPeers.push_back(*pPeer);
 
 	pPeer->m_UnsentHiMark = m_Cfg.m_BandwidthCtl.m_Drown;
+	pPeer->m_pIoShards = &m_IoShards;
     pPeer->m_pInfo = NULL;
     pPeer->m_Flags = 0;
     pPeer->m_Port = 0;
@@ -970,8 +1016,23 @@ void Node::Initialize(IExternalPOW* externalPOW)
     m_Processor.m_ExecutorMT.set_Threads(std::max<uint32_t>(m_Cfg.m_VerificationThreads, 1U));
 
     m_Processor.m_Horizon = m_Cfg.m_Horizon;
+    m_Processor.m_BodyCache.m_MaxSize = m_Cfg.m_BandwidthCtl.m_BodyCacheSize;
+    m_Processor.m_ContractVarCache.m_MaxSize = m_Cfg.m_ContractVarCacheSize;
+
+    if (m_Cfg.m_DbReaderThreads)
+        m_Cfg.m_ProcessorParams.m_Wal = true;
+
     m_Processor.Initialize(m_Cfg.m_sPathLocal.c_str(), m_Cfg.m_ProcessorParams);
 
+	if (m_Cfg.m_DbReaderThreads)
+		m_DbReader.Initialize(m_Cfg.m_sPathLocal.c_str(), m_Cfg.m_DbReaderThreads);
+
+	if (m_Cfg.m_IoThreads)
+	{
+		m_IoShards.Start(m_Cfg.m_IoThreads);
+		LOG_INFO() << "I/O threads: " << m_Cfg.m_IoThreads;
+	}
+
 	if (m_Cfg.m_ProcessorParams.m_EraseSelfID)
 	{
 		m_Processor.get_DB().ParamSet(NodeDB::ParamID::MyID, nullptr, nullptr);
@@ -1007,9 +1068,7 @@ void Node::Initialize(IExternalPOW* externalPOW)
 
     m_PeerMan.Initialize();
     m_Miner.Initialize(externalPOW);
-	m_Processor.get_DB().get_BbsTotals(m_Bbs.m_Totals);
-    m_Bbs.Cleanup();
-	m_Bbs.m_HighestPosted_s = m_Processor.get_DB().get_BbsMaxTime();
+	m_Bbs.Initialize();
 }
 
 uint32_t Node::get_AcessiblePeerCount() const
@@ -1126,32 +1185,76 @@ void Node::RefreshOwnedUtxos()
     }
 }
 
-bool Node::Bbs::IsInLimits() const
+void Node::Bbs::Initialize()
 {
-	const NodeDB::BbsTotals& lims = get_ParentObj().m_Cfg.m_Bbs.m_Limit;
+	Node& n = get_ParentObj();
+	if (!n.m_Cfg.m_Bbs.IsEnabled())
+		return;
 
-	return
-		(m_Totals.m_Count <= lims.m_Count) &&
-		(m_Totals.m_Size <= lims.m_Size);
+	NodeDB& db = n.m_Processor.get_DB();
+
+	uint64_t nStamp = db.ParamIntGetDef(NodeDB::ParamID::BbsStamp);
+	if (!nStamp)
+	{
+		ECC::GenRandom(&nStamp, sizeof(nStamp));
+		nStamp |= 1; // nonzero
+		db.ParamIntSet(NodeDB::ParamID::BbsStamp, nStamp);
+	}
+
+	std::string sPath;
+	NodeProcessor::get_DerivedPath(sPath, n.m_Cfg.m_sPathLocal.c_str(), "-bbs");
+	m_Store.m_Cfg.m_MaxAhead_s = Rules::get().DA.MaxAhead_s;
+	m_Store.Open(sPath.c_str(), nStamp);
+
+	ImportFromDB();
+	Cleanup();
+
+	m_HighestPosted_s = m_Store.get_MaxTime();
 }
 
-void Node::Bbs::Cleanup()
+void Node::Bbs::ImportFromDB()
 {
+	// messages stored in the node db by older versions
 	NodeDB& db = get_ParentObj().m_Processor.get_DB();
-	NodeDB::WalkerBbsTimeLen wlk;
 
-	Timestamp ts = getTimestamp() - get_ParentObj().m_Cfg.m_Bbs.m_MessageTimeout_s;
+	NodeDB::BbsTotals tots;
+	db.get_BbsTotals(tots);
+	if (!tots.m_Count)
+		return;
+
+	LOG_INFO() << "Moving " << tots.m_Count << " bbs messages from the db...";
 
-	for (db.EnumAllBbs(wlk); wlk.MoveNext(); )
+	NodeDB::WalkerBbsLite wlk;
+	wlk.m_ID = 0;
+	for (db.EnumAllBbsSeq(wlk); wlk.MoveNext(); )
 	{
-		if (IsInLimits() && (wlk.m_Time >= ts))
-			break;
+		NodeDB::WalkerBbs wlkMsg;
+		wlkMsg.m_Data.m_Key = wlk.m_Key;
 
-		db.BbsDel(wlk.m_ID);
-		m_Totals.m_Count--;
-		m_Totals.m_Size -= wlk.m_Size;
+		if (db.BbsFind(wlkMsg) && !m_Store.Find(wlk.m_Key))
+			m_Store.Insert(wlkMsg.m_Data);
 	}
 
+	db.BbsDelAll();
+}
+
+bool Node::Bbs::IsInLimits() const
+{
+	const NodeDB::BbsTotals& lims = get_ParentObj().m_Cfg.m_Bbs.m_Limit;
+	const NodeDB::BbsTotals& tots = m_Store.get_Totals();
+
+	return
+		(tots.m_Count <= lims.m_Count) &&
+		(tots.m_Size <= lims.m_Size);
+}
+
+void Node::Bbs::Cleanup()
+{
+	const Config::Bbs& cfg = get_ParentObj().m_Cfg.m_Bbs;
+	Timestamp ts = getTimestamp() - cfg.m_MessageTimeout_s;
+
+	m_Store.Cleanup(ts, cfg.m_Limit);
+
 	m_LastCleanup_ms = GetTime_ms();
 }
 
@@ -1196,11 +1299,21 @@ Node::~Node()
 
     assert(m_setTasks.empty());
 
+	if (m_IoShards.IsRunning())
+	{
+		const proto::IoShards::Stats& s = get_IoStats();
+		LOG_INFO() << "I/O threads processed " << s.m_Messages << " messages, " << s.m_Bytes << " bytes";
+		m_IoShards.Stop();
+	}
+
+	m_DbReader.Stop();
 	m_Processor.Stop();
 
 	if (!std::uncaught_exceptions() && m_Processor.get_DB().IsOpen())
 		m_PeerMan.OnFlush();
 
+	NodeMetrics::TxRejectCached.Add(-static_cast<int64_t>(m_TxReject.size()));
+
     LOG_INFO() << "Node stopped";
 }
 
@@ -1252,6 +1365,11 @@ void Node::Peer::GenerateSChannelNonce(ECC::Scalar::Native& nonce)
     m_This.NextNonce(nonce);
 }
 
+void Node::Peer::OnMsgIn(uint8_t nCode)
+{
+    NodeMetrics::MsgIn.Inc(nCode);
+}
+
 void Node::Peer::OnConnectedSecure()
 {
     LOG_VERBOSE() << "Peer " << m_RemoteAddr << " Connected";
@@ -1627,6 +1745,11 @@ void Node::Peer::DeleteSelf(bool bIsError, uint8_t nByeReason)
 
 	SetTxCursor(nullptr);
 
+	if (m_pDbTask)
+		m_pDbTask->m_pPeer = nullptr;
+	if (m_pAlive)
+		*m_pAlive = false;
+
     m_This.m_lstPeers.erase(PeerList::s_iterator_to(*this));
     delete this;
 }
@@ -1736,6 +1859,16 @@ void Node::Peer::OnFirstTaskDone()
 	m_This.m_Processor.TryGoUpAsync();
 }
 
+void Node::Peer::OnBodiesFetched(size_t nCount)
+{
+	PeerManager::TimePoint tp;
+	uint32_t dt_ms = tp.get() - get_FirstTask().m_TimeAssigned_ms;
+
+	NodeProcessor::SyncPipeline::Stage& stg = m_This.m_Processor.m_SyncPipeline.m_Fetch;
+	stg.m_Blocks += nCount;
+	stg.m_Time_us += static_cast<uint64_t>(dt_ms) * 1000;
+}
+
 void Node::Peer::ModifyRatingWrtData(size_t nSize)
 {
 	PeerManager::TimePoint tp;
@@ -2064,6 +2197,7 @@ void Node::Peer::OnMsg(proto::Body&& msg)
 		ThrowUnexpected();
 
 	ModifyRatingWrtData(msg.m_Body.m_Eternal.size() + msg.m_Body.m_Perishable.size());
+	OnBodiesFetched(1);
 
 	const Block::SystemState::ID& id = t.m_Key.first;
 	Height h = id.m_Height;
@@ -2104,6 +2238,7 @@ void Node::Peer::OnMsg(proto::BodyPack&& msg)
 			msg.m_Bodies[i].m_Perishable.size();
 	}
 	ModifyRatingWrtData(nSize);
+	OnBodiesFetched(msg.m_Bodies.size());
 
 	NodeProcessor::DataStatus::Enum eStatus = NodeProcessor::DataStatus::Rejected;
 	if (!msg.m_Bodies.empty() && ShouldAcceptBodyPack())
@@ -2209,16 +2344,315 @@ void Node::OnTransactionDeferred(Transaction::Ptr&& pTx, std::unique_ptr<Merkle:
 
 void Node::TxDeferred::OnSchedule()
 {
-    if (!m_lst.empty())
+    Node& n = get_ParentObj();
+
+    if (n.m_Cfg.m_MaxTxVerifyAsync)
+        n.m_TxVerifier.Dispatch();
+    else
     {
-        TxDeferred::Element& x = m_lst.front();
-        get_ParentObj().OnTransaction(std::move(x.m_pTx), std::move(x.m_pCtx), &x.m_Sender, x.m_Fluff, nullptr);
+        if (!m_lst.empty())
+        {
+            TxDeferred::Element& x = m_lst.front();
+            n.OnTransaction(std::move(x.m_pTx), std::move(x.m_pCtx), &x.m_Sender, x.m_Fluff, nullptr);
+            m_lst.pop_front();
+        }
+    }
+
+    if (m_lst.empty() || n.m_TxVerifier.IsSaturated())
+        cancel(); // will be resumed when the verifier is done
+}
+
+bool Node::TxVerifier::IsSaturated() const
+{
+    return m_lst.size() >= get_ParentObj().m_Cfg.m_MaxTxVerifyAsync;
+}
+
+void Node::TxVerifier::Dispatch()
+{
+    Node& n = get_ParentObj();
+    auto& lstSrc = n.m_TxDeferred.m_lst;
+
+    if (!m_pEvt)
+    {
+        io::AsyncEvent::Callback cb = [this]() { OnEvent(); };
+        m_pEvt = io::AsyncEvent::create(io::Reactor::get_Current(), std::move(cb));
+    }
+
+    std::vector<Element*> vTest;
+    bool bSkipped = false;
+
+    for (; !lstSrc.empty() && !IsSaturated(); lstSrc.pop_front())
+    {
+        Element& x = m_lst.emplace_back();
+        Cast::Down<TxDeferred::Element>(x) = std::move(lstSrc.front());
+
+        x.m_Height = n.m_Processor.m_Cursor.m_ID.m_Height;
+        x.m_Valid = false;
+
+        // don't waste time on txs that will be dismissed anyway
+        Transaction::KeyType keyTx;
+        x.m_pTx->get_Key(keyTx);
+
+        bool bKnown =
+            (n.m_TxReject.end() != n.m_TxReject.find(keyTx)) ||
+            (n.m_TxPool.m_setTxs.end() != n.m_TxPool.m_setTxs.find(keyTx, TxPool::Fluff::Element::Tx::Comparator()));
+
+        if (bKnown)
+        {
+            x.m_pTested = nullptr;
+            x.m_Done = true;
+            bSkipped = true;
+        }
+        else
+        {
+            x.m_pTested = x.m_pTx.get();
+            x.m_Done = false;
+            vTest.push_back(&x);
+        }
+    }
+
+    if (!vTest.empty())
+    {
+        Executor& ex = n.m_Processor.m_ExecutorMT;
+        uint32_t nTasks = std::min<uint32_t>(ex.get_Threads(), static_cast<uint32_t>(vTest.size()));
+
+        for (uint32_t iTask = 0; iTask < nTasks; iTask++)
+        {
+            auto pTask = std::make_unique<Task>();
+            pTask->m_pThis = this;
+
+            uint32_t i0 = static_cast<uint32_t>(vTest.size() * iTask / nTasks);
+            uint32_t i1 = static_cast<uint32_t>(vTest.size() * (iTask + 1) / nTasks);
+            pTask->m_vElems.assign(vTest.begin() + i0, vTest.begin() + i1);
+
+            ex.Push(std::move(pTask));
+        }
+    }
+
+    if (bSkipped)
+        m_pEvt->post();
+}
+
+bool Node::TxVerifier::Task::Validate(Element& x)
+{
+    x.m_Ctx.Reset();
+    x.m_Ctx.m_Height.m_Min = x.m_Height + 1;
+
+    return x.m_Ctx.ValidateAndSummarize(*x.m_pTx, x.m_pTx->get_Reader());
+}
+
+void Node::TxVerifier::Task::Exec(Executor::Context&)
+{
+    // Use a dedicated batch context. The one of this thread may contain the pending block verification
+    auto pBc = std::make_unique<ECC::InnerProduct::BatchContextEx<4> >();
+
+    {
+        ECC::InnerProduct::BatchContext::Scope scope(*pBc);
+
+        bool bAllValid = true;
+        for (auto* pElem : m_vElems)
+        {
+            pElem->m_Valid = Validate(*pElem);
+            if (!pElem->m_Valid)
+                bAllValid = false;
+        }
+
+        if (!pBc->Flush() || !bAllValid)
+        {
+            // the batch is spoiled, can't tell which tx is invalid. Verify them individually
+            for (auto* pElem : m_vElems)
+            {
+                if (!pElem->m_Valid)
+                    continue;
+
+                pBc->Reset();
+                pElem->m_Valid = Validate(*pElem) && pBc->Flush();
+            }
+        }
+    }
+
+    {
+        std::unique_lock<std::mutex> scope(m_pThis->m_Mutex);
+        for (auto* pElem : m_vElems)
+            pElem->m_Done = true;
+    }
+
+    m_pThis->m_pEvt->post();
+}
+
+void Node::TxVerifier::OnEvent()
+{
+    Node& n = get_ParentObj();
+
+    while (!m_lst.empty())
+    {
+        Element& x = m_lst.front();
+        {
+            std::unique_lock<std::mutex> scope(m_Mutex);
+            if (!x.m_Done)
+                break;
+        }
+
+        m_pCurrent = &x;
+        n.OnTransaction(std::move(x.m_pTx), std::move(x.m_pCtx), &x.m_Sender, x.m_Fluff, nullptr);
+        m_pCurrent = nullptr;
+
         m_lst.pop_front();
     }
 
-    if (m_lst.empty())
-        cancel();
+    if (!n.m_TxDeferred.m_lst.empty() && !IsSaturated())
+        n.m_TxDeferred.start();
+}
+
+bool Node::TxVerifier::get_Validated(Transaction::Context& ctx, const Transaction& tx, bool& bValid) const
+{
+    if (!m_pCurrent || (m_pCurrent->m_pTested != &tx))
+        return false;
+
+    if (m_pCurrent->m_Height != get_ParentObj().m_Processor.m_Cursor.m_ID.m_Height)
+        return false; // tip changed meanwhile, context-free validation is height-dependent
+
+    bValid = m_pCurrent->m_Valid;
+    if (bValid)
+    {
+        ctx.m_Sigma = m_pCurrent->m_Ctx.m_Sigma;
+        ctx.m_Stats = m_pCurrent->m_Ctx.m_Stats;
+        ctx.m_Height = m_pCurrent->m_Ctx.m_Height;
+    }
+
+    return true;
+}
+
+void Node::DbReader::Initialize(const char* szPath, uint32_t nThreads)
+{
+    assert(!IsEnabled());
+
+    io::AsyncEvent::Callback cb = [this]() { OnEvent(); };
+    m_pEvt = io::AsyncEvent::create(io::Reactor::get_Current(), std::move(cb));
+
+    m_Stop = false;
+    m_vDBs.resize(nThreads);
+
+    for (auto& pDB : m_vDBs)
+    {
+        pDB = std::make_unique<NodeDB>();
+        pDB->OpenReadOnly(szPath);
+    }
+
+    for (auto& pDB : m_vDBs)
+        m_vThreads.emplace_back(&DbReader::RunThread, this, std::ref(*pDB));
+
+    LOG_INFO() << "DB readers: " << nThreads;
+}
+
+void Node::DbReader::Stop()
+{
+    if (!IsEnabled())
+        return;
 
+    {
+        std::unique_lock<std::mutex> scope(m_Mutex);
+        m_Stop = true;
+        m_qPending.clear();
+    }
+
+    m_NewTask.notify_all();
+
+    for (auto& t : m_vThreads)
+        if (t.joinable())
+            t.join();
+
+    m_vThreads.clear();
+    m_vDBs.clear();
+
+    while (!m_lstActive.empty())
+    {
+        Task& t = m_lstActive.front();
+        if (t.m_pPeer)
+            t.m_pPeer->m_pDbTask = nullptr;
+
+        m_lstActive.pop_front();
+        delete &t;
+    }
+}
+
+void Node::DbReader::Push(Task::Ptr&& pTask)
+{
+    assert(IsEnabled());
+    Task& t = *pTask.release();
+    m_lstActive.push_back(t);
+
+    {
+        std::unique_lock<std::mutex> scope(m_Mutex);
+        m_qPending.push_back(&t);
+    }
+
+    m_NewTask.notify_one();
+}
+
+void Node::DbReader::RunThread(NodeDB& db)
+{
+    while (true)
+    {
+        Task* pTask;
+        {
+            std::unique_lock<std::mutex> scope(m_Mutex);
+            while (!m_Stop && m_qPending.empty())
+                m_NewTask.wait(scope);
+
+            if (m_Stop)
+                break;
+
+            pTask = m_qPending.front();
+            m_qPending.pop_front();
+        }
+
+        bool bFailed = false;
+        try {
+            NodeDB::Transaction t(db); // pins the snapshot, rolled back on exit
+            pTask->Exec(db);
+        }
+        catch (const std::exception& e) {
+            LOG_WARNING() << "DB reader: " << e.what();
+            bFailed = true;
+        }
+
+        {
+            std::unique_lock<std::mutex> scope(m_Mutex);
+            pTask->m_Failed = bFailed;
+            pTask->m_Done = true;
+        }
+
+        m_pEvt->post();
+    }
+}
+
+void Node::DbReader::OnEvent()
+{
+    TaskList lstDone;
+
+    {
+        std::unique_lock<std::mutex> scope(m_Mutex);
+        for (auto it = m_lstActive.begin(); m_lstActive.end() != it; )
+        {
+            Task& t = *it++;
+            if (t.m_Done)
+            {
+                m_lstActive.erase(TaskList::s_iterator_to(t));
+                lstDone.push_back(t);
+            }
+        }
+    }
+
+    while (!lstDone.empty())
+    {
+        Task::Ptr pTask(&lstDone.front());
+        lstDone.pop_front();
+
+        // the peer may be deleted while the previous tasks are handled
+        if (pTask->m_pPeer)
+            pTask->m_pPeer->OnDbTaskDone(*pTask);
+    }
 }
 
 uint8_t Node::OnTransaction(Transaction::Ptr&& pTx, std::unique_ptr<Merkle::Hash>&& pCtx, const PeerID* pSender, bool bFluff, std::ostream* pExtraInfo)
@@ -2240,6 +2674,8 @@ uint8_t Node::ValidateTx(TxPool::Stats& stats, const Transaction& tx, const Tran
         return it->second;
     }
 
+    Metrics::Histogram::Scope scopeMetrics(NodeMetrics::TxValidate_us);
+
     Transaction::Context::Params pars;
     Transaction::Context ctx(pars);
     uint32_t nBvmCharge = 0;
@@ -2261,6 +2697,9 @@ uint8_t Node::ValidateTx(TxPool::Stats& stats, const Transaction& tx, const Tran
     {
         m_TxReject[keyTx] = nRet;
         m_Wtx.Delete(keyTx);
+
+        NodeMetrics::TxReject.Inc(nRet);
+        NodeMetrics::TxRejectCached.Add(1);
     }
 
     return nRet;
@@ -2270,7 +2709,11 @@ uint8_t Node::ValidateTx2(Transaction::Context& ctx, const Transaction& tx, uint
 {
     ctx.m_Height.m_Min = m_Processor.m_Cursor.m_ID.m_Height + 1;
 
-    if (!(m_Processor.ValidateAndSummarize(ctx, tx, tx.get_Reader()) && ctx.IsValidTransaction()))
+    bool bValid;
+    if (!m_TxVerifier.get_Validated(ctx, tx, bValid))
+        bValid = m_Processor.ValidateAndSummarize(ctx, tx, tx.get_Reader());
+
+    if (!(bValid && ctx.IsValidTransaction()))
     {
         if (pExtraInfo)
             *pExtraInfo << "Context-free validation failed";
@@ -3102,17 +3545,16 @@ void Node::Peer::BroadcastBbs()
 
 	size_t nExtra = 0;
 
-	NodeDB& db = m_This.m_Processor.get_DB();
-	NodeDB::WalkerBbsLite wlk;
+	BbsStore::Walker wlk;
 
 	wlk.m_ID = m_CursorBbs;
-	for (db.EnumAllBbsSeq(wlk); wlk.MoveNext(); )
+	for (m_This.m_Bbs.m_Store.EnumAll(wlk); wlk.MoveNext(); )
 	{
 		proto::BbsHaveMsg msgOut;
-		msgOut.m_Key = wlk.m_Key;
+		msgOut.m_Key = wlk.m_Data.m_Key;
 		Send(msgOut);
 
-		nExtra += wlk.m_Size;
+		nExtra += wlk.m_Data.m_Message.n;
 		if (IsChocking(nExtra))
 			break;
 	}
@@ -3622,32 +4064,30 @@ void Node::Peer::OnMsg(proto::BbsMsg&& msg)
     if (msg.m_TimePosted + Rules::get().DA.MaxAhead_s < m_This.m_Bbs.m_HighestPosted_s)
         return; // don't allow too much out-of-order messages
 
-    NodeDB& db = m_This.m_Processor.get_DB();
-    NodeDB::WalkerBbs wlk;
+    BbsStore& store = m_This.m_Bbs.m_Store;
+    BbsStore::Data d;
 
-    wlk.m_Data.m_Channel = msg.m_Channel;
-    wlk.m_Data.m_TimePosted = msg.m_TimePosted;
-    wlk.m_Data.m_Message = Blob(msg.m_Message);
-	msg.m_Nonce.Export(wlk.m_Data.m_Nonce);
+    d.m_Channel = msg.m_Channel;
+    d.m_TimePosted = msg.m_TimePosted;
+    d.m_Message = Blob(msg.m_Message);
+	msg.m_Nonce.Export(d.m_Nonce);
 
-    Bbs::CalcMsgKey(wlk.m_Data);
+    Bbs::CalcMsgKey(d);
 
-    if (db.BbsFind(wlk.m_Data.m_Key))
+    if (store.Find(d.m_Key))
         return; // already have it
 
     m_This.m_Bbs.MaybeCleanup();
 
-    uint64_t id = db.BbsIns(wlk.m_Data);
-    m_This.m_Bbs.m_W.Delete(wlk.m_Data.m_Key);
+    uint64_t id = store.Insert(d);
+    m_This.m_Bbs.m_W.Delete(d.m_Key);
 
 	std::setmax(m_This.m_Bbs.m_HighestPosted_s, msg.m_TimePosted);
-	m_This.m_Bbs.m_Totals.m_Count++;
-	m_This.m_Bbs.m_Totals.m_Size += wlk.m_Data.m_Message.n;
 
     // 1. Send to other BBS-es
 
     proto::BbsHaveMsg msgOut;
-    msgOut.m_Key = wlk.m_Data.m_Key;
+    msgOut.m_Key = d.m_Key;
 
     for (PeerList::iterator it = m_This.m_lstPeers.begin(); m_This.m_lstPeers.end() != it; ++it)
     {
@@ -3675,7 +4115,7 @@ void Node::Peer::OnMsg(proto::BbsMsg&& msg)
         if (s.m_pPeer->IsChocking())
             continue;
 
-        s.m_pPeer->SendBbsMsg(wlk.m_Data);
+        s.m_pPeer->SendBbsMsg(d);
 		s.m_Cursor = id;
 
 		s.m_pPeer->IsChocking(); // in case it's chocking - for faster recovery recheck it ASAP
@@ -3687,8 +4127,7 @@ void Node::Peer::OnMsg(proto::BbsHaveMsg&& msg)
     if (!m_This.m_Cfg.m_Bbs.IsEnabled())
 		ThrowUnexpected();
 
-    NodeDB& db = m_This.m_Processor.get_DB();
-	if (db.BbsFind(msg.m_Key)) {
+	if (m_This.m_Bbs.m_Store.Find(msg.m_Key)) {
 		// stupid compiler insists on parentheses here!
 		return; // already have it
 	}
@@ -3708,14 +4147,14 @@ void Node::Peer::OnMsg(proto::BbsGetMsg&& msg)
 	if (!m_This.m_Cfg.m_Bbs.IsEnabled())
 		ThrowUnexpected();
 
-	NodeDB& db = m_This.m_Processor.get_DB();
-    NodeDB::WalkerBbs wlk;
+	const BbsStore& store = m_This.m_Bbs.m_Store;
+	BbsStore::Data d;
 
-    wlk.m_Data.m_Key = msg.m_Key;
-    if (!db.BbsFind(wlk))
-        return; // don't have it
+	uint64_t id = store.Find(msg.m_Key);
+	if (!id || !store.Find(id, d))
+		return; // don't have it
 
-    SendBbsMsg(wlk.m_Data);
+	SendBbsMsg(d);
 }
 
 void Node::Peer::SendBbsMsg(const NodeDB::WalkerBbs::Data& d)
@@ -3750,7 +4189,7 @@ void Node::Peer::OnMsg(proto::BbsSubscribe&& msg)
         m_This.m_Bbs.m_Subscribed.insert(pS->m_Bbs);
         m_Subscriptions.insert(pS->m_Peer);
 
-		pS->m_Cursor = m_This.m_Processor.get_DB().BbsFindCursor(msg.m_TimeFrom) - 1;
+		pS->m_Cursor = m_This.m_Bbs.m_Store.FindCursor(msg.m_TimeFrom) - 1;
 
 		BroadcastBbs(*pS);
     }
@@ -3763,13 +4202,10 @@ void Node::Peer::BroadcastBbs(Bbs::Subscription& s)
 	if (IsChocking())
 		return;
 
-	NodeDB& db = m_This.m_Processor.get_DB();
-	NodeDB::WalkerBbs wlk;
-
-	wlk.m_Data.m_Channel = s.m_Peer.m_Channel;
+	BbsStore::Walker wlk;
 	wlk.m_ID = s.m_Cursor;
 
-	for (db.EnumBbsCSeq(wlk); wlk.MoveNext(); )
+	for (m_This.m_Bbs.m_Store.EnumChannel(wlk, s.m_Peer.m_Channel); wlk.MoveNext(); )
 	{
 		SendBbsMsg(wlk.m_Data);
 		if (IsChocking())
@@ -3784,7 +4220,7 @@ void Node::Peer::OnMsg(proto::BbsResetSync&& msg)
 	if (!m_This.m_Cfg.m_Bbs.IsEnabled())
 		ThrowUnexpected();
 
-	m_CursorBbs = m_This.m_Processor.get_DB().BbsFindCursor(msg.m_TimeFrom) - 1;
+	m_CursorBbs = m_This.m_Bbs.m_Store.FindCursor(msg.m_TimeFrom) - 1;
 	BroadcastBbs();
 }
 
@@ -3965,22 +4401,16 @@ void Node::Peer::OnMsg(proto::GetAssetsListAt&& msg)
 
 void Node::Peer::OnMsg(proto::ContractVarsEnum&& msg)
 {
-    struct Wrk
-        :public NodeProcessor::IWorker
+    struct MyTask
+        :public DbReader::Task
     {
-        Peer& m_This;
-        proto::ContractVarsEnum& m_In;
+        proto::ContractVarsEnum m_In;
         proto::ContractVars m_Out;
 
-        Wrk(Peer& x, proto::ContractVarsEnum& msgIn)
-            :m_This(x)
-            ,m_In(msgIn)
-        {}
-
-        void Do() override
+        void Exec(NodeDB& db) override
         {
             NodeDB::WalkerContractData wlk;
-            m_This.m_This.m_Processor.get_DB().ContractDataEnum(wlk, m_In.m_KeyMin, m_In.m_KeyMax);
+            db.ContractDataEnum(wlk, m_In.m_KeyMin, m_In.m_KeyMax);
 
             Serializer ser;
 
@@ -3999,7 +4429,7 @@ void Node::Peer::OnMsg(proto::ContractVarsEnum&& msg)
                 ser.WriteRaw(wlk.m_Key.p, wlk.m_Key.n);
                 ser.WriteRaw(wlk.m_Val.p, wlk.m_Val.n);
 
-                if (m_This.IsChocking(ser.buffer().second))
+                if (ser.buffer().second > m_nSizeMax)
                 {
                     m_Out.m_bMore = true;
                     break;
@@ -4008,33 +4438,30 @@ void Node::Peer::OnMsg(proto::ContractVarsEnum&& msg)
 
             ser.swap_buf(m_Out.m_Result);
         }
-    };
 
-    Wrk wrk(*this, msg);
-
-    m_This.m_Processor.ExecInDependentContext(wrk, m_Dependent.m_pQuery.get(), m_This.m_TxDependent);
+        void Send(Peer& p) override
+        {
+            if (m_Out.m_bMore)
+                p.IsChocking(m_Out.m_Result.size());
+            p.Send(m_Out);
+        }
+    };
 
-    Send(wrk.m_Out);
+    auto pTask = std::make_unique<MyTask>();
+    pTask->m_In = std::move(msg);
+    ExecDbTask(std::move(pTask));
 }
 
 void Node::Peer::OnMsg(proto::ContractLogsEnum&& msg)
 {
-    struct Wrk
-        :public NodeProcessor::IWorker
+    struct MyTask
+        :public DbReader::Task
     {
-        Peer& m_This;
-        proto::ContractLogsEnum& m_In;
+        proto::ContractLogsEnum m_In;
         proto::ContractLogs m_Out;
 
-        Wrk(Peer& x, proto::ContractLogsEnum& msgIn)
-            :m_This(x)
-            , m_In(msgIn)
-        {}
-
-        void Do() override
+        void Exec(NodeDB& db) override
         {
-            auto& db = m_This.m_This.m_Processor.get_DB();
-
             NodeDB::ContractLog::Walker wlk;
             if (m_In.m_KeyMin.empty() && m_In.m_KeyMax.empty())
                 db.ContractLogEnum(wlk, m_In.m_PosMin, m_In.m_PosMax);
@@ -4067,7 +4494,7 @@ void Node::Peer::OnMsg(proto::ContractLogsEnum&& msg)
                 ser.WriteRaw(wlk.m_Entry.m_Key.p, wlk.m_Entry.m_Key.n);
                 ser.WriteRaw(wlk.m_Entry.m_Val.p, wlk.m_Entry.m_Val.n);
 
-                if (m_This.IsChocking(ser.buffer().second))
+                if (ser.buffer().second > m_nSizeMax)
                 {
                     m_Out.m_bMore = true;
                     break;
@@ -4076,13 +4503,149 @@ void Node::Peer::OnMsg(proto::ContractLogsEnum&& msg)
 
             ser.swap_buf(m_Out.m_Result);
         }
+
+        void Send(Peer& p) override
+        {
+            if (m_Out.m_bMore)
+                p.IsChocking(m_Out.m_Result.size());
+            p.Send(m_Out);
+        }
     };
 
-    Wrk wrk(*this, msg);
+    auto pTask = std::make_unique<MyTask>();
+    pTask->m_In = std::move(msg);
+    ExecDbTask(std::move(pTask));
+}
+
+size_t Node::Peer::get_ChockingRemaining()
+{
+    if (Flags::Chocking & m_Flags)
+        return 0;
+
+    size_t nUnsent = get_Unsent();
+    size_t nMax = m_This.m_Cfg.m_BandwidthCtl.m_Chocking;
+    return (nUnsent < nMax) ? (nMax - nUnsent) : 0;
+}
+
+void Node::Peer::ExecDbTask(DbReader::Task::Ptr&& pTask)
+{
+    assert(!m_pDbTask);
+    pTask->m_pPeer = this;
+    pTask->m_nSizeMax = get_ChockingRemaining();
+
+    // The reader sees only the committed data. Use it only if the processor has nothing pending, and no dependent context is involved
+    if (m_This.m_DbReader.IsEnabled() && !m_Dependent.m_pQuery && !m_This.m_Processor.m_bFlushPending)
+    {
+        m_pDbTask = pTask.get();
+        m_This.m_DbReader.Push(std::move(pTask));
+        return;
+    }
+
+    struct Wrk
+        :public NodeProcessor::IWorker
+    {
+        DbReader::Task& m_Task;
+        NodeDB& m_DB;
+
+        Wrk(DbReader::Task& t, NodeDB& db)
+            :m_Task(t)
+            ,m_DB(db)
+        {}
+
+        void Do() override
+        {
+            m_Task.Exec(m_DB);
+        }
+    };
 
+    Wrk wrk(*pTask, m_This.m_Processor.get_DB());
     m_This.m_Processor.ExecInDependentContext(wrk, m_Dependent.m_pQuery.get(), m_This.m_TxDependent);
 
-    Send(wrk.m_Out);
+    pTask->Send(*this);
+}
+
+void Node::Peer::OnDbTaskDone(DbReader::Task& t)
+{
+    assert(m_pDbTask == &t);
+    m_pDbTask = nullptr;
+
+    try {
+        if (t.m_Failed)
+            t.Exec(m_This.m_Processor.get_DB()); // retry on the main connection
+
+        t.Send(*this);
+    }
+    catch (const std::exception& e) {
+        OnExc(e);
+        return; // deleted
+    }
+
+    HandleDeferred();
+}
+
+template <typename TMsg>
+struct Node::Peer::DeferredMsg
+    :public IDeferredMsg
+{
+    TMsg m_Msg;
+
+    DeferredMsg(TMsg&& msg) :m_Msg(std::move(msg)) {}
+
+    void Handle(Peer& p) override
+    {
+        // virtual dispatch via the base, the overloads are hidden in Peer
+        proto::INodeMsgHandler& h = p;
+        h.OnMsg(std::move(m_Msg));
+    }
+};
+
+#define THE_MACRO(code, msg) \
+bool Node::Peer::OnMsg2(proto::msg&& v) \
+{ \
+    if (m_pDbTask || !m_lstDeferred.empty()) \
+    { \
+        m_lstDeferred.push_back(std::make_unique<DeferredMsg<proto::msg> >(std::move(v))); \
+        PauseInput(); \
+    } \
+    else \
+        static_cast<proto::INodeMsgHandler&>(*this).OnMsg(std::move(v)); \
+    return true; \
+}
+
+BeamNodeMsgsAll(THE_MACRO)
+#undef THE_MACRO
+
+void Node::Peer::HandleDeferred()
+{
+    if (m_pAlive)
+        return; // already in progress
+
+    bool bAlive = true;
+    m_pAlive = &bAlive;
+
+    while (!m_pDbTask && !m_lstDeferred.empty())
+    {
+        IDeferredMsg::Ptr pMsg = std::move(m_lstDeferred.front());
+        m_lstDeferred.pop_front();
+
+        try {
+            pMsg->Handle(*this);
+        }
+        catch (const proto::NodeProcessingException& e) {
+            OnProcessingExc(e);
+        }
+        catch (const std::exception& e) {
+            OnExc(e);
+        }
+
+        if (!bAlive)
+            return;
+    }
+
+    m_pAlive = nullptr;
+
+    if (!m_pDbTask)
+        ResumeInput();
 }
 
 void Node::Peer::OnMsg(proto::GetContractVar&& msg)
@@ -15,6 +15,7 @@
 #pragma once
 
 #include "processor.h"
+#include "bbs_store.h"
 #include "utility/io/timer.h"
 #include "core/proto.h"
 #include "core/block_crypt.h"
@@ -79,11 +80,28 @@ struct Node
 		bool m_LogTxStem = true;
 		bool m_LogTxFluff = true;
 
-		// Number of verification threads for CPU-hungry cryptography. Currently used for block validation only.
+		// Number of verification threads for CPU-hungry cryptography. Used for block validation, and context-free validation of the incoming transactions.
 		// 0: single threaded
 		// negative: number of cores minus number of mining threads.
 		int m_VerificationThreads = 0;
 
+		// Max number of deferred (received from other nodes) transactions, which are validated asynchronously by the verification threads.
+		// 0: validate them on the reactor thread.
+		uint32_t m_MaxTxVerifyAsync = 256;
+
+		// Number of threads that serve heavy read-only requests (contract vars/logs enumeration) from a snapshot of the committed data.
+		// Implies the DB in WAL mode (m_ProcessorParams.m_Wal).
+		// 0: serve them on the reactor thread.
+		uint32_t m_DbReaderThreads = 0;
+
+		// Number of I/O threads for the inbound traffic of the peers: decryption, MAC verification and deserialization of the messages.
+		// The processing remains on the reactor thread.
+		// 0: all on the reactor thread.
+		uint32_t m_IoThreads = 0;
+
+		// Cache of the contract variables, shared by the block interpretation and the mempool validation. 0 to disable
+		size_t m_ContractVarCacheSize = 1024 * 1024 * 32;
+
 		struct RollbackLimit
 		{
 			Height m_Max = 60; // artificial restriction on how much the node will rollback automatically
@@ -121,6 +139,8 @@ struct Node
 			size_t m_MaxBodyPackSize = 1024 * 1024 * 5;
 			uint32_t m_MaxBodyPackCount = 3000;
 
+			size_t m_BodyCacheSize = 1024 * 1024 * 64; // cache of re-created block bodies, shared by all the peers. 0 to disable
+
 		} m_BandwidthCtl;
 
 		struct TestMode {
@@ -180,6 +200,7 @@ struct Node
 	void Initialize(IExternalPOW* externalPOW=nullptr);
 
 	NodeProcessor& get_Processor() { return m_Processor; } // for tests only!
+	const proto::IoShards::Stats& get_IoStats() const { return m_IoShards.get_Stats(); }
 
 	struct SyncStatus
 	{
@@ -267,6 +288,7 @@ private:
 		io::Timer::Ptr m_pGoUpTimer;
 		void TryGoUpAsync();
 		void OnGoUpTimer();
+		bool OnGoUpYield() override;
 
 		std::deque<PeerID> m_lstInsanePeers;
 		io::AsyncEvent::Ptr m_pAsyncPeerInsane;
@@ -387,6 +409,46 @@ private:
 		IMPLEMENT_GET_PARENT_OBJ(Node, m_TxDeferred)
 	} m_TxDeferred;
 
+	struct TxVerifier
+	{
+		// Context-free validation of the deferred transactions is performed by the verification threads.
+		// The results are handled on the reactor thread, in the order of submission.
+		struct Element
+			:public TxDeferred::Element
+		{
+			Transaction::Context::Params m_Pars;
+			Transaction::Context m_Ctx;
+			const Transaction* m_pTested; // null if not tested
+			Height m_Height; // cursor height at the moment of submission
+			bool m_Done;
+			bool m_Valid;
+
+			Element() :m_Ctx(m_Pars) {}
+		};
+
+		struct Task
+			:public Executor::TaskAsync
+		{
+			TxVerifier* m_pThis;
+			std::vector<Element*> m_vElems;
+
+			virtual void Exec(Executor::Context&) override;
+			static bool Validate(Element&);
+		};
+
+		std::list<Element> m_lst; // elements are not moved
+		std::mutex m_Mutex;
+		io::AsyncEvent::Ptr m_pEvt;
+		const Element* m_pCurrent = nullptr; // being handled
+
+		bool IsSaturated() const;
+		void Dispatch();
+		void OnEvent();
+		bool get_Validated(Transaction::Context&, const Transaction&, bool& bValid) const;
+
+		IMPLEMENT_GET_PARENT_OBJ(Node, m_TxVerifier)
+	} m_TxVerifier;
+
 	void OnTransactionDeferred(Transaction::Ptr&&, std::unique_ptr<Merkle::Hash>&&, const PeerID*, bool bFluff);
 	uint8_t OnTransactionStem(Transaction::Ptr&&, std::ostream* pExtraInfo);
 	uint8_t OnTransactionFluff(Transaction::Ptr&&, std::ostream* pExtraInfo, const PeerID*, const TxPool::Stats*);
@@ -419,6 +481,8 @@ private:
 
 		static void CalcMsgKey(NodeDB::WalkerBbs::Data&);
 		uint32_t m_LastCleanup_ms = 0;
+		void Initialize();
+		void ImportFromDB();
 		void Cleanup();
 		void MaybeCleanup();
 		bool IsInLimits() const;
@@ -447,7 +511,7 @@ private:
 		Subscription::BbsSet m_Subscribed;
 		Timestamp m_HighestPosted_s = 0;
 
-		NodeDB::BbsTotals m_Totals;
+		BbsStore m_Store;
 
 		IMPLEMENT_GET_PARENT_OBJ(Node, m_Bbs)
 	} m_Bbs;
@@ -493,6 +557,50 @@ private:
 		IMPLEMENT_GET_PARENT_OBJ(Node, m_PeerMan)
 	} m_PeerMan;
 
+	struct DbReader
+	{
+		// Each thread has its own read-only DB connection. Every task is executed within a separate read transaction,
+		// hence sees a consistent snapshot of the committed data, while the processor proceeds.
+		struct Task
+			:public boost::intrusive::list_base_hook<>
+		{
+			typedef std::unique_ptr<Task> Ptr;
+
+			Peer* m_pPeer; // reset if the peer is deleted meanwhile
+			size_t m_nSizeMax; // reply size limit wrt peer chocking
+			bool m_Done = false;
+			bool m_Failed = false;
+
+			virtual ~Task() {}
+			virtual void Exec(NodeDB&) = 0; // reader thread, or inline
+			virtual void Send(Peer&) = 0; // reactor thread
+		};
+
+		typedef boost::intrusive::list<Task> TaskList;
+
+		std::vector<std::unique_ptr<NodeDB> > m_vDBs;
+		std::vector<std::thread> m_vThreads;
+		std::mutex m_Mutex;
+		std::condition_variable m_NewTask;
+		std::deque<Task*> m_qPending; // protected by mutex
+		TaskList m_lstActive; // owns all the unhandled tasks
+		io::AsyncEvent::Ptr m_pEvt;
+		bool m_Stop = false;
+
+		~DbReader() { Stop(); }
+
+		bool IsEnabled() const { return !m_vThreads.empty(); }
+		void Initialize(const char* szPath, uint32_t nThreads);
+		void Stop();
+		void Push(Task::Ptr&&);
+		void RunThread(NodeDB&);
+		void OnEvent();
+
+		IMPLEMENT_GET_PARENT_OBJ(Node, m_DbReader)
+	} m_DbReader;
+
+	proto::IoShards m_IoShards;
+
 	struct Peer
 		:public proto::NodeConnection
 		,public boost::intrusive::list_base_hook<>
@@ -539,6 +647,21 @@ private:
 		io::Timer::Ptr m_pTimerRequest;
 		io::Timer::Ptr m_pTimerPeers;
 
+		// While a request is served by the DB reader, the subsequent messages are deferred, to keep the replies in order.
+		// The input is paused meanwhile, and resumed once all the deferred messages are handled
+		struct IDeferredMsg
+		{
+			typedef std::unique_ptr<IDeferredMsg> Ptr;
+			virtual ~IDeferredMsg() {}
+			virtual void Handle(Peer&) = 0;
+		};
+
+		template <typename TMsg> struct DeferredMsg;
+
+		DbReader::Task* m_pDbTask = nullptr;
+		std::deque<IDeferredMsg::Ptr> m_lstDeferred;
+		bool* m_pAlive = nullptr; // set while deferred messages are handled, since the peer may be deleted meanwhile
+
 		Peer(Node& n) :m_This(n) {}
 
 		void TakeTasks();
@@ -561,6 +684,10 @@ private:
 		bool GetBlock(proto::BodyBuffers&, const NodeDB::StateID&, const proto::GetBodyPack&, bool bActive);
 
 		bool IsChocking(size_t nExtra = 0);
+		size_t get_ChockingRemaining();
+		void ExecDbTask(DbReader::Task::Ptr&&);
+		void OnDbTaskDone(DbReader::Task&);
+		void HandleDeferred();
 		bool ShouldAssignTasks();
 		bool ShouldFinalizeMining();
 		Task& get_FirstTask();
@@ -568,6 +695,7 @@ private:
 		void OnFirstTaskDone();
 		void OnFirstTaskDone(NodeProcessor::DataStatus::Enum);
 		void ModifyRatingWrtData(size_t nSize);
+		void OnBodiesFetched(size_t nCount);
 		void SendHdrs(NodeDB::StateID&, uint32_t nCount);
 		void SendTx(Transaction::Ptr& ptx, bool bFluff, const Merkle::Hash* pCtx = nullptr);
 
@@ -586,6 +714,7 @@ private:
 
 		// proto::NodeConnection
 		virtual void OnConnectedSecure() override;
+		virtual void OnMsgIn(uint8_t nCode) override;
 		virtual void OnDisconnect(const DisconnectReason&) override;
 		virtual void GenerateSChannelNonce(ECC::Scalar::Native&) override; // Must be overridden to support SChannel
 		// login
@@ -593,6 +722,10 @@ private:
 		virtual void OnLogin(proto::Login&&, uint32_t nFlagsPrev) override;
 		virtual Height get_MinPeerFork() override;
 		// messages
+#define THE_MACRO(code, msg) virtual bool OnMsg2(proto::msg&&) override;
+		BeamNodeMsgsAll(THE_MACRO)
+#undef THE_MACRO
+
 		virtual void OnMsg(proto::Authentication&&) override;
 		virtual void OnMsg(proto::Bye&&) override;
 		virtual void OnMsg(proto::Pong&&) override;
@@ -0,0 +1,73 @@
+// Copyright 2018 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "node_metrics.h"
+#include "../core/proto.h"
+
+namespace beam {
+namespace NodeMetrics
+{
+	namespace
+	{
+		const char* get_MsgName(uint32_t nCode)
+		{
+			switch (nCode)
+			{
+#define THE_MACRO(code, msg) case code: return #msg;
+				BeamNodeMsgsAll(THE_MACRO)
+#undef THE_MACRO
+			}
+			return nullptr;
+		}
+
+		const char* get_TxStatusName(uint32_t nStatus)
+		{
+			switch (nStatus)
+			{
+#define THE_MACRO(name) case proto::TxStatus::name: return #name;
+				THE_MACRO(Unspecified)
+				THE_MACRO(TooSmall)
+				THE_MACRO(Obscured)
+				THE_MACRO(Invalid)
+				THE_MACRO(InvalidContext)
+				THE_MACRO(LowFee)
+				THE_MACRO(LimitExceeded)
+				THE_MACRO(InvalidInput)
+				THE_MACRO(ContractFailNode)
+				THE_MACRO(DependentNoParent)
+				THE_MACRO(DependentNotBest)
+				THE_MACRO(DependentNoNewCtx)
+#undef THE_MACRO
+			}
+			return nullptr; // contract failures are written as numbers
+		}
+	}
+
+	Metrics::CounterVec MsgIn("beam_node_peer_messages_total", "Inbound peer messages by type", "msg", get_MsgName);
+
+	Metrics::Histogram BlockHandle_us("beam_node_block_handle_us", "Block handling time");
+	Metrics::Histogram MultiblockFlush_us("beam_node_multiblock_flush_us", "Multi-block verification flush time");
+	Metrics::Gauge VerifierTasks("beam_node_verifier_tasks", "Block verification tasks in the executor queue");
+
+	Metrics::Histogram DbCommit_us("beam_node_db_commit_us", "DB transaction commit time");
+
+	Metrics::Histogram TxValidate_us("beam_node_tx_validate_us", "Transaction validation time");
+	Metrics::CounterVec TxReject("beam_node_tx_rejected_total", "Rejected transactions by status", "status", get_TxStatusName);
+	Metrics::Gauge TxRejectCached("beam_node_tx_reject_cache", "Rejected transactions remembered as spam");
+	Metrics::Gauge TxPoolFluff("beam_node_txpool_fluff", "Fluff pool transactions");
+	Metrics::Gauge TxPoolStem("beam_node_txpool_stem", "Stem pool transactions");
+	Metrics::Gauge TxPoolDependent("beam_node_txpool_dependent", "Dependent pool transactions");
+
+} // namespace NodeMetrics
+} // namespace beam
@@ -0,0 +1,44 @@
+// Copyright 2018 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "../utility/metrics.h"
+
+namespace beam {
+namespace NodeMetrics
+{
+	// Process-wide, aggregated over all the node instances. Times are in microseconds.
+
+	// Peers
+	extern Metrics::CounterVec MsgIn;
+
+	// Blocks
+	extern Metrics::Histogram BlockHandle_us; // deserialization, context-dependent validation and apply (excluding the async verification)
+	extern Metrics::Histogram MultiblockFlush_us; // waiting for the verifiers and finalizing the batch
+	extern Metrics::Gauge VerifierTasks; // executor queue depth: verification tasks pushed and not finished yet
+
+	// DB
+	extern Metrics::Histogram DbCommit_us;
+
+	// Transactions
+	extern Metrics::Histogram TxValidate_us;
+	extern Metrics::CounterVec TxReject;
+	extern Metrics::Gauge TxRejectCached; // size of the reject (spam) cache
+	extern Metrics::Gauge TxPoolFluff;
+	extern Metrics::Gauge TxPoolStem;
+	extern Metrics::Gauge TxPoolDependent;
+
+} // namespace NodeMetrics
+} // namespace beam
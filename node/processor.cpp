@@ -21,8 +21,10 @@
 #include "../utility/logger.h"
 #include "../utility/logger_checkpoints.h"
 #include "../utility/blobmap.h"
+#include "node_metrics.h"
 #include <condition_variable>
 #include <cctype>
+#include <chrono>
 
 namespace beam {
 
@@ -88,7 +90,7 @@ void NodeProcessor::Initialize(const char* szPath)
 
 void NodeProcessor::Initialize(const char* szPath, const StartParams& sp)
 {
-	m_DB.Open(szPath);
+	m_DB.Open(szPath, sp.m_Wal);
 	m_DbTx.Start(m_DB);
 
 	if (sp.m_CheckIntegrity)
@@ -223,6 +225,41 @@ void NodeProcessor::ManualSelection::Reset()
 	m_Forbidden = false;
 }
 
+void NodeProcessor::Touched::Reset()
+{
+	m_Keys.clear();
+	m_hMin = MaxHeight;
+	m_Overflow = false;
+}
+
+void NodeProcessor::Touched::OnBlock(const TxVectors::Full& txv, Height h)
+{
+	std::setmin(m_hMin, h);
+	if (m_Overflow)
+		return;
+
+	struct Walker
+		:public TxPool::Refs::IWalker
+	{
+		Touched& m_This;
+		Walker(Touched& x) :m_This(x) {}
+
+		void OnRef(const TxPool::Refs::KeyType& key) override
+		{
+			m_This.m_Keys.insert(key);
+		}
+
+	} wlk(*this);
+
+	wlk.Process(txv, true);
+
+	if (m_Keys.size() > s_MaxKeys)
+	{
+		m_Keys.clear();
+		m_Overflow = true;
+	}
+}
+
 void NodeProcessor::ManualSelection::ResetAndSave()
 {
 	Reset();
@@ -306,6 +343,9 @@ void NodeProcessor::InitializeMapped(const char* sz)
 	LOG_INFO() << "Rebuilding mapped image...";
 	InitializeUtxos();
 
+	Merkle::Hash hv;
+	m_Mapped.m_Utxo.get_Hash(hv, get_Executor()); // evaluate the rebuilt tree in parallel, before it's needed
+
 	NodeDB::WalkerContractData wlk;
 	for (m_DB.ContractDataEnum(wlk); wlk.MoveNext(); )
 		m_Mapped.m_Contract.Toggle(wlk.m_Key, wlk.m_Val, true);
@@ -353,7 +393,12 @@ int My_strcmpi(const char* sz1, const char* sz2)
 
 void NodeProcessor::get_MappingPath(std::string& sPath, const char* sz)
 {
-	// derive mapping path from db path
+	get_DerivedPath(sPath, sz, "-utxo-image.bin");
+}
+
+void NodeProcessor::get_DerivedPath(std::string& sPath, const char* sz, const char* szSufixNew)
+{
+	// derive path from db path
 	sPath = sz;
 
 	static const char szSufix[] = ".db";
@@ -362,7 +407,7 @@ void NodeProcessor::get_MappingPath(std::string& sPath, const char* sz)
 	if ((sPath.size() >= nSufix) && !My_strcmpi(sPath.c_str() + sPath.size() - nSufix, szSufix))
 		sPath.resize(sPath.size() - nSufix);
 
-	sPath += "-utxo-image.bin";
+	sPath += szSufixNew;
 }
 
 bool NodeProcessor::InitMapping(const char* sz, bool bForceReset)
@@ -504,6 +549,7 @@ void NodeProcessor::InitCursor(bool bMovingUp)
 	}
 
 	m_Cursor.m_DifficultyNext = get_NextDifficulty();
+	m_ContractVarCache.OnTip(m_Cursor.m_ID);
 }
 
 NodeProcessor::CongestionCache::TipCongestion* NodeProcessor::CongestionCache::Find(const NodeDB::StateID& sid)
@@ -898,9 +944,11 @@ private:
 
 	void DeleteRaw(Node&);
 	std::vector<ECC::Point::Native> m_vRes;
+	std::vector<Node*> m_vNodes;
 
-	virtual Sigma::CmList& get_List() = 0;
-	virtual void PrepareList(NodeProcessor&, const Node&) = 0;
+	// All the lists are prepared before the calculation, which is then split evenly across all the threads
+	virtual Sigma::CmList& get_List(uint32_t iNode) = 0;
+	virtual void PrepareList(NodeProcessor&, const Node&, uint32_t iNode) = 0;
 };
 
 void NodeProcessor::MultiSigmaContext::ClearLocked()
@@ -965,7 +1013,7 @@ struct NodeProcessor::MultiSigmaContext::MyTask
 	:public Executor::TaskSync
 {
 	MultiSigmaContext* m_pThis;
-	const Node* m_pNode;
+	uint32_t m_Total;
 
 	virtual void Exec(Executor::Context& ctx) override
 	{
@@ -973,38 +1021,61 @@ struct NodeProcessor::MultiSigmaContext::MyTask
 		val = Zero;
 
 		uint32_t i0, nCount;
-		ctx.get_Portion(i0, nCount, m_pNode->m_Max - m_pNode->m_Min);
-		i0 += m_pNode->m_Min;
+		ctx.get_Portion(i0, nCount, m_Total);
+
+		for (uint32_t iNode = 0; nCount; iNode++)
+		{
+			assert(iNode < m_pThis->m_vNodes.size());
+			const Node& n = *m_pThis->m_vNodes[iNode];
+
+			uint32_t nSize = n.m_Max - n.m_Min;
+			if (i0 >= nSize)
+			{
+				i0 -= nSize;
+				continue;
+			}
+
+			uint32_t nPortion = std::min(nCount, nSize - i0);
+			m_pThis->get_List(iNode).Calculate(val, n.m_Min + i0, nPortion, n.m_pS);
 
-		m_pThis->get_List().Calculate(val, i0, nCount, m_pNode->m_pS);
+			i0 = 0;
+			nCount -= nPortion;
+		}
 	}
 };
 
 void NodeProcessor::MultiSigmaContext::Calculate(ECC::Point::Native& res, NodeProcessor& np)
 {
+	if (m_Set.empty())
+		return;
+
 	Executor& ex = np.get_Executor();
 	uint32_t nThreads = ex.get_Threads();
 
-	while (!m_Set.empty())
+	MyTask t;
+	t.m_pThis = this;
+	t.m_Total = 0;
+
+	m_vNodes.clear();
+	for (Node::IDSet::iterator it = m_Set.begin(); m_Set.end() != it; ++it)
 	{
-		Node& n = m_Set.begin()->get_ParentObj();
+		Node& n = it->get_ParentObj();
 		assert(n.m_Min < n.m_Max);
 		assert(n.m_Max <= s_Chunk);
 
-		m_vRes.resize(nThreads);
-		PrepareList(np, n);
-
-		MyTask t;
-		t.m_pThis = this;
-		t.m_pNode = &n;
+		PrepareList(np, n, static_cast<uint32_t>(m_vNodes.size()));
+		m_vNodes.push_back(&n);
+		t.m_Total += n.m_Max - n.m_Min;
+	}
 
-		ex.ExecAll(t);
+	m_vRes.resize(nThreads);
+	ex.ExecAll(t);
 
-		for (uint32_t i = 0; i < nThreads; i++)
-			res += m_vRes[i];
+	for (uint32_t i = 0; i < nThreads; i++)
+		res += m_vRes[i];
 
-		DeleteRaw(n);
-	}
+	m_vNodes.clear();
+	ClearLocked();
 }
 
 struct NodeProcessor::MultiShieldedContext
@@ -1023,19 +1094,39 @@ struct NodeProcessor::MultiShieldedContext
 
 private:
 
-	Sigma::CmListVec m_Lst;
+	struct CmListChunk
+		:public Sigma::CmList
+	{
+		ShieldedCache::Chunk::Ptr m_pChunk;
+
+		virtual bool get_At(ECC::Point::Storage& res, uint32_t iIdx) override
+		{
+			if (iIdx >= m_pChunk->m_vec.size())
+				return false;
+
+			res = m_pChunk->m_vec[iIdx];
+			return true;
+		}
+	};
+
+	std::vector<CmListChunk> m_vLst;
 
 	bool IsValid(const TxKernelShieldedInput&, Height hScheme, std::vector<ECC::Scalar::Native>& vBuf, ECC::InnerProduct::BatchContext&);
 
-	virtual Sigma::CmList& get_List() override
+	virtual Sigma::CmList& get_List(uint32_t iNode) override
 	{
-		return m_Lst;
+		return m_vLst[iNode];
 	}
 
-	virtual void PrepareList(NodeProcessor& np, const Node& n) override
+	virtual void PrepareList(NodeProcessor& np, const Node& n, uint32_t iNode) override
 	{
-		m_Lst.m_vec.resize(s_Chunk); // will allocate if empty
-		np.get_DB().ShieldedRead(n.m_ID.m_Value + n.m_Min, &m_Lst.m_vec.front() + n.m_Min, n.m_Max - n.m_Min);
+		static_assert(s_Chunk == ShieldedCache::s_Chunk);
+		assert(!(n.m_ID.m_Value % s_Chunk));
+
+		if (m_vLst.size() <= iNode)
+			m_vLst.resize(iNode + 1);
+
+		m_vLst[iNode].m_pChunk = np.m_ShieldedCache.Get(np.get_DB(), n.m_ID.m_Value / s_Chunk, n.m_Max);
 	}
 
 	struct Walker
@@ -1193,19 +1284,23 @@ struct NodeProcessor::MultiAssetContext
 
 private:
 
-	Asset::Proof::CmList m_Lst;
+	std::vector<Asset::Proof::CmList> m_vLst;
 
-	virtual Sigma::CmList& get_List() override
+	virtual Sigma::CmList& get_List(uint32_t iNode) override
 	{
-		return m_Lst;
+		return m_vLst[iNode];
 	}
 
-	virtual void PrepareList(NodeProcessor& np, const Node& n) override
+	virtual void PrepareList(NodeProcessor& np, const Node& n, uint32_t iNode) override
 	{
-		static_assert(sizeof(n.m_ID.m_Value) >= sizeof(m_Lst.m_Begin));
+		if (m_vLst.size() <= iNode)
+			m_vLst.resize(iNode + 1);
+
+		auto& lst = m_vLst[iNode];
+		static_assert(sizeof(n.m_ID.m_Value) >= sizeof(lst.m_Begin));
 
 		// TODO: maybe cache it in DB
-		m_Lst.m_Begin = static_cast<Asset::ID>(n.m_ID.m_Value);
+		lst.m_Begin = static_cast<Asset::ID>(n.m_ID.m_Value);
 	}
 };
 
@@ -1333,6 +1428,7 @@ struct NodeProcessor::MultiblockContext
 
 	bool Flush()
 	{
+		Metrics::Histogram::Scope scopeMetrics(NodeMetrics::MultiblockFlush_us);
 		FlushInternal();
 		return !m_bFail;
 	}
@@ -1455,7 +1551,7 @@ struct NodeProcessor::MultiblockContext
 
 		m_pidLast = pid;
 
-		const size_t nSizeMax = 1024 * 1024 * 10; // fair enough
+		const size_t nSizeMax = m_This.m_SyncPipeline.m_Cfg.m_ValidateMaxSize;
 
 		Executor& ex = m_This.get_Executor();
 		for (uint32_t nTasks = static_cast<uint32_t>(-1); ; )
@@ -1469,6 +1565,9 @@ struct NodeProcessor::MultiblockContext
 				}
 			}
 
+			if (static_cast<uint32_t>(-1) == nTasks)
+				m_This.m_SyncPipeline.m_Apply.m_Stalls++; // wait for the verification to catch-up
+
 			assert(nTasks);
 			nTasks = ex.Flush(nTasks - 1);
 		}
@@ -1502,6 +1601,8 @@ struct NodeProcessor::MultiblockContext
 			auto pTask = std::make_unique<MyTask>();
 			pTask->m_pShared = pShared;
 			pTask->m_iVerifier = i;
+
+			NodeMetrics::VerifierTasks.Add(1); // before the push, the task may finish (and decrement) immediately
 			ex.Push(std::move(pTask));
 		}
 	}
@@ -1547,10 +1648,21 @@ void NodeProcessor::MultiblockContext::MyTask::Exec(Executor::Context&)
 	Asset::Proof::BatchContext::Scope scopeAssets(bcAssets);
 
 	m_pShared->Exec(m_iVerifier);
+	NodeMetrics::VerifierTasks.Add(-1);
+}
+
+namespace
+{
+	uint64_t GetTime_us()
+	{
+		return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
 }
 
 void NodeProcessor::MultiblockContext::MyTask::SharedBlock::Exec(uint32_t iVerifier)
 {
+	uint64_t t0_us = GetTime_us();
+
 	TxBase::Context ctx(m_Ctx.m_Params);
 	ctx.m_Height = m_Ctx.m_Height;
 	ctx.m_iVerifier = iVerifier;
@@ -1571,9 +1683,14 @@ void NodeProcessor::MultiblockContext::MyTask::SharedBlock::Exec(uint32_t iVerif
 	if (bValid)
 		bValid = m_Ctx.Merge(ctx);
 
+	NodeProcessor::SyncPipeline::Stage& stg = m_Mbc.m_This.m_SyncPipeline.m_Validate;
+	stg.m_Time_us += GetTime_us() - t0_us;
+
 	assert(m_Done < m_Pars.m_nVerifiers);
 	if (++m_Done == m_Pars.m_nVerifiers)
 	{
+		stg.m_Blocks++;
+
 		assert(m_Mbc.m_SizePending >= m_Size);
 		m_Mbc.m_SizePending -= m_Size;
 
@@ -1598,6 +1715,7 @@ void NodeProcessor::TryGoUp()
 
 	bool bDirty = false;
 	uint64_t rowid = m_Cursor.m_Sid.m_Row;
+	m_SyncPipeline.m_ApplyPending = 0;
 
 	while (true)
 	{
@@ -1623,19 +1741,41 @@ void NodeProcessor::TryGoUp()
 				break; // already at maximum (though maybe at different tip)
 		}
 
-		TryGoTo(sidTrg);
+		Height hTrg = sidTrg.m_Height;
 		bDirty = true;
+
+		if (!TryGoTo(sidTrg))
+		{
+			// yielded
+			m_SyncPipeline.m_ApplyPending = hTrg - m_Cursor.m_ID.m_Height;
+			if (OnGoUpYield())
+				break;
+
+			m_SyncPipeline.m_ApplyPending = 0;
+		}
 	}
 
 	if (bDirty)
 	{
 		PruneOld();
 		if (m_Cursor.m_Sid.m_Row != rowid)
+		{
+			m_SyncPipeline.Log();
 			OnNewState();
+		}
 	}
 }
 
-void NodeProcessor::TryGoTo(NodeDB::StateID& sidTrg)
+void NodeProcessor::SyncPipeline::Log() const
+{
+	LOG_INFO() << "Sync stages:"
+		<< " fetch=" << m_Fetch.m_Blocks << "/" << (m_Fetch.m_Time_us / 1000) << "ms/" << m_Fetch.m_Stalls
+		<< " validate=" << m_Validate.m_Blocks << "/" << (m_Validate.m_Time_us / 1000) << "ms"
+		<< " apply=" << m_Apply.m_Blocks << "/" << (m_Apply.m_Time_us / 1000) << "ms/" << m_Apply.m_Stalls
+		<< " pending=" << m_ApplyPending;
+}
+
+bool NodeProcessor::TryGoTo(NodeDB::StateID& sidTrg)
 {
 	// Calculate the path
 	std::vector<uint64_t> vPath;
@@ -1656,13 +1796,25 @@ void NodeProcessor::TryGoTo(NodeDB::StateID& sidTrg)
 	RollbackTo(sidTrg.m_Height);
 
 	MultiblockContext mbc(*this);
-	bool bContextFail = false, bKeepBlocks = false;
+	bool bContextFail = false, bKeepBlocks = false, bYield = false;
 
 	NodeDB::StateID sidFwd = m_Cursor.m_Sid;
 
+	const uint32_t nSlice_ms = m_SyncPipeline.m_Cfg.m_ApplySlice_ms;
+	const uint32_t t0_ms = GetTime_ms();
+
 	size_t iPos = vPath.size();
 	while (iPos)
 	{
+		if (nSlice_ms && (GetTime_ms() - t0_ms >= nSlice_ms))
+		{
+			// let the network and the rest proceed. The pending verification is completed below
+			bYield = true;
+			break;
+		}
+
+		uint64_t tBlock0_us = GetTime_us();
+
 		sidFwd.m_Height = m_Cursor.m_Sid.m_Height + 1;
 		sidFwd.m_Row = vPath[--iPos];
 
@@ -1691,6 +1843,9 @@ void NodeProcessor::TryGoTo(NodeDB::StateID& sidTrg)
 		if (IsFastSync())
 			m_DB.DelStateBlockPP(sidFwd.m_Row); // save space
 
+		m_SyncPipeline.m_Apply.m_Blocks++;
+		m_SyncPipeline.m_Apply.m_Time_us += GetTime_us() - tBlock0_us;
+
 		if (mbc.m_InProgress.m_Max == m_SyncData.m_Target.m_Height)
 		{
 			if (!mbc.Flush())
@@ -1707,7 +1862,7 @@ void NodeProcessor::TryGoTo(NodeDB::StateID& sidTrg)
 	}
 
 	if (mbc.Flush())
-		return; // at position
+		return !bYield; // at position
 
 	if (!bContextFail)
 		LOG_WARNING() << "Context-free verification failed";
@@ -1715,7 +1870,7 @@ void NodeProcessor::TryGoTo(NodeDB::StateID& sidTrg)
 	RollbackTo(mbc.m_InProgress.m_Min - 1);
 
 	if (bKeepBlocks)
-		return;
+		return true;
 
 	if (!(mbc.m_pidLast == Zero))
 	{
@@ -1739,6 +1894,7 @@ void NodeProcessor::TryGoTo(NodeDB::StateID& sidTrg)
 	LOG_INFO() << "Deleting blocks range: " << (m_Cursor.m_Sid.m_Height + 1) << "-" <<  sidFwd.m_Height;
 
 	DeleteBlocksInRange(sidFwd, m_Cursor.m_Sid.m_Height);
+	return true;
 }
 
 void NodeProcessor::OnFastSyncOver(MultiblockContext& mbc, bool& bContextFail)
@@ -2452,7 +2608,7 @@ struct NodeProcessor::BlockInterpretCtx
 	uint32_t m_ChargePerBlock = bvm2::Limits::BlockCharge;
 
 	BlobMap::Set m_ContractVars;
-	BlobMap::Entry& get_ContractVar(const Blob& key, NodeDB& db);
+	BlobMap::Entry& get_ContractVar(const Blob& key, NodeProcessor&);
 
 	std::vector<ContractInvokeExtraInfo>* m_pvC = nullptr;
 
@@ -2697,6 +2853,8 @@ struct NodeProcessor::MyRecognizer
 
 bool NodeProcessor::HandleBlock(const NodeDB::StateID& sid, const Block::SystemState::Full& s, MultiblockContext& mbc)
 {
+	Metrics::Histogram::Scope scopeMetrics(NodeMetrics::BlockHandle_us);
+
 	if (s.m_Height == m_ManualSelection.m_Sid.m_Height)
 	{
 		Merkle::Hash hv;
@@ -2904,6 +3062,8 @@ bool NodeProcessor::HandleBlock(const NodeDB::StateID& sid, const Block::SystemS
 		MyRecognizer rec(*this);
 		rec.m_Recognizer.Recognize(block, sid.m_Height, bic.m_ShieldedOuts);
 
+		m_Touched.OnBlock(block, sid.m_Height);
+
 		Serializer ser;
 		bic.m_Rollback.clear();
 		ser.swap_buf(bic.m_Rollback); // optimization
@@ -3121,11 +3281,33 @@ bool NodeProcessor::KrnWalkerRecognize::OnKrn(const TxKernel& krn)
 
 void NodeProcessor::Recognizer::Recognize(const TxKernelShieldedOutput& v, Height h, uint32_t nKrnIdx)
 {
-	TxoID nID = m_Extra.m_ShieldedOutputs++;
+	if (m_pvShieldedRecovered)
+	{
+		if (m_iShieldedRecovered >= m_pvShieldedRecovered->size())
+			throw std::runtime_error("shielded outputs recovered in advance mismatch");
+
+		Recognize(v, h, nKrnIdx, (*m_pvShieldedRecovered)[m_iShieldedRecovered++]);
+		return;
+	}
 
 	ViewerKeys vk;
 	m_Handler.get_ViewerKeys(vk);
 
+	ShieldedOutpRecovered res;
+	Recover(res, v, h, vk);
+	Recognize(v, h, nKrnIdx, res);
+}
+
+void NodeProcessor::Recognizer::set_ShieldedRecovered(const std::vector<ShieldedOutpRecovered>* pv)
+{
+	m_pvShieldedRecovered = pv;
+	m_iShieldedRecovered = 0;
+}
+
+void NodeProcessor::Recognizer::Recover(ShieldedOutpRecovered& res, const TxKernelShieldedOutput& v, Height h, const ViewerKeys& vk)
+{
+	res.m_Recovered = false;
+
 	for (Key::Index nIdx = 0; nIdx < vk.m_nSh; nIdx++)
 	{
 		const ShieldedTxo& txo = v.m_Txo;
@@ -3140,20 +3322,32 @@ void NodeProcessor::Recognizer::Recognize(const TxKernelShieldedOutput& v, Heigh
 		if (!pars.m_Output.Recover(txo, pars.m_Ticket.m_SharedSecret, h, oracle))
 			continue;
 
-		proto::Event::Shielded evt;
-		evt.m_TxoID = nID;
-		pars.ToID(evt.m_CoinID);
-		evt.m_CoinID.m_Key.m_nIdx = nIdx;
-		evt.m_Flags = proto::Event::Flags::Add;
-
-		EventKey::Shielded key = pars.m_Ticket.m_SpendPk;
-		key.m_Y |= EventKey::s_FlagShielded;
-
-		AddEvent(h, EventKey::s_IdxKernel + nKrnIdx, evt, key);
+		pars.ToID(res.m_CoinID);
+		res.m_CoinID.m_Key.m_nIdx = nIdx;
+		res.m_SpendPk = pars.m_Ticket.m_SpendPk;
+		res.m_Recovered = true;
 		break;
 	}
 }
 
+void NodeProcessor::Recognizer::Recognize(const TxKernelShieldedOutput&, Height h, uint32_t nKrnIdx, const ShieldedOutpRecovered& res)
+{
+	TxoID nID = m_Extra.m_ShieldedOutputs++;
+
+	if (!res.m_Recovered)
+		return;
+
+	proto::Event::Shielded evt;
+	evt.m_TxoID = nID;
+	evt.m_CoinID = res.m_CoinID;
+	evt.m_Flags = proto::Event::Flags::Add;
+
+	EventKey::Shielded key = res.m_SpendPk;
+	key.m_Y |= EventKey::s_FlagShielded;
+
+	AddEvent(h, EventKey::s_IdxKernel + nKrnIdx, evt, key);
+}
+
 void NodeProcessor::Recognizer::Recognize(const Output& x, Height h, Key::IPKdf& keyViewer)
 {
 	CoinID cid;
@@ -3267,7 +3461,7 @@ bool NodeProcessor::HandleKernelType(const TxKernelContractCreate& krn, BlockInt
 		bvm2::ContractID cid;
 		bvm2::get_CidViaSid(cid, sid, krn.m_Args);
 
-		auto& e = bic.get_ContractVar(cid, m_DB);
+		auto& e = bic.get_ContractVar(cid, *this);
 		if (!e.m_Data.empty())
 		{
 			bic.m_TxStatus = proto::TxStatus::ContractFailNode;
@@ -3367,53 +3561,252 @@ bool NodeProcessor::ViewerKeys::IsEmpty() const
 
 void NodeProcessor::RescanOwnedTxos()
 {
+	// The recovery (bulletproof rewind for txos, trial decryption for shielded outputs) is done in chunks on the executor threads.
+	// The DB is only accessed from this thread, and the events are added in the original (height) order.
 	m_DB.DeleteEventsFrom(Rules::HeightGenesis - 1);
 
 	MyRecognizer rec(*this);
 
 	struct TxoRecover
-		:public ITxoRecover
+		:public ITxoWalker
 	{
+		struct Item
+		{
+			ByteBuffer m_Value;
+			Height m_hCreate;
+			Height m_hSpend;
+			Output m_Outp;
+			CoinID m_Cid;
+			Output::User m_User;
+			bool m_Recovered;
+		};
+
+		struct MyTask
+			:public Executor::TaskSync
+		{
+			TxoRecover* m_pThis;
+			std::vector<uint8_t> m_vFailed; // per thread
+
+			virtual void Exec(Executor::Context& ctx) override
+			{
+				uint32_t i0, nCount;
+				ctx.get_Portion(i0, nCount, static_cast<uint32_t>(m_pThis->m_vItems.size()));
+
+				try
+				{
+					for (uint32_t i = 0; i < nCount; i++)
+					{
+						Item& x = m_pThis->m_vItems[i0 + i];
+
+						Deserializer der;
+						der.reset(x.m_Value);
+						der & x.m_Outp;
+
+						x.m_Recovered = x.m_Outp.Recover(x.m_hCreate, m_pThis->m_Key, x.m_Cid, &x.m_User);
+					}
+				}
+				catch (const std::exception&)
+				{
+					m_vFailed[ctx.m_iThread] = 1;
+				}
+			}
+		};
+
+		NodeProcessor& m_This;
+		Key::IPKdf& m_Key;
 		MyRecognizer& m_Rec;
+		std::vector<Item> m_vItems;
+		size_t m_Chunk = 0x2000;
 		uint32_t m_Total = 0;
 		uint32_t m_Unspent = 0;
 
 		TxoRecover(Key::IPKdf& key, NodeProcessor& x, MyRecognizer& rec)
-			:ITxoRecover(key)
+			:m_This(x)
+			,m_Key(key)
 			,m_Rec(rec)
 		{
 		}
 
-		virtual bool OnTxo(const NodeDB::WalkerTxo& wlk, Height hCreate, Output& outp, const CoinID& cid, const Output::User& user) override
+		virtual bool OnTxo(const NodeDB::WalkerTxo& wlk, Height hCreate) override
 		{
-			if (cid.IsDummy())
-			{
-				m_Rec.m_Handler.m_Proc.OnDummy(cid, hCreate);
+			if (TxoIsNaked(wlk.m_Value))
 				return true;
+
+			Item& x = m_vItems.emplace_back();
+			wlk.m_Value.Export(x.m_Value);
+			x.m_hCreate = hCreate;
+			x.m_hSpend = wlk.m_SpendHeight;
+
+			if (m_vItems.size() >= m_Chunk)
+				Flush();
+
+			return true;
+		}
+
+		void Flush()
+		{
+			if (m_vItems.empty())
+				return;
+
+			Executor& ex = m_This.get_Executor();
+
+			MyTask t;
+			t.m_pThis = this;
+			t.m_vFailed.resize(ex.get_Threads());
+			ex.ExecAll(t);
+
+			for (size_t i = 0; i < t.m_vFailed.size(); i++)
+				if (t.m_vFailed[i])
+					OnCorrupted();
+
+			for (size_t i = 0; i < m_vItems.size(); i++)
+			{
+				const Item& x = m_vItems[i];
+				if (x.m_Recovered)
+					OnRecovered(x);
+			}
+
+			m_vItems.clear();
+		}
+
+		void OnRecovered(const Item& x)
+		{
+			if (x.m_Cid.IsDummy())
+			{
+				m_Rec.m_Handler.m_Proc.OnDummy(x.m_Cid, x.m_hCreate);
+				return;
 			}
 
 			proto::Event::Utxo evt;
 			evt.m_Flags = proto::Event::Flags::Add;
-			evt.m_Cid = cid;
-			evt.m_Commitment = outp.m_Commitment;
-			evt.m_Maturity = outp.get_MinMaturity(hCreate);
-			evt.m_User = user;
+			evt.m_Cid = x.m_Cid;
+			evt.m_Commitment = x.m_Outp.m_Commitment;
+			evt.m_Maturity = x.m_Outp.get_MinMaturity(x.m_hCreate);
+			evt.m_User = x.m_User;
 
-			const EventKey::Utxo& key = outp.m_Commitment;
-			m_Rec.m_Recognizer.AddEvent(hCreate, EventKey::s_IdxOutput, evt, key);
+			const EventKey::Utxo& key = x.m_Outp.m_Commitment;
+			m_Rec.m_Recognizer.AddEvent(x.m_hCreate, EventKey::s_IdxOutput, evt, key);
 
 			m_Total++;
 
-			if (MaxHeight == wlk.m_SpendHeight)
+			if (MaxHeight == x.m_hSpend)
 				m_Unspent++;
 			else
 			{
 				evt.m_Flags = 0;
-				m_Rec.m_Recognizer.AddEvent(wlk.m_SpendHeight, EventKey::s_IdxInput, evt);
+				m_Rec.m_Recognizer.AddEvent(x.m_hSpend, EventKey::s_IdxInput, evt);
+			}
+		}
+	};
+
+	struct KrnRecover
+		:public IKrnWalker
+	{
+		struct Outp
+		{
+			const TxKernelShieldedOutput* m_pKrn;
+			Height m_Height;
+		};
+
+		struct MyTask
+			:public Executor::TaskSync
+		{
+			KrnRecover* m_pThis;
+
+			virtual void Exec(Executor::Context& ctx) override
+			{
+				uint32_t i0, nCount;
+				ctx.get_Portion(i0, nCount, static_cast<uint32_t>(m_pThis->m_vOutp.size()));
+
+				for (uint32_t i = 0; i < nCount; i++)
+				{
+					const Outp& x = m_pThis->m_vOutp[i0 + i];
+					Recognizer::Recover(m_pThis->m_vRes[i0 + i], *x.m_pKrn, x.m_Height, m_pThis->m_Vk);
+				}
+			}
+		};
+
+		NodeProcessor& m_This;
+		Recognizer& m_Rec;
+		const ViewerKeys& m_Vk;
+
+		Height m_h0 = 0;
+		std::vector<std::vector<TxKernel::Ptr> > m_vBlocks;
+		std::vector<Outp> m_vOutp;
+		std::vector<Recognizer::ShieldedOutpRecovered> m_vRes; // per outp
+		size_t m_Krns = 0;
+		size_t m_ChunkOutp = 0x400;
+		size_t m_ChunkKrns = 0x10000;
+
+		KrnRecover(NodeProcessor& x, Recognizer& rec, const ViewerKeys& vk)
+			:m_This(x)
+			,m_Rec(rec)
+			,m_Vk(vk)
+		{
+		}
+
+		virtual bool OnKrn(const TxKernel& krn) override
+		{
+			m_Krns++;
+
+			if (TxKernel::Subtype::ShieldedOutput == krn.get_Subtype())
+			{
+				Outp& x = m_vOutp.emplace_back();
+				x.m_pKrn = &Cast::Up<TxKernelShieldedOutput>(krn);
+				x.m_Height = m_Height;
 			}
 
 			return true;
 		}
+
+		void AddHeight(Height h)
+		{
+			if (m_vBlocks.empty())
+				m_h0 = h;
+
+			TxVectors::Eternal txve;
+			m_This.ReadKrns(m_This.FindActiveAtStrict(h), txve);
+
+			m_Height = h;
+			m_nKrnIdx = 0;
+			Process(txve.m_vKernels);
+
+			m_vBlocks.emplace_back().swap(txve.m_vKernels);
+
+			if ((m_vOutp.size() >= m_ChunkOutp) || (m_Krns >= m_ChunkKrns))
+				Flush();
+		}
+
+		void Flush()
+		{
+			if (!m_vOutp.empty())
+			{
+				m_vRes.resize(m_vOutp.size());
+
+				MyTask t;
+				t.m_pThis = this;
+				m_This.get_Executor().ExecAll(t);
+
+				m_Rec.set_ShieldedRecovered(&m_vRes);
+			}
+
+			// the same walk, the shielded outputs are already recovered
+			KrnWalkerRecognize wlk(m_Rec);
+			for (size_t i = 0; i < m_vBlocks.size(); i++)
+			{
+				wlk.m_Height = m_h0 + i;
+				wlk.m_nKrnIdx = 0;
+				wlk.Process(m_vBlocks[i]);
+			}
+
+			assert(m_vRes.empty() || (m_Rec.m_iShieldedRecovered == m_vRes.size()));
+			m_Rec.set_ShieldedRecovered(nullptr);
+
+			m_vBlocks.clear();
+			m_vOutp.clear();
+			m_vRes.clear();
+			m_Krns = 0;
+		}
 	};
 
 	ViewerKeys vk;
@@ -3425,6 +3818,7 @@ void NodeProcessor::RescanOwnedTxos()
 
 		TxoRecover wlk(*vk.m_pMw, *this, rec);
 		EnumTxos(wlk);
+		wlk.Flush();
 
 		LOG_INFO() << "Recovered " << wlk.m_Unspent << "/" << wlk.m_Total << " unspent/total Txos";
 	}
@@ -3444,8 +3838,10 @@ void NodeProcessor::RescanOwnedTxos()
 			TxoID nOuts = m_Extra.m_ShieldedOutputs;
 			m_Extra.m_ShieldedOutputs = 0;
 
-			KrnWalkerRecognize wlkKrn(rec.m_Recognizer);
-			EnumKernels(wlkKrn, HeightRange(h0, m_Cursor.m_Sid.m_Height));
+			KrnRecover wlkKrn(*this, rec.m_Recognizer, vk);
+			for (Height h = h0; h <= m_Cursor.m_Sid.m_Height; h++)
+				wlkKrn.AddHeight(h);
+			wlkKrn.Flush();
 
 			assert(m_Extra.m_ShieldedOutputs == nOuts);
 			nOuts; // supporess unused var warning in release
@@ -3836,6 +4232,7 @@ bool NodeProcessor::HandleKernelType(const TxKernelShieldedOutput& krn, BlockInt
 			// Append to cmList
 			m_DB.ShieldedResize(m_Extra.m_ShieldedOutputs + 1, m_Extra.m_ShieldedOutputs);
 			m_DB.ShieldedWrite(m_Extra.m_ShieldedOutputs, &pt_s, 1);
+			m_ShieldedCache.OnModified(m_Extra.m_ShieldedOutputs);
 
 			// Append state hash
 			ECC::Hash::Value hvState;
@@ -3876,6 +4273,7 @@ bool NodeProcessor::HandleKernelType(const TxKernelShieldedOutput& krn, BlockInt
 		{
 			m_DB.ShieldedResize(m_Extra.m_ShieldedOutputs - 1, m_Extra.m_ShieldedOutputs);
 			m_DB.ShieldedStateResize(m_Extra.m_ShieldedOutputs - 1, m_Extra.m_ShieldedOutputs);
+			m_ShieldedCache.OnModified(m_Extra.m_ShieldedOutputs - 1);
 		}
 
 		if (!bic.m_SkipDefinition)
@@ -4562,6 +4960,10 @@ NodeProcessor::BlockInterpretCtx::BvmProcessor::BvmProcessor(BlockInterpretCtx&
 	:m_Bic(bic)
 	,m_Proc(proc)
 {
+	if (!proc.m_pBvmDecoded)
+		proc.m_pBvmDecoded = std::make_unique<bvm2::DecodedCache>();
+	m_pDecodedCache = proc.m_pBvmDecoded.get();
+
 	if (bic.m_Fwd)
 	{
 		BlockInterpretCtx::Ser ser(bic);
@@ -4604,10 +5006,7 @@ bool NodeProcessor::BlockInterpretCtx::BvmProcessor::Invoke(const bvm2::Contract
 		}
 
 		while (!IsDone())
-		{
-			DischargeUnits(bvm2::Limits::Cost::Cycle);
-			RunOnce();
-		}
+			RunCharged();
 
 		if (!m_Bic.m_AlreadyValidated)
 			CheckSigs(krn.m_Commitment, krn.m_Signature);
@@ -4852,42 +5251,79 @@ void NodeProcessor::get_ContractDescr(const ECC::uintBig& sid, const ECC::uintBi
 	}
 }
 
-BlobMap::Entry& NodeProcessor::BlockInterpretCtx::get_ContractVar(const Blob& key, NodeDB& db)
+BlobMap::Entry& NodeProcessor::BlockInterpretCtx::get_ContractVar(const Blob& key, NodeProcessor& p)
 {
 	auto* pE = m_ContractVars.Find(key);
 	if (!pE)
 	{
 		pE = m_ContractVars.Create(key);
-
-		Blob data;
-		NodeDB::Recordset rs;
-		if (db.ContractDataFind(key, data, rs))
-			data.Export(pE->m_Data);
+		p.ContractVarLoad(key, pE->m_Data, m_Temporary);
 	}
 	return *pE;
 }
 
+NodeProcessor::ContractVarCache* NodeProcessor::get_ContractVarCache(bool bTemporary)
+{
+	if (!m_ContractVarCache.m_MaxSize)
+		return nullptr;
+
+	if (!m_ContractVarCache.m_Settled)
+		// the DB is being modified. The cache is in sync, but it's not for the current tip
+		return bTemporary ? nullptr : &m_ContractVarCache;
+
+	assert(m_ContractVarCache.m_Tip == m_Cursor.m_ID); // stamped on each cursor change
+	return &m_ContractVarCache;
+}
+
+bool NodeProcessor::ContractVarLoad(const Blob& key, ByteBuffer& res, bool bTemporary)
+{
+	auto* pCache = get_ContractVarCache(bTemporary);
+	if (pCache)
+		return pCache->Load(key, res, m_DB);
+
+	Blob data;
+	NodeDB::Recordset rs;
+	if (!m_DB.ContractDataFind(key, data, rs))
+		return false;
+
+	data.Export(res);
+	return true;
+}
+
+bool NodeProcessor::ContractVarFindNext(const Blob& key, ByteBuffer& keyNext, bool bBigger, bool bTemporary)
+{
+	auto* pCache = get_ContractVarCache(bTemporary);
+	if (pCache)
+		return pCache->FindNext(key, keyNext, bBigger, m_DB);
+
+	NodeDB::Recordset rs;
+	Blob keyDB = key;
+	bool bFound = bBigger ?
+		m_DB.ContractDataFindNext(keyDB, rs) :
+		m_DB.ContractDataFindPrev(keyDB, rs);
+
+	if (bFound)
+		keyDB.Export(keyNext);
+
+	return bFound;
+}
+
 void NodeProcessor::BlockInterpretCtx::BvmProcessor::LoadVar(const Blob& key, Blob& res)
 {
-	auto& e = m_Bic.get_ContractVar(key, m_Proc.m_DB);
+	auto& e = m_Bic.get_ContractVar(key, m_Proc);
 	res = e.m_Data;
 }
 
 BlobMap::Entry* NodeProcessor::BlockInterpretCtx::BvmProcessor::FindVarEx(const Blob& key, bool bExact, bool bBigger)
 {
-	auto* pE = &m_Bic.get_ContractVar(key, m_Proc.m_DB);
+	auto* pE = &m_Bic.get_ContractVar(key, m_Proc);
 	if (pE->m_Data.empty() || !bExact)
 	{
+		ByteBuffer keyDB;
 		while (true)
 		{
-			NodeDB::Recordset rs;
-			Blob keyDB = pE->ToBlob();
-			bool bNextDB = bBigger ?
-				m_Proc.m_DB.ContractDataFindNext(keyDB, rs) :
-				m_Proc.m_DB.ContractDataFindPrev(keyDB, rs);
-
-			if (bNextDB)
-				m_Bic.get_ContractVar(keyDB, m_Proc.m_DB);
+			if (m_Proc.ContractVarFindNext(pE->ToBlob(), keyDB, bBigger, m_Bic.m_Temporary))
+				m_Bic.get_ContractVar(keyDB, m_Proc);
 
 			auto it = BlobMap::Set::s_iterator_to(*pE);
 			if (bBigger)
@@ -4928,7 +5364,7 @@ void NodeProcessor::BlockInterpretCtx::BvmProcessor::LoadVarEx(Blob& key, Blob&
 
 uint32_t NodeProcessor::BlockInterpretCtx::BvmProcessor::SaveVar(const Blob& key, const Blob& data)
 {
-	auto& e = m_Bic.get_ContractVar(key, m_Proc.m_DB);
+	auto& e = m_Bic.get_ContractVar(key, m_Proc);
 	auto nOldSize = static_cast<uint32_t>(e.m_Data.size());
 
 	if (Blob(e.m_Data) != data)
@@ -4971,7 +5407,10 @@ void NodeProcessor::BlockInterpretCtx::BvmProcessor::ContractDataInsert(const Bl
 {
 	ContractDataToggleTree(key, data, true);
 	if (!m_Bic.m_Temporary)
+	{
 		m_Proc.m_DB.ContractDataInsert(key, data);
+		m_Proc.m_ContractVarCache.OnModified(key, data);
+	}
 }
 
 void NodeProcessor::BlockInterpretCtx::BvmProcessor::ContractDataUpdate(const Blob& key, const Blob& val, const Blob& valOld)
@@ -4979,14 +5418,20 @@ void NodeProcessor::BlockInterpretCtx::BvmProcessor::ContractDataUpdate(const Bl
 	ContractDataToggleTree(key, val, true);
 	ContractDataToggleTree(key, valOld, false);
 	if (!m_Bic.m_Temporary)
+	{
 		m_Proc.m_DB.ContractDataUpdate(key, val);
+		m_Proc.m_ContractVarCache.OnModified(key, val);
+	}
 }
 
 void NodeProcessor::BlockInterpretCtx::BvmProcessor::ContractDataDel(const Blob& key, const Blob& valOld)
 {
 	ContractDataToggleTree(key, valOld, false);
 	if (!m_Bic.m_Temporary)
+	{
 		m_Proc.m_DB.ContractDataDel(key);
+		m_Proc.m_ContractVarCache.OnModified(key, Blob());
+	}
 }
 
 bool NodeProcessor::Mapped::Contract::IsStored(const Blob& key)
@@ -5236,7 +5681,7 @@ void NodeProcessor::BlockInterpretCtx::BvmProcessor::UndoVars()
 		default:
 			{
 				der & key;
-				auto& e = m_Bic.get_ContractVar(key, m_Proc.m_DB);
+				auto& e = m_Bic.get_ContractVar(key, m_Proc);
 
 				if (RecoveryTag::Delete == nTag)
 				{
@@ -5386,6 +5831,9 @@ void NodeProcessor::RollbackTo(Height h)
 
 	assert(h >= m_Extra.m_Fossil);
 
+	m_Touched.m_Overflow = true;
+	m_BodyCache.ShrinkTo(0);
+
 	TxoID id0 = get_TxosBefore(h + 1);
 
 	// undo inputs
@@ -6597,33 +7045,193 @@ bool NodeProcessor::ITxoWalker_Unspent::OnTxo(const NodeDB::WalkerTxo& wlk, Heig
 
 void NodeProcessor::InitializeUtxos()
 {
+	// The unspent txos are collected in chunks. For each chunk the keys are evaluated and sorted on the executor threads,
+	// then inserted in the key order (much more cache-friendly than the txo order).
+	// The tree hashes are evaluated lazily afterwards, in a single pass.
 	struct Walker
-		:public ITxoWalker_UnspentNaked
+		:public ITxoWalker
 	{
+		struct Raw
+		{
+			TxoID m_ID;
+			Height m_hCreate;
+			uint32_t m_nNaked;
+			uint8_t m_pNaked[s_TxoNakedMax];
+		};
+
+		struct Element
+		{
+			UtxoTree::Key m_Key;
+			TxoID m_ID;
+
+			bool operator < (const Element& x) const
+			{
+				int n = m_Key.V.cmp(x.m_Key.V);
+				return n ? (n < 0) : (m_ID < x.m_ID);
+			}
+		};
+
+		struct MyTask
+			:public Executor::TaskSync
+		{
+			Walker* m_pThis;
+			std::vector<uint32_t> m_vEnd; // per thread
+			std::vector<uint8_t> m_vFailed; // per thread
+
+			virtual void Exec(Executor::Context& ctx) override
+			{
+				uint32_t i0, nCount;
+				ctx.get_Portion(i0, nCount, static_cast<uint32_t>(m_pThis->m_vRaw.size()));
+				m_vEnd[ctx.m_iThread] = i0 + nCount;
+
+				try
+				{
+					for (uint32_t i = 0; i < nCount; i++)
+					{
+						const Raw& x = m_pThis->m_vRaw[i0 + i];
+
+						Deserializer der;
+						der.reset(x.m_pNaked, x.m_nNaked);
+
+						Output outp;
+						der & outp;
+
+						UtxoTree::Key::Data d;
+						d.m_Commitment = outp.m_Commitment;
+						d.m_Maturity = outp.get_MinMaturity(x.m_hCreate);
+
+						Element& el = m_pThis->m_vElems[i0 + i];
+						el.m_Key = d;
+						el.m_ID = x.m_ID;
+					}
+
+					std::sort(m_pThis->m_vElems.begin() + i0, m_pThis->m_vElems.begin() + i0 + nCount);
+				}
+				catch (const std::exception&)
+				{
+					m_vFailed[ctx.m_iThread] = 1;
+				}
+			}
+		};
+
 		TxoID m_TxosTotal = 0;
+		size_t m_Chunk = 0x40000;
 		NodeProcessor& m_This;
+		std::vector<Raw> m_vRaw;
+		std::vector<Element> m_vElems;
+
 		Walker(NodeProcessor& x) :m_This(x) {}
 
 		virtual bool OnTxo(const NodeDB::WalkerTxo& wlk, Height hCreate) override
 		{
 			m_This.InitializeUtxosProgress(wlk.m_ID, m_TxosTotal);
-			return ITxoWalker_UnspentNaked::OnTxo(wlk, hCreate);
+
+			if (wlk.m_SpendHeight != MaxHeight)
+				return true;
+
+			Raw& x = m_vRaw.emplace_back();
+			x.m_ID = wlk.m_ID;
+			x.m_hCreate = hCreate;
+
+			Blob blob = wlk.m_Value;
+			TxoToNaked(x.m_pNaked, blob); // save allocation and deserialization of sig
+			x.m_nNaked = blob.n;
+
+			if (m_vRaw.size() >= m_Chunk)
+				Flush();
+
+			return true;
 		}
 
-		virtual bool OnTxo(const NodeDB::WalkerTxo& wlk, Height hCreate, Output& outp) override
+		void Flush()
 		{
-			m_This.m_Extra.m_Txos = wlk.m_ID;
-			BlockInterpretCtx bic(hCreate, true);
-			if (!m_This.HandleBlockElement(outp, bic))
-				OnCorrupted();
+			if (m_vRaw.empty())
+				return;
 
-			return true;
+			Executor& ex = m_This.get_Executor();
+			uint32_t nThreads = ex.get_Threads();
+
+			m_vElems.resize(m_vRaw.size());
+
+			MyTask t;
+			t.m_pThis = this;
+			t.m_vEnd.resize(nThreads);
+			t.m_vFailed.resize(nThreads);
+			ex.ExecAll(t);
+
+			for (uint32_t i = 0; i < nThreads; i++)
+				if (t.m_vFailed[i])
+					OnCorrupted();
+
+			// merge the sorted portions
+			std::vector<uint32_t> vPos(nThreads);
+			for (uint32_t i = 1; i < nThreads; i++)
+				vPos[i] = t.m_vEnd[i - 1];
+
+			auto& tree = m_This.m_Mapped.m_Utxo;
+
+			// keys arrive sorted, hence each search resumes from the common prefix with the previous one
+			UtxoTree::Cursor cu;
+			const Element* pPrev = nullptr;
+
+			while (true)
+			{
+				const Element* pMin = nullptr;
+				uint32_t iMin = 0;
+
+				for (uint32_t i = 0; i < nThreads; i++)
+				{
+					if (vPos[i] < t.m_vEnd[i])
+					{
+						const Element& el = m_vElems[vPos[i]];
+						if (!pMin || (el < *pMin))
+						{
+							pMin = &el;
+							iMin = i;
+						}
+					}
+				}
+
+				if (!pMin)
+					break;
+				vPos[iMin]++;
+
+				if (tree.EnsureReserve())
+					pPrev = nullptr; // remapped, the cursor is stale
+
+				bool bCreate = true;
+				UtxoTree::MyLeaf* p = pPrev ?
+					tree.FindNext(cu, pMin->m_Key, pPrev->m_Key, bCreate) :
+					tree.Find(cu, pMin->m_Key, bCreate);
+
+				pPrev = pMin;
+
+				cu.InvalidateElement();
+				tree.OnDirty();
+
+				if (bCreate)
+					p->m_ID = pMin->m_ID;
+				else
+				{
+					Input::Count nCountInc = p->get_Count() + 1;
+					if (!nCountInc)
+						OnCorrupted();
+
+					tree.PushID(pMin->m_ID, *p);
+				}
+			}
+
+			m_vRaw.clear();
+			m_vElems.clear();
 		}
 	};
 
 	Walker wlk(*this);
 	wlk.m_TxosTotal = get_TxosBefore(m_Cursor.m_ID.m_Height + 1);
+	wlk.m_vRaw.reserve(wlk.m_Chunk);
+
 	EnumTxos(wlk);
+	wlk.Flush();
 }
 
 bool NodeProcessor::GetBlock(const NodeDB::StateID& sid, ByteBuffer* pEthernal, ByteBuffer* pPerishable, Height h0, Height hLo1, Height hHi1, bool bActive)
@@ -6675,6 +7283,25 @@ bool NodeProcessor::GetBlockInternal(const NodeDB::StateID& sid, ByteBuffer* pEt
 	if (!bActive && !(m_DB.GetStateFlags(sid.m_Row) & NodeDB::StateFlags::Active))
 		return false; // only active states are supported
 
+	// The result depends on the spend heights of the block outputs. It won't change with new blocks if they're all above hHi1.
+	// Rollback invalidates the whole cache.
+	BodyCache::Entry::Key::Type keyCache;
+	bool bCacheable = !pBody && m_BodyCache.m_MaxSize && (hHi1 <= m_Cursor.m_ID.m_Height);
+	if (bCacheable)
+	{
+		keyCache.m_Row = sid.m_Row;
+		keyCache.m_h0 = (sid.m_Height > hLo1) ? MaxHeight : h0; // otherwise all the inputs are transferred
+		keyCache.m_hLo1 = hLo1;
+		keyCache.m_hHi1 = hHi1;
+
+		const ByteBuffer* pBuf = m_BodyCache.Find(keyCache);
+		if (pBuf)
+		{
+			*pPerishable = *pBuf;
+			return true;
+		}
+	}
+
 	TxoID idInpCut = get_TxosBefore(h0 + 1);
 	TxoID id0;
 
@@ -6802,6 +7429,9 @@ bool NodeProcessor::GetBlockInternal(const NodeDB::StateID& sid, ByteBuffer* pEt
 		ser.swap_buf(*pPerishable);
 
 		ser.swap_buf(*pPerishable);
+
+		if (bCacheable)
+			m_BodyCache.Insert(keyCache, *pPerishable);
 	}
 
 	return true;
@@ -6874,6 +7504,7 @@ void NodeProcessor::RebuildNonStd()
 	// Delete all asset info, contracts, shielded, and replay everything
 	m_Mapped.m_Contract.Clear();
 	m_DB.ContractDataDelAll();
+	m_ContractVarCache.Clear();
 	m_DB.ContractLogDel(HeightPos(0), HeightPos(MaxHeight));
 	m_DB.ShieldedOutpDelFrom(0);
 	m_DB.ParamDelSafe(NodeDB::ParamID::ShieldedInputs);
@@ -6887,6 +7518,7 @@ void NodeProcessor::RebuildNonStd()
 
 	static_assert(NodeDB::StreamType::StatesMmr == 0);
 	m_DB.StreamsDelAll(static_cast<NodeDB::StreamType::Enum>(1), NodeDB::StreamType::count);
+	m_ShieldedCache.Clear();
 
 	struct KrnWalkerRebuild
 		:public IKrnWalker
@@ -6949,6 +7581,8 @@ void NodeProcessor::RebuildNonStd()
 	wlk.m_pvC = m_DB.ParamIntGetDef(NodeDB::ParamID::RichContractInfo) ? &vC : nullptr;
 
 	EnumKernels(wlk, HeightRange(Rules::get().pForks[2].m_Height, m_Cursor.m_ID.m_Height));
+
+	m_ContractVarCache.OnTip(m_Cursor.m_ID);
 }
 
 int NodeProcessor::get_AssetAt(Asset::Full& ai, Height h)
@@ -7079,6 +7713,315 @@ void NodeProcessor::ValidatedCache::MoveInto(ValidatedCache& dst)
 	}
 }
 
+bool NodeProcessor::BodyCache::Entry::Key::Type::operator < (const Type& x) const
+{
+	if (m_Row != x.m_Row)
+		return m_Row < x.m_Row;
+	if (m_h0 != x.m_h0)
+		return m_h0 < x.m_h0;
+	if (m_hLo1 != x.m_hLo1)
+		return m_hLo1 < x.m_hLo1;
+	return m_hHi1 < x.m_hHi1;
+}
+
+void NodeProcessor::BodyCache::Delete(Entry& x)
+{
+	assert(m_Size >= x.m_Perishable.size());
+	m_Size -= x.m_Perishable.size();
+
+	m_Keys.erase(KeySet::s_iterator_to(x.m_Key));
+	m_Mru.erase(MruList::s_iterator_to(x.m_Mru));
+	delete &x;
+}
+
+void NodeProcessor::BodyCache::ShrinkTo(size_t n)
+{
+	while (m_Size > n)
+		Delete(m_Mru.back().get_ParentObj());
+}
+
+const ByteBuffer* NodeProcessor::BodyCache::Find(const Entry::Key::Type& val)
+{
+	Entry::Key key;
+	key.m_Value = val;
+
+	KeySet::iterator it = m_Keys.find(key);
+	if (m_Keys.end() == it)
+		return nullptr;
+
+	Entry& x = it->get_ParentObj();
+
+	m_Mru.erase(MruList::s_iterator_to(x.m_Mru));
+	m_Mru.push_front(x.m_Mru);
+
+	return &x.m_Perishable;
+}
+
+void NodeProcessor::BodyCache::Insert(const Entry::Key::Type& val, const ByteBuffer& buf)
+{
+	if (buf.empty() || (buf.size() > m_MaxSize))
+		return;
+
+	ShrinkTo(m_MaxSize - buf.size());
+
+	Entry* pEntry(new Entry);
+	pEntry->m_Key.m_Value = val;
+	pEntry->m_Perishable = buf;
+
+	m_Keys.insert(pEntry->m_Key);
+	m_Mru.push_front(pEntry->m_Mru);
+	m_Size += buf.size();
+}
+
+void NodeProcessor::ContractVarCache::Delete(Entry& x)
+{
+	assert(m_Size >= x.get_Size());
+	m_Size -= x.get_Size();
+
+	// the gap that spans over the deleted entry remains known only if it's absent
+	bool bGap = x.m_GapNext && x.m_Data.empty();
+
+	KeySet::iterator it = KeySet::s_iterator_to(x.m_Key);
+	if (m_Keys.begin() == it)
+		m_GapFront = m_GapFront && bGap;
+	else
+	{
+		Entry& xPrev = std::prev(it)->get_ParentObj();
+		xPrev.m_GapNext = xPrev.m_GapNext && bGap;
+	}
+
+	m_Keys.erase(it);
+	m_Mru.erase(MruList::s_iterator_to(x.m_Mru));
+	delete &x;
+}
+
+void NodeProcessor::ContractVarCache::ShrinkTo(size_t n)
+{
+	while (m_Size > n)
+		Delete(m_Mru.back().get_ParentObj());
+}
+
+void NodeProcessor::ContractVarCache::Clear()
+{
+	ShrinkTo(0);
+	m_GapFront = false;
+}
+
+void NodeProcessor::ContractVarCache::OnTip(const Block::SystemState::ID& id)
+{
+	// the cache is write-through, all the modifications (if any) are already reflected. Most blocks don't touch contract vars
+	m_Tip = id;
+	m_Settled = true;
+}
+
+NodeProcessor::ContractVarCache::Entry* NodeProcessor::ContractVarCache::Find(const Blob& key)
+{
+	KeySet::iterator it = m_Keys.find(key, Comparator());
+	if (m_Keys.end() == it)
+		return nullptr;
+
+	Entry& x = it->get_ParentObj();
+
+	m_Mru.erase(MruList::s_iterator_to(x.m_Mru));
+	m_Mru.push_front(x.m_Mru);
+
+	return &x;
+}
+
+NodeProcessor::ContractVarCache::Entry& NodeProcessor::ContractVarCache::Insert(const Blob& key, const Blob& data)
+{
+	Entry* pEntry(new Entry);
+	key.Export(pEntry->m_Key.m_Value);
+	data.Export(pEntry->m_Data);
+
+	KeySet::iterator it = m_Keys.insert(pEntry->m_Key).first;
+	m_Mru.push_front(pEntry->m_Mru);
+	m_Size += pEntry->get_Size();
+
+	// inherit the gap: a single new key doesn't break it
+	pEntry->m_GapNext = (m_Keys.begin() == it) ? m_GapFront : std::prev(it)->get_ParentObj().m_GapNext;
+
+	return *pEntry;
+}
+
+NodeProcessor::ContractVarCache::Entry& NodeProcessor::ContractVarCache::Get(const Blob& key, NodeDB& db)
+{
+	Entry* pEntry = Find(key);
+	if (pEntry)
+		return *pEntry;
+
+	Blob data;
+	NodeDB::Recordset rs;
+	if (!db.ContractDataFind(key, data, rs))
+		data.n = 0;
+
+	return Insert(key, data);
+}
+
+bool NodeProcessor::ContractVarCache::Load(const Blob& key, ByteBuffer& res, NodeDB& db)
+{
+	res = Get(key, db).m_Data;
+	ShrinkTo(m_MaxSize);
+	return !res.empty();
+}
+
+bool NodeProcessor::ContractVarCache::FindNext(const Blob& key, ByteBuffer& keyNext, bool bBigger, NodeDB& db)
+{
+	KeySet::iterator itKey = KeySet::s_iterator_to(Get(key, db).m_Key);
+	KeySet::iterator it = bBigger ? itKey : m_Keys.begin();
+
+	// walk through the known gaps. Upwards from the key, or from the lowest variable (see NodeDB::ContractDataFindPrev)
+	if (bBigger || m_GapFront)
+	{
+		while (true)
+		{
+			if (bBigger)
+			{
+				if (!it->get_ParentObj().m_GapNext)
+					break;
+
+				if (m_Keys.end() == ++it)
+				{
+					ShrinkTo(m_MaxSize);
+					return false;
+				}
+			}
+			else
+			{
+				if (itKey == it)
+				{
+					ShrinkTo(m_MaxSize);
+					return false; // nothing below the key
+				}
+			}
+
+			Entry& x = it->get_ParentObj();
+			if (!x.m_Data.empty())
+			{
+				m_Mru.erase(MruList::s_iterator_to(x.m_Mru));
+				m_Mru.push_front(x.m_Mru);
+
+				keyNext = x.m_Key.m_Value;
+				ShrinkTo(m_MaxSize);
+				return true;
+			}
+
+			if (!bBigger)
+			{
+				if (!x.m_GapNext)
+					break;
+				++it;
+			}
+		}
+	}
+
+	NodeDB::Recordset rs;
+	Blob keyDB = key;
+	bool bFound = bBigger ?
+		db.ContractDataFindNext(keyDB, rs) :
+		db.ContractDataFindPrev(keyDB, rs);
+
+	if (bFound)
+		keyDB.Export(keyNext);
+
+	// record the gaps. All the cached entries within them are absent
+	itKey = KeySet::s_iterator_to(Get(key, db).m_Key);
+	KeySet::iterator itFound = bFound ? KeySet::s_iterator_to(Get(keyNext, db).m_Key) : m_Keys.end();
+
+	if (bBigger)
+	{
+		// between the key and the found variable
+		for (it = itKey; itFound != it; ++it)
+			it->get_ParentObj().m_GapNext = true;
+	}
+	else
+	{
+		// below the found (lowest) variable, or below the key if none
+		m_GapFront = true;
+
+		KeySet::iterator itStop = bFound ? itFound : itKey;
+		for (it = m_Keys.begin(); itStop != it; ++it)
+			it->get_ParentObj().m_GapNext = true;
+	}
+
+	ShrinkTo(m_MaxSize);
+	return bFound;
+}
+
+void NodeProcessor::ContractVarCache::OnModified(const Blob& key, const Blob& data)
+{
+	m_Settled = false;
+
+	Entry* pEntry = Find(key);
+	if (pEntry)
+	{
+		m_Size -= pEntry->get_Size();
+		data.Export(pEntry->m_Data);
+		m_Size += pEntry->get_Size();
+	}
+	else
+	{
+		if (!data.n)
+			return; // was not cached, hence not within a known gap
+
+		Insert(key, data);
+	}
+
+	ShrinkTo(m_MaxSize);
+}
+
+const NodeProcessor::ShieldedCache::Chunk::Ptr& NodeProcessor::ShieldedCache::Get(NodeDB& db, uint64_t iChunk, uint32_t nCount)
+{
+	assert(nCount <= s_Chunk);
+
+	auto it = m_Map.find(iChunk);
+	if (m_Map.end() == it)
+	{
+		if (m_Map.size() >= m_MaxChunks)
+		{
+			// evict the least recently used
+			auto itLru = m_Map.begin();
+			for (auto it2 = m_Map.begin(); m_Map.end() != it2; ++it2)
+				if (it2->second->m_Used < itLru->second->m_Used)
+					itLru = it2;
+			m_Map.erase(itLru);
+		}
+
+		auto pChunk = std::make_shared<Chunk>();
+		pChunk->m_vec.reserve(s_Chunk);
+		it = m_Map.emplace(iChunk, std::move(pChunk)).first;
+	}
+
+	Chunk& c = *it->second;
+	c.m_Used = ++m_Used;
+
+	uint32_t nLoaded = static_cast<uint32_t>(c.m_vec.size());
+	if (nLoaded < nCount)
+	{
+		c.m_vec.resize(nCount);
+		db.ShieldedRead(iChunk * s_Chunk + nLoaded, &c.m_vec.front() + nLoaded, nCount - nLoaded);
+	}
+
+	return it->second;
+}
+
+void NodeProcessor::ShieldedCache::OnModified(uint64_t nPos)
+{
+	uint64_t iChunk = nPos / s_Chunk;
+
+	auto it = m_Map.lower_bound(iChunk);
+	if ((m_Map.end() != it) && (it->first == iChunk))
+	{
+		auto& vec = it->second->m_vec;
+		uint32_t nOffset = static_cast<uint32_t>(nPos % s_Chunk);
+		if (vec.size() > nOffset)
+			vec.resize(nOffset);
+		++it;
+	}
+
+	m_Map.erase(it, m_Map.end());
+}
+
 /////////////////////////////
 // Mapped
 struct NodeProcessor::Mapped::Type {
@@ -7149,8 +8092,10 @@ void NodeProcessor::Mapped::FlushStrict(const Stamp& s)
 	h.m_Stamp = s;
 }
 
-void NodeProcessor::Mapped::Utxo::EnsureReserve()
+bool NodeProcessor::Mapped::Utxo::EnsureReserve()
 {
+	intptr_t nBase0 = get_Base();
+
 	try
 	{
 		get_ParentObj().m_Mapping.EnsureReserve(Type::UtxoLeaf, sizeof(MyLeaf), 1);
@@ -7165,6 +8110,8 @@ void NodeProcessor::Mapped::Utxo::EnsureReserve()
 		exc.m_sErr = e.what();
 		throw exc;
 	}
+
+	return get_Base() != nBase0;
 }
 
 void NodeProcessor::Mapped::OnDirty()
@@ -26,6 +26,10 @@
 
 namespace beam {
 
+namespace bvm2 {
+	struct DecodedCache;
+}
+
 class NodeProcessor
 {
 	struct DB
@@ -74,7 +78,7 @@ class NodeProcessor
 
 			virtual void OnDirty() override { get_ParentObj().OnDirty(); }
 
-			void EnsureReserve();
+			bool EnsureReserve(); // returns true if the mapping has moved, i.e. cursors are invalidated
 
 			IMPLEMENT_GET_PARENT_OBJ(Mapped, m_Utxo)
 		} m_Utxo;
@@ -270,6 +274,7 @@ public:
 		bool m_Vacuum = false;
 		bool m_ResetSelfID = false;
 		bool m_EraseSelfID = false;
+		bool m_Wal = false; // allow concurrent read-only access to the committed data (see NodeDB::OpenReadOnly)
 
 		struct RichInfo {
 			static const uint8_t Off = 1;
@@ -285,6 +290,7 @@ public:
 
     static bool ExtractTreasury(const Blob&, Treasury::Data&);
 	static void get_MappingPath(std::string&, const char*);
+	static void get_DerivedPath(std::string&, const char*, const char* szSufix); // replaces the .db extension by the sufix
 
 	NodeProcessor();
 	virtual ~NodeProcessor();
@@ -314,6 +320,34 @@ public:
 
 	} m_Horizon;
 
+	// Sync is a 3-stage pipeline: bodies are fetched (by the network layer), verified context-free on the executor,
+	// and applied in-order. Each stage is bounded, and the apply stage yields periodically to let the others proceed.
+	struct SyncPipeline
+	{
+		struct Cfg
+		{
+			uint32_t m_ApplySlice_ms = 500; // 0 = apply all the available blocks at once
+			size_t m_ValidateMaxSize = 1024 * 1024 * 10; // size of bodies being verified concurrently
+			uint32_t m_FetchMaxPending = 500; // max downloaded blocks waiting to be applied, before more are requested
+		} m_Cfg;
+
+		struct Stage
+		{
+			uint64_t m_Blocks = 0;
+			uint64_t m_Time_us = 0; // for validation - total time of all the verifiers
+			uint64_t m_Stalls = 0; // times the stage was throttled by backpressure
+		};
+
+		Stage m_Fetch;
+		Stage m_Validate;
+		Stage m_Apply;
+
+		Height m_ApplyPending = 0; // blocks available for apply when the last slice was over
+
+		void Log() const;
+
+	} m_SyncPipeline;
+
 #pragma pack (push, 1)
 	struct StateExtra
 	{
@@ -390,6 +424,20 @@ public:
 		IMPLEMENT_GET_PARENT_OBJ(NodeProcessor, m_ManualSelection)
 	} m_ManualSelection;
 
+	// Objects affected by the blocks applied since the last Reset(). Used to revalidate only the relevant mempool txs
+	struct Touched
+	{
+		static const size_t s_MaxKeys = 0x40000;
+
+		TxPool::Refs::KeySet m_Keys;
+		Height m_hMin = MaxHeight;
+		bool m_Overflow = true; // set on rollback or too many keys, everything must be revalidated
+
+		void Reset();
+		void OnBlock(const TxVectors::Full&, Height);
+
+	} m_Touched;
+
 	struct UnreachableLog
 	{
 		uint32_t m_Time_ms = 0;
@@ -533,7 +581,7 @@ public:
 	void EnumCongestions();
 	const uint64_t* get_CachedRows(const NodeDB::StateID&, Height nCountExtra); // retval valid till next call to this func, or to EnumCongestions()
 	void TryGoUp();
-	void TryGoTo(NodeDB::StateID&);
+	bool TryGoTo(NodeDB::StateID&); // returns false if yielded before reaching the target
 	void OnFastSyncOver(MultiblockContext&, bool& bContextFail);
 
 	// Lowest height to which it's possible to rollback.
@@ -549,6 +597,7 @@ public:
 	virtual void OnModified() {}
 	virtual void InitializeUtxosProgress(uint64_t done, uint64_t total) {}
 	virtual void OnFastSyncSucceeded() {}
+	virtual bool OnGoUpYield() { return false; } // return true if TryGoUp will be called again asynchronously
 	virtual Height get_MaxAutoRollback();
 
 	struct MyExecutor
@@ -569,6 +618,7 @@ public:
 	};
 
 	std::unique_ptr<MyExecutor> m_pExecSync;
+	std::unique_ptr<bvm2::DecodedCache> m_pBvmDecoded; // pre-decoded contract code, created on demand
 
 	virtual Executor& get_Executor();
 
@@ -772,6 +822,23 @@ public:
 		BeamKernelsAll(THE_MACRO)
 #undef THE_MACRO
 
+		// The trial decryption of the shielded output doesn't touch the recognizer state, so it may be done in advance (on any thread)
+		struct ShieldedOutpRecovered
+		{
+			ShieldedTxo::ID m_CoinID;
+			ECC::Point m_SpendPk;
+			bool m_Recovered;
+		};
+
+		static void Recover(ShieldedOutpRecovered&, const TxKernelShieldedOutput&, Height, const ViewerKeys&);
+		void Recognize(const TxKernelShieldedOutput&, Height, uint32_t nKrnIdx, const ShieldedOutpRecovered&);
+
+		// if set - the shielded outputs are already recovered, the results are consumed in the kernel walk order
+		const std::vector<ShieldedOutpRecovered>* m_pvShieldedRecovered = nullptr;
+		size_t m_iShieldedRecovered = 0; // consumed so far
+
+		void set_ShieldedRecovered(const std::vector<ShieldedOutpRecovered>*);
+
 		template <typename TKey, typename TEvt>
 		bool FindEvent(const TKey&, TEvt&);
 
@@ -868,12 +935,157 @@ public:
 
 	} m_ValCache;
 
+	// Perishable bodies re-created from Txos, as served to syncing peers
+	struct BodyCache
+	{
+		struct Entry
+		{
+			struct Key
+				:public boost::intrusive::set_base_hook<>
+			{
+				struct Type
+				{
+					uint64_t m_Row;
+					Height m_h0; // only if it affects the result, otherwise MaxHeight
+					Height m_hLo1;
+					Height m_hHi1;
+
+					bool operator < (const Type&) const;
+				};
+
+				Type m_Value;
+				bool operator < (const Key& x) const { return m_Value < x.m_Value; }
+				IMPLEMENT_GET_PARENT_OBJ(Entry, m_Key)
+			} m_Key;
+
+			struct Mru
+				:public boost::intrusive::list_base_hook<>
+			{
+				IMPLEMENT_GET_PARENT_OBJ(Entry, m_Mru)
+			} m_Mru;
+
+			ByteBuffer m_Perishable;
+		};
+
+		typedef boost::intrusive::set<Entry::Key> KeySet;
+		typedef boost::intrusive::list<Entry::Mru> MruList;
+
+		KeySet m_Keys;
+		MruList m_Mru;
+		size_t m_Size = 0; // total size of the cached bodies
+		size_t m_MaxSize = 0; // disabled by default
+
+		~BodyCache() {
+			ShrinkTo(0);
+		}
+
+		void Delete(Entry&);
+		void ShrinkTo(size_t);
+
+		const ByteBuffer* Find(const Entry::Key::Type&); // modifies MRU if found
+		void Insert(const Entry::Key::Type&, const ByteBuffer&);
+
+	} m_BodyCache;
+
+	// Contract variables as stored in the DB, shared by the block interpretation and the mempool validation.
+	// Kept in sync with all the DB modifications (including rollback), and stamped by the tip it corresponds to.
+	// Absent variables are cached too, and the known gaps between the cached keys allow range scans without the DB.
+	struct ContractVarCache
+	{
+		struct Entry
+		{
+			struct Key
+				:public boost::intrusive::set_base_hook<>
+			{
+				ByteBuffer m_Value;
+				bool operator < (const Key& x) const { return Blob(m_Value) < Blob(x.m_Value); }
+				IMPLEMENT_GET_PARENT_OBJ(Entry, m_Key)
+			} m_Key;
+
+			struct Mru
+				:public boost::intrusive::list_base_hook<>
+			{
+				IMPLEMENT_GET_PARENT_OBJ(Entry, m_Mru)
+			} m_Mru;
+
+			ByteBuffer m_Data; // empty if the variable doesn't exist
+			bool m_GapNext; // no variables in the DB between this and the next entry (or above this, if it's the last)
+
+			size_t get_Size() const { return sizeof(Entry) + m_Key.m_Value.size() + m_Data.size(); }
+		};
+
+		struct Comparator
+		{
+			bool operator()(const Blob& a, const Entry::Key& b) const { return a < Blob(b.m_Value); }
+			bool operator()(const Entry::Key& a, const Blob& b) const { return Blob(a.m_Value) < b; }
+		};
+
+		typedef boost::intrusive::set<Entry::Key> KeySet;
+		typedef boost::intrusive::list<Entry::Mru> MruList;
+
+		KeySet m_Keys;
+		MruList m_Mru;
+		size_t m_Size = 0; // total size of the cached entries
+		size_t m_MaxSize = 0; // disabled by default
+		bool m_GapFront = false; // no variables in the DB below the first entry
+
+		Block::SystemState::ID m_Tip; // valid only if settled
+		bool m_Settled = false; // reset while the DB is being modified, until the new tip is set
+
+		~ContractVarCache() {
+			Clear();
+		}
+
+		void Delete(Entry&); // updates the gap of the preceeding entry
+		void ShrinkTo(size_t);
+		void Clear();
+		void OnTip(const Block::SystemState::ID&);
+
+		// all the following keep the cache within the limit
+		bool Load(const Blob& key, ByteBuffer& res, NodeDB&); // returns false if the variable doesn't exist
+		bool FindNext(const Blob& key, ByteBuffer& keyNext, bool bBigger, NodeDB&); // same as the DB: the nearest bigger variable, or the lowest variable if it's smaller than the key
+		void OnModified(const Blob& key, const Blob& data); // empty data means deletion
+
+	private:
+		Entry* Find(const Blob& key); // modifies MRU if found
+		Entry& Get(const Blob& key, NodeDB&); // loads from the DB if not cached
+		Entry& Insert(const Blob& key, const Blob& data);
+
+	} m_ContractVarCache;
+
+	// Shielded elements as stored in the DB, in the chunks of the sigma verification.
+	// Reused by the consequent blocks and txs that refer to the same window. Modified only via append/remove at the end.
+	struct ShieldedCache
+	{
+		static const uint32_t s_Chunk = 0x400;
+
+		struct Chunk
+		{
+			typedef std::shared_ptr<Chunk> Ptr;
+			std::vector<ECC::Point::Storage> m_vec; // loaded prefix of the chunk, capacity reserved
+			uint64_t m_Used;
+		};
+
+		std::map<uint64_t, Chunk::Ptr> m_Map; // by chunk index
+		uint32_t m_MaxChunks = 256; // 16MB
+		uint64_t m_Used = 0;
+
+		const Chunk::Ptr& Get(NodeDB&, uint64_t iChunk, uint32_t nCount); // loads at least nCount elements
+		void OnModified(uint64_t nPos); // truncates the cached elements starting from this position
+		void Clear() { m_Map.clear(); }
+
+	} m_ShieldedCache;
+
 	struct IWorker {
 		virtual void Do() = 0;
 	};
 	bool ExecInDependentContext(IWorker&, const Merkle::Hash*, const TxPool::Dependent&);
 
 private:
+	ContractVarCache* get_ContractVarCache(bool bTemporary);
+	bool ContractVarLoad(const Blob& key, ByteBuffer& res, bool bTemporary);
+	bool ContractVarFindNext(const Blob& key, ByteBuffer& keyNext, bool bBigger, bool bTemporary);
+
 	size_t GenerateNewBlockInternal(BlockContext&, BlockInterpretCtx&);
 	void GenerateNewHdr(BlockContext&, BlockInterpretCtx&);
 	DataStatus::Enum OnStateInternal(const Block::SystemState::Full&, Block::SystemState::ID&, bool bAlreadyChecked);
@@ -15,6 +15,7 @@
 #include "processor.h"
 #include "../utility/logger.h"
 #include "../utility/logger_checkpoints.h"
+#include "node_metrics.h"
 
 namespace beam {
 
@@ -50,6 +51,137 @@ bool TxPool::Profit::operator < (const Profit& t) const
 		(uintBigFrom(t.m_Stats.m_Fee) * uintBigFrom(m_Stats.m_Size + m_Stats.m_SizeCorrection));
 }
 
+/////////////////////////////
+// Refs
+void TxPool::Refs::get_Key(KeyType& key, uint8_t nType, const Blob& b)
+{
+	ECC::Hash::Processor()
+		<< nType
+		<< b
+		>> key;
+}
+
+void TxPool::Refs::get_Key(KeyType& key, uint8_t nType)
+{
+	get_Key(key, nType, Blob(nullptr, 0));
+}
+
+void TxPool::Refs::IWalker::Add(uint8_t nType, const Blob& b)
+{
+	KeyType key;
+	get_Key(key, nType, b);
+	OnRef(key);
+}
+
+void TxPool::Refs::IWalker::Add(uint8_t nType)
+{
+	Add(nType, Blob(nullptr, 0));
+}
+
+void TxPool::Refs::IWalker::Process(const TxVectors::Full& txv, bool bBlock)
+{
+	for (size_t i = 0; i < txv.m_vInputs.size(); i++)
+	{
+		const ECC::Point& comm = txv.m_vInputs[i]->m_Commitment;
+		Add(Type::Input, Blob(&comm, sizeof(comm)));
+	}
+
+	if (!bBlock)
+	{
+		// asset proofs refer to a range of asset IDs, their validity depends on the existing assets
+		for (size_t i = 0; i < txv.m_vOutputs.size(); i++)
+		{
+			if (txv.m_vOutputs[i]->m_pAsset)
+			{
+				Add(Type::AnyAsset);
+				break;
+			}
+		}
+	}
+
+	for (size_t i = 0; i < txv.m_vKernels.size(); i++)
+		Process(*txv.m_vKernels[i], bBlock);
+
+	if (bBlock)
+		Add(Type::AnyContract); // contracts may depend on the height, their txs are always affected
+}
+
+void TxPool::Refs::IWalker::Process(const TxKernel& krn, bool bBlock)
+{
+	for (size_t i = 0; i < krn.m_vNested.size(); i++)
+		Process(*krn.m_vNested[i], bBlock);
+
+	Add(Type::Kernel, krn.m_Internal.m_ID);
+
+	switch (krn.get_Subtype())
+	{
+	case TxKernel::Subtype::Std:
+		{
+			const auto& x = krn.CastTo_Std();
+			if (x.m_pRelativeLock && !bBlock)
+				Add(Type::Kernel, x.m_pRelativeLock->m_ID);
+		}
+		break;
+
+	case TxKernel::Subtype::AssetEmit:
+		{
+			const auto& x = krn.CastTo_AssetEmit();
+			Add(Type::Asset, Blob(&x.m_AssetID, sizeof(x.m_AssetID)));
+		}
+		break;
+
+	case TxKernel::Subtype::AssetDestroy:
+		{
+			const auto& x = krn.CastTo_AssetDestroy();
+			Add(Type::Asset, Blob(&x.m_AssetID, sizeof(x.m_AssetID)));
+			if (bBlock)
+				Add(Type::AnyAsset);
+		}
+		break;
+
+	case TxKernel::Subtype::AssetCreate:
+		Add(Type::AnyAsset);
+		break;
+
+	case TxKernel::Subtype::ShieldedInput:
+		{
+			const auto& x = krn.CastTo_ShieldedInput();
+			Add(Type::Unique, Blob(&x.m_SpendProof.m_SpendPk, sizeof(x.m_SpendProof.m_SpendPk)));
+			if (!bBlock)
+			{
+				Add(Type::ShieldedPool);
+				if (x.m_pAsset)
+					Add(Type::AnyAsset);
+			}
+		}
+		break;
+
+	case TxKernel::Subtype::ShieldedOutput:
+		{
+			const auto& x = krn.CastTo_ShieldedOutput();
+			Add(Type::Unique, Blob(&x.m_Txo.m_Ticket.m_SerialPub, sizeof(x.m_Txo.m_Ticket.m_SerialPub)));
+			if (bBlock)
+				Add(Type::ShieldedPool);
+			else
+			{
+				if (x.m_Txo.m_pAsset)
+					Add(Type::AnyAsset);
+			}
+		}
+		break;
+
+	case TxKernel::Subtype::ContractCreate:
+	case TxKernel::Subtype::ContractInvoke:
+		Add(Type::AnyContract);
+		if (bBlock)
+			Add(Type::AnyAsset); // contracts may create and destroy assets
+		break;
+
+	default: // suppress warning
+		break;
+	}
+}
+
 /////////////////////////////
 // Fluff
 TxPool::Fluff::Element* TxPool::Fluff::AddValidTx(Transaction::Ptr&& pValue, const Stats& stats, const Transaction::KeyType& key, State s, Height hLst /* = 0 */)
@@ -67,6 +199,7 @@ TxPool::Fluff::Element* TxPool::Fluff::AddValidTx(Transaction::Ptr&& pValue, con
 	Features f0 = { false };
 	SetState(*p, f0, Features::get(s));
 
+	NodeMetrics::TxPoolFluff.Add(1);
 	return p;
 }
 
@@ -119,6 +252,7 @@ void TxPool::Fluff::SetState(Element& x, Features f0, Features f)
 			m_SendQueue.push_back(*x.m_pSend);
 
 			m_setProfit.insert(x.m_Profit);
+			InsertRefs(x);
 		}
 		else
 		{
@@ -129,6 +263,7 @@ void TxPool::Fluff::SetState(Element& x, Features f0, Features f)
 			x.m_pSend = nullptr;
 
 			m_setProfit.erase(ProfitSet::s_iterator_to(x.m_Profit));
+			DeleteRefs(x);
 		}
 	}
 
@@ -161,12 +296,87 @@ void TxPool::Fluff::SetStateHistOut(Element& x, HistList& lst, bool b0, bool b)
 		lst.erase(HistList::s_iterator_to(x.m_Hist));
 }
 
+void TxPool::Fluff::InsertRefs(Element& x)
+{
+	assert(!x.m_pRefs);
+
+	x.m_Expiry.m_Key = x.m_Profit.m_Stats.m_Hr.m_Max;
+	m_setExpiry.insert(x.m_Expiry);
+
+	struct Walker
+		:public Refs::IWalker
+	{
+		std::vector<Refs::KeyType> m_vKeys;
+
+		void OnRef(const Refs::KeyType& key) override
+		{
+			m_vKeys.push_back(key);
+		}
+
+	} wlk;
+
+	wlk.Process(*x.m_pValue, false);
+
+	// the same object may be referenced several times (such as equal inputs)
+	std::sort(wlk.m_vKeys.begin(), wlk.m_vKeys.end());
+	auto itEnd = std::unique(wlk.m_vKeys.begin(), wlk.m_vKeys.end());
+
+	for (auto it = wlk.m_vKeys.begin(); itEnd != it; ++it)
+	{
+		auto* pRef = new Element::Ref;
+		pRef->m_Key = *it;
+		pRef->m_pThis = &x;
+		pRef->m_pNext = x.m_pRefs;
+		x.m_pRefs = pRef;
+
+		m_setRefs.insert(*pRef);
+	}
+}
+
+void TxPool::Fluff::DeleteRefs(Element& x)
+{
+	m_setExpiry.erase(ExpirySet::s_iterator_to(x.m_Expiry));
+
+	while (x.m_pRefs)
+	{
+		auto* pRef = x.m_pRefs;
+		x.m_pRefs = pRef->m_pNext;
+
+		m_setRefs.erase(RefSet::s_iterator_to(*pRef));
+		delete pRef;
+	}
+}
+
+void TxPool::Fluff::get_Affected(std::vector<Element*>& v, const Refs::KeySet& keys, Height h)
+{
+	std::set<Element*> s;
+
+	for (auto it = m_setExpiry.begin(); m_setExpiry.end() != it; ++it)
+	{
+		if (it->m_Key >= h)
+			break;
+		s.insert(&it->get_ParentObj());
+	}
+
+	for (const auto& key : keys)
+	{
+		auto itLo = m_setRefs.lower_bound(key, Element::Ref::Comparator());
+		auto itHi = m_setRefs.upper_bound(key, Element::Ref::Comparator());
+
+		for (; itHi != itLo; ++itLo)
+			s.insert(itLo->m_pThis);
+	}
+
+	v.assign(s.begin(), s.end());
+}
+
 void TxPool::Fluff::Delete(Element& x)
 {
 	auto f0 = Features::get(x.m_State);
 	Features f = { false };
 	SetState(x, f0, f);
 
+	NodeMetrics::TxPoolFluff.Add(-1);
 	delete &x;
 }
 
@@ -264,11 +474,13 @@ void TxPool::Stem::DeleteRaw(Element& x)
 void TxPool::Stem::InsertAggr(Element& x)
 {
 	m_setProfit.insert(x.m_Profit);
+	NodeMetrics::TxPoolStem.Add(1);
 }
 
 void TxPool::Stem::DeleteAggr(Element& x)
 {
 	m_setProfit.erase(ProfitSet::s_iterator_to(x.m_Profit));
+	NodeMetrics::TxPoolStem.Add(-1);
 }
 
 void TxPool::Stem::DeleteTimer(Element& x)
@@ -405,6 +617,7 @@ TxPool::Dependent::Element* TxPool::Dependent::AddValidTx(Transaction::Ptr&& pVa
 	if (ShouldUpdateBest(*p))
 		m_pBest = p;
 
+	NodeMetrics::TxPoolDependent.Add(1);
 	return p;
 }
 
@@ -438,6 +651,7 @@ void TxPool::Dependent::Clear()
 		m_setContexts.erase(it);
 		m_setTxs.erase(TxSet::s_iterator_to(x.m_Tx));
 
+		NodeMetrics::TxPoolDependent.Add(-1);
 		delete &x;
 	}
 }
@@ -42,6 +42,39 @@ struct TxPool
 		bool operator < (const Profit& t) const;
 	};
 
+	// Objects referenced by txs, which are affected (touched) by blocks. Used to find the pool txs that should be revalidated after the tip change.
+	struct Refs
+	{
+		typedef Merkle::Hash KeyType;
+		typedef std::set<KeyType> KeySet;
+
+		struct Type
+		{
+			static const uint8_t Input = 1; // utxo commitment
+			static const uint8_t Kernel = 2; // kernel ID, or relative lock target
+			static const uint8_t Unique = 3; // shielded spend key or serial
+			static const uint8_t Asset = 4;
+			// wildcards
+			static const uint8_t AnyAsset = 5; // asset creation/destruction. Referenced by txs with asset proofs too
+			static const uint8_t AnyContract = 6; // contract execution may depend on anything, including the height
+			static const uint8_t ShieldedPool = 7; // new shielded outputs may move the window of the shielded inputs
+		};
+
+		static void get_Key(KeyType&, uint8_t nType, const Blob&);
+		static void get_Key(KeyType&, uint8_t nType);
+
+		struct IWalker
+		{
+			virtual void OnRef(const KeyType&) = 0;
+
+			void Process(const TxVectors::Full&, bool bBlock);
+		private:
+			void Add(uint8_t nType, const Blob&);
+			void Add(uint8_t nType);
+			void Process(const TxKernel&, bool bBlock);
+		};
+	};
+
 	struct Fluff
 	{
 		enum State {
@@ -81,18 +114,37 @@ struct TxPool
 				uint32_t m_Refs = 0;
 			};
 			Send* m_pSend = nullptr;
+
+			// the following are maintained for elements in the profit set
+			struct Expiry
+				:public intrusive::set_base_hook<Height>
+			{
+				IMPLEMENT_GET_PARENT_OBJ(Element, m_Expiry)
+			} m_Expiry;
+
+			struct Ref
+				:public intrusive::set_base_hook<Refs::KeyType>
+			{
+				Element* m_pThis;
+				Ref* m_pNext;
+			};
+			Ref* m_pRefs = nullptr;
 		};
 
 		typedef boost::intrusive::multiset<Element::Tx> TxSet;
 		typedef boost::intrusive::multiset<Element::Profit> ProfitSet;
 		typedef boost::intrusive::list<Element::Hist> HistList;
 		typedef boost::intrusive::list<Element::Send> SendQueue;
+		typedef boost::intrusive::multiset<Element::Expiry> ExpirySet;
+		typedef boost::intrusive::multiset<Element::Ref> RefSet;
 
 		TxSet m_setTxs;
 		ProfitSet m_setProfit;
 		SendQueue m_SendQueue;
 		HistList m_lstOutdated;
 		HistList m_lstWaitFluff;
+		ExpirySet m_setExpiry;
+		RefSet m_setRefs;
 
 		Element* AddValidTx(Transaction::Ptr&&, const Stats&, const Transaction::KeyType&, State, Height hLst = 0);
 		void SetState(Element&, State);
@@ -100,6 +152,9 @@ struct TxPool
 		void Release(Element::Send&);
 		void Clear();
 
+		// elements of the profit set that either reference the touched objects, or expire below the specified height
+		void get_Affected(std::vector<Element*>&, const Refs::KeySet&, Height h);
+
 		~Fluff() { Clear(); }
 
 	private:
@@ -118,6 +173,9 @@ struct TxPool
 		static void SetStateHistIn(Element&, HistList&, bool b0, bool b);
 		static void SetStateHistOut(Element&, HistList&, bool b0, bool b);
 
+		void InsertRefs(Element&);
+		void DeleteRefs(Element&);
+
 	};
 
 	struct Stem
@@ -17,6 +17,8 @@
 #include "../node.h"
 #include "../db.h"
 #include "../processor.h"
+#include "../bbs_store.h"
+#include "../node_metrics.h"
 #include "../../core/fly_client.h"
 #include "../../core/serialization_adapters.h"
 #include "../../core/treasury.h"
@@ -24,9 +26,11 @@
 #include "../../utility/test_helpers.h"
 #include "../../utility/serialize.h"
 #include "../../utility/blobmap.h"
+#include "../../utility/fsutils.h"
 #include "../../core/unittest/mini_blockchain.h"
 #include "../../bvm/bvm2.h"
 #include "../../bvm/ManagerStd.h"
+#include <sstream>
 
 #ifndef LOG_VERBOSE_ENABLED
     #define LOG_VERBOSE_ENABLED 0
@@ -810,6 +814,314 @@ namespace beam
 			NodeDB db;
 			db.Open(g_sz); // test to open already-existing DB
 		}
+
+		{
+			// concurrent read-only access in WAL mode
+			NodeDB db;
+			db.Open(g_sz, true);
+
+			NodeDB dbR;
+			dbR.OpenReadOnly(g_sz);
+
+			NodeDB::Transaction tr(db);
+			db.ParamIntSet(NodeDB::ParamID::LastRecoveryHeight, 15);
+
+			NodeDB::Transaction trR(dbR);
+			verify_test(dbR.ParamIntGetDef(NodeDB::ParamID::LastRecoveryHeight) != 15); // not committed yet
+
+			tr.Commit();
+			verify_test(dbR.ParamIntGetDef(NodeDB::ParamID::LastRecoveryHeight) != 15); // the snapshot is pinned
+
+			trR.Rollback();
+			trR.Start(dbR);
+			verify_test(dbR.ParamIntGetDef(NodeDB::ParamID::LastRecoveryHeight) == 15);
+		}
+	}
+
+	void DeleteBbsStore(const char* szDB)
+	{
+		std::string sPath;
+		NodeProcessor::get_DerivedPath(sPath, szDB, "-bbs");
+
+		{
+			BbsStore bs;
+			bs.Open(sPath.c_str(), 0); // stamp mismatch (node stamps are nonzero), the segments are deleted
+		}
+
+		DeleteFile((sPath + "/stamp").c_str());
+		fsutils::remove(sPath); // empty by now
+	}
+
+	void TestBbsStore()
+	{
+		std::string sPath;
+		NodeProcessor::get_DerivedPath(sPath, g_sz, "-bbs");
+
+		const uint64_t nStamp = 17;
+		const uint32_t nMsgs = 300;
+		const uint32_t nChannels = 7;
+		const char szMsg[] = "hello";
+
+		BbsStore::Data d;
+		d.m_Message.p = szMsg;
+		d.m_Message.n = sizeof(szMsg);
+		d.m_Nonce = 0;
+
+		{
+			BbsStore bs;
+			bs.Open(sPath.c_str(), nStamp + 1);
+			bs.Open(sPath.c_str(), nStamp); // stamp mismatch, discard the leftovers
+			verify_test(!bs.get_Totals().m_Count);
+
+			bs.m_Cfg.m_SegmentSpan_s = 10;
+			bs.m_Cfg.m_GrowSize = 1024;
+
+			for (uint32_t i = 0; i < nMsgs; i++)
+			{
+				d.m_Key = i + 1;
+				d.m_Channel = i % nChannels;
+				d.m_TimePosted = i + 100;
+
+				verify_test(bs.Insert(d) == i + 1);
+			}
+
+			verify_test(bs.get_Segments() == nMsgs / 10);
+		}
+
+		BbsStore bs;
+		bs.Open(sPath.c_str(), nStamp); // reopen
+		bs.m_Cfg.m_SegmentSpan_s = 10;
+		verify_test(bs.get_Totals().m_Count == nMsgs);
+		verify_test(bs.get_Totals().m_Size == nMsgs * sizeof(szMsg));
+		verify_test(bs.get_LastID() == nMsgs);
+		verify_test(bs.get_MaxTime() == nMsgs - 1 + 100);
+
+		d.m_Key = 5U;
+		uint64_t id = bs.Find(d.m_Key);
+		verify_test(id == 5);
+		verify_test(bs.Find(id, d));
+		verify_test(d.m_Channel == 4);
+		verify_test(d.m_TimePosted == 104);
+		verify_test(Blob(szMsg, sizeof(szMsg)) == d.m_Message);
+
+		d.m_Key = nMsgs + 1;
+		verify_test(!bs.Find(d.m_Key));
+
+		verify_test(bs.FindCursor(150) == 51);
+		verify_test(bs.FindCursor(1000) == nMsgs + 1);
+
+		BbsStore::Walker wlk;
+		uint32_t n = 0;
+		wlk.m_ID = 0;
+		for (bs.EnumAll(wlk); wlk.MoveNext(); n++)
+			verify_test(wlk.m_ID == n + 1);
+		verify_test(n == nMsgs);
+
+		for (BbsChannel ch = 0; ch < nChannels; ch++)
+		{
+			wlk.m_ID = 20;
+			for (bs.EnumChannel(wlk, ch); wlk.MoveNext(); )
+			{
+				verify_test(wlk.m_Data.m_Channel == ch);
+				verify_test(wlk.m_ID > 20);
+				verify_test((wlk.m_ID - 1) % nChannels == ch);
+			}
+		}
+
+		// expiration drops whole segments
+		NodeDB::BbsTotals lims;
+		lims.m_Count = nMsgs;
+		lims.m_Size = nMsgs * sizeof(szMsg);
+
+		bs.Cleanup(125, lims);
+		verify_test(bs.get_Totals().m_Count == nMsgs - 20);
+		verify_test(bs.get_Segments() == nMsgs / 10 - 2);
+		verify_test(bs.FindCursor(0) == 21);
+
+		d.m_Key = 5U;
+		verify_test(!bs.Find(d.m_Key));
+		verify_test(!bs.Find(5, d));
+
+		wlk.m_ID = 0;
+		bs.EnumAll(wlk);
+		verify_test(wlk.MoveNext());
+		verify_test(wlk.m_ID == 21);
+
+		lims.m_Count = 100; // limits
+		bs.Cleanup(0, lims);
+		verify_test(bs.get_Totals().m_Count == 100);
+
+		d.m_Key = nMsgs + 1;
+		d.m_TimePosted = 1000;
+		d.m_Message.p = szMsg; // was pointing to the dropped segment
+		verify_test(bs.Insert(d) == nMsgs + 1);
+
+		bs.Cleanup(1000, lims);
+		verify_test(bs.get_Totals().m_Count == 1);
+		verify_test(bs.Find(d.m_Key) == nMsgs + 1);
+
+		lims.m_Count = 0;
+		bs.Cleanup(0, lims);
+		verify_test(!bs.get_Segments());
+
+		// a message posted far ahead doesn't keep its segment alive
+		Timestamp t = getTimestamp();
+		d.m_Key = nMsgs + 2;
+		d.m_TimePosted = t + 1000000;
+		id = bs.Insert(d);
+		verify_test(bs.get_MaxTime() < t + bs.m_Cfg.m_MaxAhead_s + 100);
+
+		verify_test(bs.Find(id, d));
+		verify_test(d.m_TimePosted == t + 1000000); // kept intact
+
+		lims.m_Count = nMsgs;
+		bs.Cleanup(t + bs.m_Cfg.m_MaxAhead_s + 100, lims);
+		verify_test(!bs.get_Segments());
+		bs.Close();
+
+		DeleteBbsStore(g_sz);
+		verify_test(!fsutils::exists(sPath));
+	}
+
+	void TestContractVarCache()
+	{
+		NodeDB db;
+		db.Open(g_sz);
+		NodeDB::Transaction tr(db);
+
+		NodeProcessor::ContractVarCache cache;
+		cache.m_MaxSize = (sizeof(NodeProcessor::ContractVarCache::Entry) + 3) * 16; // tight, to test eviction
+
+		const uint32_t nKeys = 48;
+		uint8_t pVal[nKeys]; // 0 if absent
+		memset0(pVal, sizeof(pVal));
+
+		for (uint32_t i = 0; i < 20000; i++)
+		{
+			uint32_t nRnd;
+			ECC::GenRandom(&nRnd, sizeof(nRnd));
+
+			uint8_t iKey = static_cast<uint8_t>((nRnd >> 8) % nKeys);
+			uint8_t pKey[] = { 0x5a, iKey };
+			Blob key(pKey, sizeof(pKey));
+
+			ByteBuffer buf;
+
+			switch (nRnd & 3)
+			{
+			case 0:
+				{
+					uint8_t nVal = static_cast<uint8_t>((nRnd >> 16) % 3);
+					Blob val(&nVal, nVal ? 1 : 0);
+
+					if (nVal)
+					{
+						if (pVal[iKey])
+							db.ContractDataUpdate(key, val);
+						else
+							db.ContractDataInsert(key, val);
+					}
+					else
+					{
+						if (!pVal[iKey])
+							continue;
+						db.ContractDataDel(key);
+					}
+
+					pVal[iKey] = nVal;
+					cache.OnModified(key, val);
+				}
+				break;
+
+			case 1:
+				verify_test(cache.Load(key, buf, db) == (pVal[iKey] != 0));
+				if (pVal[iKey])
+					verify_test((buf.size() == 1) && (buf[0] == pVal[iKey]));
+				break;
+
+			default:
+				{
+					bool bBigger = !!(nRnd & 1);
+
+					// upwards - the nearest variable, downwards - the lowest one (legacy DB query semantics)
+					int iNext = bBigger ? iKey + 1 : 0;
+					while ((iNext < (int) nKeys) && !pVal[iNext])
+						iNext++;
+
+					bool bFound = bBigger ? (iNext < (int) nKeys) : (iNext < iKey);
+					verify_test(cache.FindNext(key, buf, bBigger, db) == bFound);
+					if (bFound)
+						verify_test((buf.size() == 2) && (buf[1] == iNext));
+
+					// must match the DB
+					NodeDB::Recordset rs;
+					Blob keyDB = key;
+					bool bFoundDB = bBigger ?
+						db.ContractDataFindNext(keyDB, rs) :
+						db.ContractDataFindPrev(keyDB, rs);
+					verify_test(bFoundDB == bFound);
+					if (bFound)
+						verify_test(Blob(buf) == keyDB);
+				}
+			}
+
+			verify_test(cache.m_Size <= cache.m_MaxSize);
+		}
+	}
+
+	void TestShieldedCache()
+	{
+		NodeDB db;
+		db.Open(g_sz);
+		NodeDB::Transaction tr(db);
+
+		typedef NodeProcessor::ShieldedCache Cache;
+
+		const uint32_t nTotal = Cache::s_Chunk * 2 + 100;
+		std::vector<ECC::Point::Storage> vPts(nTotal);
+		for (uint32_t i = 0; i < nTotal; i++)
+		{
+			vPts[i].m_X = i;
+			vPts[i].m_Y = i + 1;
+		}
+
+		db.ShieldedResize(nTotal, 0);
+		db.ShieldedWrite(0, &vPts.front(), nTotal);
+
+		auto Num = [](uint32_t n) {
+			ECC::uintBig x;
+			x = n;
+			return x;
+		};
+
+		Cache cache;
+		cache.m_MaxChunks = 2;
+
+		auto pC = cache.Get(db, 1, 10);
+		verify_test(pC->m_vec.size() == 10);
+		verify_test(pC->m_vec[9].m_X == Num(Cache::s_Chunk + 9));
+
+		verify_test(cache.Get(db, 1, Cache::s_Chunk) == pC); // loaded the rest
+		verify_test(pC->m_vec.back().m_Y == Num(Cache::s_Chunk * 2));
+
+		auto pC2 = cache.Get(db, 2, 100);
+		verify_test(pC2->m_vec.back().m_X == Num(nTotal - 1));
+
+		cache.Get(db, 0, 1); // should evict chunk 1
+		verify_test(cache.m_Map.size() == 2);
+		verify_test(cache.m_Map.end() == cache.m_Map.find(1));
+
+		// modify (as in rollback + append), the cache must be truncated
+		vPts[Cache::s_Chunk * 2 + 50].m_X = 77U;
+		db.ShieldedWrite(Cache::s_Chunk * 2 + 50, &vPts[Cache::s_Chunk * 2 + 50], 1);
+		cache.OnModified(Cache::s_Chunk * 2 + 50);
+
+		verify_test(pC2->m_vec.size() == 50);
+		verify_test(cache.Get(db, 2, 100)->m_vec[50].m_X == Num(77));
+
+		cache.OnModified(5);
+		verify_test(cache.m_Map.size() == 1);
+		verify_test(cache.Get(db, 0, 1)->m_vec.size() == 1);
 	}
 
 	struct MiniWallet
@@ -1044,11 +1356,19 @@ namespace beam
 	{
 		MyNodeProcessor1 np;
 		np.m_Horizon.m_Branching = 35;
+		np.m_ContractVarCache.m_MaxSize = 1024 * 1024;
 		np.Initialize(g_sz);
 		np.OnTreasury(g_Treasury);
 
 		const Height hIncubation = 3; // artificial incubation period for outputs.
 
+		// cached (absent) contract var must survive the contract-free blocks
+		uint8_t pVarKey[] = { 0x5a, 0x11 };
+		ByteBuffer bufVar;
+		verify_test(!np.m_ContractVarCache.Load(Blob(pVarKey, sizeof(pVarKey)), bufVar, np.get_DB()));
+		const size_t nVarCacheSize = np.m_ContractVarCache.m_Size;
+		verify_test(nVarCacheSize);
+
 		for (Height h = Rules::HeightGenesis; h < 96 + Rules::HeightGenesis; h++)
 		{
 			while (true)
@@ -1085,9 +1405,20 @@ namespace beam
 			Block::SystemState::ID id;
 			bc.m_Hdr.get_ID(id);
 
+			np.m_Touched.Reset();
+
 			np.OnBlock(id, bc.m_BodyP, bc.m_BodyE, PeerID());
 			np.TryGoUp();
 
+			verify_test(np.m_ContractVarCache.m_Settled && (np.m_ContractVarCache.m_Tip == np.m_Cursor.m_ID));
+			verify_test(np.m_ContractVarCache.m_Size == nVarCacheSize);
+
+			// all the txs that were included in the block must be considered affected
+			verify_test(!np.m_Touched.m_Overflow);
+			std::vector<TxPool::Fluff::Element*> vAffected;
+			np.m_TxPool.get_Affected(vAffected, np.m_Touched.m_Keys, np.m_Cursor.m_ID.m_Height + 1);
+			verify_test(vAffected.size() == np.m_TxPool.m_setProfit.size());
+
 			np.m_Wallet.AddMyUtxo(CoinID(bc.m_Fees, h, Key::Type::Comission));
 			np.m_Wallet.AddMyUtxo(CoinID(Rules::get_Emission(h), h, Key::Type::Coinbase));
 
@@ -1219,6 +1550,17 @@ namespace beam
 			np.Initialize(g_sz, sp);
 		}
 
+		{
+			// force the mapped image rebuild. The result is verified vs the current state definition
+			std::string sMapping;
+			NodeProcessor::get_MappingPath(sMapping, g_sz);
+			DeleteFile(sMapping.c_str());
+
+			NodeProcessor np;
+			np.m_Horizon = horz;
+			np.Initialize(g_sz);
+		}
+
 	}
 
 	void TestNodeProcessor3(std::vector<BlockPlus::Ptr>& blockChain)
@@ -1228,6 +1570,7 @@ namespace beam
 		np.m_Horizon.m_Sync.Hi = 12;
 		np.m_Horizon.m_Sync.Lo = 30;
 		np.m_Horizon.m_Local = np.m_Horizon.m_Sync;
+		np.m_SyncPipeline.m_Cfg.m_ApplySlice_ms = 1; // apply in many small slices, the fast-sync state must carry over between them
 		np.Initialize(g_sz);
 		np.OnTreasury(g_Treasury);
 
@@ -1256,6 +1599,8 @@ namespace beam
 		verify_test(np.IsFastSync()); // should go into fast-sync mode
 		verify_test(np.m_SyncData.m_TxoLo); // should be used on the 1st attempt
 
+		npSrc.m_BodyCache.m_MaxSize = 1024 * 1024;
+
 		// 1st attempt - tamper with txlo. Remove arbitrary input
 		bool bTampered = false;
 		for (Height h = Rules::HeightGenesis; h <= np.m_SyncData.m_TxoLo; h++)
@@ -1267,6 +1612,12 @@ namespace beam
 			ByteBuffer bbE, bbP;
 			verify_test(npSrc.GetBlock(sid, &bbE, &bbP, 0, np.m_SyncData.m_TxoLo, np.m_SyncData.m_Target.m_Height, true));
 
+			// 2nd time it should come from the cache
+			ByteBuffer bbP2;
+			verify_test(npSrc.GetBlock(sid, nullptr, &bbP2, 0, np.m_SyncData.m_TxoLo, np.m_SyncData.m_Target.m_Height, true));
+			verify_test(bbP == bbP2);
+			verify_test(npSrc.m_BodyCache.m_Size); // re-created, not the original block
+
 			if (!bTampered)
 			{
 				Deserializer der;
@@ -1543,6 +1894,115 @@ namespace beam
 		np.TryGoUp();
 		verify_test(!np.IsFastSync());
 		verify_test(np.m_Cursor.m_ID.m_Height == blockChain.size());
+
+		verify_test(!np.m_SyncPipeline.m_ApplyPending);
+		verify_test(np.m_SyncPipeline.m_Apply.m_Blocks >= blockChain.size());
+		verify_test(np.m_SyncPipeline.m_Validate.m_Blocks >= blockChain.size());
+	}
+
+	void TestTxPoolRefs()
+	{
+		struct Walker
+			:public TxPool::Refs::IWalker
+		{
+			TxPool::Refs::KeySet m_Keys;
+
+			void OnRef(const TxPool::Refs::KeyType& key) override
+			{
+				m_Keys.insert(key);
+			}
+
+			bool Has(bool bBlock, const TxVectors::Full& txv, uint8_t nType)
+			{
+				m_Keys.clear();
+				Process(txv, bBlock);
+
+				TxPool::Refs::KeyType key;
+				TxPool::Refs::get_Key(key, nType);
+				return m_Keys.end() != m_Keys.find(key);
+			}
+
+		} wlk;
+
+		Transaction tx;
+		tx.m_vOutputs.emplace_back(new Output);
+		tx.m_vKernels.emplace_back(new TxKernelStd);
+
+		verify_test(!wlk.Has(false, tx, TxPool::Refs::Type::AnyAsset));
+
+		// txs with asset proofs must be revalidated on asset creation/destruction
+		tx.m_vOutputs.front()->m_pAsset = std::make_unique<Asset::Proof>();
+		verify_test(wlk.Has(false, tx, TxPool::Refs::Type::AnyAsset));
+		verify_test(!wlk.Has(true, tx, TxPool::Refs::Type::AnyAsset));
+
+		tx.m_vOutputs.front()->m_pAsset.reset();
+
+		std::unique_ptr<TxKernelShieldedOutput> pKrn(new TxKernelShieldedOutput);
+		pKrn->m_Txo.m_pAsset = std::make_unique<Asset::Proof>();
+		tx.m_vKernels.push_back(std::move(pKrn));
+		verify_test(wlk.Has(false, tx, TxPool::Refs::Type::AnyAsset));
+	}
+
+	void TestMetrics()
+	{
+		// bucket boundaries must be contiguous and cover the whole range
+		verify_test(!Metrics::Histogram::get_Bucket(0));
+		for (uint32_t i = 0; i + 1 < Metrics::Histogram::s_Buckets; i++)
+		{
+			uint64_t val = Metrics::Histogram::get_BucketMax(i);
+			verify_test(Metrics::Histogram::get_Bucket(val) == i);
+			verify_test(Metrics::Histogram::get_Bucket(val + 1) == i + 1);
+		}
+		verify_test(Metrics::Histogram::get_Bucket(static_cast<uint64_t>(-1)) == Metrics::Histogram::s_Buckets - 1);
+
+		Metrics::Registry reg;
+		Metrics::Counter cnt("test_counter", "Counter", reg);
+		Metrics::Gauge gauge("test_gauge", "Gauge", reg);
+		Metrics::CounterVec vec("test_vec", "CounterVec", "code", [](uint32_t n) -> const char* { return (1 == n) ? "One" : nullptr; }, reg);
+		Metrics::Histogram hist("test_hist", "Histogram", reg);
+
+		std::vector<std::thread> vThreads;
+		for (uint32_t iThread = 0; iThread < 4; iThread++)
+		{
+			vThreads.emplace_back([&]() {
+				for (uint64_t i = 1; i <= 1000; i++)
+				{
+					cnt.Inc();
+					gauge.Add(1);
+					vec.Inc(static_cast<uint32_t>(i & 1) + 1);
+					hist.Add(i);
+				}
+			});
+		}
+		for (auto& t : vThreads)
+			t.join();
+
+		verify_test(cnt.get() == 4000);
+		verify_test(gauge.get() == 4000);
+		verify_test((vec.get(1) == 2000) && (vec.get(2) == 2000));
+		verify_test(hist.get_Count() == 4000);
+		verify_test(hist.get_Sum() == 4 * 500500);
+
+		// relative error of quantiles is bounded by the sub-bucket resolution
+		uint64_t nMedian = hist.get_Quantile(0.5);
+		verify_test((nMedian >= 500) && (nMedian < 500 * 5 / 4));
+		verify_test(hist.get_Quantile(1.) >= 1000);
+
+		std::ostringstream os;
+		reg.WritePrometheus(os);
+		std::string s = os.str();
+
+		verify_test(s.find("# TYPE test_counter counter\ntest_counter 4000\n") != std::string::npos);
+		verify_test(s.find("# TYPE test_gauge gauge\ntest_gauge 4000\n") != std::string::npos);
+		verify_test(s.find("test_vec{code=\"One\"} 2000\n") != std::string::npos);
+		verify_test(s.find("test_vec{code=\"2\"} 2000\n") != std::string::npos);
+		verify_test(s.find("test_hist_bucket{le=\"+Inf\"} 4000\n") != std::string::npos);
+		verify_test(s.find("test_hist_count 4000\n") != std::string::npos);
+		// bounds are fixed, regardless of the observed values
+		verify_test(s.find("test_hist_bucket{le=\"0\"} 0\n") != std::string::npos);
+		verify_test(s.find("test_hist_bucket{le=\"511\"} 2044\n") != std::string::npos);
+		verify_test(s.find("test_hist_bucket{le=\"1023\"} 4000\n") != std::string::npos);
+		verify_test(s.find("test_hist_bucket{le=\"1099511627775\"} 4000\n") != std::string::npos);
 	}
 
 	const uint16_t g_Port = 25003; // don't use the default port to prevent collisions with running nodes, beacons and etc.
@@ -1570,6 +2030,7 @@ namespace beam
 		node2.m_Cfg.m_Treasury = g_Treasury;
 
 		node2.m_Cfg.m_BeaconPort = g_Port;
+		node2.m_Cfg.m_IoThreads = 2; // the inbound traffic of node2 is decoded by the I/O threads, node stays single-threaded
 
 		ECC::SetRandom(node);
 		ECC::SetRandom(node2);
@@ -1667,6 +2128,8 @@ namespace beam
 
 		pReactor->run();
 
+		verify_test(node2.get_IoStats().m_Messages > 0);
+
 		node.GenerateRecoveryInfo(g_sz3);
 
 		struct MyParser :public RecoveryInfo::IParser
@@ -1698,6 +2161,108 @@ namespace beam
 		DeleteFile(g_sz3);
 	}
 
+	void TestNodeIoClose()
+	{
+		// Testing configuration: Sender -> Node <- Receiver. The inbound traffic of the node is decoded by the I/O thread.
+		// Sender sends bbs messages and closes the connection at once, all of them must be processed by the node anyway
+
+		io::Reactor::Ptr pReactor(io::Reactor::create());
+		io::Reactor::Scope scope(*pReactor);
+
+		Node node;
+		node.m_Cfg.m_sPathLocal = g_sz;
+		node.m_Cfg.m_Listen.port(g_Port);
+		node.m_Cfg.m_Listen.ip(INADDR_ANY);
+		node.m_Cfg.m_Treasury = g_Treasury;
+		node.m_Cfg.m_IoThreads = 1;
+
+		ECC::SetRandom(node);
+		node.Initialize();
+
+		static const uint32_t s_Msgs = 50;
+		static const BbsChannel s_Channel = 17;
+
+		struct MySender
+			:public proto::NodeConnection
+		{
+			io::Timer::Ptr m_pTimer;
+
+			virtual void OnConnectedSecure() override
+			{
+				// let the node move the connection to the I/O thread
+				m_pTimer = io::Timer::create(io::Reactor::get_Current());
+				m_pTimer->start(300, false, [this]() { OnTimer(); });
+			}
+
+			void OnTimer()
+			{
+				proto::BbsMsg msg;
+				msg.m_Channel = s_Channel;
+				msg.m_TimePosted = getTimestamp();
+
+				for (uint32_t i = 0; i < s_Msgs; i++)
+				{
+					msg.m_Message.resize(sizeof(i));
+					memcpy(&msg.m_Message.front(), &i, sizeof(i));
+					Send(msg);
+				}
+
+				Reset();
+			}
+
+			virtual void OnDisconnect(const DisconnectReason&) override {
+				fail_test("OnDisconnect");
+			}
+		};
+
+		struct MyReceiver
+			:public proto::NodeConnection
+		{
+			io::Timer::Ptr m_pTimer;
+			uint32_t m_Received = 0;
+
+			virtual void OnConnectedSecure() override
+			{
+				proto::BbsSubscribe msg;
+				msg.m_Channel = s_Channel;
+				msg.m_TimeFrom = 0;
+				msg.m_On = true;
+				Send(msg);
+			}
+
+			virtual void OnMsg(proto::BbsMsg&& msg) override
+			{
+				verify_test(msg.m_Channel == s_Channel);
+				if (++m_Received == s_Msgs)
+					io::Reactor::get_Current().stop();
+			}
+
+			virtual void OnDisconnect(const DisconnectReason&) override {
+				fail_test("OnDisconnect");
+			}
+		};
+
+		io::Address addr;
+		addr.resolve("127.0.0.1");
+		addr.port(g_Port);
+
+		MyReceiver cl2;
+		cl2.Connect(addr);
+
+		MySender cl;
+		cl.Connect(addr);
+
+		io::Timer::Ptr pTimer = io::Timer::create(*pReactor);
+		pTimer->start(10000, false, []() {
+			io::Reactor::get_Current().stop();
+		});
+
+		pReactor->run();
+
+		verify_test(cl2.m_Received == s_Msgs);
+		verify_test(node.get_IoStats().m_Messages >= s_Msgs);
+	}
+
 	namespace bvm2
 	{
 		void Compile(ByteBuffer& res, const char* sz, Processor::Kind kind)
@@ -1737,6 +2302,7 @@ namespace beam
 		node.m_Cfg.m_Horizon.m_Sync.Lo = 14;
 		//node.m_Cfg.m_Horizon.m_Local = node.m_Cfg.m_Horizon.m_Sync;
 		node.m_Cfg.m_VerificationThreads = -1;
+		node.m_Cfg.m_DbReaderThreads = 2;
 
 		node.m_Cfg.m_Dandelion.m_AggregationTime_ms = 0;
 		node.m_Cfg.m_Dandelion.m_OutputsMin = 3;
@@ -3094,9 +3660,31 @@ namespace beam
 		TxoRecover wlk(*node.m_Keys.m_pOwner);
 		node2.get_Processor().EnumTxos(wlk);
 
+		// the rescan must reproduce exactly the events recognized live
+		auto fnEvents = [&node]()
+		{
+			std::vector<std::pair<Height, ByteBuffer> > v;
+
+			NodeDB::WalkerEvent wlkEvt;
+			for (node.get_Processor().get_DB().EnumEvents(wlkEvt, 0); wlkEvt.MoveNext(); )
+			{
+				auto& x = v.emplace_back();
+				x.first = wlkEvt.m_Height;
+				wlkEvt.m_Body.Export(x.second);
+				const uint8_t* pKey = reinterpret_cast<const uint8_t*>(wlkEvt.m_Key.p);
+				x.second.insert(x.second.end(), pKey, pKey + wlkEvt.m_Key.n);
+			}
+
+			std::sort(v.begin(), v.end());
+			return v;
+		};
+
+		auto vEvts0 = fnEvents();
+
 		node.get_Processor().RescanOwnedTxos();
 
 		verify_test(wlk.m_Recovered);
+		verify_test(!vEvts0.empty() && (fnEvents() == vEvts0));
 
 		// Test recovery info. Check if shielded in/outs and assets can re recognized
 		node.GenerateRecoveryInfo(beam::g_sz3);
@@ -3507,6 +4095,239 @@ namespace beam
 		return bRes;
 	}
 
+	void TestTxVerifier()
+	{
+		// Txs received from another node are verified asynchronously, in batches limited by m_MaxTxVerifyAsync.
+		// The only verification thread is blocked by a gate task, to control when the results are handled.
+		io::Reactor::Ptr pReactor(io::Reactor::create());
+		io::Reactor::Scope scope(*pReactor);
+
+		Key::IKdf::Ptr pKdf;
+		ECC::SetRandom(pKdf);
+
+		Node node;
+		node.m_Cfg.m_sPathLocal = g_sz;
+		node.m_Cfg.m_Listen.port(g_Port);
+		node.m_Cfg.m_Listen.ip(INADDR_ANY);
+		node.m_Cfg.m_MiningThreads = 0;
+		node.m_Cfg.m_VerificationThreads = 1;
+		node.m_Cfg.m_MaxTxVerifyAsync = 3;
+		node.m_Cfg.m_Treasury = g_Treasury;
+		node.m_Keys.SetSingleKey(pKdf);
+		node.Initialize();
+		node.m_PostStartSynced = true;
+
+		Height h0 = node.get_Processor().m_Cursor.m_ID.m_Height;
+		RaiseHeightTo(node, 25);
+		Height h = node.get_Processor().m_Cursor.m_ID.m_Height;
+
+		MiniWallet wallet;
+		wallet.m_pKdf = pKdf;
+		wallet.m_AutoAddTxOutputs = false;
+
+		for (Height hCb = h0 + 1; hCb <= h; hCb++)
+			wallet.AddMyUtxo(CoinID(Rules::get_Emission(hCb), hCb, Key::Type::Coinbase));
+
+		auto fnMakeTx = [&wallet, h](uint32_t iSpoil)
+		{
+			Transaction::Ptr pTx;
+			verify_test(wallet.MakeTx(pTx, h, 0));
+
+			ECC::Scalar::Native k1;
+			k1 = 1U;
+
+			if (1 == iSpoil)
+			{
+				// the tx doesn't balance anymore. Detected by the node, after the context-free verification
+				ECC::Scalar::Native k = pTx->m_Offset;
+				k += k1;
+				pTx->m_Offset = k;
+			}
+
+			if (2 == iSpoil)
+			{
+				// bad kernel signature. Spoils the verification batch
+				auto& krn = Cast::Up<TxKernelStd>(*pTx->m_vKernels.front());
+				ECC::Scalar::Native k = krn.m_Signature.m_k;
+				k += k1;
+				krn.m_Signature.m_k = k;
+			}
+
+			return pTx;
+		};
+
+		std::vector<Transaction::Ptr> vValid, vInvalid, vBatch;
+		for (uint32_t i = 0; i < 8; i++)
+		{
+			uint32_t iSpoil = (i % 3 == 2) ? (i % 2) + 1 : 0;
+			vBatch.push_back(fnMakeTx(iSpoil));
+			(iSpoil ? vInvalid : vValid).push_back(vBatch.back());
+		}
+
+		auto fnInPool = [&node](const Transaction& tx)
+		{
+			Transaction::KeyType key;
+			tx.get_Key(key);
+			return node.m_TxPool.m_setTxs.end() != node.m_TxPool.m_setTxs.find(key, TxPool::Fluff::Element::Tx::Comparator());
+		};
+
+		auto fnRejected = [&node](const Transaction& tx)
+		{
+			Transaction::KeyType key;
+			tx.get_Key(key);
+			auto it = node.m_TxReject.find(key);
+			return (node.m_TxReject.end() != it) && (proto::TxStatus::Invalid == it->second);
+		};
+
+		struct Gate
+		{
+			std::mutex m_Mutex;
+			std::condition_variable m_Cv;
+			bool m_Open = false;
+
+			struct Task
+				:public Executor::TaskAsync
+			{
+				Gate* m_pThis;
+
+				virtual void Exec(Executor::Context&) override
+				{
+					std::unique_lock<std::mutex> scope(m_pThis->m_Mutex);
+					while (!m_pThis->m_Open)
+						m_pThis->m_Cv.wait(scope);
+				}
+			};
+
+			void Close(Executor& ex)
+			{
+				auto pTask = std::make_unique<Task>();
+				pTask->m_pThis = this;
+				ex.Push(std::move(pTask));
+			}
+
+			void Open()
+			{
+				{
+					std::unique_lock<std::mutex> scope(m_Mutex);
+					m_Open = true;
+				}
+				m_Cv.notify_all();
+			}
+
+		} gate;
+
+		struct MyClient
+			:public proto::NodeConnection
+		{
+			std::vector<Transaction::Ptr>* m_pBatch;
+
+			virtual void OnConnectedSecure() override
+			{
+				// introduce ourselves as a node: the txs are deferred and verified asynchronously, without the reply
+				ECC::Scalar::Native sk;
+				ECC::SetRandom(sk);
+				ProveID(sk, proto::IDType::Node);
+
+				SendTxs(*m_pBatch);
+			}
+
+			void SendTxs(const std::vector<Transaction::Ptr>& vTxs)
+			{
+				for (const auto& pTx : vTxs)
+				{
+					proto::NewTransaction msg;
+					msg.m_Transaction = pTx;
+					msg.m_Fluff = true;
+					Send(msg);
+				}
+			}
+
+			virtual void OnMsg(proto::Status&&) override {
+				fail_test("unexpected reply");
+			}
+
+			virtual void OnDisconnect(const DisconnectReason&) override {
+				fail_test("OnDisconnect");
+				io::Reactor::get_Current().stop();
+			}
+		};
+
+		gate.Close(node.get_Processor().get_Executor());
+
+		io::Address addr;
+		addr.resolve("127.0.0.1");
+		addr.port(g_Port);
+
+		MyClient cl;
+		cl.m_pBatch = &vBatch;
+		cl.Connect(addr);
+
+		Transaction::Ptr pTxNew = fnMakeTx(0);
+
+		uint32_t iStage = 0, nTicks = 0;
+
+		io::Timer::Ptr pTimer = io::Timer::create(*pReactor);
+		pTimer->start(50, true, [&]() {
+
+			if (++nTicks > 400)
+			{
+				fail_test("TxVerifier timeout");
+				io::Reactor::get_Current().stop();
+				return;
+			}
+
+			switch (iStage)
+			{
+			case 0:
+				if (nTicks < 10)
+					return;
+
+				// the verifier is saturated and blocked, nothing is handled yet
+				verify_test(node.m_TxPool.m_setTxs.empty());
+				verify_test(node.m_TxReject.empty());
+
+				// let the pending batch finish while the tip is changing. The results must be re-validated at the new height
+				gate.Open();
+				RaiseHeightTo(node, h + 1);
+				break;
+
+			case 1:
+				if (node.m_TxPool.m_setTxs.size() + node.m_TxReject.size() < vBatch.size())
+					return;
+
+				verify_test(node.m_TxPool.m_setTxs.size() == vValid.size());
+				verify_test(node.m_TxReject.size() == vInvalid.size());
+
+				for (const auto& pTx : vValid)
+					verify_test(fnInPool(*pTx));
+				for (const auto& pTx : vInvalid)
+					verify_test(fnRejected(*pTx));
+
+				// resend the known txs, they must be dismissed without re-verification, the new one follows them
+				cl.SendTxs({ vValid.front(), vInvalid.front(), pTxNew });
+				break;
+
+			case 2:
+				if (!fnInPool(*pTxNew))
+					return;
+
+				verify_test(node.m_TxPool.m_setTxs.size() == vValid.size() + 1);
+				verify_test(node.m_TxReject.size() == vInvalid.size());
+				verify_test(fnRejected(*vInvalid.front()));
+
+				io::Reactor::get_Current().stop();
+				break;
+			}
+
+			iStage++;
+		});
+
+		pReactor->run();
+
+		gate.Open(); // in case of a failure
+		verify_test(3 == iStage);
+	}
+
 	void TestDependentTxs()
 	{
 		io::Reactor::Ptr pReactor(io::Reactor::create());
@@ -3844,6 +4665,33 @@ void TestAll()
 		beam::TestNodeDB();
 		beam::DeleteFile(beam::g_sz);
 
+		printf("BbsStore test...\n");
+		fflush(stdout);
+
+		beam::TestBbsStore();
+
+		printf("ContractVarCache test...\n");
+		fflush(stdout);
+
+		beam::TestContractVarCache();
+		beam::DeleteFile(beam::g_sz);
+
+		printf("ShieldedCache test...\n");
+		fflush(stdout);
+
+		beam::TestShieldedCache();
+		beam::DeleteFile(beam::g_sz);
+
+		printf("TxPool refs test...\n");
+		fflush(stdout);
+
+		beam::TestTxPoolRefs();
+
+		printf("Metrics test...\n");
+		fflush(stdout);
+
+		beam::TestMetrics();
+
 		{
 			printf("NodeProcessor test1...\n");
 			fflush(stdout);
@@ -3874,6 +4722,22 @@ void TestAll()
 		beam::TestNodeConversation();
 		beam::DeleteFile(beam::g_sz);
 		beam::DeleteFile(beam::g_sz2);
+
+		printf("Node I/O close test...\n");
+		fflush(stdout);
+
+		beam::TestNodeIoClose();
+		beam::DeleteFile(beam::g_sz);
+
+		printf("TxVerifier test...\n");
+		fflush(stdout);
+
+		beam::TestTxVerifier();
+		beam::DeleteFile(beam::g_sz);
+
+		verify_test(beam::NodeMetrics::MsgIn.get(beam::proto::NewTip::s_Code));
+		verify_test(beam::NodeMetrics::BlockHandle_us.get_Count());
+		verify_test(beam::NodeMetrics::DbCommit_us.get_Count());
 	}
 
 	beam::Rules::get().MaxRollback = 100;
@@ -3947,6 +4811,9 @@ void TestAll()
 	beam::TestDependentTxs();
 	beam::DeleteFile(beam::g_sz);
 	beam::DeleteFile(beam::g_sz2);
+
+	beam::DeleteBbsStore(beam::g_sz);
+	beam::DeleteBbsStore(beam::g_sz2);
 }
 
 int main()
@@ -49,6 +49,17 @@ public:
     /// Disables all messages
     void disable_all_msg_types() { _msgReader.disable_all_msg_types(); }
 
+    /// Replaces the input handler (the default one feeds the msg reader)
+    io::Result set_input(const io::TcpStream::Callback& callback) {
+        _stream->disable_read();
+        return _stream->enable_read(callback);
+    }
+
+    /// Stops reading from the stream, until the input is set again
+    void pause_input() { _stream->disable_read(); }
+
+    MsgReader& get_msg_reader() { return _msgReader; }
+
 private:
     MsgReader _msgReader;
 };
@@ -48,6 +48,18 @@ void MsgReader::reset() {
     _cursor = _msgBuffer.data();
 }
 
+void MsgReader::take_state(MsgReader& src) {
+    size_t offset = src._cursor - src._msgBuffer.data();
+    _msgBuffer.swap(src._msgBuffer);
+    _cursor = _msgBuffer.data() + offset;
+    _bytesLeft = src._bytesLeft;
+    _state = src._state;
+    _expectedMsgTypes = src._expectedMsgTypes;
+
+    src._msgBuffer.resize(src._defaultSize);
+    src.reset();
+}
+
 void MsgReader::change_id(uint64_t newStreamId) {
     _streamId = newStreamId;
 }
@@ -48,6 +48,9 @@ public:
     /// Resets to initial state
     void reset();
 
+    /// Continues reading from the point where the other reader stopped (incomplete message included). The other one is reset
+    void take_state(MsgReader& src);
+
 private:
     /// 2 states of the reader
     enum State { reading_header, reading_message };
@@ -41,6 +41,8 @@ public:
         std::string apiKeysFile;
         std::string certFile;
         std::string privKeyFile;
+        uint32_t shareInterval_s = 0; // vardiff target time between shares of a connection, 0 = shares at the block difficulty
+        uint32_t verifierThreads = 0; // solution verification threads, 0 = number of cores
     };
 
     // creates stratum server
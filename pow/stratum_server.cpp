@@ -18,6 +18,7 @@
 #include <boost/filesystem.hpp>
 #include <boost/algorithm/string/trim.hpp>
 #include <fstream>
+#include <algorithm>
 
 #ifndef LOG_VERBOSE_ENABLED
 #define LOG_VERBOSE_ENABLED 1
@@ -38,9 +39,15 @@ namespace stratum {
 
 static const uint64_t SERVER_RESTART_TIMER = 1;
 static const uint64_t ACL_REFRESH_TIMER = 2;
+static const uint64_t VARDIFF_TIMER = 3;
 static const unsigned SERVER_RESTART_INTERVAL = 1000;
 static const unsigned ACL_REFRESH_INTERVAL = 5000;
 
+static const uint32_t VARDIFF_WINDOW_SHARES = 8; // expected shares per vardiff window
+static const uint32_t MAX_PENDING_SHARES_PER_PEER = 8;
+static const uint32_t MAX_PENDING_SHARES_PER_THREAD = 32;
+static const size_t MAX_RECENT_JOBS = 64; // same as the node's backlog of jobs being mined
+
 static const char STS[] = "stratum server ";
 
 Server::Server(const IExternalPOW::Options& o, io::Reactor& reactor, io::Address listenTo, unsigned noncePrefixDigits) :
@@ -51,13 +58,25 @@ Server::Server(const IExternalPOW::Options& o, io::Reactor& reactor, io::Address
     _fw(4096, 0, [this](io::SharedBuffer&& buf){ _currentMsg.push_back(buf); }),
     _acl(o.apiKeysFile),
     _prefixDigits(noncePrefixDigits),
-    _prefixSeed(0)
+    _prefixSeed(0),
+    _pendingShares(0),
+    _sessions(0)
 {
     assert(_prefixDigits <= 6);
     _timers.set_timer(SERVER_RESTART_TIMER, 0, BIND_THIS_MEMFN(start_server));
     if (!o.apiKeysFile.empty()) {
         _timers.set_timer(ACL_REFRESH_TIMER, 0, BIND_THIS_MEMFN(refresh_acl));
     }
+    if (o.shareInterval_s) {
+        _timers.set_timer(VARDIFF_TIMER, o.shareInterval_s * 1000, BIND_THIS_MEMFN(retarget_all));
+    }
+
+    _verifiedEvent = io::AsyncEvent::create(reactor, BIND_THIS_MEMFN(on_verified));
+
+    _verifier = std::make_unique<ExecutorMT_R>();
+    if (o.verifierThreads) {
+        _verifier->set_Threads(o.verifierThreads);
+    }
     if (_prefixDigits > 0) {
         ECC::GenRandom(&_prefixSeed, 8);
     }
@@ -97,12 +116,14 @@ void Server::on_stream_accepted(io::TcpStream::Ptr&& newStream, io::ErrorCode er
     if (errorCode == 0) {
         auto peer = newStream->peer_address();
         LOG_DEBUG() << STS << "+peer " << peer;
-        _connections[peer.u64()] = std::make_unique<Connection>(
+        auto& conn = _connections[peer.u64()];
+        conn = std::make_unique<Connection>(
             *this,
             peer.u64(),
             gen_nonceprefix(peer.u64()),
             std::move(newStream)
         );
+        conn->shares.session = ++_sessions;
     } else {
         LOG_ERROR() << STS << io::error_str(errorCode) << ", restarting server in  " << SERVER_RESTART_INTERVAL << " msec";
         _timers.set_timer(SERVER_RESTART_TIMER, SERVER_RESTART_INTERVAL, BIND_THIS_MEMFN(start_server));
@@ -146,14 +167,16 @@ bool Server::on_login(uint64_t from, const Login& login) {
     if (!sent || !loginSuccess)
         return false;
 
-    return _connections[from]->send_msg(_recentJob.msg, true);
+    return send_job(*conn);
 }
 
 bool Server::on_solution(uint64_t from, const Solution& sol) {
 	LOG_DEBUG() << TRACE(sol.nonce) << TRACE(sol.output);
 
+	auto& conn = _connections[from];
+
 	if (_prefixDigits > 0) {
-	    const std::string& nonceprefix = _connections[from]->get_nonceprefix();
+	    const std::string& nonceprefix = conn->get_nonceprefix();
 	    if (
 	        sol.nonce.size() < _prefixDigits ||
 	        memcmp(sol.nonce.c_str(), nonceprefix.c_str(), _prefixDigits) != 0
@@ -161,16 +184,128 @@ bool Server::on_solution(uint64_t from, const Solution& sol) {
             Result res(sol.id, stratum::solution_rejected);
             //res.nonceprefix = nonceprefix;
             append_json_msg(_fw, res);
-            _connections[from]->send_msg(_currentMsg, true, true);
+            conn->send_msg(_currentMsg, true, true);
             _currentMsg.clear();
             return false;
 	    }
 	}
 
-	_recentResult.id = sol.id;
-    sol.fill_pow(_recentResult.pow);
+    auto itJob = std::find_if(_jobs.begin(), _jobs.end(), [&sol](const RecentJob& j) { return j.id == sol.id; });
+    if (itJob == _jobs.end()) {
+        return send_result(from, sol.id, stratum::solution_expired);
+    }
+
+    std::unique_ptr<VerifyTask> pTask = std::make_unique<VerifyTask>();
+    pTask->server = this;
+
+    ShareCheck& check = pTask->check;
+    check.from = from;
+    check.session = conn->shares.session;
+    check.id = sol.id;
+    check.input = itJob->input;
+    check.height = itJob->height;
+    check.pow = itJob->pow;
+    check.valid = false;
+
+    if (!sol.fill_pow(check.pow)) {
+        return send_result(from, sol.id, stratum::solution_rejected);
+    }
+
+    if (Rules::get().FakePoW) {
+        // not verified by the node either
+        check.isBlock = check.valid = true;
+        on_share(*conn, check);
+        return true;
+    }
+
+    // cheap checks first: the solution hash must reach the share difficulty, the expensive verification is off the reactor
+    ECC::Hash::Value hv;
+    ECC::Hash::Processor() << Blob(check.pow.m_Indices.data(), static_cast<uint32_t>(check.pow.m_Indices.size())) >> hv;
+
+    check.isBlock = check.pow.m_Difficulty.IsTargetReached(hv);
+    if (!check.isBlock) {
+        const Connection::Shares& shares = conn->shares;
+        if (!_options.shareInterval_s) {
+            return send_result(from, sol.id, stratum::solution_rejected);
+        }
+
+        if (shares.current.IsTargetReached(hv)) {
+            check.pow.m_Difficulty = shares.current;
+        } else if (shares.is_previous_valid(GetTime_ms()) && shares.previous.IsTargetReached(hv)) {
+            check.pow.m_Difficulty = shares.previous; // the miner hasn't switched to the retargeted job yet
+        } else {
+            return send_result(from, sol.id, stratum::solution_rejected);
+        }
+    }
+
+    if ((conn->shares.pending >= MAX_PENDING_SHARES_PER_PEER) || (_pendingShares >= _verifier->get_Threads() * MAX_PENDING_SHARES_PER_THREAD)) {
+        LOG_DEBUG() << STS << "verification queue full, share from " << io::Address::from_u64(from) << " dropped";
+        return send_result(from, sol.id, stratum::solution_rejected);
+    }
+
+    conn->shares.pending++;
+    _pendingShares++;
+    _verifier->Push(std::move(pTask));
+    return true;
+}
 
-    LOG_INFO() << STS << "solution to " << sol.id << " from " << io::Address::from_u64(from);
+void Server::VerifyTask::Exec(Executor::Context&) {
+    check.valid = check.pow.IsValid(check.input.m_pData, check.input.nBytes, check.height);
+
+    {
+        std::unique_lock<std::mutex> scope(server->_verifiedMutex);
+        server->_verified.push_back(std::move(check));
+    }
+
+    server->_verifiedEvent->post();
+}
+
+void Server::on_verified() {
+    std::vector<ShareCheck> v;
+    {
+        std::unique_lock<std::mutex> scope(_verifiedMutex);
+        v.swap(_verified);
+    }
+
+    for (auto& check : v) {
+        assert(_pendingShares);
+        _pendingShares--;
+
+        auto it = _connections.find(check.from);
+        if ((it == _connections.end()) || (it->second->shares.session != check.session)) {
+            continue; // disconnected meanwhile
+        }
+
+        Connection& conn = *it->second;
+        assert(conn.shares.pending);
+        conn.shares.pending--;
+
+        on_share(conn, check);
+    }
+}
+
+void Server::on_share(Connection& conn, ShareCheck& check) {
+    if (!check.valid) {
+        LOG_INFO() << STS << "invalid solution to " << check.id << " from " << io::Address::from_u64(check.from);
+        send_result(check.from, check.id, stratum::solution_rejected);
+        return;
+    }
+
+    // shares of the previous (easier) difficulty are accepted, but don't count for the vardiff
+    if (check.isBlock || (check.pow.m_Difficulty.m_Packed >= conn.shares.current.m_Packed)) {
+        conn.shares.found++;
+    }
+
+    if (!check.isBlock) {
+        send_result(check.from, check.id, stratum::solution_accepted);
+        return;
+    }
+
+	_recentResult.id = check.id;
+    _recentResult.pow.m_Indices = check.pow.m_Indices;
+    _recentResult.pow.m_Nonce = check.pow.m_Nonce;
+
+    LOG_INFO() << STS << "solution to " << check.id << " from " << io::Address::from_u64(check.from);
 	IExternalPOW::BlockFoundResult result = _recentResult.onBlockFound();
     stratum::ResultCode stratumCode = stratum::solution_rejected;
     if (result == IExternalPOW::solution_accepted) {
@@ -178,16 +313,121 @@ bool Server::on_solution(uint64_t from, const Solution& sol) {
     } else if (result == IExternalPOW::solution_expired) {
         stratumCode = stratum::solution_expired;
     }
-    Result res(sol.id, stratumCode);
-    if (result == IExternalPOW::solution_accepted) {
-        res.blockhash = result._blockhash;
-    }
+
+    send_result(check.from, check.id, stratumCode, (result == IExternalPOW::solution_accepted) ? result._blockhash : std::string());
+}
+
+bool Server::send_result(uint64_t to, const std::string& id, ResultCode code, const std::string& blockhash) {
+    Result res(id, code);
+    res.blockhash = blockhash;
     append_json_msg(_fw, res);
-    bool sent = _connections[from]->send_msg(_currentMsg, true);
+    bool sent = _connections[to]->send_msg(_currentMsg, true);
     _currentMsg.clear();
     return sent;
 }
 
+bool Server::send_job(Connection& conn) {
+    Connection::Shares& shares = conn.shares;
+    if (!_options.shareInterval_s || _recentJob.id.empty()) {
+        return conn.send_msg(_recentJob.msg, true);
+    }
+
+    const Difficulty& dBlock = _recentJob.pow.m_Difficulty;
+    if (!shares.initialized) {
+        // start at the block difficulty, the retarget lowers it quickly enough for slow miners
+        shares.initialized = true;
+        shares.current = dBlock;
+        shares.previous = dBlock;
+        shares.windowStart_ms = GetTime_ms();
+    }
+
+    if (shares.current.m_Packed >= dBlock.m_Packed) {
+        return conn.send_msg(_recentJob.msg, true);
+    }
+
+    Block::PoW pow = _recentJob.pow;
+    pow.m_Difficulty = shares.current;
+
+    Job jobMsg(_recentJob.id, _recentJob.input, pow, _recentJob.height);
+    append_json_msg(_fw, jobMsg);
+    bool sent = conn.send_msg(_currentMsg, true);
+    _currentMsg.clear();
+    return sent;
+}
+
+Difficulty Server::retarget_share_difficulty(Difficulty current, Difficulty maximum, uint32_t shares, uint32_t elapsed_ms, uint32_t target_ms) {
+    uint32_t order, mantissa;
+    current.Unpack(order, mantissa);
+
+    // compare the found shares with the expected count (elapsed / target)
+    uint64_t found = static_cast<uint64_t>(shares) * target_ms;
+    uint64_t expected = elapsed_ms;
+
+    for (uint32_t i = 0; (i < 2) && (found >= expected * 2) && (order < Difficulty::s_MaxOrder); i++) {
+        order++;
+        expected *= 2;
+    }
+
+    for (uint32_t i = 0; (i < 2) && (found * 2 <= expected) && order; i++) {
+        order--;
+        found *= 2;
+    }
+
+    Difficulty ret;
+    ret.Pack(order, mantissa);
+
+    if (ret.m_Packed > maximum.m_Packed) {
+        ret = maximum;
+    }
+    return ret;
+}
+
+void Server::retarget_all() {
+    const uint32_t target_ms = _options.shareInterval_s * 1000;
+    const uint32_t window_ms = target_ms * VARDIFF_WINDOW_SHARES;
+    const uint32_t now_ms = GetTime_ms();
+
+    for (auto& p : _connections) {
+        Connection::Shares& shares = p.second->shares;
+        if (!shares.initialized) {
+            continue;
+        }
+
+        uint32_t elapsed_ms = now_ms - shares.windowStart_ms;
+        // retarget at the end of the window, or earlier if shares come too fast
+        if ((elapsed_ms < window_ms) && (shares.found < VARDIFF_WINDOW_SHARES * 2)) {
+            continue;
+        }
+
+        Difficulty d = retarget_share_difficulty(shares.current, _recentJob.pow.m_Difficulty, shares.found, elapsed_ms, target_ms);
+
+        shares.found = 0;
+        shares.windowStart_ms = now_ms;
+
+        if (d.m_Packed == shares.current.m_Packed) {
+            continue;
+        }
+
+        LOG_DEBUG() << STS << "share difficulty for " << io::Address::from_u64(p.first) << ": " << shares.current << " -> " << d;
+
+        // the job with the new difficulty is sent right away, one share interval is enough for the miner to switch
+        shares.previous = shares.current;
+        shares.previousExpires_ms = now_ms + target_ms;
+        shares.current = d;
+
+        if (!send_job(*p.second)) {
+            _deadConnections.push_back(p.first);
+        }
+    }
+
+    for (auto c : _deadConnections) {
+        _connections.erase(c);
+    }
+    _deadConnections.clear();
+
+    _timers.set_timer(VARDIFF_TIMER, target_ms, BIND_THIS_MEMFN(retarget_all));
+}
+
 void Server::on_bad_peer(uint64_t from) {
     LOG_INFO() << STS << "-peer " << io::Address::from_u64(from);
     _connections.erase(from);
@@ -202,6 +442,9 @@ void Server::new_job(
     const CancelCallback& /* cancelCallback */
 ) {
     _recentJob.id = id;
+    _recentJob.input = input;
+    _recentJob.pow = pow;
+    _recentJob.height = height;
     _recentResult.onBlockFound = callback;
     _recentResult.height = height;	
 
@@ -212,8 +455,13 @@ void Server::new_job(
 	_recentJob.msg.swap(_currentMsg);
     _currentMsg.clear();
 
+    _jobs.push_front(_recentJob);
+    if (_jobs.size() > MAX_RECENT_JOBS) {
+        _jobs.pop_back();
+    }
+
     for (auto& p : _connections) {
-        if (!p.second->send_msg(_recentJob.msg, true)) {
+        if (!send_job(*p.second)) {
             _deadConnections.push_back(p.first);
         }
     }
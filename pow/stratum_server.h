@@ -18,8 +18,11 @@
 #include "p2p/line_protocol.h"
 #include "utility/io/tcpserver.h"
 #include "utility/io/coarsetimer.h"
+#include "utility/io/asyncevent.h"
 #include <set>
 #include <map>
+#include <deque>
+#include <mutex>
 
 namespace beam { namespace stratum {
 
@@ -35,6 +38,10 @@ class Server : public IExternalPOW, public ConnectionToServer {
 public:
     Server(const IExternalPOW::Options& o, io::Reactor& reactor, io::Address listenTo, unsigned noncePrefixDigits);
 
+    // vardiff: share difficulty for the next window, given the shares found during the elapsed one.
+    // Changes in power-of-2 steps, at most 4x per window, and never exceeds the block difficulty
+    static Difficulty retarget_share_difficulty(Difficulty current, Difficulty maximum, uint32_t shares, uint32_t elapsed_ms, uint32_t target_ms);
+
 private:
     class AccessControl {
     public:
@@ -60,6 +67,19 @@ private:
 
         bool send_msg(const io::SerializedMsg& msg, bool onlyIfLoggedIn, bool shutdown=false);
 
+        struct Shares {
+            Difficulty current; // sent with the last job
+            Difficulty previous; // shares for the jobs sent before the last retarget, welcome until previousExpires_ms
+            uint32_t previousExpires_ms = 0;
+            bool initialized = false;
+            uint32_t found = 0; // within the current vardiff window
+            uint32_t windowStart_ms = 0;
+            uint32_t pending = 0; // being verified
+            uint64_t session = 0; // tells apart reconnections from the same address
+
+            bool is_previous_valid(uint32_t now_ms) const { return static_cast<int32_t>(previousExpires_ms - now_ms) > 0; }
+        } shares;
+
     private:
         bool on_message(const Login& login) override;
 
@@ -93,6 +113,32 @@ private:
     bool on_solution(uint64_t from, const Solution& solution) override;
     void on_bad_peer(uint64_t from) override;
 
+    bool send_job(Connection& conn);
+    bool send_result(uint64_t to, const std::string& id, ResultCode code, const std::string& blockhash = std::string());
+    void retarget_all();
+
+    // Solutions are verified on the worker threads. Only those that reach the block difficulty are passed to the node
+    struct ShareCheck {
+        uint64_t from;
+        uint64_t session;
+        std::string id;
+        Merkle::Hash input;
+        Height height;
+        Block::PoW pow; // m_Difficulty is the share difficulty
+        bool isBlock;
+        bool valid;
+    };
+
+    struct VerifyTask : public Executor::TaskAsync {
+        Server* server;
+        ShareCheck check;
+
+        void Exec(Executor::Context&) override;
+    };
+
+    void on_verified();
+    void on_share(Connection& conn, ShareCheck& check);
+
     void new_job(
         const std::string&,
         const Merkle::Hash& input, const Block::PoW& pow,
@@ -117,8 +163,14 @@ private:
 	struct RecentJob {
 		io::SerializedMsg msg;
 		std::string id;
+		Merkle::Hash input;
+		Block::PoW pow;
+		Height height;
 	} _recentJob;
 
+    // recent jobs which still may be solved, the newest first
+    std::deque<RecentJob> _jobs;
+
 	struct RecentResult {
 		std::string id;
 		Height height;
@@ -130,6 +182,15 @@ private:
     std::vector<uint64_t> _deadConnections;
     unsigned _prefixDigits; // nonceprefix hex digits, 0..6
     uint64_t _prefixSeed;
+
+    std::mutex _verifiedMutex;
+    std::vector<ShareCheck> _verified; // protected by _verifiedMutex
+    io::AsyncEvent::Ptr _verifiedEvent;
+    uint32_t _pendingShares;
+    uint64_t _sessions;
+
+    // must be the last member, its threads are stopped before the rest is destroyed
+    std::unique_ptr<ExecutorMT_R> _verifier;
 };
 
 }} //namespaces
@@ -13,11 +13,14 @@
 // limitations under the License.
 
 #include "pow/stratum.h"
+#include "pow/stratum_server.h"
 #include "core/ecc.h"
 #include "utility/io/json_serializer.h"
 #include "p2p/line_protocol.h"
 #include "utility/helpers.h"
 #include "utility/logger.h"
+#include "utility/io/timer.h"
+#include <thread>
 
 using namespace beam;
 
@@ -61,6 +64,297 @@ int json_creation_test() {
     return nErrors;
 }
 
+int vardiff_test() {
+    int nErrors = 0;
+
+    using namespace beam::stratum;
+
+    Difficulty dMax, d;
+    dMax.Pack(40, 1U << Difficulty::s_MantissaBits);
+    d.Pack(20, 3U << (Difficulty::s_MantissaBits - 1));
+
+    auto check = [&nErrors](bool b, const char* sz) {
+        if (!b) {
+            LOG_ERROR() << "vardiff: " << sz;
+            ++nErrors;
+        }
+    };
+
+    auto get_order = [](Difficulty x) {
+        uint32_t order, mantissa;
+        x.Unpack(order, mantissa);
+        return order;
+    };
+
+    // 8 shares expected within 80 sec
+    check(Server::retarget_share_difficulty(d, dMax, 8, 80000, 10000).m_Packed == d.m_Packed, "on target");
+    check(Server::retarget_share_difficulty(d, dMax, 12, 80000, 10000).m_Packed == d.m_Packed, "within tolerance");
+    check(get_order(Server::retarget_share_difficulty(d, dMax, 16, 80000, 10000)) == 21, "raise x2");
+    check(get_order(Server::retarget_share_difficulty(d, dMax, 1000, 80000, 10000)) == 22, "raise limit");
+    check(get_order(Server::retarget_share_difficulty(d, dMax, 4, 80000, 10000)) == 19, "lower x2");
+    check(get_order(Server::retarget_share_difficulty(d, dMax, 0, 80000, 10000)) == 18, "lower limit");
+
+    Difficulty dMin;
+    dMin.Pack(0, 1U << Difficulty::s_MantissaBits);
+    check(Server::retarget_share_difficulty(dMin, dMax, 0, 80000, 10000).m_Packed == dMin.m_Packed, "lower bound");
+    check(Server::retarget_share_difficulty(dMax, dMax, 1000, 80000, 10000).m_Packed == dMax.m_Packed, "upper bound");
+
+    // mantissa is preserved
+    Difficulty x = Server::retarget_share_difficulty(d, dMax, 16, 80000, 10000);
+    check(x.ToFloat() == d.ToFloat() * 2, "mantissa");
+
+    return nErrors;
+}
+
+// The PoW of the mainnet block 903720 (BeamHash III), solving takes minutes
+const char SOLUTION_INPUT[] = "a05ea9b3dd329bbf3e8ef68415eae102021f1d9a995d4a727cb3e307e5d17321";
+const char SOLUTION_NONCE[] = "ad636476f7117400";
+const char SOLUTION_INDICES[] =
+    "188306068af692bdd9d40355eeca8640005aa7ff65b61a85b45fc70a8a2ac127db2d90c4fc397643a5d98f3e644f9f59fc"
+    "f9677a0da2e90f597f61a1bf17d67512c6d57e680d0aa2642f7d275d2700188dbf8b43fac5c88fa08fa270e8d8fbc33777"
+    "619b00000000";
+const Height SOLUTION_HEIGHT = 903720;
+
+struct TestMiner : public stratum::ParserCallback {
+    io::TcpStream::Ptr stream;
+    LineProtocol protocol;
+    io::SerializedMsg unsent;
+    std::string jobId;
+    uint32_t jobDifficulty = 0;
+    uint32_t results[stratum::solution_expired + 1] = { 0 }; // by code
+
+    TestMiner() :
+        protocol(BIND_THIS_MEMFN(on_raw_message), BIND_THIS_MEMFN(on_write))
+    {}
+
+    bool on_raw_message(void* data, size_t size) {
+        return stratum::parse_json_msg(data, size, *this);
+    }
+
+    void on_write(io::SharedBuffer&& fragment) {
+        unsent.push_back(fragment);
+    }
+
+    // a single write, the server parses it at once
+    void flush() {
+        protocol.finalize();
+        if (stream) {
+            stream->write(unsent);
+        }
+        unsent.clear();
+    }
+
+    bool on_stream_data(io::ErrorCode errorCode, void* data, size_t size) {
+        if (errorCode != 0) {
+            stream.reset();
+            return false;
+        }
+        return protocol.new_data_from_stream(data, size);
+    }
+
+    bool on_message(const stratum::Job& job) override {
+        jobId = job.id;
+        jobDifficulty = job.difficulty;
+        return true;
+    }
+
+    bool on_message(const stratum::Result& res) override {
+        if ((res.code >= 0) && (res.code <= stratum::solution_expired)) {
+            results[res.code]++;
+        }
+        return true;
+    }
+
+    void send_solutions(const std::string& id, const Block::PoW& pow, uint32_t count) {
+        for (uint32_t i = 0; i < count; i++) {
+            stratum::append_json_msg(protocol, stratum::Solution(id, pow));
+        }
+        flush();
+    }
+};
+
+int server_test() {
+    int nErrors = 0;
+
+    using namespace beam::stratum;
+
+    auto check = [&nErrors](bool b, const char* sz) {
+        if (!b) {
+            LOG_ERROR() << "server: " << sz;
+            ++nErrors;
+        }
+    };
+
+    io::Reactor::Ptr reactor = io::Reactor::create();
+    io::Reactor::Scope scope(*reactor);
+    io::Address listenTo = io::Address::localhost().port(20013);
+
+    IExternalPOW::Options options;
+    options.shareInterval_s = 3600; // vardiff enabled, but doesn't retarget during the test
+    options.verifierThreads = 1; // 32 pending shares at most
+
+    std::unique_ptr<IExternalPOW> server = IExternalPOW::create(options, *reactor, listenTo, 0);
+
+    Merkle::Hash input;
+    input.Scan(SOLUTION_INPUT);
+    const Height h = SOLUTION_HEIGHT;
+
+    Block::PoW powValid;
+    bool ok = false;
+    std::vector<uint8_t> buf = from_hex(SOLUTION_NONCE, &ok);
+    check(ok && (buf.size() == powValid.m_Nonce.nBytes), "nonce");
+    memcpy(powValid.m_Nonce.m_pData, buf.data(), powValid.m_Nonce.nBytes);
+    buf = from_hex(SOLUTION_INDICES, &ok);
+    check(ok && (buf.size() == powValid.m_Indices.size()), "indices");
+    std::copy(buf.begin(), buf.end(), powValid.m_Indices.begin());
+    check(powValid.IsValid(input.m_pData, input.nBytes, h), "test vector");
+
+    Block::PoW powInvalid = powValid;
+    powInvalid.m_Indices[7] ^= 1;
+
+    const std::thread::id reactorThread = std::this_thread::get_id();
+    uint32_t blocksFound = 0;
+    auto onBlockFound = [&]() -> IExternalPOW::BlockFoundResult {
+        check(std::this_thread::get_id() == reactorThread, "block found off the reactor");
+        blocksFound++;
+        return IExternalPOW::solution_accepted;
+    };
+
+    // job 1: every solution is a block
+    Block::PoW pow;
+    pow.m_Difficulty = 0;
+    server->new_job("1", input, pow, h, onBlockFound, []() { return false; });
+
+    static const uint32_t s_Miners = 6;
+    TestMiner miners[s_Miners];
+
+    auto get_total = [&miners](ResultCode code) {
+        uint32_t n = 0;
+        for (const auto& m : miners) {
+            n += m.results[code];
+        }
+        return n;
+    };
+
+    auto all_got_job = [&miners](const char* id) {
+        for (const auto& m : miners) {
+            if (m.jobId != id) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    uint32_t stage = 0;
+    const uint32_t deadline_ms = GetTime_ms() + 30000;
+    uint32_t resume_ms = 0;
+    io::Timer::Ptr timer = io::Timer::create(*reactor);
+
+    timer->start(20, true, [&]() {
+        if (static_cast<int32_t>(GetTime_ms() - deadline_ms) > 0) {
+            check(false, "timeout");
+            reactor->stop();
+            return;
+        }
+
+        switch (stage) {
+        case 0:
+            // the server is listening by now
+            for (uint32_t i = 0; i < s_Miners; i++) {
+                TestMiner& m = miners[i];
+                reactor->tcp_connect(listenTo, i, [&m](uint64_t, io::TcpStream::Ptr&& newStream, io::ErrorCode errorCode) {
+                    if (errorCode == 0) {
+                        m.stream = std::move(newStream);
+                        m.stream->enable_read([&m](io::ErrorCode err, void* data, size_t size) {
+                            return m.on_stream_data(err, data, size);
+                        });
+                        stratum::append_json_msg(m.protocol, stratum::Login("key"));
+                        m.flush();
+                    }
+                }, 10000);
+            }
+            break;
+
+        case 1:
+            if (!all_got_job("1")) {
+                return;
+            }
+
+            // job 2: the block difficulty is out of reach, the miners get it with the share difficulty (still 0)
+            pow.m_Difficulty.m_Packed = Difficulty::s_Inf - 1;
+            server->new_job("2", input, pow, h, onBlockFound, []() { return false; });
+            break;
+
+        case 2:
+            if (!all_got_job("2")) {
+                return;
+            }
+            check(miners[0].jobDifficulty == 0, "share difficulty");
+
+            // a share, a block, an invalid solution and an unknown job
+            miners[0].send_solutions("2", powValid, 1);
+            miners[0].send_solutions("1", powValid, 1);
+            miners[0].send_solutions("1", powInvalid, 1);
+            miners[0].send_solutions("3", powValid, 1);
+            break;
+
+        case 3:
+            if (get_total(solution_accepted) + get_total(solution_rejected) + get_total(solution_expired) < 4) {
+                return;
+            }
+            check(get_total(solution_accepted) == 2, "accepted");
+            check(get_total(solution_rejected) == 1, "invalid solution");
+            check(get_total(solution_expired) == 1, "unknown job");
+            check(blocksFound == 1, "only blocks are passed to the node");
+
+            // per-peer limit
+            miners[0].send_solutions("2", powValid, 12);
+            break;
+
+        case 4:
+            if (get_total(solution_accepted) + get_total(solution_rejected) < 2 + 1 + 12) {
+                return;
+            }
+            check(get_total(solution_accepted) == 2 + 8, "per-peer limit, accepted");
+            check(get_total(solution_rejected) == 1 + 4, "per-peer limit, rejected");
+
+            // disconnected while its shares are verified, they must not leak the per-thread limit
+            miners[s_Miners - 1].send_solutions("2", powValid, 8);
+            miners[s_Miners - 1].stream.reset();
+            resume_ms = GetTime_ms() + 1000; // the results are not visible, give the verifier a second
+            break;
+
+        case 5:
+            if (static_cast<int32_t>(GetTime_ms() - resume_ms) < 0) {
+                return;
+            }
+
+            // per-thread limit: all of them are parsed before any of them is verified
+            for (uint32_t i = 0; i < s_Miners - 1; i++) {
+                miners[i].send_solutions("2", powValid, (i < 4) ? 8 : 1);
+            }
+            break;
+
+        case 6:
+            if (get_total(solution_accepted) + get_total(solution_rejected) < 10 + 5 + 33) {
+                return;
+            }
+            check(get_total(solution_accepted) == 10 + 32, "per-thread limit, accepted");
+            check(get_total(solution_rejected) == 5 + 1, "per-thread limit, rejected");
+            check(blocksFound == 1, "shares are not blocks");
+            reactor->stop();
+            return;
+        }
+
+        stage++;
+    });
+
+    reactor->run();
+
+    check(stage == 6, "not completed");
+    return nErrors;
+}
+
 void gen_examples() {
     using namespace beam::stratum;
 
@@ -115,6 +409,8 @@ int main() {
 #endif
     auto logger = Logger::create(logLevel, logLevel);
     auto res = json_creation_test();
+    res += vardiff_test();
+    res += server_test();
     gen_examples();
     return res;
 }
@@ -133,6 +133,8 @@ namespace beam
         const char* STRATUM_PORT = "stratum_port";
         const char* STRATUM_SECRETS_PATH = "stratum_secrets_path";
         const char* STRATUM_USE_TLS = "stratum_use_tls";
+        const char* STRATUM_SHARE_INTERVAL = "stratum_share_interval";
+        const char* STRATUM_VERIFIER_THREADS = "stratum_verifier_threads";
         const char* WEBSOCKET_PORT = "websocket_port";
         const char* WEBSOCKET_SECRETS_PATH = "websocket_secrets_path";
         const char* WEBSOCKET_USE_TLS = "websocket_use_tls";
@@ -144,6 +146,8 @@ namespace beam
         const char* MINING_THREADS = "mining_threads";
         const char* POW_SOLVE_TIME = "pow_solve_time";
         const char* VERIFICATION_THREADS = "verification_threads";
+        const char* DB_READER_THREADS = "db_reader_threads";
+        const char* IO_THREADS = "io_threads";
         const char* NONCEPREFIX_DIGITS = "nonceprefix_digits";
         const char* NODE_PEER = "peer";
         const char* NODE_PEERS_PERSISTENT = "peers_persistent";
@@ -428,12 +432,16 @@ namespace beam
             (cli::POW_SOLVE_TIME, po::value<uint32_t>()->default_value(15 * 1000), "pow solve time. It works if FakePoW is enabled")
 
             (cli::VERIFICATION_THREADS, po::value<int>()->default_value(-1), "number of threads for cryptographic verifications (0 = single thread, -1 = auto)")
+            (cli::DB_READER_THREADS, po::value<uint32_t>()->default_value(0), "number of threads serving heavy read-only requests from the DB snapshot, switches the DB to WAL mode (0 = serve on the main thread)")
+            (cli::IO_THREADS, po::value<uint32_t>()->default_value(0), "number of threads decrypting and decoding the inbound peer traffic (0 = on the main thread)")
             (cli::NONCEPREFIX_DIGITS, po::value<unsigned>()->default_value(0), "number of hex digits for nonce prefix for stratum client (0..6)")
             (cli::NODE_PEER, po::value<vector<string>>()->multitoken(), "nodes to connect to")
             (cli::NODE_PEERS_PERSISTENT, po::value<bool>()->default_value(false), "Keep persistent connection to the specified peers, regardless to ratings")
             (cli::STRATUM_PORT, po::value<uint16_t>()->default_value(0), "port to start stratum server on")
             (cli::STRATUM_SECRETS_PATH, po::value<string>()->default_value("."), "path to stratum server api keys file, and tls certificate and private key")
             (cli::STRATUM_USE_TLS, po::value<bool>()->default_value(true), "enable TLS on startum server")
+            (cli::STRATUM_SHARE_INTERVAL, po::value<uint32_t>()->default_value(0), "stratum vardiff: target average time between shares of a miner (in seconds), 0 - accept block solutions only")
+            (cli::STRATUM_VERIFIER_THREADS, po::value<uint32_t>()->default_value(0), "number of stratum solution verification threads, 0 - number of cores")
             (cli::WEBSOCKET_PORT, po::value<uint16_t>()->default_value(0), "port to start websocket server on, it allows to communicate with node from web browser")
             (cli::WEBSOCKET_SECRETS_PATH, po::value<string>()->default_value("."), "path to websocket server api keys file, and tls certificate and private key")
             (cli::WEBSOCKET_USE_TLS, po::value<bool>()->default_value(true), "enable TLS on websocket server")
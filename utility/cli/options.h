@@ -35,6 +35,8 @@ namespace beam
         extern const char* STRATUM_PORT;
         extern const char* STRATUM_SECRETS_PATH;
         extern const char* STRATUM_USE_TLS;
+        extern const char* STRATUM_SHARE_INTERVAL;
+        extern const char* STRATUM_VERIFIER_THREADS;
         extern const char* WEBSOCKET_PORT;
         extern const char* WEBSOCKET_SECRETS_PATH;
         extern const char* WEBSOCKET_USE_TLS;
@@ -46,6 +48,8 @@ namespace beam
         extern const char* MINING_THREADS;
         extern const char* POW_SOLVE_TIME;
         extern const char* VERIFICATION_THREADS;
+        extern const char* DB_READER_THREADS;
+        extern const char* IO_THREADS;
         extern const char* NONCEPREFIX_DIGITS;
         extern const char* NODE_PEER;
         extern const char* NODE_PEERS_PERSISTENT;
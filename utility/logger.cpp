@@ -40,6 +40,11 @@ namespace fs = std::filesystem;
 #include <iostream>
 #include <fstream>
 #include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <chrono>
 #include <algorithm>
 
 namespace beam {
@@ -61,6 +66,20 @@ protected:
     std::string _timeFormat;
     bool _printMilliseconds;
 
+    mutex _cfgMutex; // header formatter and time format may be read by the writer thread
+    uint32_t _cfgVersion = 0;
+
+    // strftime is called once per second, the milliseconds are appended
+    struct TimestampCache {
+        uint64_t seconds = static_cast<uint64_t>(-1);
+        uint32_t cfgVersion = 0;
+        size_t size = 0;
+        char buf[MAX_TIMESTAMP_SIZE];
+    };
+
+    class Async;
+    std::unique_ptr<Async> _async;
+
     LoggerImpl(FILE* sink, int minLevel, int flushLevel) :
         _sink(sink),
         _minLevel(minLevel),
@@ -73,16 +92,19 @@ protected:
     }
 
     virtual ~LoggerImpl() {
+        stop_async();
         if (this == g_logger) {
             g_logger = 0;
         }
     }
 
     void set_header_formatter(LogMessageHeaderFormatter formatter) override {
+        lock_guard<mutex> lock(_cfgMutex);
         if (formatter) _headerFormatter = formatter;
     }
 
     void set_time_format(const char* format, bool printMilliseconds) override {
+        lock_guard<mutex> lock(_cfgMutex);
         if (format) {
             _timeFormat = format;
             _printMilliseconds = printMilliseconds;
@@ -90,17 +112,43 @@ protected:
             _timeFormat.clear();
             _printMilliseconds = false;
         }
+        _cfgVersion++;
     }
 
-    void write_message(const LogMessageHeader& header, const char* buf, size_t size) override {
+    void set_async(bool enable) override;
+
+    // must be called by the most derived class destructor, before the sinks are destroyed
+    void stop_async();
+
+    size_t format_header(char* headerFormatted, const LogMessageHeader& header, TimestampCache& tc) {
+        lock_guard<mutex> lock(_cfgMutex);
+
         char timestampFormatted[MAX_TIMESTAMP_SIZE];
-        char headerFormatted[MAX_HEADER_SIZE];
         if (!_timeFormat.empty()) {
-            format_timestamp(timestampFormatted, MAX_TIMESTAMP_SIZE, _timeFormat.c_str(), header.timestamp, _printMilliseconds);
+            uint64_t seconds = header.timestamp / 1000;
+            if ((tc.seconds != seconds) || (tc.cfgVersion != _cfgVersion)) {
+                tc.size = format_timestamp(tc.buf, MAX_TIMESTAMP_SIZE, _timeFormat.c_str(), seconds * 1000, false);
+                tc.seconds = seconds;
+                tc.cfgVersion = _cfgVersion;
+            }
+
+            memcpy(timestampFormatted, tc.buf, tc.size);
+            timestampFormatted[tc.size] = 0;
+            if (_printMilliseconds && MAX_TIMESTAMP_SIZE - tc.size > 4) {
+                snprintf(timestampFormatted + tc.size, 5, ".%03d", int(header.timestamp % 1000));
+            }
         } else {
             timestampFormatted[0] = 0;
         }
-        size_t headerSize = _headerFormatter(headerFormatted, MAX_HEADER_SIZE, timestampFormatted, header);
+        return _headerFormatter(headerFormatted, MAX_HEADER_SIZE, timestampFormatted, header);
+    }
+
+    void write_message(const LogMessageHeader& header, const char* buf, size_t size) override;
+
+    // formats and writes the message synchronously
+    virtual void write_formatted(const LogMessageHeader& header, const char* buf, size_t size, TimestampCache& tc) {
+        char headerFormatted[MAX_HEADER_SIZE];
+        size_t headerSize = format_header(headerFormatted, header, tc);
         write_impl(header.level, headerFormatted, headerSize, buf, size);
     }
 
@@ -122,14 +170,332 @@ public:
         fwrite(msg, 1, size, _sink);
         if (level >= _flushLevel) fflush(_sink);
     }
+
+    virtual void flush_sinks() {
+        lock_guard<mutex> lock(_mutex);
+        if (_sink) fflush(_sink);
+    }
+};
+
+// Background writer.
+// Each producer thread appends the raw messages (binary header + text) to its own single-producer/single-consumer ring.
+// The writer thread merges the rings by the global sequence number, formats the headers and writes to the sinks.
+// Messages of flush level and above are never dropped: the producer waits for the space, and then until it's written.
+// Lower levels are dropped if the ring is full, the writer reports the number of dropped messages.
+// The header file and func must be static strings (as they're from __FILE__ and __FUNCTION__).
+class LoggerImpl::Async {
+public:
+    static const uint32_t RING_SIZE = 0x20000; // must be a power of 2
+    static const uint32_t MAX_QUEUED_SIZE = RING_SIZE / 4; // larger messages are written synchronously
+    static const uint32_t MAX_OVERFLOW_YIELDS = 16; // before a low level message is dropped
+
+    explicit Async(LoggerImpl& logger) :
+        _logger(logger),
+        _generation(++g_generation)
+    {
+        _thread = std::thread(&Async::run_writer, this);
+    }
+
+    ~Async() {
+        {
+            lock_guard<mutex> lock(_mutex);
+            _run = false;
+        }
+        _cvWork.notify_one();
+        _thread.join();
+    }
+
+    void write(const LogMessageHeader& header, const char* buf, size_t size);
+
+private:
+    struct Rec {
+        uint32_t len; // total, aligned. 0 means the rest of the buffer is skipped
+        uint32_t size; // message text size
+        uint64_t seq;
+        LogMessageHeader header;
+    };
+
+    static_assert(!(sizeof(Rec) & 7), "");
+
+    struct Ring {
+        std::unique_ptr<uint8_t[]> buf{ new uint8_t[RING_SIZE] };
+        std::atomic<uint64_t> writePos{ 0 };
+        std::atomic<uint64_t> readPos{ 0 };
+        std::atomic<uint64_t> dropped{ 0 };
+        std::atomic<bool> closed{ false }; // the owning thread has exited
+
+        bool empty() const { return readPos.load() == writePos.load(); }
+        const Rec& front() const;
+    };
+
+    typedef std::shared_ptr<Ring> RingPtr;
+
+    struct ThreadRing {
+        uint64_t generation = 0;
+        RingPtr ring;
+
+        ~ThreadRing() {
+            if (ring) ring->closed = true;
+        }
+    };
+
+    static std::atomic<uint64_t> g_generation;
+    static std::atomic<uint64_t> g_seq;
+
+    LoggerImpl& _logger;
+    const uint64_t _generation;
+
+    mutex _mutex;
+    condition_variable _cvWork;
+    condition_variable _cvDone;
+    std::atomic<bool> _sleeping{ false };
+    std::atomic<uint32_t> _waiters{ 0 };
+    bool _run = true;
+
+    std::vector<RingPtr> _rings; // protected by _mutex
+    bool _ringsChanged = false;
+
+    std::thread _thread;
+
+    Ring& get_ring();
+    void wake_writer();
+    void wait_written(Ring&, uint64_t pos);
+
+    void run_writer();
+    bool write_all(std::vector<RingPtr>&, TimestampCache&);
+    bool has_pending();
 };
 
+std::atomic<uint64_t> LoggerImpl::Async::g_generation{ 0 };
+std::atomic<uint64_t> LoggerImpl::Async::g_seq{ 0 };
+
+const LoggerImpl::Async::Rec& LoggerImpl::Async::Ring::front() const {
+    uint64_t pos = readPos.load(std::memory_order_relaxed);
+    return *reinterpret_cast<const Rec*>(buf.get() + (pos & (RING_SIZE - 1)));
+}
+
+LoggerImpl::Async::Ring& LoggerImpl::Async::get_ring() {
+    static thread_local ThreadRing t;
+
+    if (!t.ring || (t.generation != _generation)) {
+        if (t.ring) t.ring->closed = true; // belongs to a previous logger
+
+        t.ring = std::make_shared<Ring>();
+        t.generation = _generation;
+
+        lock_guard<mutex> lock(_mutex);
+        _rings.push_back(t.ring);
+        _ringsChanged = true;
+    }
+
+    return *t.ring;
+}
+
+void LoggerImpl::Async::wake_writer() {
+    if (_sleeping.load()) {
+        lock_guard<mutex> lock(_mutex);
+        _cvWork.notify_one();
+    }
+}
+
+void LoggerImpl::Async::wait_written(Ring& r, uint64_t pos) {
+    unique_lock<mutex> lock(_mutex);
+    _waiters++;
+    _cvWork.notify_one();
+
+    while (_run && (r.readPos.load() < pos)) {
+        _cvDone.wait_for(lock, std::chrono::milliseconds(100));
+    }
+
+    _waiters--;
+}
+
+void LoggerImpl::Async::write(const LogMessageHeader& header, const char* buf, size_t size) {
+    Ring& r = get_ring();
+    bool important = (header.level >= _logger._flushLevel);
+
+    if (size > MAX_QUEUED_SIZE) {
+        // preserve the order of this thread messages, then write it directly
+        wait_written(r, r.writePos.load(std::memory_order_relaxed));
+
+        TimestampCache tc;
+        _logger.write_formatted(header, buf, size, tc);
+        return;
+    }
+
+    uint32_t len = static_cast<uint32_t>((sizeof(Rec) + size + 7) & ~static_cast<size_t>(7));
+
+    uint64_t pos = r.writePos.load(std::memory_order_relaxed);
+    uint32_t offset = static_cast<uint32_t>(pos & (RING_SIZE - 1));
+    uint32_t tail = RING_SIZE - offset;
+    uint32_t needed = (tail < len) ? (tail + len) : len;
+
+    for (uint32_t nYields = 0; pos + needed - r.readPos.load(std::memory_order_acquire) > RING_SIZE; nYields++) {
+        if (!important && (nYields >= MAX_OVERFLOW_YIELDS)) {
+            r.dropped++;
+            return;
+        }
+
+        wake_writer();
+        std::this_thread::yield();
+    }
+
+    uint8_t* p = r.buf.get();
+    if (tail < len) {
+        *reinterpret_cast<uint32_t*>(p + offset) = 0; // skip to the beginning
+        pos += tail;
+        offset = 0;
+    }
+
+    Rec& rec = *reinterpret_cast<Rec*>(p + offset);
+    rec.len = len;
+    rec.size = static_cast<uint32_t>(size);
+    rec.seq = ++g_seq;
+    memcpy(&rec.header, &header, sizeof(header));
+    memcpy(&rec + 1, buf, size);
+
+    pos += len;
+    r.writePos.store(pos);
+
+    if (important) {
+        wait_written(r, pos);
+    } else {
+        wake_writer();
+    }
+}
+
+bool LoggerImpl::Async::has_pending() {
+    for (const auto& r : _rings) {
+        if (!r->empty()) return true;
+    }
+    return false;
+}
+
+bool LoggerImpl::Async::write_all(std::vector<RingPtr>& rings, TimestampCache& tc) {
+    bool written = false;
+
+    while (true) {
+        // pick the oldest message
+        Ring* pMin = nullptr;
+        for (const auto& r : rings) {
+            if (r->empty()) continue;
+
+            const Rec& rec = r->front();
+            if (!rec.len) {
+                uint64_t pos = r->readPos.load(std::memory_order_relaxed);
+                r->readPos.store(pos + RING_SIZE - (pos & (RING_SIZE - 1)));
+                if (r->empty()) continue;
+            }
+
+            if (!pMin || (r->front().seq < pMin->front().seq)) {
+                pMin = r.get();
+            }
+        }
+
+        if (!pMin) break;
+
+        const Rec& rec = pMin->front();
+        _logger.write_formatted(rec.header, reinterpret_cast<const char*>(&rec + 1), rec.size, tc);
+        pMin->readPos.store(pMin->readPos.load(std::memory_order_relaxed) + rec.len);
+        written = true;
+    }
+
+    uint64_t dropped = 0;
+    for (const auto& r : rings) {
+        dropped += r->dropped.exchange(0);
+    }
+
+    if (dropped) {
+        LogMessageHeader header(LOG_LEVEL_WARNING, nullptr, 0, nullptr);
+        char msg[80];
+        int size = snprintf(msg, sizeof(msg), "%llu log messages dropped (queue overflow)\n", static_cast<unsigned long long>(dropped));
+        _logger.write_formatted(header, msg, size, tc);
+        written = true;
+    }
+
+    if (written && _waiters.load()) {
+        lock_guard<mutex> lock(_mutex);
+        _cvDone.notify_all();
+    }
+
+    return written;
+}
+
+void LoggerImpl::Async::run_writer() {
+    TimestampCache tc;
+    std::vector<RingPtr> rings;
+    bool unflushed = false;
+
+    while (true) {
+        if (write_all(rings, tc)) {
+            unflushed = true;
+            continue;
+        }
+
+        if (unflushed) {
+            _logger.flush_sinks();
+            unflushed = false;
+        }
+
+        unique_lock<mutex> lock(_mutex);
+
+        if (_ringsChanged) {
+            _ringsChanged = false;
+            rings = _rings;
+            continue;
+        }
+
+        // forget the rings of the exited threads
+        auto itEnd = std::remove_if(_rings.begin(), _rings.end(), [](const RingPtr& r) { return r->closed && r->empty(); });
+        if (_rings.end() != itEnd) {
+            _rings.erase(itEnd, _rings.end());
+            rings = _rings;
+        }
+
+        if (!_run && !has_pending()) break;
+
+        _sleeping = true;
+        if (!has_pending()) {
+            _cvWork.wait_for(lock, std::chrono::milliseconds(100));
+        }
+        _sleeping = false;
+    }
+}
+
+void LoggerImpl::set_async(bool enable) {
+#ifdef __EMSCRIPTEN__
+    enable = false;
+#endif // __EMSCRIPTEN__
+    if (!enable) {
+        stop_async();
+    } else if (!_async) {
+        _async = std::make_unique<Async>(*this);
+    }
+}
+
+void LoggerImpl::stop_async() {
+    _async.reset(); // the queued messages are written
+}
+
+void LoggerImpl::write_message(const LogMessageHeader& header, const char* buf, size_t size) {
+    if (_async) {
+        _async->write(header, buf, size);
+    } else {
+        TimestampCache tc;
+        write_formatted(header, buf, size, tc);
+    }
+}
+
 class ConsoleLogger : public LoggerImpl {
 public:
     ConsoleLogger(int flushLevel, int consoleLevel) :
         LoggerImpl(stdout, consoleLevel, flushLevel)
     {}
 
+    ~ConsoleLogger() {
+        stop_async();
+    }
+
     // does nothing for console
     void rotate() override {}
 };
@@ -153,6 +519,7 @@ public:
     }
 
     ~FileLogger() {
+        stop_async();
         fclose(_sink);
     }
 
@@ -231,15 +598,13 @@ public:
         _consoleSink(flushLevel, consoleLevel)
     {}
 
-    void write_message(const LogMessageHeader& header, const char* buf, size_t size) override {
-        char timestampFormatted[MAX_TIMESTAMP_SIZE];
+    ~CombinedLogger() {
+        stop_async();
+    }
+
+    void write_formatted(const LogMessageHeader& header, const char* buf, size_t size, TimestampCache& tc) override {
         char headerFormatted[MAX_HEADER_SIZE];
-        if (!_timeFormat.empty()) {
-            format_timestamp(timestampFormatted, MAX_TIMESTAMP_SIZE, _timeFormat.c_str(), header.timestamp, _printMilliseconds);
-        } else {
-            timestampFormatted[0] = 0;
-        }
-        size_t headerSize = _headerFormatter(headerFormatted, MAX_HEADER_SIZE, timestampFormatted, header);
+        size_t headerSize = format_header(headerFormatted, header, tc);
         if (_consoleSink.level_accepted(header.level)) {
             _consoleSink.write_impl(header.level, headerFormatted, headerSize, buf, size);
         }
@@ -248,6 +613,11 @@ public:
         }
     }
 
+    void flush_sinks() override {
+        _consoleSink.flush_sinks();
+        _fileSink.flush_sinks();
+    }
+
     const FileNameType& get_current_file_name() override {
         return _fileSink.get_current_file_name();
     }
@@ -289,6 +659,8 @@ std::shared_ptr<Logger> Logger::create(
             throw runtime_error("no logger sink configured");
     }
 
+    logger->set_async(true);
+
     g_logger = logger.get();
     return logger;
 }
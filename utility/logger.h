@@ -167,6 +167,12 @@ public:
     /// Rotates file name, called externally
     virtual void rotate() = 0;
 
+    /// Enables/disables the background writer (enabled by default).
+    /// When enabled, each thread queues its messages in its own buffer, and a dedicated thread formats and writes them.
+    /// Messages of flush level and above are written before the logging statement returns. Lower levels are dropped
+    /// if the thread buffer overflows, the number of dropped messages is reported in the log.
+    virtual void set_async(bool enable) = 0;
+
     static bool will_log(int level) {
         return g_logger && g_logger->level_accepted(level);
     }
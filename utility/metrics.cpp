@@ -0,0 +1,201 @@
+// Copyright 2018 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "metrics.h"
+#include <chrono>
+
+namespace beam {
+namespace Metrics
+{
+	/////////////////////////////
+	// Registry
+	Metric::Metric(Registry& r, const char* szName, const char* szHelp)
+		:m_szName(szName)
+		,m_szHelp(szHelp)
+		,m_pNext(nullptr)
+	{
+		r.Add(*this);
+	}
+
+	void Registry::Add(Metric& m)
+	{
+		Metric* pHead = m_pHead.load(std::memory_order_relaxed);
+		do
+			m.m_pNext = pHead;
+		while (!m_pHead.compare_exchange_weak(pHead, &m, std::memory_order_release, std::memory_order_relaxed));
+	}
+
+	void Registry::WritePrometheus(std::ostream& os) const
+	{
+		for (const Metric* p = m_pHead.load(std::memory_order_acquire); p; p = p->m_pNext)
+		{
+			os << "# HELP " << p->m_szName << ' ' << p->m_szHelp << '\n';
+			os << "# TYPE " << p->m_szName << ' ' << p->get_Type() << '\n';
+			p->Write(os);
+		}
+	}
+
+	Registry& Registry::get()
+	{
+		static Registry s_Registry;
+		return s_Registry;
+	}
+
+	uint64_t get_Time_us()
+	{
+		return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	/////////////////////////////
+	// Counter, Gauge
+	void Counter::Write(std::ostream& os) const
+	{
+		os << m_szName << ' ' << get() << '\n';
+	}
+
+	void Gauge::Write(std::ostream& os) const
+	{
+		os << m_szName << ' ' << get() << '\n';
+	}
+
+	/////////////////////////////
+	// CounterVec
+	CounterVec::CounterVec(const char* szName, const char* szHelp, const char* szLabel, NameFunc pfnName /* = nullptr */, Registry& r /* = Registry::get() */)
+		:Metric(r, szName, szHelp)
+		,m_szLabel(szLabel)
+		,m_pfnName(pfnName)
+	{
+		for (uint32_t i = 0; i < s_Count; i++)
+			m_pValue[i].store(0, std::memory_order_relaxed);
+	}
+
+	void CounterVec::Write(std::ostream& os) const
+	{
+		for (uint32_t i = 0; i < s_Count; i++)
+		{
+			uint64_t val = get(i);
+			if (!val)
+				continue;
+
+			os << m_szName << '{' << m_szLabel << "=\"";
+
+			const char* sz = m_pfnName ? m_pfnName(i) : nullptr;
+			if (sz)
+				os << sz;
+			else
+				os << i;
+
+			os << "\"} " << val << '\n';
+		}
+	}
+
+	/////////////////////////////
+	// Histogram
+	Histogram::Histogram(const char* szName, const char* szHelp, Registry& r /* = Registry::get() */)
+		:Metric(r, szName, szHelp)
+	{
+		for (uint32_t i = 0; i < s_Buckets; i++)
+			m_pBucket[i].store(0, std::memory_order_relaxed);
+	}
+
+	uint32_t Histogram::get_Bucket(uint64_t val)
+	{
+		if (val < s_Sub)
+			return static_cast<uint32_t>(val);
+
+		uint32_t nMsb = 0;
+		for (uint32_t nStep = 32; nStep; nStep >>= 1)
+		{
+			if (val >> (nMsb + nStep))
+				nMsb += nStep;
+		}
+
+		uint32_t nShift = nMsb - s_SubBits;
+		return ((nShift + 1) << s_SubBits) + static_cast<uint32_t>((val >> nShift) & (s_Sub - 1));
+	}
+
+	uint64_t Histogram::get_BucketMax(uint32_t iBucket)
+	{
+		if (iBucket < s_Sub)
+			return iBucket;
+
+		uint32_t nShift = (iBucket >> s_SubBits) - 1;
+		uint64_t nLo = static_cast<uint64_t>(s_Sub + (iBucket & (s_Sub - 1))) << nShift;
+		return nLo + ((static_cast<uint64_t>(1) << nShift) - 1);
+	}
+
+	void Histogram::Add(uint64_t val)
+	{
+		m_pBucket[get_Bucket(val)].fetch_add(1, std::memory_order_relaxed);
+		m_Sum.fetch_add(val, std::memory_order_relaxed);
+		m_Count.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	uint64_t Histogram::get_Quantile(double q) const
+	{
+		uint64_t nCount = get_Count();
+		if (!nCount)
+			return 0;
+
+		uint64_t nRank = static_cast<uint64_t>(q * nCount);
+		if (nRank >= nCount)
+			nRank = nCount - 1;
+
+		uint64_t nAcc = 0;
+		for (uint32_t i = 0; i < s_Buckets; i++)
+		{
+			nAcc += m_pBucket[i].load(std::memory_order_relaxed);
+			if (nAcc > nRank)
+				return get_BucketMax(i);
+		}
+
+		return static_cast<uint64_t>(-1); // the buckets are updated concurrently and may lag behind the total count
+	}
+
+	void Histogram::Write(std::ostream& os) const
+	{
+		// a fixed set of bounds (ends of the power-of-2 ranges), so that the series don't depend on the observed values
+		uint64_t nAcc = 0;
+		uint32_t iBucket = 0;
+
+		for (uint32_t nBits = 0; nBits <= s_WriteBits; nBits++)
+		{
+			uint64_t nBound = (static_cast<uint64_t>(1) << nBits) - 1;
+			for (; (iBucket < s_Buckets) && (get_BucketMax(iBucket) <= nBound); iBucket++)
+				nAcc += m_pBucket[iBucket].load(std::memory_order_relaxed);
+
+			os << m_szName << "_bucket{le=\"" << nBound << "\"} " << nAcc << '\n';
+		}
+
+		for (; iBucket < s_Buckets; iBucket++)
+			nAcc += m_pBucket[iBucket].load(std::memory_order_relaxed);
+
+		os << m_szName << "_bucket{le=\"+Inf\"} " << nAcc << '\n';
+		os << m_szName << "_sum " << get_Sum() << '\n';
+		os << m_szName << "_count " << nAcc << '\n';
+	}
+
+	Histogram::Scope::Scope(Histogram& h)
+		:m_Hist(h)
+		,m_t0_us(get_Time_us())
+	{
+	}
+
+	Histogram::Scope::~Scope()
+	{
+		m_Hist.Add(get_Time_us() - m_t0_us);
+	}
+
+} // namespace Metrics
+} // namespace beam
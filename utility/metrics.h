@@ -0,0 +1,151 @@
+// Copyright 2018 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+
+namespace beam {
+namespace Metrics
+{
+	// Lock-free counters, gauges and histograms. Updates are relaxed atomics, safe from any thread.
+	// Metrics are registered on construction and are never removed, hence they must outlive the registry readers
+	// (normally they're objects with static storage duration, registered in the global registry).
+	struct Registry;
+
+	struct Metric
+	{
+		const char* m_szName;
+		const char* m_szHelp;
+		Metric* m_pNext;
+
+		Metric(Registry&, const char* szName, const char* szHelp);
+		virtual ~Metric() = default;
+
+		virtual const char* get_Type() const = 0;
+		virtual void Write(std::ostream&) const = 0;
+	};
+
+	struct Registry
+	{
+		std::atomic<Metric*> m_pHead = { nullptr };
+
+		void Add(Metric&);
+		void WritePrometheus(std::ostream&) const; // text exposition format, version 0.0.4
+
+		static Registry& get(); // process-wide
+	};
+
+	struct Counter
+		:public Metric
+	{
+		std::atomic<uint64_t> m_Value = { 0 };
+
+		Counter(const char* szName, const char* szHelp, Registry& r = Registry::get())
+			:Metric(r, szName, szHelp)
+		{
+		}
+
+		void Inc(uint64_t n = 1) { m_Value.fetch_add(n, std::memory_order_relaxed); }
+		uint64_t get() const { return m_Value.load(std::memory_order_relaxed); }
+
+		virtual const char* get_Type() const override { return "counter"; }
+		virtual void Write(std::ostream&) const override;
+	};
+
+	struct Gauge
+		:public Metric
+	{
+		std::atomic<int64_t> m_Value = { 0 };
+
+		Gauge(const char* szName, const char* szHelp, Registry& r = Registry::get())
+			:Metric(r, szName, szHelp)
+		{
+		}
+
+		void Set(int64_t n) { m_Value.store(n, std::memory_order_relaxed); }
+		void Add(int64_t n) { m_Value.fetch_add(n, std::memory_order_relaxed); }
+		int64_t get() const { return m_Value.load(std::memory_order_relaxed); }
+
+		virtual const char* get_Type() const override { return "gauge"; }
+		virtual void Write(std::ostream&) const override;
+	};
+
+	// Counters indexed by a small integer (message code, status code, etc.), exposed with a single label.
+	// Indexes for which the name callback returns nullptr are written as numbers.
+	struct CounterVec
+		:public Metric
+	{
+		static const uint32_t s_Count = 0x100;
+
+		typedef const char* (*NameFunc)(uint32_t);
+
+		const char* m_szLabel;
+		NameFunc m_pfnName;
+		std::atomic<uint64_t> m_pValue[s_Count];
+
+		CounterVec(const char* szName, const char* szHelp, const char* szLabel, NameFunc pfnName = nullptr, Registry& r = Registry::get());
+
+		void Inc(uint32_t i, uint64_t n = 1) { m_pValue[i % s_Count].fetch_add(n, std::memory_order_relaxed); }
+		uint64_t get(uint32_t i) const { return m_pValue[i % s_Count].load(std::memory_order_relaxed); }
+
+		virtual const char* get_Type() const override { return "counter"; }
+		virtual void Write(std::ostream&) const override;
+	};
+
+	// HDR-style histogram of non-negative integer samples: power-of-2 ranges, each split into 4 linear sub-buckets,
+	// so that the relative error of any reported quantile is below 25% across the whole uint64_t range.
+	struct Histogram
+		:public Metric
+	{
+		static const uint32_t s_SubBits = 2;
+		static const uint32_t s_Sub = 1U << s_SubBits;
+		static const uint32_t s_Buckets = (64 - s_SubBits + 1) * s_Sub;
+		static const uint32_t s_WriteBits = 40; // written bounds are 2^n-1 for n = 0..40, i.e. up to ~12 days in microseconds
+
+		std::atomic<uint64_t> m_pBucket[s_Buckets];
+		std::atomic<uint64_t> m_Count = { 0 };
+		std::atomic<uint64_t> m_Sum = { 0 };
+
+		Histogram(const char* szName, const char* szHelp, Registry& r = Registry::get());
+
+		void Add(uint64_t);
+
+		uint64_t get_Count() const { return m_Count.load(std::memory_order_relaxed); }
+		uint64_t get_Sum() const { return m_Sum.load(std::memory_order_relaxed); }
+		uint64_t get_Quantile(double) const; // upper bound of the bucket that contains the quantile
+
+		static uint32_t get_Bucket(uint64_t);
+		static uint64_t get_BucketMax(uint32_t); // inclusive
+
+		virtual const char* get_Type() const override { return "histogram"; }
+		virtual void Write(std::ostream&) const override;
+
+		// Measures the scope duration in microseconds
+		struct Scope
+		{
+			Histogram& m_Hist;
+			uint64_t m_t0_us;
+
+			Scope(Histogram&);
+			~Scope();
+		};
+	};
+
+	uint64_t get_Time_us(); // monotonic
+
+} // namespace Metrics
+} // namespace beam
@@ -15,9 +15,23 @@
 #include "utility/logger_checkpoints.h"
 #include "utility/helpers.h"
 #include <thread>
+#include <vector>
+#include <fstream>
+#include <cstdio>
 
 using namespace beam;
 
+static int error_count = 0;
+
+#define CHECK(s) \
+do {\
+    assert(s);\
+    if (!(s)) {\
+        ++error_count;\
+    }\
+} while(false)\
+
+
 struct XXX {
     int z = 333;
 };
@@ -79,6 +93,62 @@ void test_ndc_2(bool exc)
     }
 }
 
+void test_logger_async() {
+    const int nThreads = 4;
+    const int nMsgs = 5000;
+
+    Logger::FileNameType fileName;
+    {
+        auto logger = Logger::create(LOG_LEVEL_WARNING, LOG_SINK_DISABLED, LOG_LEVEL_INFO, "AsyncTest");
+        logger->set_header_formatter(custom_header_formatter);
+        fileName = logger->get_current_file_name();
+
+        std::vector<std::thread> threads;
+        for (int i = 0; i < nThreads; i++) {
+            threads.emplace_back([i]() {
+                for (int j = 0; j < nMsgs; j++) {
+                    LOG_INFO() << "thread " << i << " msg " << j;
+                }
+                LOG_WARNING() << "thread " << i << " done";
+            });
+        }
+
+        for (auto& t : threads) {
+            t.join();
+        }
+    } // the logger writes all the queued messages on destruction
+
+    std::ifstream f(fileName);
+    CHECK(f.good());
+
+    int pLast[nThreads];
+    std::fill_n(pLast, nThreads, -1);
+    int nWritten = 0, nDone = 0;
+    unsigned long long nDropped = 0;
+
+    std::string line;
+    while (std::getline(f, line)) {
+        int i, j;
+        unsigned long long n;
+        if (sscanf(line.c_str(), "I %*s thread %d msg %d", &i, &j) == 2) {
+            CHECK(i >= 0 && i < nThreads);
+            CHECK(j > pLast[i]); // per-thread order is preserved
+            pLast[i] = j;
+            nWritten++;
+        } else if (sscanf(line.c_str(), "W %*s %llu log messages dropped", &n) == 1) {
+            nDropped += n;
+        } else if (line.find(" done") != std::string::npos) {
+            nDone++;
+        }
+    }
+
+    CHECK(nDone == nThreads);
+    CHECK(nWritten + nDropped == nThreads * nMsgs);
+
+    f.close();
+    std::remove(std::string(fileName.begin(), fileName.end()).c_str());
+}
+
 int main() {
     test_logger_1();
     test_ndc_1();
@@ -87,4 +157,6 @@ int main() {
         test_ndc_2(true);
     }
     catch(...) {}
+    test_logger_async();
+    return error_count;
 }
@@ -416,16 +416,19 @@ namespace beam::wallet
 
         struct Outputs
         {
-            std::vector<IPrivateKeyKeeper2::Method::CreateOutput> m_vMethods;
+            IPrivateKeyKeeper2::Method::CreateOutputs m_Method; // all the outputs are created in a single (batched) call
             std::vector<Output::Ptr> m_Done;
 
-            bool IsAllDone() const { return m_vMethods.size() == m_Done.size(); }
+            bool IsAllDone() const { return m_Method.m_vOutputs.size() == m_Done.size(); }
 
             bool OnNext()
             {
-                size_t iDone = m_Done.size();
-                assert(m_vMethods[iDone].m_pResult);
-                m_Done.push_back(std::move(m_vMethods[iDone].m_pResult));
+                for (auto& m : m_Method.m_vOutputs)
+                {
+                    if (!m.m_pResult)
+                        return false;
+                    m_Done.push_back(std::move(m.m_pResult));
+                }
                 return true;
             }
 
@@ -601,16 +604,19 @@ namespace beam::wallet
         HandlerInOuts& x = Cast::Up<HandlerInOuts>(*pHandler);
 
         // outputs
-        x.m_Outputs.m_vMethods.resize(m_Coins.m_Output.size());
+        auto& vOuts = x.m_Outputs.m_Method.m_vOutputs;
+        vOuts.resize(m_Coins.m_Output.size());
         x.m_Outputs.m_Done.reserve(m_Coins.m_Output.size());
         for (size_t i = 0; i < m_Coins.m_Output.size(); i++)
         {
-            x.m_Outputs.m_vMethods[i].m_hScheme = m_Height.m_Min;
-            x.m_Outputs.m_vMethods[i].m_Cid = m_Coins.m_Output[i];
-            FillUserData(Output::User::ToPacked(x.m_Outputs.m_vMethods[i].m_User));
-            m_Tx.get_KeyKeeperStrict()->InvokeAsync(x.m_Outputs.m_vMethods[i], pHandler);
+            vOuts[i].m_hScheme = m_Height.m_Min;
+            vOuts[i].m_Cid = m_Coins.m_Output[i];
+            FillUserData(Output::User::ToPacked(vOuts[i].m_User));
         }
 
+        if (!vOuts.empty())
+            m_Tx.get_KeyKeeperStrict()->InvokeAsync(x.m_Outputs.m_Method, pHandler);
+
         // inputs
         x.m_Inputs.m_vMethods.resize(m_Coins.m_Input.size());
         x.m_Inputs.m_Done.reserve(m_Coins.m_Input.size());
@@ -14,9 +14,115 @@
 #include <boost/scope_exit.hpp>
 #include "shaders_manager.h"
 #include "utility/logger.h"
+#include "version.h"
 
 namespace beam::wallet {
 
+    const char CompiledShaderCache::s_szIndexName[] = "app_sh_bin_index";
+
+    CompiledShaderCache& CompiledShaderCache::get()
+    {
+        static CompiledShaderCache s_Cache;
+        return s_Cache;
+    }
+
+    void CompiledShaderCache::get_Key(ECC::Hash::Value& hv, const Blob& src)
+    {
+        ECC::Hash::Processor()
+            << "app.shader.compiled"
+            << bvm2::Processor::s_CompilerVersion
+            << PROJECT_VERSION
+            << GIT_COMMIT_HASH // the compiled code may differ across builds even with the same compiler version
+            << src
+            >> hv;
+    }
+
+    bool CompiledShaderCache::Find(const ECC::Hash::Value& hv, ByteBuffer& res, const IWalletDB& db)
+    {
+        {
+            std::unique_lock<std::mutex> scope(m_Mutex);
+
+            for (auto it = m_Items.begin(); m_Items.end() != it; it++)
+            {
+                if (it->m_Key == hv)
+                {
+                    m_Items.splice(m_Items.begin(), m_Items, it);
+                    res = it->m_Body;
+                    return true;
+                }
+            }
+        }
+
+        VarName vn(hv);
+        if (!db.getBlob(vn.m_sz, res) || res.empty())
+            return false;
+
+        InsertMem(hv, res);
+        return true;
+    }
+
+    void CompiledShaderCache::Insert(const ECC::Hash::Value& hv, const ByteBuffer& body, IWalletDB& db)
+    {
+        VarName vn(hv);
+        db.setVarRaw(vn.m_sz, body.data(), body.size());
+
+        UpdateIndexDB(hv, db);
+        InsertMem(hv, body);
+    }
+
+    void CompiledShaderCache::ClearMem()
+    {
+        std::unique_lock<std::mutex> scope(m_Mutex);
+        m_Items.clear();
+    }
+
+    void CompiledShaderCache::UpdateIndexDB(const ECC::Hash::Value& hv, IWalletDB& db)
+    {
+        std::vector<ECC::Hash::Value> vKeys;
+
+        ByteBuffer buf;
+        if (db.getBlob(s_szIndexName, buf))
+        {
+            size_t n = buf.size() / ECC::Hash::Value::nBytes;
+            vKeys.reserve(n + 1);
+
+            for (size_t i = 0; i < n; i++)
+            {
+                ECC::Hash::Value& hvKey = vKeys.emplace_back();
+                memcpy(hvKey.m_pData, &buf.front() + i * hvKey.nBytes, hvKey.nBytes);
+                if (hvKey == hv)
+                    vKeys.pop_back();
+            }
+        }
+
+        vKeys.insert(vKeys.begin(), hv);
+
+        while (vKeys.size() > s_MaxItemsDB)
+        {
+            VarName vn(vKeys.back());
+            db.removeVarRaw(vn.m_sz);
+            vKeys.pop_back();
+        }
+
+        db.setVarRaw(s_szIndexName, &vKeys.front(), vKeys.size() * ECC::Hash::Value::nBytes);
+    }
+
+    void CompiledShaderCache::InsertMem(const ECC::Hash::Value& hv, const ByteBuffer& body)
+    {
+        std::unique_lock<std::mutex> scope(m_Mutex);
+
+        for (const auto& x : m_Items)
+            if (x.m_Key == hv)
+                return;
+
+        m_Items.emplace_front();
+        m_Items.front().m_Key = hv;
+        m_Items.front().m_Body = body;
+
+        if (m_Items.size() > s_MaxItems)
+            m_Items.pop_back();
+    }
+
     struct ManagerStdInWallet::SlotName
     {
 #define SLOT_PREFIX_NAME "app_sh_slot_"
@@ -40,6 +146,8 @@ namespace beam::wallet {
 
         m_pNetwork = m_pWallet->GetNodeEndpoint();
         assert(m_pNetwork);
+
+        m_pReadCache = m_pWallet->GetContractReadCache();
     }
 
     ManagerStdInWallet::~ManagerStdInWallet()
@@ -72,6 +180,21 @@ namespace beam::wallet {
         m_pWalletDB->removeVarRaw(sn.m_sz);
     }
 
+    void ManagerStdInWallet::CompileAppShader(const Blob& shader)
+    {
+        auto& cache = CompiledShaderCache::get();
+
+        ECC::Hash::Value hv;
+        cache.get_Key(hv, shader);
+        if (cache.Find(hv, m_BodyManager, *m_pWalletDB))
+            return;
+
+        // this throws
+        bvm2::Processor::Compile(m_BodyManager, shader, ManagerStd::Kind::Manager);
+
+        cache.Insert(hv, m_BodyManager, *m_pWalletDB);
+    }
+
     struct ManagerStdInWallet::Channel
         :public ManagerStd::Comm::Channel
     {
@@ -180,11 +303,8 @@ namespace beam::wallet {
             throw std::runtime_error("empty code buffer in ::Compile");
         }
 
-        auto &resBuffer = m_BodyManager;
-        beam::Blob shaderBlob(shader);
-
         // this throws
-        beam::bvm2::Processor::Compile(resBuffer, shaderBlob, ManagerStd::Kind::Manager);
+        CompileAppShader(shader);
     }
 
     void ShadersManager::pushRequest(Request newReq)
@@ -16,9 +16,55 @@
 #include "utility/logger.h"
 #include "i_shaders_manager.h"
 #include "bvm/ManagerStd.h"
+#include <list>
+#include <mutex>
 
 namespace beam::wallet {
 
+    // Compiled app shaders, keyed by the hash of the source Wasm, the compiler version and the build.
+    // Recently used are kept in memory (shared by all the wallets in the process), and in the wallet DB.
+    // The DB entries are listed in a separate variable (most recently used first), the ones beyond the limit are erased.
+    struct CompiledShaderCache
+    {
+        static const size_t s_MaxItems = 16;
+        static const size_t s_MaxItemsDB = 32;
+
+        static const char s_szIndexName[];
+
+        struct VarName
+        {
+#define COMPILED_PREFIX_NAME "app_sh_bin_"
+            char m_sz[_countof(COMPILED_PREFIX_NAME) + ECC::Hash::Value::nTxtLen];
+
+            VarName(const ECC::Hash::Value& hv)
+            {
+                memcpy(m_sz, COMPILED_PREFIX_NAME, sizeof(COMPILED_PREFIX_NAME) - sizeof(char));
+                hv.Print(m_sz + _countof(COMPILED_PREFIX_NAME) - 1);
+            }
+        };
+
+        static CompiledShaderCache& get();
+        static void get_Key(ECC::Hash::Value&, const Blob& src);
+
+        bool Find(const ECC::Hash::Value&, ByteBuffer& res, const IWalletDB&);
+        void Insert(const ECC::Hash::Value&, const ByteBuffer& body, IWalletDB&);
+        void ClearMem();
+
+    private:
+
+        struct Item
+        {
+            ECC::Hash::Value m_Key;
+            ByteBuffer m_Body;
+        };
+
+        std::mutex m_Mutex;
+        std::list<Item> m_Items; // most recently used first
+
+        static void UpdateIndexDB(const ECC::Hash::Value&, IWalletDB&);
+        void InsertMem(const ECC::Hash::Value&, const ByteBuffer& body);
+    };
+
     struct ManagerStdInWallet
         :public bvm2::ManagerStd
     {
@@ -38,6 +84,9 @@ namespace beam::wallet {
 
         void TestCommAllowed() const;
 
+        // compiles into m_BodyManager, reuses the cached result if available. Throws on error
+        void CompileAppShader(const Blob&);
+
         bool SlotLoad(ECC::Hash::Value&, uint32_t iSlot) override;
         void SlotSave(const ECC::Hash::Value&, uint32_t iSlot) override;
         void SlotErase(uint32_t iSlot) override;
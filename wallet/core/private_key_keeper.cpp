@@ -70,6 +70,48 @@ namespace beam::wallet
 	KEY_KEEPER_METHODS(THE_MACRO)
 #undef THE_MACRO
 
+	IPrivateKeyKeeper2::Status::Type IPrivateKeyKeeper2::InvokeSync(Method::CreateOutputs& m)
+	{
+		for (auto& x : m.m_vOutputs)
+		{
+			Status::Type ret = InvokeSync(x);
+			if (Status::Success != ret)
+				return ret;
+		}
+
+		return Status::Success;
+	}
+
+	void IPrivateKeyKeeper2::InvokeAsync(Method::CreateOutputs& m, const Handler::Ptr& pHandler)
+	{
+		struct MyHandler
+			:public Handler
+		{
+			Handler::Ptr m_pNext;
+			size_t m_Pending;
+			Status::Type m_Status = Status::Success;
+
+			virtual void OnDone(Status::Type n) override
+			{
+				if (Status::Success == m_Status)
+					m_Status = n;
+
+				assert(m_Pending);
+				if (!--m_Pending)
+					m_pNext->OnDone(m_Status);
+			}
+		};
+
+		assert(!m.m_vOutputs.empty());
+
+		auto p = std::make_shared<MyHandler>();
+		p->m_pNext = pHandler;
+		p->m_Pending = m.m_vOutputs.size();
+
+		for (auto& x : m.m_vOutputs)
+			InvokeAsync(x, p);
+	}
+
 	////////////////////////////////
 	// misc
 	IPrivateKeyKeeper2::Status::Type IPrivateKeyKeeper2::get_Commitment(ECC::Point::Native& res, const CoinID& cid)
@@ -184,16 +226,47 @@ namespace beam::wallet
 	KEY_KEEPER_METHODS(THE_MACRO)
 #undef THE_MACRO
 
+	void PrivateKeyKeeper_AsyncNotify::InvokeAsync(Method::CreateOutputs& m, const Handler::Ptr& p)
+	{
+		Status::Type res = InvokeSync(m);
+		PushOut(res, p);
+	}
+
 	////////////////////////////////
 	// ThreadedPrivateKeyKeeper
 	void ThreadedPrivateKeyKeeper::PushIn(Task::Ptr& p)
 	{
 		std::unique_lock<std::mutex> scope(m_MutexIn);
 
+		Cast::Up<Task>(*p).m_Seq = m_SeqIn++;
+
 		if (m_queIn.Push(p))
 			m_NewIn.notify_one();
 	}
 
+	void ThreadedPrivateKeyKeeper::OnTaskDone(Task::Ptr& pTask)
+	{
+		// must be called with m_MutexIn locked. Report completions in the invocation order
+		uint64_t nSeq = Cast::Up<Task>(*pTask).m_Seq;
+		if (nSeq != m_SeqOut)
+		{
+			m_mapDone[nSeq] = std::move(pTask);
+			return;
+		}
+
+		PushOut(pTask);
+
+		for (m_SeqOut++; !m_mapDone.empty(); m_SeqOut++)
+		{
+			auto it = m_mapDone.begin();
+			if (it->first != m_SeqOut)
+				break;
+
+			PushOut(it->second);
+			m_mapDone.erase(it);
+		}
+	}
+
 	void ThreadedPrivateKeyKeeper::Thread(const Rules& r)
 	{
 		Rules::Scope scopeRules(r);
@@ -220,32 +293,51 @@ namespace beam::wallet
 			}
 
 			assert(pTask);
-			Cast::Up<Task>(*pTask).Exec(*m_pKeyKeeper);
+			Task& t = Cast::Up<Task>(*pTask);
 
-			PushOut(pTask);
+			if (t.m_Stateless)
+				t.Exec(*m_pKeyKeeper);
+			else
+			{
+				std::unique_lock<std::mutex> scope(m_MutexState);
+				t.Exec(*m_pKeyKeeper);
+			}
+
+			std::unique_lock<std::mutex> scope(m_MutexIn);
+			OnTaskDone(pTask);
 		}
 	}
 
-	ThreadedPrivateKeyKeeper::ThreadedPrivateKeyKeeper(const IPrivateKeyKeeper2::Ptr& p)
+	ThreadedPrivateKeyKeeper::ThreadedPrivateKeyKeeper(const IPrivateKeyKeeper2::Ptr& p, uint32_t nWorkers)
 		:m_pKeyKeeper(p)
 	{
 		EnsureEvtOut();
-		m_Thread = MyThread(&ThreadedPrivateKeyKeeper::Thread, this, Rules::get());
+
+		m_vThreads.resize(std::max(nWorkers, 1U));
+		for (auto& t : m_vThreads)
+			t = MyThread(&ThreadedPrivateKeyKeeper::Thread, this, Rules::get());
 	}
 
 	ThreadedPrivateKeyKeeper::~ThreadedPrivateKeyKeeper()
 	{
-		if (m_Thread.joinable())
 		{
-			{
-				std::unique_lock<std::mutex> scope(m_MutexIn);
-				m_Run = false;
-				m_NewIn.notify_one();
-			}
-			m_Thread.join();
+			std::unique_lock<std::mutex> scope(m_MutexIn);
+			m_Run = false;
+			m_NewIn.notify_all();
 		}
+
+		for (auto& t : m_vThreads)
+			if (t.joinable())
+				t.join();
 	}
 
+	template <typename TMethod> struct KeyKeeperMethodStateless { static const bool s_Value = false; };
+	template <> struct KeyKeeperMethodStateless<IPrivateKeyKeeper2::Method::get_Kdf> { static const bool s_Value = true; };
+	template <> struct KeyKeeperMethodStateless<IPrivateKeyKeeper2::Method::CreateOutput> { static const bool s_Value = true; };
+	template <> struct KeyKeeperMethodStateless<IPrivateKeyKeeper2::Method::CreateOutputs> { static const bool s_Value = true; };
+	template <> struct KeyKeeperMethodStateless<IPrivateKeyKeeper2::Method::CreateInputShielded> { static const bool s_Value = true; };
+	template <> struct KeyKeeperMethodStateless<IPrivateKeyKeeper2::Method::CreateVoucherShielded> { static const bool s_Value = true; };
+
 	template <typename TMethod>
 	void ThreadedPrivateKeyKeeper::InvokeAsyncInternal(TMethod& m, const Handler::Ptr& pHandler)
 	{
@@ -257,6 +349,7 @@ namespace beam::wallet
 		Task::Ptr pTask = std::make_unique<MyTask>();
 		pTask->m_pHandler = pHandler;
 		Cast::Up<MyTask>(*pTask).m_pM = &m;
+		Cast::Up<MyTask>(*pTask).m_Stateless = KeyKeeperMethodStateless<TMethod>::s_Value;
 
 		PushIn(pTask);
 	}
@@ -270,6 +363,11 @@ namespace beam::wallet
 	KEY_KEEPER_METHODS(THE_MACRO)
 #undef THE_MACRO
 
+	void ThreadedPrivateKeyKeeper::InvokeAsync(Method::CreateOutputs& m, const Handler::Ptr& pHandler)
+	{
+		InvokeAsyncInternal<Method::CreateOutputs>(m, pHandler);
+	}
+
 
 
 } // namespace beam::wallet
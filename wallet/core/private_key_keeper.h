@@ -93,6 +93,10 @@ namespace beam::wallet
                 CreateOutput() { ZeroObject(m_User); }
             };
 
+            struct CreateOutputs {
+                std::vector<CreateOutput> m_vOutputs; // on success all the results are set
+            };
+
             struct CreateInputShielded
                 :public ShieldedTxo::ID
             {
@@ -184,6 +188,10 @@ namespace beam::wallet
         KEY_KEEPER_METHODS(THE_MACRO)
 #undef THE_MACRO
 
+        // batched CreateOutput. By default emulated by the individual invocations
+        virtual Status::Type InvokeSync(Method::CreateOutputs&);
+        virtual void InvokeAsync(Method::CreateOutputs&, const Handler::Ptr&);
+
         virtual ~IPrivateKeyKeeper2() {}
 
         // synthetic functions (in terms of underlying ones)
@@ -253,33 +261,45 @@ namespace beam::wallet
 		KEY_KEEPER_METHODS(THE_MACRO)
 #undef THE_MACRO
 
+		void InvokeAsync(Method::CreateOutputs& m, const Handler::Ptr& pHandler) override;
 	};
 
+	// Runs the underlying (synchronous) key keeper on worker threads.
+	// With several workers the methods that don't modify the key keeper state (get_Kdf, CreateOutput(s), CreateInputShielded, CreateVoucherShielded)
+	// may run concurrently, the rest are serialized. The completions are reported in the invocation order anyway.
 	class ThreadedPrivateKeyKeeper
 		:public PrivateKeyKeeper_WithMarshaller
 	{
         IPrivateKeyKeeper2::Ptr m_pKeyKeeper;
 
-		MyThread m_Thread;
+		std::vector<MyThread> m_vThreads;
 		bool m_Run = true;
 
 		std::mutex m_MutexIn;
 		std::condition_variable m_NewIn;
 
+		std::mutex m_MutexState; // serializes the methods that modify the key keeper state
+
         struct Task
             :public TaskFin
         {
+            uint64_t m_Seq;
+            bool m_Stateless;
             virtual void Exec(IPrivateKeyKeeper2&) = 0;
         };
 
 		TaskList m_queIn;
+		uint64_t m_SeqIn = 0;
+		uint64_t m_SeqOut = 0;
+		std::map<uint64_t, Task::Ptr> m_mapDone; // completed out of order
 
         void PushIn(Task::Ptr& p);
         void Thread(const Rules&);
+        void OnTaskDone(Task::Ptr&);
 
     public:
 
-        ThreadedPrivateKeyKeeper(const IPrivateKeyKeeper2::Ptr& p);
+        ThreadedPrivateKeyKeeper(const IPrivateKeyKeeper2::Ptr& p, uint32_t nWorkers = 1);
         ~ThreadedPrivateKeyKeeper();
 
 		template <typename TMethod>
@@ -291,6 +311,7 @@ namespace beam::wallet
 		KEY_KEEPER_METHODS(THE_MACRO)
 #undef THE_MACRO
 
+		void InvokeAsync(Method::CreateOutputs& m, const Handler::Ptr& pHandler) override;
 	};
 
 }
@@ -23,6 +23,7 @@
 #include "utility/helpers.h"
 #include "simple_transaction.h"
 #include "contract_transaction.h"
+#include "bvm/ManagerStd.h"
 #include "strings_resources.h"
 #include "assets_utils.h"
 
@@ -31,6 +32,7 @@
 #include <iomanip>
 #include <numeric>
 #include <queue>
+#include <chrono>
 
 
 namespace beam::wallet
@@ -255,6 +257,13 @@ namespace beam::wallet
         return m_NodeEndpoint;
     }
 
+    std::shared_ptr<bvm2::ContractReadCache> Wallet::GetContractReadCache()
+    {
+        if (!m_pContractReadCache)
+            m_pContractReadCache = std::make_shared<bvm2::ContractReadCache>();
+        return m_pContractReadCache;
+    }
+
     void Wallet::AddMessageEndpoint(IWalletMessageEndpoint::Ptr endpoint)
     {
         m_MessageEndpoints.insert(endpoint);
@@ -1341,6 +1350,15 @@ namespace beam::wallet
         }
     };
 
+    uint32_t Wallet::s_ParallelBodiesThreshold = 4;
+
+    struct Wallet::PreparedBody
+    {
+        Block::Body m_Block;
+        std::vector<NodeProcessor::Recognizer::ShieldedOutpRecovered> m_vShielded; // in the kernel walk order
+        bool m_Valid = false;
+    };
+
     void Wallet::OnRequestComplete(MyRequestBodyPack& r)
     {
         RecognizerHandler h(*this, m_WalletDB->get_MasterKdf());
@@ -1352,15 +1370,88 @@ namespace beam::wallet
             {
                 RequestBodies(r.m_Msg.m_Height0, startHeight + r.m_Res.m_Bodies.size());
             }
-            for (const auto& b : r.m_Res.m_Bodies)
+
+            auto t0 = std::chrono::steady_clock::now();
+
+            // Deserialization and trial recovery don't depend on the wallet state, hence can be done for all the blocks at once
+            struct Task
+                :public Executor::TaskSync
+            {
+                const proto::BodyBuffers* m_pSrc;
+                PreparedBody* m_pRes;
+                const NodeProcessor::ViewerKeys* m_pVk;
+                Height m_h0;
+                uint32_t m_Count;
+
+                void Run(uint32_t i0, uint32_t nCount)
+                {
+                    for (uint32_t i = 0; i < nCount; i++)
+                    {
+                        try {
+                            PrepareBody(m_pRes[i0 + i], m_pSrc[i0 + i], m_h0 + i0 + i, *m_pVk);
+                        }
+                        catch (const std::exception&) {
+                            // remains invalid
+                        }
+                    }
+                }
+
+                void Exec(Executor::Context& ctx) override
+                {
+                    uint32_t i0, nCount;
+                    ctx.get_Portion(i0, nCount, m_Count);
+                    Run(i0, nCount);
+                }
+            };
+
+            NodeProcessor::ViewerKeys vk;
+            h.get_ViewerKeys(vk);
+
+            uint32_t nCount = static_cast<uint32_t>(r.m_Res.m_Bodies.size());
+            std::vector<PreparedBody> vBodies(nCount);
+
+            if (nCount)
+            {
+                Task t;
+                t.m_pSrc = &r.m_Res.m_Bodies.front();
+                t.m_pRes = &vBodies.front();
+                t.m_pVk = &vk;
+                t.m_h0 = startHeight;
+                t.m_Count = nCount;
+
+                Executor* pExec = nullptr;
+                if (nCount >= s_ParallelBodiesThreshold)
+                {
+                    if (!m_pBodiesExecutor)
+                        m_pBodiesExecutor = std::make_unique<ExecutorMT_R>();
+
+                    if (m_pBodiesExecutor->get_Threads() > 1)
+                        pExec = m_pBodiesExecutor.get();
+                }
+
+                if (pExec)
+                    pExec->ExecAll(t);
+                else
+                    t.Run(0, nCount);
+            }
+
+            for (auto& pb : vBodies)
             {
-                ProcessBody(b, startHeight, recognizer);
+                if (!pb.m_Valid)
+                    return;
+
+                ProcessBody(pb, startHeight, recognizer);
 
                 ++startHeight;
             }
             assert(GetEventsHeightNext() == startHeight);
 
             m_WalletDB->set_ShieldedOuts(m_Extra.m_ShieldedOutputs);
+
+            m_BodySyncStats.m_Blocks += nCount;
+            m_BodySyncStats.m_Time_us += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - t0).count();
+
+            LOG_DEBUG() << "Bodies sync: " << nCount << " blocks, " << m_BodySyncStats.get_BlocksPerSec() << " blocks/sec";
         }
         catch (const std::exception&)
         {
@@ -1395,7 +1486,12 @@ namespace beam::wallet
                 return;
             }
 
-            ProcessBody(r.m_Res.m_Body, r.m_Height, recognizer);
+            NodeProcessor::ViewerKeys vk;
+            h.get_ViewerKeys(vk);
+
+            PreparedBody pb;
+            PrepareBody(pb, r.m_Res.m_Body, r.m_Height, vk);
+            ProcessBody(pb, r.m_Height, recognizer);
 
             if (r.m_Height < r.m_Msg.m_Top.m_Height)
             {
@@ -1408,9 +1504,9 @@ namespace beam::wallet
         }
     }
 
-    void Wallet::ProcessBody(const proto::BodyBuffers& b, Height h, NodeProcessor::Recognizer& recognizer)
+    void Wallet::PrepareBody(PreparedBody& pb, const proto::BodyBuffers& b, Height h, const NodeProcessor::ViewerKeys& vk)
     {
-        Block::Body block;
+        Block::Body& block = pb.m_Block;
         Deserializer der;
         der.reset(b.m_Perishable);
 
@@ -1430,8 +1526,68 @@ namespace beam::wallet
 
         der.reset(b.m_Eternal);
         der& Cast::Down<TxVectors::Eternal>(block);
-        PreprocessBlock(block);
-        recognizer.Recognize(block, h, 0, false);
+
+        // remove asset kernels, we don't support them
+        auto& kernels = block.m_vKernels;
+        kernels.erase(std::remove_if(kernels.begin(), kernels.end(), [](const auto& k)
+        {
+            switch (k->get_Subtype())
+            {
+            case TxKernel::Subtype::AssetCreate:
+            case TxKernel::Subtype::AssetDestroy:
+            case TxKernel::Subtype::AssetEmit:
+                return true;
+            default:
+                return false;
+            }
+        }), kernels.end());
+
+        // Trial recovery. Only the recognized outputs are left (they are recovered once more by the recognizer)
+        if (vk.m_pMw)
+        {
+            auto& outputs = block.m_vOutputs;
+            outputs.erase(std::remove_if(outputs.begin(), outputs.end(), [h, &vk](const auto& pOutp)
+            {
+                CoinID cid;
+                return !pOutp->Recover(h, *vk.m_pMw, cid);
+            }), outputs.end());
+        }
+
+        if (!vk.IsEmpty())
+        {
+            struct Walker
+                :public TxKernel::IWalker
+            {
+                PreparedBody& m_Pb;
+                const NodeProcessor::ViewerKeys& m_Vk;
+                Height m_Height;
+
+                Walker(PreparedBody& pb, const NodeProcessor::ViewerKeys& vk) :m_Pb(pb), m_Vk(vk) {}
+
+                bool OnKrn(const TxKernel& krn) override
+                {
+                    if (TxKernel::Subtype::ShieldedOutput == krn.get_Subtype())
+                        NodeProcessor::Recognizer::Recover(m_Pb.m_vShielded.emplace_back(), krn.CastTo_ShieldedOutput(), m_Height, m_Vk);
+                    return true;
+                }
+
+            } wlk(pb, vk);
+
+            wlk.m_Height = h;
+            wlk.Process(kernels);
+        }
+
+        pb.m_Valid = true;
+    }
+
+    void Wallet::ProcessBody(PreparedBody& pb, Height h, NodeProcessor::Recognizer& recognizer)
+    {
+        PreprocessBlock(pb.m_Block);
+
+        recognizer.set_ShieldedRecovered(pb.m_vShielded.empty() ? nullptr : &pb.m_vShielded);
+        recognizer.Recognize(pb.m_Block, h, 0, false);
+        recognizer.set_ShieldedRecovered(nullptr);
+
         SetEventsHeight(h);
         ++m_BlocksDone;
     }
@@ -1449,21 +1605,6 @@ namespace beam::wallet
                 input->m_Internal.m_Maturity = cit->second;
             }
         }
-
-        // remove asset kernels, we don't support them
-        auto& kernels = block.m_vKernels;
-        kernels.erase(std::remove_if(kernels.begin(), kernels.end(), [](const auto& k)
-        {
-            switch (k->get_Subtype())
-            {
-            case TxKernel::Subtype::AssetCreate:
-            case TxKernel::Subtype::AssetDestroy:
-            case TxKernel::Subtype::AssetEmit:
-                return true;
-            default:
-                return false;
-            }
-        }), kernels.end());
     }
 
     void Wallet::RequestBodies()
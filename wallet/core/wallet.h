@@ -20,6 +20,11 @@
 #include "core/fly_client.h"
 #include "node/processor.h"
 
+namespace beam::bvm2
+{
+    struct ContractReadCache;
+}
+
 namespace beam::wallet
 {
     // Exceptions
@@ -136,6 +141,7 @@ namespace beam::wallet
 
         void SetNodeEndpoint(proto::FlyClient::INetwork::Ptr nodeEndpoint);
         proto::FlyClient::INetwork::Ptr GetNodeEndpoint() const;
+        std::shared_ptr<bvm2::ContractReadCache> GetContractReadCache(); // shared by the app shaders, created on demand
         void AddMessageEndpoint(IWalletMessageEndpoint::Ptr endpoint);
 
         // Rescans the blockchain from scratch
@@ -181,6 +187,21 @@ namespace beam::wallet
         bool IsConnectedToOwnNode() const;
         bool CanDetectCoins() const;
         void EnableBodyRequests(bool value);
+
+        // Mobile node sync: the blocks of a body pack are deserialized and trial-recognized on worker threads,
+        // the recognized events are then committed in the height order
+        struct BodySyncStats
+        {
+            uint64_t m_Blocks = 0;
+            uint64_t m_Time_us = 0; // total time spent on the block processing
+
+            uint64_t get_BlocksPerSec() const { return m_Time_us ? (m_Blocks * 1000000 / m_Time_us) : 0; }
+        };
+
+        const BodySyncStats& get_BodySyncStats() const { return m_BodySyncStats; }
+
+        // if a body pack contains at least that many blocks - they are prepared on worker threads
+        static uint32_t s_ParallelBodiesThreshold;
         void assertThread() const; // throws if not in wallet thread
         void markAppNotificationAsRead(const TxID& id);
 
@@ -252,7 +273,9 @@ namespace beam::wallet
         void UpdateOnSynced(BaseTransaction::Ptr tx);
         void UpdateOnNextTip(BaseTransaction::Ptr tx);
         void SaveKnownState();
-        void ProcessBody(const proto::BodyBuffers& b, Height h, NodeProcessor::Recognizer& recoginzer);
+        struct PreparedBody;
+        static void PrepareBody(PreparedBody&, const proto::BodyBuffers& b, Height h, const NodeProcessor::ViewerKeys&);
+        void ProcessBody(PreparedBody&, Height h, NodeProcessor::Recognizer& recoginzer);
         void PreprocessBlock(TxVectors::Full& block);
         void RequestBodies();
         void RequestTreasury();
@@ -435,6 +458,7 @@ namespace beam::wallet
         IWalletDB::Ptr m_WalletDB; 
         
         proto::FlyClient::INetwork::Ptr m_NodeEndpoint;
+        std::shared_ptr<bvm2::ContractReadCache> m_pContractReadCache;
         std::set<IWalletMessageEndpoint::Ptr> m_MessageEndpoints;
 
         struct VoucherManager
@@ -501,6 +525,8 @@ namespace beam::wallet
         bool m_IsTreasuryHandled = false;
         std::map<ECC::Point, Height> m_Commitments;
         bool m_IsCommitmentsCached = false;
+        std::unique_ptr<ExecutorMT_R> m_pBodiesExecutor; // created on demand
+        BodySyncStats m_BodySyncStats;
 
         // the queue of actions to be performed after wallet synchronization
         using ActionQueue = std::queue<OnSyncAction>;
@@ -3067,23 +3067,47 @@ namespace beam::wallet
         Block::SystemState::ID stateID = {};
         getSystemStateID(stateID);
 
+        ensureCoinIndex();
+
         {
-            const char* query = "SELECT " STORAGE_FIELDS " FROM " STORAGE_NAME " WHERE maturity>=0 AND maturity<=?1 AND spentHeight<0 ORDER BY amount ASC";
+            const char* req = "SELECT " ENUM_STORAGE_FIELDS(LIST, COMMA, ) " FROM " STORAGE_NAME STORAGE_WHERE_ID;
+            sqlite::Statement stm(this, req);
 
-            sqlite::Statement stm(this, query);
-            stm.bind(1, stateID.m_Height);
+            CoinID cidFirst(Zero);
+            cidFirst.m_SubIdx = 0;
+            cidFirst.m_AssetID = assetId;
 
-            while (stm.step())
+            for (auto it = m_CoinIndex.m_Map.lower_bound(cidFirst); m_CoinIndex.m_Map.end() != it; ++it)
             {
+                if (it->first.m_AssetID != assetId)
+                    break;
+                if (it->second > stateID.m_Height)
+                    continue; // not mature yet
+
                 auto& coin = coins.emplace_back();
+                coin.m_ID = it->first;
+
                 int colIdx = 0;
-                ENUM_ALL_STORAGE_FIELDS(STM_GET_LIST, NOSEP, coin);
+                STORAGE_BIND_ID(coin)
+
+                bool bFound = stm.step();
+                if (bFound)
+                {
+                    colIdx = 0;
+                    ENUM_STORAGE_FIELDS(STM_GET_LIST, NOSEP, coin);
+                }
+                stm.Reset();
+
+                if (!bFound)
+                {
+                    assert(false); // index out of sync
+                    coins.pop_back();
+                    continue;
+                }
 
                 storage::DeduceStatus(*this, coin, stateID.m_Height);
                 if (Coin::Status::Available != coin.m_status)
                     coins.pop_back();
-                else if (coin.m_ID.m_AssetID != assetId)
-                    coins.pop_back();
                 else
                 {
                     if (coin.m_ID.m_Value >= amount)
@@ -3111,6 +3135,63 @@ namespace beam::wallet
         return coinsSel;
     }
 
+    void WalletDB::ensureCoinIndex()
+    {
+        if (m_CoinIndex.m_Valid)
+            return;
+
+        m_CoinIndex.m_Map.clear();
+
+        sqlite::Statement stm(this, "SELECT " STORAGE_FIELDS " FROM " STORAGE_NAME " WHERE maturity>=0 AND spentHeight<0;");
+        while (stm.step())
+        {
+            Coin coin;
+            int colIdx = 0;
+            ENUM_ALL_STORAGE_FIELDS(STM_GET_LIST, NOSEP, coin);
+
+            m_CoinIndex.m_Map[coin.m_ID] = coin.m_maturity;
+        }
+
+        m_CoinIndex.m_Valid = true;
+    }
+
+    bool WalletDB::CoinIndex::Cmp::operator()(const CoinID& a, const CoinID& b) const
+    {
+        if (a.m_AssetID != b.m_AssetID)
+            return a.m_AssetID < b.m_AssetID;
+        if (a.m_Value != b.m_Value)
+            return a.m_Value < b.m_Value;
+        return a.cmp(b) < 0;
+    }
+
+    bool WalletDB::CoinIndex::IsSelectable(const Coin& coin)
+    {
+        return (MaxHeight != coin.m_maturity) && (MaxHeight == coin.m_spentHeight);
+    }
+
+    void WalletDB::CoinIndex::Reset()
+    {
+        m_Map.clear();
+        m_Valid = false;
+    }
+
+    void WalletDB::CoinIndex::OnSaved(const Coin& coin)
+    {
+        if (!m_Valid)
+            return;
+
+        if (IsSelectable(coin))
+            m_Map[coin.m_ID] = coin.m_maturity;
+        else
+            m_Map.erase(coin.m_ID);
+    }
+
+    void WalletDB::CoinIndex::OnRemoved(const CoinID& cid)
+    {
+        if (m_Valid)
+            m_Map.erase(cid);
+    }
+
     std::vector<Coin> WalletDB::getNormalCoins(Asset::ID assetId) const
     {
         std::vector<Coin> coins;
@@ -3214,6 +3295,8 @@ namespace beam::wallet
         int colIdx = 0;
         ENUM_ALL_STORAGE_FIELDS(STM_BIND_LIST, NOSEP, coin);
         stm.step();
+
+        m_CoinIndex.OnSaved(coin);
     }
 
     void WalletDB::insertNewCoin(Coin& coin)
@@ -3237,7 +3320,11 @@ namespace beam::wallet
         ENUM_STORAGE_ID(STM_BIND_LIST, NOSEP, coin);
         stm.step();
 
-        return sqlite3_changes(_db) > 0;
+        if (sqlite3_changes(_db) <= 0)
+            return false;
+
+        m_CoinIndex.OnSaved(coin);
+        return true;
     }
 
     bool WalletDB::saveCoinRaw(const Coin& coin)
@@ -3402,12 +3489,15 @@ namespace beam::wallet
         STORAGE_BIND_ID(wrp)
 
         stm.step();
+
+        m_CoinIndex.OnRemoved(cid);
     }
 
     void WalletDB::clearCoins()
     {
         sqlite::Statement stm(this, "DELETE FROM " STORAGE_NAME ";");
         stm.step();
+        m_CoinIndex.m_Map.clear();
         notifyCoinsChanged(ChangeAction::Reset, {});
     }
 
@@ -3635,6 +3725,8 @@ namespace beam::wallet
                 stm.bind(2, minHeight);
                 stm.step();
             }
+
+            m_CoinIndex.Reset();
  
             notifyCoinsChanged(ChangeAction::Updated, getCoinsByRowIDs(changedRows));
         }
@@ -4100,6 +4192,9 @@ namespace beam::wallet
             stm.bind(2, MaxHeight);
             stm.step();
 
+            for (const auto& coin : deletedItems)
+                m_CoinIndex.OnRemoved(coin.m_ID);
+
             notifyCoinsChanged(ChangeAction::Removed, deletedItems);
         }
     }
@@ -5399,6 +5494,7 @@ namespace beam::wallet
         {
             m_DbTransaction->rollback();
             m_DbTransaction.reset();
+            m_CoinIndex.Reset();
         }
     }
 
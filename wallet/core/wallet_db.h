@@ -812,6 +812,7 @@ namespace beam::wallet
         void saveShieldedCoinRaw(const ShieldedCoin& coin);
 
         Amount selectCoinsStd(Amount nTrg, Amount nSel, Asset::ID, std::vector<Coin>&);
+        void ensureCoinIndex();
 
         // ////////////////////////////////////////
         // Cache for optimized access for database fields
@@ -880,6 +881,26 @@ namespace beam::wallet
         uint32_t m_coinConfirmationsOffset = 0;
 
         struct ShieldedStatusCtx;
+
+        // In-memory index of the coins that may be selected for spending (confirmed maturity, not spent),
+        // ordered by asset and amount. Maps to the coin maturity.
+        // Built on the first coin selection, then kept in sync by the raw coin writes. Bulk updates drop it.
+        struct CoinIndex
+        {
+            struct Cmp {
+                bool operator()(const CoinID&, const CoinID&) const;
+            };
+
+            typedef std::map<CoinID, Height, Cmp> Map;
+            Map m_Map;
+            bool m_Valid = false;
+
+            static bool IsSelectable(const Coin&);
+
+            void Reset();
+            void OnSaved(const Coin&);
+            void OnRemoved(const CoinID&);
+        } m_CoinIndex;
     };
 
     namespace storage
@@ -13,6 +13,7 @@
 // limitations under the License.
 
 #include "wallet_network.h"
+#include <chrono>
 
 using namespace std;
 
@@ -27,6 +28,8 @@ namespace beam::wallet {
 
     ///////////////////////////
 
+    uint32_t BaseMessageEndpoint::s_ParallelDecryptThreshold = 32;
+
     BaseMessageEndpoint::BaseMessageEndpoint(IWalletMessageConsumer& w, const IWalletDB::Ptr& pWalletDB)
         : m_Wallet(w)
         , m_WalletDB(pWalletDB)
@@ -62,6 +65,8 @@ namespace beam::wallet {
         Addr::Channel key;
         key.m_Value = msg.m_Channel;
 
+        m_vCandidates.clear();
+
         for (ChannelSet::iterator it = m_Channels.lower_bound(key); ; ++it)
         {
             if (m_Channels.end() == it)
@@ -78,14 +83,39 @@ namespace beam::wallet {
                 return;
             }
 
+            m_vCandidates.push_back(&it->get_ParentObj());
+        }
+
+        if (m_vCandidates.empty())
+            return;
+
+        auto t0 = std::chrono::steady_clock::now();
+
+        proto::Bbs::Decryptor dec;
+        bool bValidMsg = dec.Init(msg.m_Message.data(), static_cast<uint32_t>(msg.m_Message.size()));
+        if (bValidMsg)
+            DecryptCandidates(dec, msg.m_Message);
+
+        m_DecryptStats.m_Messages++;
+        m_DecryptStats.m_Time_us += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - t0).count();
+
+        if (!bValidMsg)
+            return;
+
+        for (size_t i = 0; i < m_vCandidates.size(); i++)
+        {
+            if (!m_vDecrypted[i])
+                continue;
+
+            auto& x = *m_vCandidates[i];
+
+            // decrypt it again, this time to keep the plaintext. Happens only for the matching addresses
             ByteBuffer buf = msg.m_Message; // duplicate, copy
             uint8_t* pMsg = &buf.front();
             uint32_t nSize = static_cast<uint32_t>(buf.size());
 
-            auto& x = it->get_ParentObj();
-
-            if (!proto::Bbs::Decrypt(pMsg, nSize, x.m_sk))
-                continue;
+            if (!dec.Decrypt(pMsg, nSize, x.m_sk, x.m_Pk))
+                continue; // should not happen
 
             if (x.m_pHandler)
                 x.m_pHandler->OnMsg(Blob(pMsg, nSize));
@@ -106,13 +136,77 @@ namespace beam::wallet {
 
                 if (bValid)
                 {
-                    m_Wallet.OnWalletMessage(it->get_ParentObj().m_Wid.m_Value, msgWallet);
+                    m_Wallet.OnWalletMessage(x.m_Wid.m_Value, msgWallet);
                     break;
                 }
             }
         }
     }
 
+    void BaseMessageEndpoint::DecryptCandidates(const proto::Bbs::Decryptor& dec, const ByteBuffer& msg)
+    {
+        // Only the outcome is recorded here, the (rare) matching messages are re-decrypted by the caller.
+        struct Task
+            :public Executor::TaskSync
+        {
+            const proto::Bbs::Decryptor* m_pDec;
+            const ByteBuffer* m_pMsg;
+            Addr* const* m_ppAddr;
+            uint8_t* m_pRes;
+            uint32_t m_Count;
+
+            void Run(uint32_t i0, uint32_t nCount)
+            {
+                ByteBuffer buf;
+                for (uint32_t i = 0; i < nCount; i++)
+                {
+                    buf = *m_pMsg;
+                    uint8_t* pMsg = &buf.front();
+                    uint32_t nSize = static_cast<uint32_t>(buf.size());
+
+                    const Addr& x = *m_ppAddr[i0 + i];
+                    m_pRes[i0 + i] = m_pDec->Decrypt(pMsg, nSize, x.m_sk, x.m_Pk) ? 1 : 0;
+                }
+            }
+
+            void Exec(Executor::Context& ctx) override
+            {
+                uint32_t i0, nCount;
+                ctx.get_Portion(i0, nCount, m_Count);
+                Run(i0, nCount);
+            }
+        };
+
+        uint32_t nCount = static_cast<uint32_t>(m_vCandidates.size());
+        m_vDecrypted.assign(nCount, 0);
+
+        Task t;
+        t.m_pDec = &dec;
+        t.m_pMsg = &msg;
+        t.m_ppAddr = &m_vCandidates.front();
+        t.m_pRes = &m_vDecrypted.front();
+        t.m_Count = nCount;
+
+        Executor* pExec = nullptr;
+        if (nCount >= s_ParallelDecryptThreshold)
+        {
+            if (!m_pDecryptExecutor)
+                m_pDecryptExecutor = std::make_unique<ExecutorMT_R>();
+
+            if (m_pDecryptExecutor->get_Threads() > 1)
+                pExec = m_pDecryptExecutor.get();
+        }
+
+        if (pExec)
+            pExec->ExecAll(t);
+        else
+            t.Run(0, nCount);
+
+        m_DecryptStats.m_Attempts += nCount;
+        for (uint32_t i = 0; i < nCount; i++)
+            m_DecryptStats.m_Decrypted += m_vDecrypted[i];
+    }
+
     BaseMessageEndpoint::Addr* BaseMessageEndpoint::CreateOwnAddr(const WalletID& wid)
     {
         Addr* pAddr = new Addr;
@@ -143,6 +237,7 @@ namespace beam::wallet {
         {
             pAddr = CreateOwnAddr(address.m_walletID);
             m_WalletDB->get_SbbsPeerID(pAddr->m_sk, pAddr->m_Wid.m_Value.m_Pk, address.m_OwnID);
+            pAddr->m_Pk = pAddr->m_Wid.m_Value.m_Pk;
         }
         else
         {
@@ -241,6 +336,20 @@ namespace beam::wallet {
         {
             DeleteAddr(*address);
         }
+
+        const DecryptStats& s = m_DecryptStats;
+        DecryptStats& s0 = m_DecryptStatsReported;
+        if (s.m_Messages != s0.m_Messages)
+        {
+            DecryptStats d;
+            d.m_Messages = s.m_Messages - s0.m_Messages;
+            d.m_Attempts = s.m_Attempts - s0.m_Attempts;
+            d.m_Decrypted = s.m_Decrypted - s0.m_Decrypted;
+            d.m_Time_us = s.m_Time_us - s0.m_Time_us;
+
+            LOG_DEBUG() << "BBS decrypt: " << d.m_Messages << " msgs, " << d.m_Attempts << " attempts, " << d.m_Decrypted << " decrypted, " << d.get_AttemptsPerSec() << " attempts/sec";
+            s0 = s;
+        }
         m_AddressExpirationTimer->start(AddressUpdateInterval_ms, false, [this] { OnAddressTimer(); });
     }
 
@@ -248,6 +357,7 @@ namespace beam::wallet {
     {
         Addr* pAddr = CreateOwnAddr(addr);
         pAddr->m_sk = sk;
+        pAddr->m_Pk.FromSk(pAddr->m_sk);
         pAddr->m_ExpirationTime = Timestamp(-1);
         pAddr->m_pHandler = pHandler;
     }
@@ -50,6 +50,7 @@ namespace beam::wallet
             }
 
             ECC::Scalar::Native m_sk; // private addr
+            PeerID m_Pk; // its public key, cached for decryption
             Timestamp m_ExpirationTime = 0;
             IHandler* m_pHandler = nullptr;
         };
@@ -58,6 +59,22 @@ namespace beam::wallet
         virtual ~BaseMessageEndpoint();
         void AddOwnAddress(const WalletAddress& address);
         void DeleteOwnAddress(const WalletID&);
+
+        // Incoming messages are tried with all own addresses on their channel
+        struct DecryptStats
+        {
+            uint64_t m_Messages = 0;
+            uint64_t m_Attempts = 0; // total decryption attempts (message x address)
+            uint64_t m_Decrypted = 0;
+            uint64_t m_Time_us = 0; // total time spent on decryption
+
+            uint64_t get_AttemptsPerSec() const { return m_Time_us ? (m_Attempts * 1000000 / m_Time_us) : 0; }
+        };
+
+        const DecryptStats& get_DecryptStats() const { return m_DecryptStats; }
+
+        // if a message should be tried with at least that many addresses - the attempts are split across worker threads
+        static uint32_t s_ParallelDecryptThreshold;
     protected:
         void ProcessMessage(const proto::BbsMsg& msg);
         void Subscribe();
@@ -76,6 +93,7 @@ namespace beam::wallet
         void Listen(const WalletID&, const ECC::Scalar::Native&, IHandler*) override;
         void Unlisten(const WalletID&) override;
         void OnAddressTimer();
+        void DecryptCandidates(const proto::Bbs::Decryptor&, const ByteBuffer&);
         
     private:
         typedef bi::multiset<Addr::Wid> WidSet;
@@ -88,6 +106,12 @@ namespace beam::wallet
         IWalletDB::Ptr m_WalletDB;
         Key::IKdf::Ptr m_pKdfSbbs;
         io::Timer::Ptr m_AddressExpirationTimer;
+
+        std::vector<Addr*> m_vCandidates;
+        std::vector<uint8_t> m_vDecrypted; // per candidate
+        std::unique_ptr<ExecutorMT_R> m_pDecryptExecutor; // created on demand
+        DecryptStats m_DecryptStats;
+        DecryptStats m_DecryptStatsReported;
     };
     struct ITimestampHolder
     {
@@ -428,6 +428,179 @@ void TestRestoreInterruption()
     }
 }
 
+void TestParallelBodiesSync()
+{
+    cout << "\nTest parallel bodies sync\n";
+    io::Reactor::Ptr mainReactor{ io::Reactor::create() };
+    io::Reactor::Scope scope(*mainReactor);
+
+    const int txNum = 6;
+    int completedCount = txNum;
+    auto completeAction = [&completedCount](auto)
+    {
+        --completedCount;
+    };
+
+    auto senderWalletDB = createSenderWalletDB(0, 0);
+    auto binaryTreasury = createTreasury(senderWalletDB, AmountList(txNum, Amount(50000000)));
+    TestWalletRig sender(senderWalletDB, completeAction, TestWalletRig::RegularWithoutPoWBbs);
+    auto receiverWalletDB = createReceiverWalletDB(false, true);
+    TestWalletRig receiver(receiverWalletDB, completeAction, TestWalletRig::RegularWithoutPoWBbs);
+    receiver.m_Wallet->EnableBodyRequests(true);
+
+    sender.m_Wallet->RegisterTransactionType(TxType::PushTransaction, std::make_shared<lelantus::PushTransaction::Creator>([=]() { return senderWalletDB; }));
+    receiver.m_Wallet->RegisterTransactionType(TxType::PushTransaction, std::make_shared<lelantus::PushTransaction::Creator>([=]() { return receiverWalletDB; }));
+
+    sender.m_Wallet->Rescan();
+    Node node;
+    NodeObserver observer([&]()
+    {
+        auto cursor = node.get_Processor().m_Cursor;
+        if (cursor.m_Sid.m_Height == Rules::get().pForks[2].m_Height + 3)
+        {
+            for (int i = 0; i < txNum; ++i)
+            {
+                WalletAddress walletAddress;
+                receiver.m_WalletDB->createAddress(walletAddress);
+                receiver.m_WalletDB->saveAddress(walletAddress);
+
+                auto vouchers = GenerateVoucherList(receiver.m_WalletDB->get_KeyKeeper(), walletAddress.m_OwnID, 1);
+                auto newAddress = GenerateOfflineToken(walletAddress, 0, Asset::s_BeamID, vouchers, "");
+                auto p = ParseParameters(newAddress);
+                WALLET_CHECK(p);
+                auto parameters = lelantus::CreatePushTransactionParameters(sender.m_WalletID)
+                    .SetParameter(TxParameterID::Amount, 38000000)
+                    .SetParameter(TxParameterID::Fee, 12000000);
+
+                LoadReceiverParams(*p, parameters, TxAddressType::Offline);
+
+                sender.m_Wallet->StartTransaction(parameters);
+            }
+        }
+        else if (cursor.m_Sid.m_Height == 40)
+        {
+            mainReactor->stop();
+        }
+    });
+
+    InitOwnNodeToTest(node, binaryTreasury, &observer, sender.m_WalletDB->get_OwnerKdf(), 32125, 200);
+
+    mainReactor->run();
+    WALLET_CHECK(completedCount == 0);
+
+    // Forwards the requests to the node. Optionally damages the block at the specified height in the body packs
+    struct CorruptingNetwork
+        :public proto::FlyClient::INetwork
+        ,public proto::FlyClient::Request::IHandler
+    {
+        proto::FlyClient::INetwork::Ptr m_pNet;
+        std::map<proto::FlyClient::Request*, proto::FlyClient::Request::IHandler*> m_Handlers;
+        Height m_hCorrupt = 0;
+        uint32_t m_Corrupted = 0;
+
+        void Connect() override { m_pNet->Connect(); }
+        void Disconnect() override { m_pNet->Disconnect(); }
+        void BbsSubscribe(BbsChannel ch, Timestamp ts, proto::FlyClient::IBbsReceiver* p) override { m_pNet->BbsSubscribe(ch, ts, p); }
+
+        void PostRequestInternal(proto::FlyClient::Request& r) override
+        {
+            if (proto::FlyClient::Request::Type::BodyPack == r.get_Type())
+            {
+                m_Handlers[&r] = r.m_pTrg;
+                r.m_pTrg = this;
+            }
+            m_pNet->PostRequestInternal(r);
+        }
+
+        void OnComplete(proto::FlyClient::Request& r) override
+        {
+            auto it = m_Handlers.find(&r);
+            WALLET_CHECK(m_Handlers.end() != it);
+            if (m_Handlers.end() == it)
+                return;
+
+            r.m_pTrg = it->second;
+            m_Handlers.erase(it);
+
+            auto& x = r.As<proto::FlyClient::RequestBodyPack>();
+            Height h0 = x.m_Msg.m_Top.m_Height - x.m_Msg.m_CountExtra;
+            if ((m_hCorrupt >= h0) && (m_hCorrupt - h0 < x.m_Res.m_Bodies.size()))
+            {
+                auto& buf = x.m_Res.m_Bodies[m_hCorrupt - h0].m_Eternal;
+                buf.resize(buf.size() / 2); // can't be deserialized
+                m_Corrupted++;
+            }
+
+            if (r.m_pTrg)
+                r.m_pTrg->OnComplete(r);
+        }
+    };
+
+    auto pNet = std::make_shared<CorruptingNetwork>();
+    pNet->m_pNet = receiver.m_Wallet->GetNodeEndpoint();
+    receiver.m_Wallet->SetNodeEndpoint(pNet);
+
+    struct SyncObserver : public wallet::IWalletObserver
+    {
+        void onSyncProgress(int done, int total) override
+        {
+            if (done == total && total == 0)
+                io::Reactor::get_Current().stop();
+        }
+    };
+
+    // the outcome of the events, which doesn't depend on the current tip
+    typedef std::vector<std::tuple<TxoID, Amount, Height, Height> > Result;
+
+    auto sync = [&](uint32_t nParallelThreshold, Height hCorrupt)
+    {
+        Wallet::s_ParallelBodiesThreshold = nParallelThreshold;
+        pNet->m_hCorrupt = hCorrupt;
+        pNet->m_Corrupted = 0;
+
+        SyncObserver ob;
+        receiver.m_Wallet->Subscribe(&ob);
+        receiver.m_Wallet->Rescan();
+
+        io::Timer::Ptr timer = io::Timer::create(*mainReactor);
+        timer->start(60000, false, [&]() { mainReactor->stop(); });
+
+        mainReactor->run();
+        receiver.m_Wallet->Unsubscribe(&ob);
+
+        WALLET_CHECK(!hCorrupt || pNet->m_Corrupted);
+
+        Result res;
+        for (const auto& c : receiver.m_WalletDB->getShieldedCoins(Asset::s_BeamID))
+            res.emplace_back(c.m_TxoID, c.m_CoinID.m_Value, c.m_confirmHeight, c.m_spentHeight);
+
+        for (const auto& c : receiver.GetCoins())
+            res.emplace_back(MaxHeight, c.m_ID.m_Value, c.m_confirmHeight, c.m_spentHeight);
+
+        std::sort(res.begin(), res.end());
+        return res;
+    };
+
+    Result resSerial = sync(static_cast<uint32_t>(-1), 0);
+    Result resParallel = sync(1, 0);
+
+    WALLET_CHECK(resSerial.size() == txNum);
+    WALLET_CHECK(resParallel == resSerial);
+
+    // damage a block with a shielded output for the receiver. The processing of its pack stops there, regardless of the mode
+    Height hCorrupt = MaxHeight;
+    for (const auto& x : resSerial)
+        std::setmin(hCorrupt, std::get<2>(x));
+
+    Result resSerialCorrupt = sync(static_cast<uint32_t>(-1), hCorrupt);
+    Result resParallelCorrupt = sync(1, hCorrupt);
+
+    WALLET_CHECK(resSerialCorrupt.size() < resSerial.size());
+    WALLET_CHECK(resParallelCorrupt == resSerialCorrupt);
+
+    Wallet::s_ParallelBodiesThreshold = 4;
+}
+
 void TestSimpleTx()
 {
     cout << "\nTest simple lelantus tx's: 2 pushTx and 2 pullTx\n";
@@ -1638,6 +1811,7 @@ int main()
     {
         TestMaxPrivacyAndOffline();
         TestRestoreInterruption();
+        TestParallelBodiesSync();
         TestTreasuryRestore();
         TestSimpleTx();
         TestMaxPrivacyTx();
@@ -1303,6 +1303,65 @@ void TestSelect7()
     SelectCoins(db, 6'456'001'778'569 + 1000, false);
 }
 
+void TestSelectIndex()
+{
+    cout << "\nWallet database coin selection index test\n";
+    auto db = createSqliteWalletDB();
+
+    auto selectAmount = [&db](Amount amount, Asset::ID aid = 0) -> Amount
+    {
+        vector<Coin> coins;
+        vector<ShieldedCoin> shieldedCoins;
+        db->selectCoins2(0, amount, aid, coins, shieldedCoins, 0, false);
+
+        Amount sum = 0;
+        for (const auto& c : coins)
+        {
+            WALLET_CHECK(c.m_ID.m_AssetID == aid);
+            WALLET_CHECK(c.m_status == Coin::Available);
+            sum += c.m_ID.m_Value;
+        }
+        return sum;
+    };
+
+    Coin c5 = CreateAvailCoin(5);
+    Coin c10 = CreateAvailCoin(10);
+    Coin c20 = CreateAvailCoin(20);
+    Coin cAsset = CreateAvailCoin(7);
+    cAsset.m_ID.m_AssetID = 1;
+    Coin cMaturing = CreateAvailCoin(100, 200);
+
+    db->storeCoin(c5);
+    db->storeCoin(c10);
+    db->storeCoin(c20);
+    db->storeCoin(cAsset);
+    db->storeCoin(cMaturing);
+
+    WALLET_CHECK(selectAmount(35) == 35);
+    WALLET_CHECK(selectAmount(36) == 0); // the maturing coin is not selectable
+    WALLET_CHECK(selectAmount(7, 1) == 7);
+    WALLET_CHECK(selectAmount(8, 1) == 0);
+
+    // spend, remove and add coins after the index has been built
+    c5.m_spentHeight = 100;
+    db->saveCoin(c5);
+    WALLET_CHECK(selectAmount(30) == 30);
+    WALLET_CHECK(selectAmount(31) == 0);
+
+    db->removeCoins({ c10.m_ID });
+    WALLET_CHECK(selectAmount(20) == 20);
+    WALLET_CHECK(selectAmount(21) == 0);
+
+    Coin c3 = CreateAvailCoin(3);
+    db->storeCoin(c3);
+    WALLET_CHECK(selectAmount(23) == 23);
+
+    // the spent coin is back after rollback
+    db->rollbackConfirmedUtxo(99);
+    WALLET_CHECK(selectAmount(28) == 28);
+    WALLET_CHECK(selectAmount(29) == 0);
+}
+
 void TestWalletMessages()
 {
     cout << "\nWallet database wallet messages test\n";
@@ -1709,6 +1768,7 @@ int main()
     TestSelect5();
     TestSelect6();
     TestSelect7();
+    TestSelectIndex();
     TestAddresses();
     TestExportImportTx();
     TestTxParameters();
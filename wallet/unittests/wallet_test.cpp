@@ -1738,6 +1738,7 @@ namespace
         bool m_Async = false;
 
         using ManagerStdInWallet::ManagerStdInWallet;
+        using ManagerStdInWallet::CompileAppShader;
 
         void OnDone(const std::exception* pExc) override
         {
@@ -1755,7 +1756,7 @@ namespace
             pt.Export(res);
         }
 
-        static void Compile(ByteBuffer& res, const char* sz, Kind kind)
+        static void Load(ByteBuffer& res, const char* sz)
         {
             std::FStream fs;
             fs.Open(sz, true, true);
@@ -1763,7 +1764,11 @@ namespace
             res.resize(static_cast<size_t>(fs.get_Remaining()));
             if (!res.empty())
                 fs.read(&res.front(), res.size());
+        }
 
+        static void Compile(ByteBuffer& res, const char* sz, Kind kind)
+        {
+            Load(res, sz);
             bvm2::Processor::Compile(res, res, kind);
         }
 
@@ -1858,6 +1863,107 @@ namespace
     };
 
 
+    void TestAppShaderCache()
+    {
+        printf("Testing compiled app shader cache...\n");
+
+        io::Reactor::Ptr mainReactor(io::Reactor::create());
+        io::Reactor::Scope scope(*mainReactor);
+
+        auto db = createSenderWalletDB();
+        TestWalletRig rig(db);
+
+        auto& cache = CompiledShaderCache::get();
+        cache.ClearMem();
+
+        ByteBuffer bufSrc1, bufSrc2, bufRef1, bufRef2;
+        MyManager::Load(bufSrc1, "vault/app.wasm");
+        MyManager::Load(bufSrc2, "dao-vault/app.wasm");
+        bvm2::Processor::Compile(bufRef1, bufSrc1, MyManager::Kind::Manager);
+        bvm2::Processor::Compile(bufRef2, bufSrc2, MyManager::Kind::Manager);
+        WALLET_CHECK(bufRef1 != bufRef2);
+
+        ECC::Hash::Value hv1, hv2;
+        cache.get_Key(hv1, bufSrc1);
+        cache.get_Key(hv2, bufSrc2);
+        WALLET_CHECK(hv1 != hv2);
+
+        ByteBuffer buf;
+        WALLET_CHECK(!cache.Find(hv1, buf, *db));
+
+        MyManager man(db, rig.m_Wallet);
+        man.CompileAppShader(bufSrc1);
+        WALLET_CHECK(man.m_BodyManager == bufRef1);
+
+        WALLET_CHECK(cache.Find(hv1, buf, *db) && (buf == bufRef1));
+        WALLET_CHECK(!cache.Find(hv2, buf, *db));
+
+        man.m_BodyManager.clear();
+        man.CompileAppShader(bufSrc1);
+        WALLET_CHECK(man.m_BodyManager == bufRef1);
+
+        // reload from the DB
+        cache.ClearMem();
+        WALLET_CHECK(db->getBlob(CompiledShaderCache::VarName(hv1).m_sz, buf) && (buf == bufRef1));
+
+        man.m_BodyManager.clear();
+        man.CompileAppShader(bufSrc1);
+        WALLET_CHECK(man.m_BodyManager == bufRef1);
+
+        man.CompileAppShader(bufSrc2);
+        WALLET_CHECK(man.m_BodyManager == bufRef2);
+
+        // the cached body is used as-is, no recompilation
+        ByteBuffer bufFake(bufRef1.begin(), bufRef1.begin() + bufRef1.size() / 2);
+        cache.Insert(hv1, bufFake, *db);
+        man.CompileAppShader(bufSrc1);
+        WALLET_CHECK(man.m_BodyManager == bufFake);
+
+        cache.ClearMem();
+        man.CompileAppShader(bufSrc1);
+        WALLET_CHECK(man.m_BodyManager == bufFake);
+
+        // overflow the DB index. The first keys are pushed out, and their vars are erased
+        const uint32_t nExtra = 5;
+        std::vector<ECC::Hash::Value> vKeys;
+        vKeys.resize(CompiledShaderCache::s_MaxItemsDB + nExtra);
+
+        for (uint32_t i = 0; i < vKeys.size(); i++)
+        {
+            ECC::Hash::Processor() << "test.key" << i >> vKeys[i];
+            ByteBuffer body(1, static_cast<uint8_t>(i));
+            cache.Insert(vKeys[i], body, *db);
+        }
+
+        WALLET_CHECK(db->getBlob(CompiledShaderCache::s_szIndexName, buf));
+        WALLET_CHECK(buf.size() == CompiledShaderCache::s_MaxItemsDB * ECC::Hash::Value::nBytes);
+
+        // most recently inserted first
+        for (uint32_t i = 0; i < CompiledShaderCache::s_MaxItemsDB; i++)
+            WALLET_CHECK(!memcmp(&buf.front() + i * ECC::Hash::Value::nBytes, vKeys[vKeys.size() - 1 - i].m_pData, ECC::Hash::Value::nBytes));
+
+        cache.ClearMem();
+
+        WALLET_CHECK(!db->getBlob(CompiledShaderCache::VarName(hv1).m_sz, buf));
+        WALLET_CHECK(!db->getBlob(CompiledShaderCache::VarName(hv2).m_sz, buf));
+        WALLET_CHECK(!cache.Find(hv1, buf, *db));
+
+        for (uint32_t i = 0; i < vKeys.size(); i++)
+        {
+            bool bKept = (i >= nExtra);
+            bool bFound = cache.Find(vKeys[i], buf, *db);
+            WALLET_CHECK(bFound == bKept);
+            if (bFound)
+                WALLET_CHECK((buf.size() == 1) && (buf[0] == static_cast<uint8_t>(i)));
+        }
+
+        // a recompilation is stored again
+        man.CompileAppShader(bufSrc1);
+        WALLET_CHECK(man.m_BodyManager == bufRef1);
+
+        cache.ClearMem();
+    }
+
     void TestAppShader1()
     {
         printf("Testing multi-wallet app shader with comm...\n");
@@ -3947,6 +4053,120 @@ void TestKeyKeeper(IPrivateKeyKeeper2::Ptr externalKeyKeeper = {}, size_t index
     WALLET_CHECK(tx.IsValid(ctx));
 }
 
+void TestKeyKeeperBatch()
+{
+    cout << "Test KeyKeeper batch and multi-worker" << std::endl;
+
+    io::Reactor::Ptr mainReactor{ io::Reactor::create() };
+    io::Reactor::Scope scope(*mainReactor);
+
+    Key::IKdf::Ptr pKdf;
+    HKdf::Create(pKdf, 54321U);
+    auto pKk = std::make_shared<LocalPrivateKeyKeeperStd>(pKdf);
+
+    Height hScheme = Rules::get().pForks[1].m_Height + 10;
+
+    IPrivateKeyKeeper2::Method::CreateOutputs mB;
+    for (uint32_t i = 0; i < 20; i++)
+    {
+        auto& m = mB.m_vOutputs.emplace_back();
+        m.m_hScheme = hScheme;
+        m.m_Cid = CoinID(100 + i, 3000 + i, Key::Type::Regular, i % 3); // some go to child subkeys
+    }
+
+    WALLET_CHECK(IPrivateKeyKeeper2::Status::Success == pKk->InvokeSync(mB));
+
+    for (const auto& m : mB.m_vOutputs)
+    {
+        Point::Native comm, comm2;
+        WALLET_CHECK(m.m_pResult && m.m_pResult->IsValid(hScheme, comm));
+        WALLET_CHECK(IPrivateKeyKeeper2::Status::Success == pKk->get_Commitment(comm2, m.m_Cid));
+        WALLET_CHECK(comm == comm2);
+    }
+
+    // multi-worker: completions must arrive in the invocation order
+    ThreadedPrivateKeyKeeper tkk(pKk, 4);
+
+    struct MyHandler
+        :public IPrivateKeyKeeper2::Handler
+    {
+        std::vector<uint32_t>* m_pOrder;
+        uint32_t m_Idx;
+        uint32_t m_Total;
+
+        void OnDone(IPrivateKeyKeeper2::Status::Type n) override
+        {
+            WALLET_CHECK(IPrivateKeyKeeper2::Status::Success == n);
+            m_pOrder->push_back(m_Idx);
+            if (m_pOrder->size() == m_Total)
+                io::Reactor::get_Current().stop();
+        }
+    };
+
+    std::vector<uint32_t> vOrder;
+    std::vector<IPrivateKeyKeeper2::Method::CreateOutput> vSingle(12);
+    IPrivateKeyKeeper2::Method::CreateOutputs mB2;
+    mB2.m_vOutputs.resize(10);
+    IPrivateKeyKeeper2::Method::SignSplit mSplit;
+
+    uint32_t nTotal = static_cast<uint32_t>(vSingle.size()) + 2;
+
+    auto fnHandler = [&](uint32_t iIdx)
+    {
+        auto p = std::make_shared<MyHandler>();
+        p->m_pOrder = &vOrder;
+        p->m_Idx = iIdx;
+        p->m_Total = nTotal;
+        return p;
+    };
+
+    uint32_t iIdx = 0;
+    for (uint32_t i = 0; i < vSingle.size(); i++)
+    {
+        vSingle[i].m_hScheme = hScheme;
+        vSingle[i].m_Cid = CoinID(7 + i, 500 + i, Key::Type::Regular);
+        tkk.InvokeAsync(vSingle[i], fnHandler(iIdx++));
+
+        if (i == 5)
+        {
+            for (uint32_t j = 0; j < mB2.m_vOutputs.size(); j++)
+            {
+                mB2.m_vOutputs[j].m_hScheme = hScheme;
+                mB2.m_vOutputs[j].m_Cid = CoinID(20 + j, 600 + j, Key::Type::Change);
+            }
+            tkk.InvokeAsync(mB2, fnHandler(iIdx++));
+        }
+    }
+
+    // split with many coins (the blinding factors are aggregated in parallel)
+    mSplit.m_pKernel.reset(new TxKernelStd);
+    mSplit.m_pKernel->m_Fee = 100;
+    mSplit.m_pKernel->m_Height.m_Min = hScheme;
+    mSplit.m_pKernel->m_Height.m_Max = hScheme + 100;
+    for (uint32_t i = 0; i < 10; i++)
+        mSplit.m_vInputs.push_back(CoinID(1000, 700 + i, Key::Type::Regular));
+    for (uint32_t i = 0; i < 9; i++)
+        mSplit.m_vOutputs.push_back(CoinID(1000, 800 + i, Key::Type::Regular));
+    mSplit.m_vOutputs.push_back(CoinID(900, 900, Key::Type::Change));
+    tkk.InvokeAsync(mSplit, fnHandler(iIdx++));
+
+    mainReactor->run();
+
+    WALLET_CHECK(vOrder.size() == nTotal);
+    for (uint32_t i = 0; i < vOrder.size(); i++)
+        WALLET_CHECK(vOrder[i] == i);
+
+    for (const auto& m : mB2.m_vOutputs)
+    {
+        Point::Native comm;
+        WALLET_CHECK(m.m_pResult && m.m_pResult->IsValid(hScheme, comm));
+    }
+
+    Point::Native exc;
+    mSplit.m_pKernel->UpdateID();
+    WALLET_CHECK(mSplit.m_pKernel->IsValid(hScheme, exc));
+}
+
 void TestArgumentParsing()
 {
     struct MyProcessor : bvm2::ProcessorManager
@@ -4744,6 +4964,7 @@ int main()
     //GenerateTreasury(100, 100, 100000000);
     TestTxList();
     TestKeyKeeper();
+    TestKeyKeeperBatch();
 
     TestVouchers();
 
@@ -4802,6 +5023,7 @@ int main()
     Rules::get().pForks[3].m_Height = 1;
     Rules::get().pForks[4].m_Height = 1;
     Rules::get().UpdateChecksum();
+    TestAppShaderCache();
     TestAppShader1();
     TestAppShader2();
     TestAppShader3();